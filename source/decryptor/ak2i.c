@@ -22,6 +22,8 @@
 #define AK2I_PATCH_LENGTH 0x20000
 #define AK2I_PAYLOAD_OFFSET 0x2000
 #define AK2I_PAYLOAD_LENGTH 0x1000
+#define AK2I_FLASH_BLOCK_SIZE 0x10000
+#define AK2I_FLASH_PAGE_SIZE 0x200
 
 unsigned short crc16tab[] =
 {
@@ -436,24 +438,22 @@ u32 DumpAk2iCart(u32 param)
     Debug("Dump flash... (length 0x%08X)", length);
 
     // TODO select filename
-    DebugFileCreate("ak2i_flash.bin", true);
-    u8 *tmp = mem;
-    for( u32 i = 0, offset = 0, read = 0; i < length; i += 512 ) {
-        ShowProgress(i, length);
-        u32 toRead = 512;
-        if( toRead > length - i )
-            toRead = length - i;
-        memset(tmp, 0, toRead);
-        AK2I_CmdReadFlash(i, tmp, toRead);
-        read += toRead;
-        tmp += 512;
-        if (toRead < 512 || (read % 0x8000) == 0) {
-            DebugFileWrite(mem, read, offset);
-            offset += read;
-            read = 0;
-            tmp = mem;
+    // flash is read in pages, but written to SD in big chunks
+    u32 chunk = BUFFER_MAX_SIZE - 0x10000;
+    if (!DebugFileCreate("ak2i_flash.bin", true))
+        return 1;
+    for (u32 offset = 0; offset < length; offset += chunk) {
+        u32 size = min(chunk, length - offset);
+        for (u32 i = 0; i < size; i += AK2I_FLASH_PAGE_SIZE) {
+            ShowProgress(offset + i, length);
+            AK2I_CmdReadFlash(offset + i, mem + i, min(AK2I_FLASH_PAGE_SIZE, size - i));
+        }
+        if (!DebugFileWrite(mem, size, offset)) {
+            FileClose();
+            return 1;
         }
     }
+    FileClose();
     ShowProgress(0, 0);
 
     Debug("Done");
@@ -578,6 +578,52 @@ int32_t patchBootrom(u8* bootrom, const struct ntrcardhax_info *info) {
     return 0;
 }
 
+static u32 FlashAk2iBlocks(u32 hwVer, u8* data, u32 length)
+{
+    // only blocks that differ get erased and programmed, each one is verified right away
+    u8* block = BUFFER_ADDRESS; // allow using AK2I_FLASH_BLOCK_SIZE byte
+    u32 n_flashed = 0;
+    
+    for (u32 offset = 0; offset < length; offset += AK2I_FLASH_BLOCK_SIZE) {
+        u32 size = min(AK2I_FLASH_BLOCK_SIZE, length - offset);
+        u8* src = data + offset;
+        ShowProgress(offset, length);
+        for (u32 i = 0; i < size; i += AK2I_FLASH_PAGE_SIZE)
+            AK2I_CmdReadFlash(offset + i, block + i, min(AK2I_FLASH_PAGE_SIZE, size - i));
+        if (memcmp(block, src, size) == 0)
+            continue;
+        
+        if (hwVer == 0x81) {
+            AK2I_CmdEraseFlashBlock_81(offset);
+        } else {
+            AK2I_CmdEraseFlashBlock_44(offset);
+        }
+        // erased flash reads 0xFF, pages that stay that way don't need programming
+        memset(block, 0xFF, AK2I_FLASH_PAGE_SIZE);
+        for (u32 i = 0; i < size; i += AK2I_FLASH_PAGE_SIZE) {
+            u32 page_size = min(AK2I_FLASH_PAGE_SIZE, size - i);
+            if (memcmp(block, src + i, page_size) == 0)
+                continue;
+            if (hwVer == 0x81) {
+                AK2I_CmdWriteFlash_81(offset + i, src + i, page_size);
+            } else {
+                AK2I_CmdWriteFlash_44(offset + i, src + i, page_size);
+            }
+        }
+        if (!AK2I_CmdVerifyFlash(src, offset, size)) {
+            Debug("verify failed at %08X", offset);
+            ShowProgress(0, 0);
+            return 1;
+        }
+        n_flashed++;
+    }
+    ShowProgress(0, 0);
+    
+    Debug("%lu of %lu blocks flashed", n_flashed, (length + AK2I_FLASH_BLOCK_SIZE - 1) / AK2I_FLASH_BLOCK_SIZE);
+    
+    return 0;
+}
+
 u32 InjectAk2iCart(u32 param)
 {
     (void) param; // unused here
@@ -644,36 +690,18 @@ u32 InjectAk2iCart(u32 param)
     // unlock 0x30000 for save map, see definition of NOR_FAT2_START above
     AK2I_CmdUnlockASIC();
 
-    Debug("Erase flash");
-    for (u32 i = 0; i < AK2I_PATCH_LENGTH; i += 64 * 1024) {
-        if (hwVer == 0x81) {
-            AK2I_CmdEraseFlashBlock_81(i);
-        } else {
-            AK2I_CmdEraseFlashBlock_44(i);
-        }
-    }
     //ioAK2EraseFlash( 0, CHIP_ERASE );
 
     //buffer[0x200C] = 'B';
 
     Debug("Writing...");
-
-    for( u32 i = 0; i < AK2I_PATCH_LENGTH; i += 512 ) {
-        ShowProgress(i, AK2I_PATCH_LENGTH);
-        if (hwVer == 0x81) {
-            AK2I_CmdWriteFlash_81(i, buffer + i, 512);
-        } else {
-            AK2I_CmdWriteFlash_44(i, buffer + i, 512);
-        }
-
-        if (!AK2I_CmdVerifyFlash(buffer + i, i, 512)) {
-            Debug("verify failed at %08X", i);
-        }
-    }
-    ShowProgress(0, 0);
+    u32 result = FlashAk2iBlocks(hwVer, buffer, AK2I_PATCH_LENGTH);
 
     Debug("Lock flash");
     AK2i_CmdLockFlash();
+    
+    if (result != 0)
+        return result;
 
 //    AK2I_CmdSetMapTableAddress(AK2I_MTN_NOR_OFFSET, 0);
 //
@@ -0,0 +1,92 @@
+#include "fs.h"
+#include "draw.h"
+#include "decryptor/sha.h"
+#include "decryptor/checkpoint.h"
+
+#define CKP_MAGIC   "D9CK"
+#define CKP_VERSION 1
+
+static CheckpointInfo checkpoint;
+static char ckpname[64 + 4] = { 0 };
+static u64 last_written = 0;
+
+
+u64 CheckpointOpen(const char* filename, const u8* source_id, u64 size, u32 param)
+{
+    // returns the offset to resume from, zero means start from scratch
+    CheckpointInfo stored;
+    
+    snprintf(ckpname, 64 + 4, "%s.ckp", filename);
+    memset(&checkpoint, 0x00, sizeof(CheckpointInfo));
+    memcpy(checkpoint.magic, CKP_MAGIC, 4);
+    checkpoint.version = CKP_VERSION;
+    memcpy(checkpoint.source_id, source_id, 32);
+    checkpoint.size = size;
+    checkpoint.param = param;
+    last_written = 0;
+    
+    if ((FileGetData(ckpname, &stored, sizeof(CheckpointInfo), 0) != sizeof(CheckpointInfo)) ||
+        (memcmp(stored.magic, CKP_MAGIC, 4) != 0) || (stored.version != CKP_VERSION) ||
+        (memcmp(stored.source_id, source_id, 32) != 0) || (stored.size != size) ||
+        (stored.param != param) || (stored.offset >= size))
+        return 0;
+    
+    // the output file has to hold at least everything up to the checkpoint
+    if (!FileOpen(filename))
+        return 0;
+    if (FileGetSize() < stored.offset) {
+        FileClose();
+        return 0;
+    }
+    FileClose();
+    
+    checkpoint.offset = last_written = stored.offset;
+    return stored.offset;
+}
+
+u32 CheckpointUpdate(u64 offset)
+{
+    // only call this after the data up to offset has been written (FileWrite() syncs)
+    checkpoint.offset = offset;
+    if (offset < last_written + CKP_INTERVAL)
+        return 0;
+    if (FileDumpData(ckpname, &checkpoint, sizeof(CheckpointInfo)) != sizeof(CheckpointInfo))
+        return 1;
+    last_written = offset;
+    
+    return 0;
+}
+
+void CheckpointClose(bool done)
+{
+    if (!*ckpname)
+        return;
+    if (done) {
+        FileDelete(ckpname);
+    } else if (checkpoint.offset) {
+        FileDumpData(ckpname, &checkpoint, sizeof(CheckpointInfo));
+        Debug("Checkpoint stored at %lluMB, restart to resume", checkpoint.offset / 0x100000);
+    }
+    *ckpname = '\0';
+}
+
+u32 CheckpointRehash(u64 offset)
+{
+    // the SHA engine state can't be saved, so rebuild it from the opened file
+    // this assumes the output file to be open, careful, uses standard buffer
+    u8* buffer = BUFFER_ADDRESS;
+    
+    sha_init(SHA256_MODE);
+    for (u64 i = 0; i < offset; i += BUFFER_MAX_SIZE) {
+        u32 read_bytes = min(BUFFER_MAX_SIZE, (offset - i));
+        ShowProgress(i, offset);
+        if (FileRead(buffer, read_bytes, i) != read_bytes) {
+            ShowProgress(0, 0);
+            return 1;
+        }
+        sha_update(buffer, read_bytes);
+    }
+    ShowProgress(0, 0);
+    
+    return 0;
+}
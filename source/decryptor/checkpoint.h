@@ -0,0 +1,21 @@
+#pragma once
+
+#include "common.h"
+
+// checkpoints are written at most once per this many bytes
+#define CKP_INTERVAL    (16 * 1024 * 1024)
+
+// on-SD checkpoint record, stored as <output>.ckp next to the output file
+typedef struct {
+    char magic[4];      // "D9CK"
+    u32  version;
+    u8   source_id[32]; // SHA-256 over the source identity (CID / cart ID + header)
+    u64  size;          // full size of the dump
+    u64  offset;        // last committed (already synced to SD) offset
+    u32  param;         // parameters the dump was started with
+} __attribute__((packed)) CheckpointInfo;
+
+u64 CheckpointOpen(const char* filename, const u8* source_id, u64 size, u32 param);
+u32 CheckpointUpdate(u64 offset);
+void CheckpointClose(bool done);
+u32 CheckpointRehash(u64 offset);
@@ -0,0 +1,232 @@
+#include "fs.h"
+#include "draw.h"
+#include "decryptor/aes.h"
+#include "decryptor/decryptor.h"
+#include "decryptor/game.h"
+#include "decryptor/nand.h"
+#include "decryptor/titlekey.h"
+#include "decryptor/cryptstream.h"
+
+
+static void CryptStreamInit(CryptStream* stream, const char* filename, u32 offset)
+{
+    memset(stream, 0x00, sizeof(CryptStream) - sizeof(stream->cache));
+    if (filename)
+        strncpy(stream->filename, filename, 255);
+    stream->offset = offset;
+    for (u32 i = 0; i < CS_CACHE_BLOCKS; i++)
+        stream->cache_offset[i] = (u32) -1;
+}
+
+static u32 CryptStreamDecrypt(CryptStream* stream, CryptStreamRegion* region, u8* buf, u32 offset, u32 size)
+{
+    // decrypts the part of region inside [offset, offset + size), buf holds that range
+    if ((region->offset >= offset + size) || (region->offset + region->size <= offset))
+        return 0;
+    u32 r_start = max(region->offset, offset);
+    u32 r_end = min(region->offset + region->size, offset + size);
+    CryptBufferInfo info = region->info;
+    if ((info.mode & (0x7 << 27)) == AES_CBC_DECRYPT_MODE) {
+        // CBC: the IV is the previous encrypted block
+        if ((r_start > region->offset) && (FileGetData(stream->filename, info.ctr, 16, stream->offset + r_start - 16) != 16))
+            return 1;
+    } else add_ctr(info.ctr, (r_start - region->offset) / 0x10);
+    if (region->use_key)
+        setup_aeskey(info.keyslot, region->key);
+    info.buffer = buf + (r_start - offset);
+    info.size = r_end - r_start;
+    CryptBuffer(&info);
+    
+    return 0;
+}
+
+static u32 CryptStreamLoad(CryptStream* stream, u8* buf, u32 offset, u32 size)
+{
+    // reads and decrypts stream data, offset has to be 16 byte aligned
+    // (NAND: offset and size have to be sector aligned, NAND has its own crypto)
+    if (stream->partition)
+        return DecryptNandToMem(buf, stream->partition->offset + offset, size, stream->partition);
+    if (FileGetData(stream->filename, buf, size, stream->offset + offset) != size)
+        return 1;
+    if (stream->use_layer && (CryptStreamDecrypt(stream, &(stream->layer), buf, offset, size) != 0))
+        return 1;
+    for (u32 i = 0; i < stream->n_regions; i++)
+        if (CryptStreamDecrypt(stream, stream->regions + i, buf, offset, size) != 0)
+            return 1;
+    
+    return 0;
+}
+
+static u8* CryptStreamGetBlock(CryptStream* stream, u32 offset)
+{
+    // returns the decrypted block at offset, from cache if possible
+    u32 slot;
+    for (slot = 0; slot < CS_CACHE_BLOCKS; slot++)
+        if (stream->cache_offset[slot] == offset)
+            return stream->cache[slot];
+    slot = stream->cache_next;
+    stream->cache_next = (slot + 1) % CS_CACHE_BLOCKS;
+    stream->cache_offset[slot] = (u32) -1;
+    if (CryptStreamLoad(stream, stream->cache[slot], offset, min(CS_BLOCK_SIZE, stream->size - offset)) != 0)
+        return NULL;
+    stream->cache_offset[slot] = offset;
+    return stream->cache[slot];
+}
+
+static u32 CryptStreamSetupNcch(CryptStream* stream, u64 seedId)
+{
+    // NCCH regions on top of an opened stream, reads go through the titlekey layer (if any)
+    __attribute__((aligned(16))) NcchHeader ncch;
+    __attribute__((aligned(16))) u8 exefs_hdr[0x200];
+    NcchCryptRegion plan[NCCH_PLAN_MAX];
+    CryptBufferInfo info0;
+    CryptBufferInfo info1;
+    u8 fixed_key[16];
+    u32 n_regions = 0;
+    
+    if ((CryptStreamLoad(stream, (u8*) &ncch, 0, 0x200) != 0) || (memcmp(ncch.magic, "NCCH", 4) != 0))
+        return 1;
+    stream->size = ncch.size * 0x200;
+    if (ncch.flags[7] & 0x04)
+        return 0; // not encrypted, nothing to do
+    
+    if (seedId == 0) seedId = ncch.programId;
+    if (SetupNcchCrypto(&ncch, seedId, &info0, &info1, fixed_key) != 0)
+        return 1;
+    
+    // the ExeFS header is needed in plain for the special ExeFS crypto
+    bool split_exefs = (info0.keyslot != info1.keyslot) || (memcmp(info0.keyY, info1.keyY, 16) != 0);
+    if ((ncch.size_exefs > 0) && split_exefs) {
+        CryptBufferInfo info = info0;
+        if (CryptStreamLoad(stream, exefs_hdr, ncch.offset_exefs * 0x200, 0x200) != 0)
+            return 1;
+        GetNcchCtr(info.ctr, &ncch, 2);
+        info.buffer = exefs_hdr;
+        info.size = 0x200;
+        CryptBuffer(&info);
+    }
+    if (GetNcchCryptPlan(plan, &n_regions, &ncch, exefs_hdr, split_exefs) != 0)
+        return 1;
+    
+    for (u32 i = 0; i < n_regions; i++) {
+        CryptStreamRegion* region = stream->regions + i;
+        region->offset = plan[i].offset;
+        region->size = plan[i].size;
+        region->info = (plan[i].key_id) ? info1 : info0;
+        memcpy(region->info.ctr, plan[i].ctr, 16);
+        if ((region->use_key = (region->info.keyslot == 0x11)))
+            memcpy(region->key, fixed_key, 16);
+    }
+    stream->n_regions = n_regions;
+    
+    return 0;
+}
+
+u32 CryptStreamOpenNcch(CryptStream* stream, const char* filename, u32 offset, u64 seedId)
+{
+    CryptStreamInit(stream, filename, offset);
+    return CryptStreamSetupNcch(stream, seedId);
+}
+
+u32 CryptStreamOpenCia(CryptStream* stream, const char* filename, u32 content_index)
+{
+    // content_index is the position in the TMD content list
+    u8* buffer = (u8*) 0x20316600;
+    TitleKeyEntry titlekeyEntry;
+    CiaInfo cia;
+    
+    CryptStreamInit(stream, filename, 0);
+    if ((FileGetData(filename, buffer, 0x20, 0) != 0x20) || (GetCiaInfo(&cia, (CiaHeader*) buffer) != 0) ||
+        (cia.size_ticktmd > 0x10000) || (cia.size_ticket != 0x140 + 0x210))
+        return 1;
+    if (FileGetData(filename, buffer, cia.size_ticktmd, cia.offset_ticktmd) != cia.size_ticktmd)
+        return 1;
+    
+    Ticket* ticket = (Ticket*) buffer;
+    TitleMetaData* tmd = (TitleMetaData*) (buffer + align(cia.size_ticket, 64));
+    TmdContentChunk* content_list = (TmdContentChunk*) (tmd + 1);
+    u32 content_count = getbe16(tmd->content_count);
+    if ((content_index >= content_count) || (content_count * 0x30 != cia.size_tmd - (0x140 + 0xC4 + (64 * 0x24))))
+        return 1;
+    
+    // find the content
+    u64 offset = cia.offset_content;
+    for (u32 i = 0; i < content_index; i++)
+        offset += getbe64(content_list[i].size);
+    stream->offset = offset;
+    stream->size = getbe64(content_list[content_index].size);
+    if (!(content_list[content_index].type[1] & 0x1))
+        return 0; // not encrypted, nothing to do
+    
+    // extract & decrypt titlekey
+    memcpy(titlekeyEntry.titleId, ticket->title_id, 8);
+    memcpy(titlekeyEntry.titleKey, ticket->titlekey, 16);
+    titlekeyEntry.commonKeyIndex = ticket->commonkey_idx;
+    CryptTitlekey(&titlekeyEntry, false);
+    
+    CryptStreamRegion* region = stream->regions;
+    region->offset = 0;
+    region->size = stream->size;
+    region->use_key = 1;
+    memcpy(region->key, titlekeyEntry.titleKey, 16);
+    region->info = (CryptBufferInfo) {.setKeyY = 0, .keyslot = 0x11, .mode = AES_CNT_TITLEKEY_DECRYPT_MODE};
+    memcpy(region->info.ctr, content_list[content_index].index, 2);
+    stream->n_regions = 1;
+    
+    return 0;
+}
+
+u32 CryptStreamOpenCiaNcch(CryptStream* stream, const char* filename, u32 content_index, u64 seedId)
+{
+    // NCCH inside a CIA content, the titlekey layer (if still there) goes below the NCCH crypto
+    if (CryptStreamOpenCia(stream, filename, content_index) != 0)
+        return 1;
+    if (stream->n_regions) {
+        stream->layer = stream->regions[0];
+        stream->use_layer = 1;
+        stream->n_regions = 0;
+    }
+    
+    return CryptStreamSetupNcch(stream, seedId);
+}
+
+u32 CryptStreamOpenNand(CryptStream* stream, u32 partition_id)
+{
+    CryptStreamInit(stream, NULL, 0);
+    stream->partition = GetPartitionInfo(partition_id);
+    if (!stream->partition)
+        return 1;
+    stream->size = stream->partition->size;
+    
+    return 0;
+}
+
+u32 CryptStreamRead(CryptStream* stream, void* buf, u32 offset, u32 size)
+{
+    u8* out = (u8*) buf;
+    
+    if ((offset > stream->size) || (size > stream->size - offset))
+        return 1;
+    
+    while (size) {
+        u32 skip = offset % CS_BLOCK_SIZE;
+        u32 read_bytes;
+        if (!skip && (size >= CS_BLOCK_SIZE) && !((uintptr_t) out & 0x3)) {
+            // full blocks go straight to the output, bypassing the cache
+            read_bytes = size - (size % CS_BLOCK_SIZE);
+            if (CryptStreamLoad(stream, out, offset, read_bytes) != 0)
+                return 1;
+        } else {
+            u8* block = CryptStreamGetBlock(stream, offset - skip);
+            if (!block)
+                return 1;
+            read_bytes = min(CS_BLOCK_SIZE - skip, size);
+            memcpy(out, block + skip, read_bytes);
+        }
+        out += read_bytes;
+        offset += read_bytes;
+        size -= read_bytes;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common.h"
+#include "decryptor/decryptor.h"
+#include "decryptor/nand.h"
+
+#define CS_MAX_REGIONS  16
+#define CS_BLOCK_SIZE   0x1000
+#define CS_CACHE_BLOCKS 8
+
+// one encrypted region of a stream, offset is relative to the stream start
+typedef struct {
+    u32 offset;
+    u32 size;
+    u32 use_key; // normal key has to be set up before use
+    u8  key[16];
+    CryptBufferInfo info; // keyslot, keyY, mode and CTR / IV at the region start
+} __attribute__((packed)) CryptStreamRegion;
+
+// decrypted view of an encrypted container, place this in free memory (~33kB)
+typedef struct {
+    char filename[256];
+    u32 offset; // stream start inside the file
+    u32 size;
+    PartitionInfo* partition; // NAND partition streams only
+    u32 use_layer; // titlekey layer below the regions (NCCHs in encrypted CIA contents)
+    CryptStreamRegion layer;
+    u32 n_regions;
+    CryptStreamRegion regions[CS_MAX_REGIONS];
+    u32 cache_offset[CS_CACHE_BLOCKS]; // (u32) -1 for unused blocks
+    u32 cache_next;
+    u8  cache[CS_CACHE_BLOCKS][CS_BLOCK_SIZE];
+} CryptStream;
+
+u32 CryptStreamOpenNcch(CryptStream* stream, const char* filename, u32 offset, u64 seedId);
+u32 CryptStreamOpenCia(CryptStream* stream, const char* filename, u32 content_index);
+u32 CryptStreamOpenCiaNcch(CryptStream* stream, const char* filename, u32 content_index, u64 seedId);
+u32 CryptStreamOpenNand(CryptStream* stream, u32 partition_id);
+u32 CryptStreamRead(CryptStream* stream, void* buf, u32 offset, u32 size);
@@ -10,6 +10,7 @@
 #include "decryptor/sha.h"
 #include "decryptor/decryptor.h"
 #include "decryptor/hashfile.h"
+#include "decryptor/checkpoint.h"
 #include "decryptor/keys.h"
 #include "decryptor/titlekey.h"
 #include "decryptor/nandfat.h"
@@ -18,6 +19,9 @@
 
 #define CART_CHUNK_SIZE (u32) (1*1024*1024)
 
+// cart reads use 4KB pages where possible, if the cart supports them
+static bool cart_large_pages = false;
+
 
 u32 GetSdCtr(u8* ctr, const char* path)
 {
@@ -239,60 +243,182 @@ u32 VerifyNcch(const char* filename, u32 offset)
     return (((ver_exthdr | ver_exefs | ver_romfs) & 1) == 0) ? 0 : 1;
 }
 
-u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encrypt_flags)
+u32 GetNcchCryptPlan(NcchCryptRegion* plan, u32* n_regions, NcchHeader* ncch, u8* exefs_hdr, bool split_exefs)
 {
-    NcchHeader* ncch = (NcchHeader*) 0x20316200;
-    u8* buffer = (u8*) 0x20316400;
-    CryptBufferInfo info0 = {.setKeyY = 1, .keyslot = 0x2C, .mode = AES_CNT_CTRNAND_MODE};
-    CryptBufferInfo info1 = {.setKeyY = 1, .mode = AES_CNT_CTRNAND_MODE};
-    u8 seedKeyY[16] = { 0x00 };
-    u32 result = 0;
+    // lists all encrypted regions of a NCCH, sorted by offset
+    // exefs_hdr has to be the plain ExeFS header (only needed for split_exefs)
+    u32 n = 0;
     
-    if (FileGetData(filename, (void*) ncch, 0x200, offset) != 0x200)
-        return 1; // it's impossible to fail here anyways
- 
-    // check (again) for magic number
-    if (memcmp(ncch->magic, "NCCH", 4) != 0) {
-        Debug("Not a NCCH container");
-        return 2; // not an actual error
+    // ExHeader
+    if (ncch->size_exthdr > 0) {
+        plan[n] = (NcchCryptRegion) {.offset = 0x200, .size = 0x800, .key_id = 0};
+        GetNcchCtr(plan[n++].ctr, ncch, 1);
     }
     
-    // size plausibility check
-    u32 size_sum = 0x200 + ((ncch->size_exthdr) ? 0x800 : 0x0) + 0x200 *
-        (ncch->size_plain + ncch->size_logo + ncch->size_exefs + ncch->size_romfs);
-    if (ncch->size * 0x200 < size_sum) {
-        Debug("Probably not a NCCH container");
-        return 2; // not an actual error
-    }        
+    // ExeFS
+    if ((ncch->size_exefs > 0) && split_exefs) {
+        u32 offset_exefs = ncch->offset_exefs * 0x200;
+        plan[n] = (NcchCryptRegion) {.offset = offset_exefs, .size = 0x200, .key_id = 0};
+        GetNcchCtr(plan[n++].ctr, ncch, 2);
+        // special ExeFS crypto ("banner" and "icon" use standard crypto)
+        for (u32 i = 0; i < 10; i++) {
+            char* name_exefs_file = (char*) exefs_hdr + (i*0x10);
+            u32 offset_exefs_file = getle32(exefs_hdr + (i*0x10) + 0x8) + 0x200;
+            u32 size_exefs_file = align(getle32(exefs_hdr + (i*0x10) + 0xC), 0x200);
+            if (size_exefs_file == 0)
+                continue;
+            if (offset_exefs_file % 16)
+                return 1; // this should not happen
+            NcchCryptRegion* region = plan + n++;
+            region->offset = offset_exefs + offset_exefs_file;
+            region->size = size_exefs_file;
+            region->key_id = ((strncmp(name_exefs_file, "banner", 8) == 0) ||
+                (strncmp(name_exefs_file, "icon", 8) == 0)) ? 0 : 1;
+            GetNcchCtr(region->ctr, ncch, 2);
+            add_ctr(region->ctr, offset_exefs_file / 0x10);
+        }
+    } else if (ncch->size_exefs > 0) {
+        plan[n] = (NcchCryptRegion) {.offset = ncch->offset_exefs * 0x200, .size = ncch->size_exefs * 0x200, .key_id = 0};
+        GetNcchCtr(plan[n++].ctr, ncch, 2);
+    }
+    
+    // RomFS
+    if (ncch->size_romfs > 0) {
+        plan[n] = (NcchCryptRegion) {.offset = ncch->offset_romfs * 0x200, .size = ncch->size_romfs * 0x200, .key_id = 1};
+        GetNcchCtr(plan[n++].ctr, ncch, 3);
+    }
     
-    // check if encrypted
-    if (!encrypt_flags && (ncch->flags[7] & 0x04)) {
-        Debug("NCCH is not encrypted");
-        return 2; // not an actual error
-    } else if (encrypt_flags && !(ncch->flags[7] & 0x04)) {
-        Debug("NCCH is already encrypted");
-        return 2; // not an actual error
-    } else if (encrypt_flags && (encrypt_flags[7] & 0x04)) {
-        Debug("Nothing to do!");
-        return 2; // not an actual error
+    // insertion sort, regions are usually in order already
+    for (u32 i = 1; i < n; i++) {
+        NcchCryptRegion region = plan[i];
+        u32 j = i;
+        for (; (j > 0) && (plan[j-1].offset > region.offset); j--)
+            plan[j] = plan[j-1];
+        plan[j] = region;
     }
     
-    // check size
-    if ((size > 0) && (ncch->size * 0x200 > size)) {
-        Debug("NCCH size is out of bounds");
+    // regions must not overlap
+    for (u32 i = 1; i < n; i++)
+        if (plan[i-1].offset + plan[i-1].size > plan[i].offset)
+            return 1;
+    
+    *n_regions = n;
+    return 0;
+}
+
+static void CryptNcchChunk(u8* buffer, u32 pos, u32 size, NcchCryptRegion* plan, u32 n_regions, CryptBufferInfo* info0, CryptBufferInfo* info1)
+{
+    // applies all plan regions overlapping the chunk at pos
+    for (u32 j = 0; (j < n_regions) && (plan[j].offset < pos + size); j++) {
+        if (plan[j].offset + plan[j].size <= pos)
+            continue;
+        u32 r_start = max(plan[j].offset, pos);
+        u32 r_end = min(plan[j].offset + plan[j].size, pos + size);
+        CryptBufferInfo info = *((plan[j].key_id) ? info1 : info0);
+        memcpy(info.ctr, plan[j].ctr, 16);
+        add_ctr(info.ctr, (r_start - plan[j].offset) / 0x10);
+        info.buffer = buffer + (r_start - pos);
+        info.size = r_end - r_start;
+        CryptBuffer(&info);
+    }
+}
+
+static u32 CryptNcchRegionsTo(const char* filename, const char* destname, u32 offset, u32 size, NcchCryptRegion* plan, u32 n_regions, CryptBufferInfo* info0, CryptBufferInfo* info1, NcchHeader* ncch)
+{
+    // out of place version of CryptNcchRegions()
+    // the whole NCCH (size == 0: up to the end of the file) is written to destname, including the new header
+    // also usable for plain copies with n_regions == 0
+    u8* buffer = BUFFER_ADDRESS;
+    u32 result = 0;
+    
+    if (!FileOpen(filename)) 
+        return 1;
+    if (!size) size = FileGetSize() - offset;
+    if (!OutFileCreate(destname, size)) {
+        Debug("Could not create %s.tmp", destname);
+        FileClose();
         return 1;
     }
     
-    // select correct title ID for seed crypto
-    if (seedId == 0) seedId = ncch->programId;
+    for (u32 pos = 0; pos < size; pos += BUFFER_MAX_SIZE) {
+        u32 read_bytes = min(BUFFER_MAX_SIZE, size - pos);
+        ShowProgress(pos, size);
+        if(!DebugFileRead(buffer, read_bytes, offset + pos)) {
+            result = 1;
+            break;
+        }
+        CryptNcchChunk(buffer, pos, read_bytes, plan, n_regions, info0, info1);
+        if (pos == 0)
+            memcpy(buffer, ncch, 0x200);
+        if (OutFileAppend(buffer, read_bytes) != read_bytes) {
+            Debug("SD failure or SD full");
+            result = 1;
+            break;
+        }
+    }
     
-    // copy over encryption parameters (if applicable)
-    if (encrypt_flags) {
-        ncch->flags[3] = encrypt_flags[3];
-        ncch->flags[7] &= (0x01|0x20|0x04)^0xFF;
-        ncch->flags[7] |= (0x01|0x20)&encrypt_flags[7];
+    ShowProgress(0, 0);
+    FileClose();
+    if (result != 0) {
+        OutFileAbort();
+    } else if (!OutFileCommit()) {
+        Debug("Could not replace %s", destname);
+        result = 1;
     }
     
+    return result;
+}
+
+static u32 CryptNcchRegions(const char* filename, u32 offset, NcchCryptRegion* plan, u32 n_regions, CryptBufferInfo* info0, CryptBufferInfo* info1)
+{
+    // applies a NCCH crypto plan in one sequential pass, gaps are skipped
+    u8* buffer = BUFFER_ADDRESS;
+    u32 start = plan[0].offset;
+    u32 end = plan[n_regions-1].offset + plan[n_regions-1].size;
+    u32 result = 0;
+    
+    // no DebugFileOpen() - at this point the file has already been checked enough
+    if (!FileOpen(filename)) 
+        return 1;
+    
+    u32 r = 0;
+    for (u32 pos = start; pos < end;) {
+        // skip to the next region if in a gap
+        while (plan[r].offset + plan[r].size <= pos)
+            r++;
+        if (plan[r].offset > pos)
+            pos = plan[r].offset;
+        // chunks end at gaps, not read / written needlessly
+        u32 read_bytes = 0;
+        for (u32 j = r; (j < n_regions) && (plan[j].offset <= pos + read_bytes) && (read_bytes < BUFFER_MAX_SIZE); j++)
+            read_bytes = min(BUFFER_MAX_SIZE, plan[j].offset + plan[j].size - pos);
+        ShowProgress(pos - start, end - start);
+        if(!DebugFileRead(buffer, read_bytes, offset + pos)) {
+            result = 1;
+            break;
+        }
+        CryptNcchChunk(buffer, pos, read_bytes, plan + r, n_regions - r, info0, info1);
+        if(!DebugFileWrite(buffer, read_bytes, offset + pos)) {
+            result = 1;
+            break;
+        }
+        pos += read_bytes;
+    }
+    
+    ShowProgress(0, 0);
+    FileClose();
+    
+    return result;
+}
+
+u32 SetupNcchCrypto(NcchHeader* ncch, u64 seedId, CryptBufferInfo* info0, CryptBufferInfo* info1, u8* fixed_key)
+{
+    // info0 is for standard crypto regions, info1 for 7x / seed crypto regions
+    // fixed_key receives the normal key for slot 0x11 (if used and provided)
+    u8 seedKeyY[16] = { 0x00 };
+    *info0 = (CryptBufferInfo) {.setKeyY = 1, .keyslot = 0x2C, .mode = AES_CNT_CTRNAND_MODE};
+    *info1 = (CryptBufferInfo) {.setKeyY = 1, .mode = AES_CNT_CTRNAND_MODE};
+    
     // check crypto type
     bool uses7xCrypto = ncch->flags[3];
     bool usesSeedCrypto = ncch->flags[7] & 0x20;
@@ -308,9 +434,11 @@ u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encryp
         u8 zeroKey[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
         u8 sysKey[16]  = {0x52, 0x7C, 0xE6, 0x30, 0xA9, 0xCA, 0x30, 0x5F, 0x36, 0x96, 0xF3, 0xCD, 0xE9, 0x54, 0x19, 0x4B};
         uses7xCrypto = usesSeedCrypto = usesSec3Crypto = usesSec4Crypto = false;
-        info1.setKeyY = info0.setKeyY = 0;
-        info1.keyslot = info0.keyslot = 0x11;
+        info1->setKeyY = info0->setKeyY = 0;
+        info1->keyslot = info0->keyslot = 0x11;
         setup_aeskey(0x11, (ncch->programId & ((u64) 0x10 << 32)) ? sysKey : zeroKey);
+        if (fixed_key)
+            memcpy(fixed_key, (ncch->programId & ((u64) 0x10 << 32)) ? sysKey : zeroKey, 16);
     }
     
     // check 7x crypto
@@ -338,26 +466,13 @@ u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encryp
     if (usesSeedCrypto) {
         u8 seed[16];
         u32 found = 0;
-        if (FindSeedInSeedSave(seed, seedId, ncch->hash_seed) == 0) { // try loading from NAND
-            Debug("Loading seed from NAND: ok");
+        if (FindSeed(seed, seedId, NULL) == 0) { // seeddb.bin & NAND seedsave
+            Debug("Loading seed: ok");
             found = 1;
-        } else if (FileOpen("seeddb.bin")) { // try loading from seeddb.bin
-            SeedInfoEntry* entry = (SeedInfoEntry*) buffer;
-            for (u32 i = 0x10;; i += 0x20) {
-                if (FileRead(entry, 0x20, i) != 0x20)
-                    break;
-                if (entry->titleId == seedId) {
-                    memcpy(seed, entry->external_seed, 16);
-                    Debug("Loading seed from seeddb.bin: ok");
-                    found = 1;
-                    break;
-                }
-            }
-            FileClose();
         }
         if (found) {
-            // validate seed
-            if (ValidateSeed(seed, seedId, ncch->hash_seed) != 0) {
+            // validate seed (there may be more than one candidate)
+            if (FindSeed(seed, seedId, ncch->hash_seed) != 0) {
                 Debug("Seed found, but validation failed!");
                 Debug("Try fixing your seeddb.bin");
                 return 1;
@@ -377,9 +492,70 @@ u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encryp
     }
     
     // basic setup of CryptBufferInfo structs
-    memcpy(info0.keyY, ncch->signature, 16);
-    memcpy(info1.keyY, (usesSeedCrypto) ? seedKeyY : ncch->signature, 16);
-    info1.keyslot = (usesSec4Crypto) ? 0x1B : ((usesSec3Crypto) ? 0x18 : ((uses7xCrypto) ? 0x25 : info0.keyslot));
+    memcpy(info0->keyY, ncch->signature, 16);
+    memcpy(info1->keyY, (usesSeedCrypto) ? seedKeyY : ncch->signature, 16);
+    info1->keyslot = (usesSec4Crypto) ? 0x1B : ((usesSec3Crypto) ? 0x18 : ((uses7xCrypto) ? 0x25 : info0->keyslot));
+    
+    return 0;
+}
+
+static u32 CryptNcchTo(const char* filename, const char* destname, u32 offset, u32 size, u64 seedId, u8* encrypt_flags)
+{
+    // with destname, the NCCH is written there instead of being processed in place
+    NcchHeader* ncch = (NcchHeader*) 0x20316200;
+    u8* buffer = (u8*) 0x20316400;
+    u32 result = 0;
+    
+    if (FileGetData(filename, (void*) ncch, 0x200, offset) != 0x200)
+        return 1; // it's impossible to fail here anyways
+ 
+    // check (again) for magic number
+    if (memcmp(ncch->magic, "NCCH", 4) != 0) {
+        Debug("Not a NCCH container");
+        return 2; // not an actual error
+    }
+    
+    // size plausibility check
+    u32 size_sum = 0x200 + ((ncch->size_exthdr) ? 0x800 : 0x0) + 0x200 *
+        (ncch->size_plain + ncch->size_logo + ncch->size_exefs + ncch->size_romfs);
+    if (ncch->size * 0x200 < size_sum) {
+        Debug("Probably not a NCCH container");
+        return 2; // not an actual error
+    }        
+    
+    // check if encrypted
+    if (!encrypt_flags && (ncch->flags[7] & 0x04)) {
+        Debug("NCCH is not encrypted");
+        return 2; // not an actual error
+    } else if (encrypt_flags && !(ncch->flags[7] & 0x04)) {
+        Debug("NCCH is already encrypted");
+        return 2; // not an actual error
+    } else if (encrypt_flags && (encrypt_flags[7] & 0x04)) {
+        Debug("Nothing to do!");
+        return 2; // not an actual error
+    }
+    
+    // check size
+    if ((size > 0) && (ncch->size * 0x200 > size)) {
+        Debug("NCCH size is out of bounds");
+        return 1;
+    }
+    
+    // select correct title ID for seed crypto
+    if (seedId == 0) seedId = ncch->programId;
+    
+    // copy over encryption parameters (if applicable)
+    if (encrypt_flags) {
+        ncch->flags[3] = encrypt_flags[3];
+        ncch->flags[7] &= (0x01|0x20|0x04)^0xFF;
+        ncch->flags[7] |= (0x01|0x20)&encrypt_flags[7];
+    }
+    
+    // setup keys for this NCCH
+    CryptBufferInfo info0;
+    CryptBufferInfo info1;
+    if (SetupNcchCrypto(ncch, seedId, &info0, &info1, NULL) != 0)
+        return 1;
     
     Debug("%s ExHdr/ExeFS/RomFS (%ukB/%ukB/%uMB)",
         (encrypt_flags) ? "Encrypt" : "Decrypt",
@@ -387,56 +563,26 @@ u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encryp
         (ncch->size_exefs * 0x200) / 1024,
         (ncch->size_romfs * 0x200) / (1024*1024));
         
-    // process ExHeader
-    if (ncch->size_exthdr > 0) {
-        GetNcchCtr(info0.ctr, ncch, 1);
-        result |= CryptSdToSd(filename, offset + 0x200, 0x800, &info0, true);
-    }
-    
-    // process ExeFS
-    if (ncch->size_exefs > 0) {
-        u32 offset_byte = ncch->offset_exefs * 0x200;
-        u32 size_byte = ncch->size_exefs * 0x200;
-        if (uses7xCrypto || usesSeedCrypto) {
-            GetNcchCtr(info0.ctr, ncch, 2);
-            if (!encrypt_flags) // decrypt this first (when decrypting)
-                result |= CryptSdToSd(filename, offset + offset_byte, 0x200, &info0, true);
-            if (FileGetData(filename, buffer, 0x200, offset + offset_byte) != 0x200) // get exeFS header
-                return 1;
-            if (encrypt_flags) // encrypt this last (when encrypting)
-                result |= CryptSdToSd(filename, offset + offset_byte, 0x200, &info0, true);
-            // special ExeFS decryption routine ("banner" and "icon" use standard crypto)
-            for (u32 i = 0; i < 10; i++) {
-                char* name_exefs_file = (char*) buffer + (i*0x10);
-                u32 offset_exefs_file = getle32(buffer + (i*0x10) + 0x8) + 0x200;
-                u32 size_exefs_file = align(getle32(buffer + (i*0x10) + 0xC), 0x200);
-                CryptBufferInfo* infoExeFs = ((strncmp(name_exefs_file, "banner", 8) == 0) ||
-                    (strncmp(name_exefs_file, "icon", 8) == 0)) ? &info0 : &info1;
-                if (size_exefs_file == 0)
-                    continue;
-                if (offset_exefs_file % 16) {
-                    Debug("ExeFS file offset not aligned!");
-                    result |= 1;
-                    break; // this should not happen
-                }
-                GetNcchCtr(infoExeFs->ctr, ncch, 2);
-                add_ctr(infoExeFs->ctr, offset_exefs_file / 0x10);
-                infoExeFs->setKeyY = 1;
-                result |= CryptSdToSd(filename, offset + offset_byte + offset_exefs_file,
-                    align(size_exefs_file, 16), infoExeFs, true);
-            }
-        } else {
-            GetNcchCtr(info0.ctr, ncch, 2);
-            result |= CryptSdToSd(filename, offset + offset_byte, size_byte, &info0, true);
+    // get the plain ExeFS header, needed for the special ExeFS crypto
+    bool split_exefs = (info0.keyslot != info1.keyslot) || (memcmp(info0.keyY, info1.keyY, 16) != 0);
+    if ((ncch->size_exefs > 0) && split_exefs) {
+        if (FileGetData(filename, buffer, 0x200, offset + (ncch->offset_exefs * 0x200)) != 0x200)
+            return 1;
+        if (!encrypt_flags) { // decrypt a copy (when decrypting)
+            CryptBufferInfo info = info0;
+            GetNcchCtr(info.ctr, ncch, 2);
+            info.buffer = buffer;
+            info.size = 0x200;
+            CryptBuffer(&info);
         }
     }
     
-    // process RomFS
-    if (ncch->size_romfs > 0) {
-        GetNcchCtr(info1.ctr, ncch, 3);
-        if (!usesFixedKey)
-            info1.setKeyY = 1;
-        result |= CryptSdToSd(filename, offset + (ncch->offset_romfs * 0x200), ncch->size_romfs * 0x200, &info1, true);
+    // build the crypto plan, then process everything in one pass
+    NcchCryptRegion plan[NCCH_PLAN_MAX];
+    u32 n_regions = 0;
+    if (GetNcchCryptPlan(plan, &n_regions, ncch, buffer, split_exefs) != 0) {
+        Debug("Bad ExeFS / NCCH layout!");
+        return 1;
     }
     
     // set NCCH header flags
@@ -446,6 +592,17 @@ u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encryp
         ncch->flags[7] |= 0x04;
     }
     
+    // out of place processing, header is included
+    // (without regions, only a copy to another file is needed, the header is rewritten in place)
+    if (destname && (n_regions || (strncmp(destname, filename, 256) != 0))) {
+        result = CryptNcchRegionsTo(filename, destname, offset, (offset) ? ncch->size * 0x200 : 0,
+            plan, n_regions, &info0, &info1, ncch);
+        return ((result == 0) && !encrypt_flags) ? VerifyNcch(destname, 0) : result;
+    }
+    
+    if (n_regions)
+        result |= CryptNcchRegions(filename, offset, plan, n_regions, &info0, &info1);
+    
     // write header back
     if (!FileOpen(filename))
         return 1;
@@ -459,6 +616,57 @@ u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encryp
     return ((result == 0) && !encrypt_flags) ? VerifyNcch(filename, offset) : result;
 }
 
+u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encrypt_flags)
+{
+    return CryptNcchTo(filename, NULL, offset, size, seedId, encrypt_flags);
+}
+
+u32 CryptSdToOut(const char* filename, const char* destname, CryptBufferInfo* info)
+{
+    // out of place version of CryptSdToSd() for complete files
+    // sequential appends to destname (which may be filename), replaced only on success
+    u8* buffer = BUFFER_ADDRESS;
+    u32 result = 0;
+    
+    // no DebugFileOpen() - at this point the file has already been checked enough
+    if (!FileOpen(filename)) 
+        return 1;
+    u32 size = FileGetSize();
+    if (!OutFileCreate(destname, size)) {
+        Debug("Could not create %s.tmp", destname);
+        FileClose();
+        return 1;
+    }
+    
+    info->buffer = buffer;
+    for (u32 i = 0; i < size; i += BUFFER_MAX_SIZE) {
+        u32 read_bytes = min(BUFFER_MAX_SIZE, (size - i));
+        ShowProgress(i, size);
+        if(!DebugFileRead(buffer, read_bytes, i)) {
+            result = 1;
+            break;
+        }
+        info->size = read_bytes;
+        CryptBuffer(info);
+        if (OutFileAppend(buffer, read_bytes) != read_bytes) {
+            Debug("SD failure or SD full");
+            result = 1;
+            break;
+        }
+    }
+    
+    ShowProgress(0, 0);
+    FileClose();
+    if (result != 0) {
+        OutFileAbort();
+    } else if (!OutFileCommit()) {
+        Debug("Could not replace %s", destname);
+        result = 1;
+    }
+    
+    return result;
+}
+
 u32 GetCiaInfo(CiaInfo* info, CiaHeader* header)
 {
     info->offset_cert = align(header->size_header, 64);
@@ -743,9 +951,7 @@ u32 CryptGameFiles(u32 param)
     u8 ncch_crypt_standard[8] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
     u8 ncch_crypt_zerokey[8]  = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
     const u8 boss_magic[] = {0x62, 0x6F, 0x73, 0x73, 0x00, 0x01, 0x00, 0x01};
-    const char* ncsd_partition_name[8] = {
-        "Executable", "Manual", "DPC", "Unknown", "Unknown", "Unknown", "UpdateN3DS", "UpdateO3DS" 
-    };
+    const char* ncsd_partition_name[8] = NCSD_PARTITION_NAMES;
     const char* batch_dir = GetGameDir();
     u8* buffer = (u8*) 0x20316000;
     
@@ -762,25 +968,30 @@ u32 CryptGameFiles(u32 param)
     u32 n_processed = 0;
     u32 n_failed = 0;
     
-    if (!batch_dir || !DebugDirOpen(batch_dir)) {
+    // snapshot the directory first, out of place processing adds / renames files
+    char* filelist = (char*) 0x20400000;
+    if (!batch_dir || !GetFileList(batch_dir, filelist, 0x100000, false, true, false)) {
         Debug("Game directory not found!");
         Debug("(check readme for more info)");
         return 1;
     }
     Debug("");
     
-    char path[256];
-    u32 path_len = strnlen(batch_dir, 128);
-    memcpy(path, batch_dir, path_len);
-    path[path_len++] = '/';
-    
-    while (DirRead(path + path_len, 256 - path_len)) {
+    u32 path_len = strnlen(batch_dir, 128) + 1;
+    for (char* path = strtok(filelist, "\n"); path != NULL; path = strtok(NULL, "\n")) {
+        u32 plen = strnlen(path, 256);
+        if ((plen > 4) && (strncmp(path + plen - 4, ".tmp", 4) == 0))
+            continue; // leftover from an aborted out of place run
         if (FileGetData(path, buffer, 0x200, 0x0) != 0x200)
             continue;
         
         if (batch_ncch && (memcmp(buffer + 0x100, "NCCH", 4) == 0)) {
             Debug("Processing NCCH \"%s\"", path + path_len);
-            if (CryptNcch(path, 0x00, 0, 0, ncch_crypt) != 1) {
+            // out of place if there is enough space, in place otherwise
+            u32 fsize = (FileOpen(path)) ? FileGetSize() : 0;
+            FileClose();
+            const char* destname = (fsize < RemainingStorageSpace()) ? path : NULL;
+            if (CryptNcchTo(path, destname, 0x00, 0, 0, ncch_crypt) != 1) {
                 Debug("Success!");
                 n_processed++;
             } else {
@@ -836,8 +1047,6 @@ u32 CryptGameFiles(u32 param)
         }
     }
     
-    DirClose();
-    
     if (n_processed) {
         Debug("%ux processed / %ux failed ", n_processed, n_failed);
     } else if (!n_failed) {
@@ -1257,6 +1466,96 @@ u32 ConvertNcsdNcchToCia(u32 param)
     return !n_processed;
 }
 
+u32 SplitNcsdFiles(u32 param)
+{
+    // writes every NCSD partition to its own file, optionally decrypted on the way
+    NcchHeader* ncch = (NcchHeader*) 0x20316000;
+    const char* part_names[8] = NCSD_PARTITION_NAMES;
+    bool decrypt = param & SP_DECRYPT;
+    u32 n_processed = 0;
+    u32 n_failed = 0;
+    
+    // snapshot the directory first, new files are written to it
+    char* filelist = (char*) 0x20400000;
+    const char* batch_dir = GetGameDir();
+    if (!batch_dir || !GetFileList(batch_dir, filelist, 0x100000, false, true, false)) {
+        Debug("Game directory not found!");
+        Debug("(check readme for more info)");
+        return 1;
+    }
+    
+    u32 path_len = strnlen(batch_dir, 128) + 1;
+    for (char* path = strtok(filelist, "\n"); path != NULL; path = strtok(NULL, "\n")) {
+        u8 header[0x200];
+        NcsdHeader* ncsd = (NcsdHeader*) header;
+        u32 order[8];
+        u32 n_parts = 0;
+        
+        if (FileGetData(path, header, 0x200, 0x0) != 0x200)
+            continue;
+        if ((memcmp(header + 0x100, "NCSD", 4) != 0) || (getle64(header + 0x110) != 0)) 
+            continue; // not a NCSD or a NAND backup NCSD
+        u32 fsize = (FileOpen(path)) ? FileGetSize() : 0;
+        FileClose();
+        
+        // partitions in offset order, the source is read front to back
+        for (u32 p = 0; p < 8; p++) {
+            if (!ncsd->partitions[p].size)
+                continue;
+            u32 i = n_parts++;
+            for (; (i > 0) && (ncsd->partitions[order[i-1]].offset > ncsd->partitions[p].offset); i--)
+                order[i] = order[i-1];
+            order[i] = p;
+        }
+        
+        Debug("");
+        Debug("Splitting \"%s\" (%lu partitions)", path + path_len, n_parts);
+        u32 result = (n_parts) ? 0 : 1;
+        for (u32 i = 0; (i < n_parts) && (result == 0); i++) {
+            u32 p = order[i];
+            u32 offset = ncsd->partitions[p].offset * 0x200;
+            u32 size = ncsd->partitions[p].size * 0x200;
+            char destname[256];
+            if ((offset + size > fsize) || (offset + size < offset) ||
+                (FileGetData(path, (void*) ncch, 0x200, offset) != 0x200) ||
+                (memcmp(ncch->magic, "NCCH", 4) != 0) || (ncch->size * 0x200 > size)) {
+                Debug("Partition %lu is not a valid NCCH", p);
+                result = 1;
+                break;
+            }
+            snprintf(destname, 256, "%s.%s.%s", path, part_names[p], (ncch->size_exthdr) ? "cxi" : "cfa");
+            if (!DebugCheckFreeSpace(size)) {
+                result = 1;
+                break;
+            }
+            Debug("Partition %lu -> %s (%luMB)", p, destname + path_len, size / (1024 * 1024));
+            // encrypted partitions are decrypted, everything else is a plain copy
+            u64 seedId = (p > 0) ? getle64(header + 0x108) : 0;
+            u32 res_crypt = (decrypt && !(ncch->flags[7] & 0x04)) ? CryptNcchTo(path, destname, offset, size, seedId, NULL) : 2;
+            if (res_crypt == 2)
+                res_crypt = CryptNcchRegionsTo(path, destname, offset, ncch->size * 0x200, NULL, 0, NULL, NULL, ncch);
+            result |= res_crypt;
+        }
+        
+        if (result == 0) {
+            Debug("Success!");
+            n_processed++;
+        } else {
+            Debug("Failed!");
+            n_failed++;
+        }
+    }
+    
+    if (n_processed) {
+        Debug("");
+        Debug("%ux processed / %ux failed ", n_processed, n_failed);
+    } else if (!n_failed) {
+        Debug("Nothing found in %s/!", batch_dir);
+    }
+    
+    return !n_processed;
+}
+
 u32 CryptSdFiles(u32 param)
 {
     (void) (param); // param is unused here
@@ -1301,7 +1600,8 @@ u32 CryptSdFiles(u32 param)
                 continue;
             }
             Debug("%2u: %s", n_processed, path + bplen);
-            if (CryptSdToSd(path, 0, fsize, &info, true) == 0) {
+            if (((fsize < RemainingStorageSpace()) ? CryptSdToOut(path, path, &info) :
+                CryptSdToSd(path, 0, fsize, &info, true)) == 0) {
                 n_processed++;
             } else {
                 Debug("Failed!");
@@ -1357,20 +1657,15 @@ u32 DecryptSdFilesDirect(u32 param)
         Debug("%2u: %s", n_processed, srcpath + bplen);
         if (FileOpen(srcpath)) {
             fsize = FileGetSize();
+            FileClose();
             if (!DebugCheckFreeSpace(fsize))
                 return 1;
-            if (FileCopyTo(dstpath, BUFFER_ADDRESS, BUFFER_MAX_SIZE) != fsize) {
-                Debug("Could not copy: %s", srcpath + bplen);
-                n_failed++;
-                break;
-            }
-            FileClose();
         } else {
             Debug("Could not open: %s", srcpath + bplen);
             n_failed++;
             continue;
         }
-        if (CryptSdToSd(dstpath, 0, fsize, &info, true) == 0) {
+        if (CryptSdToOut(srcpath, dstpath, &info) == 0) {
             n_processed++;
         } else {
             Debug("Failed!");
@@ -1738,57 +2033,66 @@ u32 DecryptSdToCxi(u32 param)
     return !n_processed;
 }
 
-static u32 DumpCartToFile(u32 offset_cart, u32 offset_file, u32 size, u32 total, CryptBufferInfo* info, u8* out)
+static void CartReadSectors(u32 sector, u32 count, void* buffer)
+{
+    // the 8 sector aligned part is read in 4KB pages (if supported), the rest in 0x200 byte pages
+    u8* buff = (u8*) buffer;
+    while (count) {
+        u32 page_sectors = (cart_large_pages && !(sector % 8) && (count >= 8)) ? 8 : 1;
+        u32 n_sectors = (page_sectors == 8) ? count - (count % 8) :
+            (cart_large_pages) ? min(count, 8 - (sector % 8)) : count;
+        // dummy commands skip bad responses some carts send
+        Cart_Dummy();
+        Cart_Dummy();
+        CTR_CmdReadData(sector, page_sectors * 0x200, n_sectors / page_sectors, buff);
+        sector += n_sectors;
+        count -= n_sectors;
+        buff += n_sectors * 0x200;
+    }
+}
+
+static bool CartCheckLargePages(void)
+{
+    // one 4KB page vs. the same data in 0x200 byte pages, at the first partition (0x4000)
+    // carts without support for 4KB pages don't return the same, uniform data is inconclusive
+    u8* page_large = BUFFER_ADDRESS;
+    u8* page_small = BUFFER_ADDRESS + 0x1000;
+    
+    cart_large_pages = false;
+    CartReadSectors(0x4000 / 0x200, 8, page_small);
+    Cart_Dummy();
+    Cart_Dummy();
+    CTR_CmdReadData(0x4000 / 0x200, 0x1000, 1, page_large);
+    if (memcmp(page_large, page_small, 0x1000) != 0)
+        return false;
+    for (u32 i = 1; i < 0x1000; i++) {
+        if (page_small[i] != page_small[0])
+            return true;
+    }
+    
+    return false;
+}
+
+static u32 DumpCartToFile(u32 offset_cart, u32 offset_file, u32 size, u32 total)
 {
     // this assumes cart dumping initialized & file open for writing
     // also, careful, uses standard buffer
     u8* buffer = BUFFER_ADDRESS;
+    u32 skip = offset_cart % 0x200; // unaligned start is read with the first chunk
     u32 result = 0;
     
-    if (info) {
-        info->buffer = buffer;
-    }
-    
-    // if offset_cart does not start at sector boundary
-    if (offset_cart % 0x200) { 
-        u32 read_bytes = 0x200 - (offset_cart % 0x200);
-        Cart_Dummy();
-        Cart_Dummy();
-        CTR_CmdReadData(offset_cart / 0x200, 0x200, 1, buffer);
-        memmove(buffer, buffer + (offset_cart % 0x200), read_bytes);
-        if (info) {
-            info->size = read_bytes;
-            CryptBuffer(info);
-        }
-        if (out) {
-            memcpy(out, buffer, read_bytes);
-            out += read_bytes;
-        }
-        if (!DebugFileWrite(buffer, read_bytes, offset_file)) 
-           return 1;
-        offset_cart += read_bytes;
-        offset_file += read_bytes;
-    }
-    
-    for (u64 i = 0; i < size; i += CART_CHUNK_SIZE) {
-        u32 read_bytes = min(CART_CHUNK_SIZE, (size - i));
+    // chunks end at CART_CHUNK_SIZE boundaries of the cart, so reads stay page aligned
+    for (u32 i = 0; i < size;) {
+        u32 read_bytes = min(CART_CHUNK_SIZE - ((offset_cart + i) % CART_CHUNK_SIZE), (size - i));
         if (total)
             ShowProgress(offset_file + i, total);
-        Cart_Dummy();
-        Cart_Dummy();
-        CTR_CmdReadData((offset_cart + i) / 0x200, 0x200, (read_bytes + 0x1FF) / 0x200, buffer);
-        if (info) {
-            info->size = read_bytes;
-            CryptBuffer(info);
-        }
-        if (out) {
-            memcpy(out, buffer, read_bytes);
-            out += read_bytes;
-        }
-        if (!DebugFileWrite(buffer, read_bytes, offset_file + i)) {
+        CartReadSectors((offset_cart + i) / 0x200, (skip + read_bytes + 0x1FF) / 0x200, buffer);
+        if (!DebugFileWrite(buffer + skip, read_bytes, offset_file + i)) {
             result = 1;
             break;
         }
+        i += read_bytes;
+        skip = 0;
     }
     ShowProgress(0, 0);
     
@@ -1798,18 +2102,18 @@ static u32 DumpCartToFile(u32 offset_cart, u32 offset_file, u32 size, u32 total,
 static u32 DecryptCartNcchToFile(u32 offset_cart, u32 offset_file, u32 size, u32 total)
 {
     // this assumes cart dumping to be initialized already and file open for writing(!)
-    // algorithm is simplified / slimmed when compared to CryptNcch()
-    // and only has required capabilities
+    // the partition is read in one sequential pass, every sector exactly once
+    // the header is read first, crypto setup may use BUFFER_ADDRESS (seed lookup)
     NcchHeader* ncch = (NcchHeader*) 0x20317000;
     u8* exefs = (u8*) 0x20317200;
-    CryptBufferInfo info = {.setKeyY = 0, .mode = AES_CNT_CTRNAND_MODE};
-    u32 slot_base = 0x2C;
-    u32 slot_7x = 0x2C;
+    u8* buffer = BUFFER_ADDRESS;
+    NcchCryptRegion plan[NCCH_PLAN_MAX];
+    u32 n_regions = 0;
+    CryptBufferInfo info0;
+    CryptBufferInfo info1;
     
     // read header
-    Cart_Dummy();
-    Cart_Dummy();
-    CTR_CmdReadData(offset_cart / 0x200, 0x200, 1, ncch);
+    CartReadSectors(offset_cart / 0x200, 1, ncch);
     
     // check header, set up stuff
     if ((memcmp(ncch->magic, "NCCH", 4) != 0) || (ncch->size > (size / 0x200))) {
@@ -1820,89 +2124,295 @@ static u32 DecryptCartNcchToFile(u32 offset_cart, u32 offset_file, u32 size, u32
     // check crypto, setup crypto
     if (ncch->flags[7] & 0x04) { // for unencrypted partitions...
         Debug("Not encrypted, dumping instead...");
-        return DumpCartToFile(offset_cart, offset_file, size, total, NULL, NULL);
-    } else if (ncch->flags[7] & 0x1) { // zeroKey / fixedKey crypto
-        // from https://github.com/profi200/Project_CTR/blob/master/makerom/pki/dev.h
-        u8 zeroKey[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-        u8 sysKey[16]  = {0x52, 0x7C, 0xE6, 0x30, 0xA9, 0xCA, 0x30, 0x5F, 0x36, 0x96, 0xF3, 0xCD, 0xE9, 0x54, 0x19, 0x4B};
-        slot_base = slot_7x = 0x11;
-        setup_aeskey(0x11, (ncch->programId & ((u64) 0x10 << 32)) ? sysKey : zeroKey);
-        use_aeskey(0x11);
-    } else if (ncch->flags[3]) { // 7x crypto type
-        slot_7x = (ncch->flags[3] == 0x0A) ? 0x18 : (ncch->flags[3] == 0x0B) ? 0x1B : 0x25;
-        if (CheckKeySlot(slot_7x, 'X') != 0) {
-            Debug("Slot0x%02XKeyX not set up", slot_7x);
+        if (!DebugFileWrite(ncch, 0x200, offset_file))
             return 1;
-        }
-        setup_aeskeyY(slot_7x, ncch->signature);
-        use_aeskey(slot_7x);
-        setup_aeskeyY(slot_base, ncch->signature);
-        use_aeskey(slot_base);
-    } else { // standard crypto type (pre 7x)
-        setup_aeskeyY(slot_base, ncch->signature);
-        use_aeskey(slot_base);
+        return DumpCartToFile(offset_cart + 0x200, offset_file + 0x200, size - 0x200, total);
     }
+    if (SetupNcchCrypto(ncch, ncch->programId, &info0, &info1, NULL) != 0)
+        return 1;
     
-    // disable crypto in header, write to file
+    // the ExeFS header is needed for split ExeFS crypto, it is decrypted once its chunk
+    // was read - regions before it don't depend on it
+    bool split_exefs = (ncch->size_exefs > 0) &&
+        ((info0.keyslot != info1.keyslot) || (memcmp(info0.keyY, info1.keyY, 16) != 0));
+    u32 offset_exefs = ncch->offset_exefs * 0x200;
+    if (GetNcchCryptPlan(plan, &n_regions, ncch, exefs, false) != 0)
+        return 1;
+    
+    // disable crypto in header
     ncch->flags[3] = 0x00;
     ncch->flags[7] &= (0x01|0x20)^0xFF;
     ncch->flags[7] |= 0x04;
-    if (!DebugFileWrite(ncch, 0x200, offset_file))
-        return 1;
-        
-    // process ExHeader
-    if (ncch->size_exthdr > 0) {
-        GetNcchCtr(info.ctr, ncch, 1);
-        info.keyslot = slot_base;
-        if (DumpCartToFile(offset_cart + 0x200, offset_file + 0x200, 0x800, total, &info, NULL) != 0)
+    
+    for (u32 pos = 0; pos < size;) {
+        u32 read_bytes = min(CART_CHUNK_SIZE - ((offset_cart + pos) % CART_CHUNK_SIZE), (size - pos));
+        if (total)
+            ShowProgress(offset_file + pos, total);
+        if (pos == 0) // header was already read, it is put back after decryption
+            CartReadSectors((offset_cart / 0x200) + 1, (read_bytes - 0x200 + 0x1FF) / 0x200, buffer + 0x200);
+        else
+            CartReadSectors((offset_cart + pos) / 0x200, (read_bytes + 0x1FF) / 0x200, buffer);
+        if (split_exefs && (offset_exefs >= pos) && (offset_exefs < pos + read_bytes)) {
+            CryptBufferInfo info = info0;
+            memcpy(exefs, buffer + (offset_exefs - pos), 0x200);
+            GetNcchCtr(info.ctr, ncch, 2);
+            info.buffer = exefs;
+            info.size = 0x200;
+            CryptBuffer(&info);
+            if (GetNcchCryptPlan(plan, &n_regions, ncch, exefs, true) != 0) {
+                Debug("Bad ExeFS / NCCH layout!");
+                return 1;
+            }
+        }
+        CryptNcchChunk(buffer, pos, read_bytes, plan, n_regions, &info0, &info1);
+        if (pos == 0)
+            memcpy(buffer, ncch, 0x200);
+        if (!DebugFileWrite(buffer, read_bytes, offset_file + pos))
             return 1;
+        pos += read_bytes;
     }
+    ShowProgress(0, 0);
     
-    // logo region / plain region
-    if (ncch->offset_exefs > 5) {
-        if (DumpCartToFile(offset_cart + 0xA00, offset_file + 0xA00, (ncch->offset_exefs - 5) * 0x200, total, NULL, NULL) != 0)
-            return 1;
+    return 0;
+}
+
+static u32 DumpCtrGameCartTee(NcsdHeader* ncsd, NcchHeader* ncch, u64 dump_size, u64 data_size, u64 card2_offset)
+{
+    // one read pass over the cart, each chunk goes to three outputs (OutFile slots):
+    // 0: encrypted .3ds, 1: decrypted .3ds, 2: decrypted .cia (skipped if there is no CIA stub)
+    NcchHeader* part_ncch = (NcchHeader*) 0x2031E000;
+    u8* exefs_hdr = (u8*) 0x2031E200;
+    CiaHeader* cia_stub = (CiaHeader*) 0x2031A000;
+    u8* buffer = BUFFER_ADDRESS;
+    NcchCryptRegion plan[NCCH_PLAN_MAX];
+    u32 n_regions = 0;
+    CryptBufferInfo info0;
+    CryptBufferInfo info1;
+    char filenames[3][64];
+    u64 sizes[3];
+    CiaInfo cia;
+    u32 n_out = 3;
+    u32 n_open = 0;
+    u32 result = 0;
+    bool sha_pass = true; // encrypted image is hashed in the pass
+    
+    // CIA stub, sizes and space check for all outputs
+    // (the images don't depend on the CIA stub, without it they are still dumped)
+    sizes[0] = sizes[1] = dump_size;
+    sizes[2] = 0;
+    if (BuildCiaStubNcch((u8*) cia_stub, (u8*) ncsd) == 0) {
+        Debug("CIA output skipped");
+        n_out = 2;
+    } else {
+        GetCiaInfo(&cia, cia_stub);
+        sizes[2] = cia.size_cia;
+        Debug("Cartridge CIA size : %lluMB", sizes[2] / 0x100000);
+    }
+    if (sizes[2] >= 0x100000000) { // should not happen
+        Debug("Error: CIA too big for the FAT32 file system");
+        return 1;
+    }
+    if (sizes[0] + sizes[1] + sizes[2] > RemainingStorageSpace()) {
+        Debug("Not enough space left on SD card");
+        return 1;
     }
     
-    // process ExeFS
-    if (ncch->size_exefs > 0) {
-        u32 offset_exefs = ncch->offset_exefs * 0x200;
-        // include space between ExeFS and RomFS if possible
-        u32 size_exefs = ((ncch->offset_romfs) ? (ncch->offset_romfs - ncch->offset_exefs) :
-            ncch->size_exefs) * 0x200;
-        // dump the whole thing encrypted, then overwrite with decrypted
-        if (DumpCartToFile(offset_cart + offset_exefs, offset_file + offset_exefs, size_exefs, total, NULL, NULL) != 0)
-            return 1;
-        // using 7x crypto routines for everything
-        GetNcchCtr(info.ctr, ncch, 2);
-        info.keyslot = slot_base;
-        if (DumpCartToFile(offset_cart + offset_exefs, offset_file + offset_exefs, 0x200, total, &info, exefs) != 0)
-            return 1;
-        for (u32 i = 0; i < 10; i++) {
-            char* name = (char*) exefs + (i*0x10);
-            u32 offset_exefs_file = getle32(exefs + (i*0x10) + 0x8) + 0x200;
-            u32 size_exefs_file = align(getle32(exefs + (i*0x10) + 0xC), 0x200);
-            if (!size_exefs_file)
+    // create all outputs, write NCSD headers / CIA stub
+    Debug("");
+    memset(((u8*) ncsd) + 0x1200, 0xFF, 0x4000 - 0x1200);
+    sha_init(SHA256_MODE);
+    for (; n_open < n_out; n_open++) {
+        snprintf(filenames[n_open], 64, "/%s%s%.16s_%02u%s.%s",
+            GetGameDir() ? GetGameDir() : "",
+            GetGameDir() ? "/" : "",
+            ncch->productcode,
+            ((u8*)ncsd)[0x312],	// version
+            (n_open) ? "-dec" : "",
+            (n_open == 2) ? "cia" : "3ds");
+        if (n_open == 1) { // fix the flags inside the NCCH copy for decrypted
+            ncch->flags[3] = 0x00;
+            ncch->flags[7] &= (0x01|0x20)^0xFF;
+            ncch->flags[7] |= 0x04;
+        }
+        OutFileSelect(n_open);
+        if (!OutFileCreate(filenames[n_open], sizes[n_open])) {
+            Debug("Could not create output file on SD");
+            result = 1;
+            break;
+        }
+        void* header = (n_open == 2) ? (void*) cia_stub : (void*) ncsd;
+        u32 header_size = (n_open == 2) ? cia.offset_content : 0x4000;
+        if (OutFileAppend(header, header_size) != header_size) {
+            n_open++;
+            result = 1;
+            break;
+        }
+        if (n_open == 0)
+            sha_update(header, header_size);
+        Debug("Dumping to %s", filenames[n_open]);
+    }
+    
+    // sequential read, chunks never cross partition or CARD2 area boundaries
+    bool wipe_card2 = (card2_offset >= data_size) && (card2_offset < dump_size);
+    for (u64 offset = 0x4000; (offset < dump_size) && (result == 0);) {
+        u64 end = min(offset - (offset % CART_CHUNK_SIZE) + CART_CHUNK_SIZE, dump_size);
+        u32 p = 8; // partition of this chunk, 8 -> none
+        u32 pos = 0; // offset inside the partition
+        for (u32 i = 0; i < 8; i++) {
+            u64 p_start = (u64) ncsd->partitions[i].offset * 0x200;
+            u64 p_end = p_start + ((u64) ncsd->partitions[i].size * 0x200);
+            if (!ncsd->partitions[i].size)
                 continue;
-            GetNcchCtr(info.ctr, ncch, 2);
-            add_ctr(info.ctr, offset_exefs_file / 0x10);
-            info.keyslot = ((strncmp(name, "banner", 8) == 0) || (strncmp(name, "icon", 8) == 0)) ? slot_base : slot_7x;
-            if (DumpCartToFile(offset_cart + offset_exefs + offset_exefs_file,
-                offset_file + offset_exefs + offset_exefs_file, size_exefs_file, total, &info, NULL) != 0)
-                return 1;
+            if ((offset >= p_start) && (offset < p_end)) {
+                p = i;
+                pos = offset - p_start;
+                end = min(end, p_end);
+            } else if (p_start > offset) {
+                end = min(end, p_start);
+            }
+        }
+        if (wipe_card2 && (offset < card2_offset))
+            end = min(end, card2_offset);
+        u32 size = end - offset;
+        
+        ShowProgress(offset, dump_size);
+        if (wipe_card2 && (offset >= card2_offset)) {
+            memset(buffer, 0xFF, size);
+        } else if ((p < 8) && (pos == 0)) {
+            // partition start: crypto setup may use BUFFER_ADDRESS (seed lookup),
+            // so only the NCCH header is read first and the rest of the chunk after it
+            CartReadSectors(offset / 0x200, 1, part_ncch);
+        } else {
+            CartReadSectors(offset / 0x200, (size + 0x1FF) / 0x200, buffer);
+        }
+        
+        // partition start: set up crypto from the NCCH header, then read the chunk
+        if ((p < 8) && (pos == 0)) {
+            n_regions = 0;
+            Debug("Partition #%lu (%luMB)...", p, (ncsd->partitions[p].size * 0x200) / 0x100000);
+            if ((memcmp(part_ncch->magic, "NCCH", 4) != 0) || (part_ncch->size > ncsd->partitions[p].size)) {
+                Debug("Error reading partition NCCH header");
+                result = 1;
+                break;
+            }
+            if (part_ncch->flags[7] & 0x20)
+                sha_pass = false; // seed crypto setup uses the SHA engine
+            if (!(part_ncch->flags[7] & 0x04) &&
+                (SetupNcchCrypto(part_ncch, part_ncch->programId, &info0, &info1, NULL) != 0)) {
+                result = 1;
+                break;
+            }
+            memcpy(buffer, part_ncch, 0x200);
+            if (size > 0x200)
+                CartReadSectors((offset / 0x200) + 1, (size - 0x200 + 0x1FF) / 0x200, buffer + 0x200);
+            if (!(part_ncch->flags[7] & 0x04)) {
+                bool split_exefs = (info0.keyslot != info1.keyslot) || (memcmp(info0.keyY, info1.keyY, 16) != 0);
+                if ((part_ncch->size_exefs > 0) && split_exefs) {
+                    CryptBufferInfo info = info0;
+                    u32 offset_exefs = part_ncch->offset_exefs * 0x200;
+                    if (offset_exefs + 0x200 <= size) // usually inside the first chunk
+                        memcpy(exefs_hdr, buffer + offset_exefs, 0x200);
+                    else
+                        CartReadSectors((offset + offset_exefs) / 0x200, 1, exefs_hdr);
+                    GetNcchCtr(info.ctr, part_ncch, 2);
+                    info.buffer = exefs_hdr;
+                    info.size = 0x200;
+                    CryptBuffer(&info);
+                }
+                if (GetNcchCryptPlan(plan, &n_regions, part_ncch, exefs_hdr, split_exefs) != 0) {
+                    Debug("Bad ExeFS / NCCH layout!");
+                    result = 1;
+                    break;
+                }
+                part_ncch->flags[3] = 0x00;
+                part_ncch->flags[7] &= (0x01|0x20)^0xFF;
+                part_ncch->flags[7] |= 0x04;
+            }
         }
+
+        
+        // encrypted image first, then decrypt in place for the others
+        if (sha_pass)
+            sha_update(buffer, size);
+        OutFileSelect(0);
+        if (OutFileAppend(buffer, size) != size)
+            result = 1;
+        if (p < 8) {
+            CryptNcchChunk(buffer, pos, size, plan, n_regions, &info0, &info1);
+            if (pos == 0)
+                memcpy(buffer, part_ncch, 0x200);
+        }
+        OutFileSelect(1);
+        if (OutFileAppend(buffer, size) != size)
+            result = 1;
+        if ((p < 3) && (n_out > 2)) { // CIA contents are partitions 0...2, in order
+            OutFileSelect(2);
+            if (OutFileAppend(buffer, size) != size)
+                result = 1;
+        }
+        if (result != 0)
+            Debug("SD failure or SD full");
+        offset = end;
     }
+    ShowProgress(0, 0);
     
-    // process RomFS
-    if (ncch->size_romfs > 0) {
-        GetNcchCtr(info.ctr, ncch, 3);
-        info.keyslot = slot_7x;
-        if (DumpCartToFile(offset_cart + (ncch->offset_romfs * 0x200),
-            offset_file + (ncch->offset_romfs * 0x200), (ncch->size_romfs * 0x200), total, &info, NULL) != 0)
-            return 1;
+    // close (or remove) all outputs
+    for (u32 s = 0; s < n_open; s++) {
+        OutFileSelect(s);
+        if (result != 0) {
+            OutFileAbort();
+        } else if (!OutFileCommit()) {
+            Debug("Could not finalize %s", filenames[s]);
+            result = 1;
+        }
     }
+    OutFileSelect(0);
+    if (result != 0)
+        return 1;
     
-    return 0;
+    // hashes: encrypted image from the pass, the others from their files (the SHA engine has one context)
+    u8 shasum[32];
+    char hashname[64 + 4];
+    if (sha_pass)
+        sha_get(shasum);
+    else if (GetHashFromFile(filenames[0], 0, 0, shasum) != 0)
+        return 1;
+    snprintf(hashname, 64 + 4, "%s.sha", filenames[0]);
+    Debug("%s SHA256: %08X...", filenames[0], getbe32(shasum));
+    if (FileDumpData(hashname, shasum, 32) != 32)
+        result = 1;
+    
+    // verify decrypted partitions (before FinalizeCiaFile() overwrites the NCSD header)
+    Debug("");
+    for (u32 p = 0; p < 8; p++) {
+        u32 offset = ncsd->partitions[p].offset * 0x200;
+        u32 size = ncsd->partitions[p].size * 0x200;
+        if (size == 0) 
+            continue;
+        Debug("Verifiying partition #%lu (%luMB)...", p, size / 0x100000);
+        if (VerifyNcch(filenames[1], offset) != 0)
+            result = 1;
+    }
+    Debug("Verification %s", (result == 0) ? "success!" : "failed!");
+    
+    // decrypted image is final as is, the CIA only after FinalizeCiaFile()
+    for (u32 i = 1; i < n_out; i++) {
+        if (i == 2) {
+            Debug("Finalizing CIA file...");
+            if (FinalizeCiaFile(filenames[2], false) != 0)
+                return 1;
+        }
+        if (GetHashFromFile(filenames[i], 0, 0, shasum) != 0) {
+            result = 1;
+            continue;
+        }
+        snprintf(hashname, 64 + 4, "%s.sha", filenames[i]);
+        Debug("%s SHA256: %08X...", filenames[i], getbe32(shasum));
+        if (FileDumpData(hashname, shasum, 32) != 32)
+            result = 1;
+    }
+    
+    return result;
 }
 
 u32 DumpCtrGameCart(u32 param)
@@ -1916,6 +2426,7 @@ u32 DumpCtrGameCart(u32 param)
     u64 data_size = 0;
     u64 dump_size = 0;
     u64 card2_offset = 0;
+    u64 resume_offset = 0;
     u32 result = 0;
 
     // read cartridge NCCH header
@@ -1936,6 +2447,7 @@ u32 DumpCtrGameCart(u32 param)
         Debug("Error reading cart NCSD header");
         return 1;
     }
+    cart_large_pages = CartCheckLargePages();
     
     // check for card2 area offset
     // see: https://www.3dbrew.org/wiki/NCSD#Partition_Flags
@@ -1995,6 +2507,9 @@ u32 DumpCtrGameCart(u32 param)
     if ((param & CD_TRIM) && card2_offset)
         Debug("Warning: Trimming CARD2 game removes save area");
     
+    if (param & CD_TEE)
+        return DumpCtrGameCartTee(ncsd, ncch, dump_size, data_size, card2_offset);
+    
     if (!DebugCheckFreeSpace((size_t) dump_size))
         return 1;
     
@@ -2007,8 +2522,27 @@ u32 DumpCtrGameCart(u32 param)
         ((u8*)ncsd)[0x312],	// version
         (param & CD_DECRYPT) ? "-dec" : "",
         (param & CD_MAKECIA) ? "cia" : "3ds");
-    if (!FileCreate(filename, true)) {
+    
+    // plain cart dumps are resumable, source identity is cart ID + NCSD header
+    if (!(param & (CD_DECRYPT|CD_MAKECIA))) {
+        u8 source_id[32];
+        u32 cart_id = Cart_GetID();
+        sha_init(SHA256_MODE);
+        sha_update(ncsd, 0x1000);
+        sha_update(&cart_id, 4);
+        sha_get(source_id);
+        resume_offset = CheckpointOpen(filename, source_id, dump_size, param);
+    }
+    if (resume_offset) {
+        Debug("Resuming %s at %lluMB ...", filename, resume_offset / 0x100000);
+        if (!FileOpen(filename)) {
+            Debug("Could not open output file on SD");
+            CheckpointClose(false);
+            return 1;
+        }
+    } else if (!FileCreate(filename, true)) {
         Debug("Could not create output file on SD");
+        CheckpointClose(false);
         return 1;
     }
     if (param & CD_DECRYPT) { // fix the flags inside the NCCH copy for decrypted
@@ -2021,10 +2555,11 @@ u32 DumpCtrGameCart(u32 param)
             FileClose();
             return 1;
         }
-    } else { // NCSD: first 0x4000 byte, including NCSD header
+    } else if (!resume_offset) { // NCSD: first 0x4000 byte, including NCSD header
         memset(((u8*) ncsd) + 0x1200, 0xFF, 0x4000 - 0x1200);
         if (!DebugFileWrite((void*) ncsd, 0x4000, 0)) {
             FileClose();
+            CheckpointClose(false);
             return 1;
         }
     }
@@ -2045,7 +2580,7 @@ u32 DumpCtrGameCart(u32 param)
                     break;
             } else {
                 Debug("Dumping partition #%lu (%luMB)...", p, size / 0x100000);
-                if (DumpCartToFile(offset_cart, offset_file, size, dump_size, NULL, NULL) != 0)
+                if (DumpCartToFile(offset_cart, offset_file, size, dump_size) != 0)
                     break;
             } 
         }
@@ -2055,7 +2590,16 @@ u32 DumpCtrGameCart(u32 param)
             result = 1;
     } else if (!(param & CD_DECRYPT)) { // dump the encrypted cart
         Debug("Dumping cartridge %.16s (%lluMB)...", ncch->productcode, dump_size / 0x100000);
-        result = DumpCartToFile(0x4000, 0x4000, dump_size - 0x4000, dump_size, NULL, NULL);
+        for (u64 offset = max(0x4000, resume_offset); offset < dump_size;) {
+            // dump in CKP_INTERVAL aligned steps, commit a checkpoint after each one
+            u64 size = min(CKP_INTERVAL - (offset % CKP_INTERVAL), dump_size - offset);
+            result = DumpCartToFile(offset, offset, size, dump_size);
+            if (result != 0)
+                break;
+            offset += size;
+            CheckpointUpdate(offset);
+        }
+        CheckpointClose(result == 0);
     } else { // dump decrypted partitions
         u32 p;
         for (p = 0; p < 8; p++) {
@@ -2076,7 +2620,7 @@ u32 DumpCtrGameCart(u32 param)
         
         if ((result == 0) && (dump_size > data_size)) {
             Debug("Dumping padding (%lluMB)...", (dump_size - data_size) / 0x100000);
-            result = DumpCartToFile(data_size, data_size, dump_size - data_size, dump_size, NULL, NULL);
+            result = DumpCartToFile(data_size, data_size, dump_size - data_size, dump_size);
         }
     }
     FileClose();
@@ -2146,6 +2690,7 @@ u32 DumpTwlGameCart(u32 param)
     u8* dsibuff = BUFFER_ADDRESS;
     u8* buff = BUFFER_ADDRESS+0x8000;
     u64 offset = 0x8000;
+    u64 resume_offset = 0;
     u32 arm9iromOffset = -1;
     int isDSi = 0;
 
@@ -2189,12 +2734,32 @@ u32 DumpTwlGameCart(u32 param)
         GetGameDir() ? GetGameDir() : "",
         GetGameDir() ? "/" : "",
         (const char*)&buff[0x0C], buff[0x1E]);
-
-    if (!DebugFileCreate(filename, true))
-        return 1;
-    if (!DebugFileWrite(buff, 0x8000, 0)) {
-        FileClose();
-        return 1;
+    
+    // source identity: cart ID + header and secure area
+    u8 source_id[32];
+    u32 cart_id = Cart_GetID();
+    sha_init(SHA256_MODE);
+    sha_update(buff, 0x8000);
+    sha_update(&cart_id, 4);
+    sha_get(source_id);
+    resume_offset = CheckpointOpen(filename, source_id, dump_size, param);
+    
+    if (resume_offset) {
+        Debug("Resuming %s at %lluMB ...", filename, resume_offset / 0x100000);
+        if (!DebugFileOpen(filename)) {
+            CheckpointClose(false);
+            return 1;
+        }
+    } else {
+        if (!DebugFileCreate(filename, true)) {
+            CheckpointClose(false);
+            return 1;
+        }
+        if (!DebugFileWrite(buff, 0x8000, 0)) {
+            FileClose();
+            CheckpointClose(false);
+            return 1;
+        }
     }
     
     if (isDSi) {
@@ -2211,26 +2776,33 @@ u32 DumpTwlGameCart(u32 param)
         arm9iromOffset = *((u32*)&dsibuff[0x1C0]);
     }
 
+    // large data reads are checked against the cart first
+    NTR_CmdCheckDataBlock (Cart_GetID(), 0x8000, buff + 0x8000);
+    
     u32 stop = 0;
-    for (offset=0x8000;offset < dump_size;offset+=CART_CHUNK_SIZE) {
+    for (offset=max(0x8000, resume_offset);offset < dump_size;offset+=CART_CHUNK_SIZE) {
         if( (offset + CART_CHUNK_SIZE) > dump_size)
             stop = (offset + CART_CHUNK_SIZE)-dump_size; // correct over-sized writes with "stop" variable
-        for(u32 i=0; i < CART_CHUNK_SIZE; i += 0x200) {
-            NTR_CmdReadData (offset+i, buff+i);
+        for(u32 i=0; i < CART_CHUNK_SIZE; i += NTR_DATA_BLOCK_SIZE) {
+            NTR_CmdReadDataBlock (offset+i, buff+i);
         }
         if (!DebugFileWrite((void*) buff, CART_CHUNK_SIZE - stop, offset)) {
             FileClose();
+            CheckpointClose(false);
             return 1;
         }
+        CheckpointUpdate(offset + CART_CHUNK_SIZE - stop);
         ShowProgress(offset, dump_size);
     }
     
     if (isDSi && !DebugFileWrite(dsibuff+0x4000, 0x4000, arm9iromOffset)) {
         FileClose();
+        CheckpointClose(false);
         return 1;
     }
     
     FileClose ();
+    CheckpointClose(true);
     ShowProgress(0, 0);
     return 0;
 }
@@ -2252,7 +2824,7 @@ u32 DumpGameCart(u32 param)
     Debug("Cartridge Type: %s", (cartId & 0x10000000) ? "CTR" : "NTR/TWL");
     
     // check options vs. cartridge type
-    if (!(cartId & 0x10000000) && (param & CD_MAKECIA)) {
+    if (!(cartId & 0x10000000) && (param & (CD_MAKECIA|CD_TEE))) {
         Debug("NTR/TWL carts can't be dumped to CIA");
         return 1;
     }
@@ -2365,10 +2937,16 @@ u32 ProcessCartSave(u32 param)
             Debug("Error reading file");
             return 1;
         }
+        // only sectors / pages that differ get erased / programmed
+        CardEepromStats stats;
         Debug("Writing savegame...");
-        // full erase for eeprom type 3
-        if (saveType == 3) cardEepromChipErase();
-        cardWriteEeprom(0, buffer, saveSize, saveType);
+        u32 n_bad = cardWriteEepromDiff(buffer, saveSize, saveType, (u8*) 0x20316000, &stats);
+        Debug("%lu sectors erased, %lu pages programmed", stats.n_erased, stats.n_programmed);
+        if (n_bad) {
+            Debug("Verification failed (%lu byte differ)", n_bad);
+            return 1;
+        }
+        Debug("Verification passed");
     } else {
         Debug("Reading savegame...");
         cardReadEeprom(0, buffer, saveSize, saveType);
@@ -17,9 +17,17 @@
 #define CD_DECRYPT      (1<<1)
 #define CD_MAKECIA      (1<<2)
 #define CD_FLASH        (1<<3)
+#define CD_TEE          (1<<4)
+
+#define SP_DECRYPT      (1<<0)
 
 #define MAX_ENTRIES 1024
+#define SEEDDB_MAX_ENTRIES 0x2000
 #define CIA_CERT_SIZE 0xA00
+#define NCCH_PLAN_MAX 16
+
+// NCSD partition names, for the log and for partition / xorpad file names
+#define NCSD_PARTITION_NAMES { "Main", "Manual", "DownloadPlay", "Partition4", "Partition5", "Partition6", "UpdateN3DS", "UpdateO3DS" }
 
 typedef struct {
     u64 titleId;
@@ -30,7 +38,7 @@ typedef struct {
 typedef struct {
     u32 n_entries;
     u8 padding[12];
-    SeedInfoEntry entries[MAX_ENTRIES];
+    SeedInfoEntry entries[SEEDDB_MAX_ENTRIES];
 } __attribute__((packed)) SeedInfo;
 
 typedef struct {
@@ -86,6 +94,14 @@ typedef struct {
     u8  hash_romfs[0x20];
 } __attribute__((packed, aligned(16))) NcchHeader;
 
+// one entry of a NCCH crypto plan, offset is relative to the NCCH start
+typedef struct {
+    u32 offset;
+    u32 size;
+    u32 key_id; // 0 -> standard keyY, 1 -> 7x / seed keyY
+    u8  ctr[16];
+} __attribute__((packed)) NcchCryptRegion;
+
 // see: https://www.3dbrew.org/wiki/CIA#Meta
 typedef struct {
 	u8  dependencies[0x180]; // from ExtHeader
@@ -202,13 +218,18 @@ u32 GetSdCtr(u8* ctr, const char* path);
 u32 GetNcchCtr(u8* ctr, NcchHeader* ncch, u8 sub_id);
 u32 SdFolderSelector(char* path, u8* keyY, bool title_select);
 u32 CryptSdToSd(const char* filename, u32 offset, u32 size, CryptBufferInfo* info, bool handle_offset16);
+u32 GetNcchCryptPlan(NcchCryptRegion* plan, u32* n_regions, NcchHeader* ncch, u8* exefs_hdr, bool split_exefs);
+u32 SetupNcchCrypto(NcchHeader* ncch, u64 seedId, CryptBufferInfo* info0, CryptBufferInfo* info1, u8* fixed_key);
+u32 CryptSdToOut(const char* filename, const char* destname, CryptBufferInfo* info);
 u32 CryptNcch(const char* filename, u32 offset, u32 size, u64 seedId, u8* encrypt_flags);
+u32 GetCiaInfo(CiaInfo* info, CiaHeader* header);
 u32 CryptCia(const char* filename, u8* ncch_crypt, bool cia_encrypt, bool cxi_only);
 u32 CryptBoss(const char* filename, bool encrypt);
 
 // --> FEATURE FUNCTIONS <--
 u32 CryptGameFiles(u32 param);
 u32 ConvertNcsdNcchToCia(u32 param);
+u32 SplitNcsdFiles(u32 param);
 u32 CryptSdFiles(u32 param);
 u32 DecryptSdFilesDirect(u32 param);
 u32 ConvertSdToCia(u32 param);
@@ -77,15 +77,12 @@ u32 SetupMovableKeyY(bool from_nand, u32 keyslot, u8* movable_key) // setup the
     u8 movable_sed[0x200];
     
     if (from_nand) { // load console keyY from movable.sed from NAND
-        PartitionInfo* p_info = GetPartitionInfo(P_CTRNAND);
-        u32 offset;
-        u32 size;
-        if ((SeekFileInNand(&offset, &size, "PRIVATE    MOVABLE SED", p_info) != 0) || (size < 0x120)) {
+        char path[256];
+        if ((GetNandFilePath(path, GetNandFileInfo(F_MOVABLE)) != 0) ||
+            (FileGetData(path, movable_sed, 0x120, 0) != 0x120)) {
             Debug("movable.sed not found or bad size!");
             return 1;
         }
-        if (DecryptNandToMem(movable_sed, offset, 0x120, p_info) != 0)
-            return 1;
     } else if (FileGetData("movable.sed", movable_sed, 0x120, 0) != 0x120) {
         Debug("movable.sed not found on SD or invalid");
         return 1;
@@ -216,6 +213,7 @@ u32 SetupTwlKey0x03(void) // setup the TWLNAND key 0x03
     setup_aeskeyX(0x03, TwlKeyX);
     setup_aeskeyY(0x03, TwlKeyY);
     use_aeskey(0x03);
+    FlushNandCache();
     keyState  |= (u64) 1 << 0x03;
     keyXState |= (u64) 1 << 0x03;
     keyYState |= (u64) 1 << 0x03;
@@ -267,6 +265,8 @@ u32 SetupKeyYFromP9(u32 keyslot, u32 offset, const u8* sha256)
     setup_aeskeyY(keyslot, keyY);
     use_aeskey(keyslot);
     keyYState |= (u64) 1 << keyslot;
+    if (keyslot < 0x08) // NAND keyslot, cached NAND data may be invalid
+        FlushNandCache();
     
     Debug("0x%02lX KeyY: automatically set up", keyslot);
     return 0;
@@ -453,6 +453,8 @@ u32 LoadKeyFromFile(u32 keyslot, char type, char* id)
         keyYState |= (u64) 1 << keyslot;
     }
     use_aeskey(keyslot);
+    if (keyslot < 0x08) // NAND keyslot, cached NAND data may be invalid
+        FlushNandCache();
     
     // Output key state
     Debug("0x%02X %s: loaded, %sset up", (unsigned int) keyslot, keyname, (verified) ? "verified, " : "");
@@ -6,6 +6,7 @@
 #include "decryptor/sha.h"
 #include "decryptor/decryptor.h"
 #include "decryptor/hashfile.h"
+#include "decryptor/checkpoint.h"
 #include "decryptor/keys.h"
 #include "decryptor/nand.h"
 #include "decryptor/nandfat.h" // for serial in NAND backup name
@@ -67,9 +68,73 @@ static PartitionInfo partitions[] = {
     { "CTRFULL", {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}, 0x0B930000, 0x41ED0000, 0x5, AES_CNT_CTRNAND_MODE }  // N3DS
 };
 
+// decrypted NAND sector cache, 4-way set associative with LRU eviction
+// only small reads (metadata, FAT lookups) go through the cache, see DecryptNandToMem()
+#define NAND_CACHE_ADDRESS  ((u8*) 0x22400000)
+#define NAND_CACHE_SETS     128
+#define NAND_CACHE_WAYS     4
+#define NAND_CACHE_MAX_READ 0x20 // in sectors
+
+typedef struct {
+    u32 sector;
+    u32 keyslot;
+    u32 last_use; // zero -> unused
+} NandCacheTag;
+
 static u32 emunand_header = 0;
 static u32 emunand_offset = 0;
 
+static NandCacheTag nand_cache[NAND_CACHE_SETS * NAND_CACHE_WAYS];
+static u32 nand_cache_clock = 0;
+static u32 nand_cache_hits = 0;
+static u32 nand_cache_misses = 0;
+
+
+void FlushNandCache(void)
+{
+    memset(nand_cache, 0x00, sizeof(nand_cache));
+    nand_cache_clock = 0;
+}
+
+void GetNandCacheStats(u32* hits, u32* misses)
+{
+    *hits = nand_cache_hits;
+    *misses = nand_cache_misses;
+}
+
+static u8* NandCacheLookup(u32 sector, u32 keyslot)
+{
+    u32 set = (sector ^ (keyslot << 24)) % NAND_CACHE_SETS;
+    for (u32 i = set * NAND_CACHE_WAYS; i < (set + 1) * NAND_CACHE_WAYS; i++) {
+        NandCacheTag* tag = nand_cache + i;
+        if (tag->last_use && (tag->sector == sector) && (tag->keyslot == keyslot)) {
+            tag->last_use = ++nand_cache_clock;
+            return NAND_CACHE_ADDRESS + (i * NAND_SECTOR_SIZE);
+        }
+    }
+    
+    return NULL;
+}
+
+static void NandCacheInsert(u32 sector, u32 keyslot, const u8* data)
+{
+    u32 set = (sector ^ (keyslot << 24)) % NAND_CACHE_SETS;
+    u32 lru = set * NAND_CACHE_WAYS;
+    for (u32 i = set * NAND_CACHE_WAYS; i < (set + 1) * NAND_CACHE_WAYS; i++) {
+        NandCacheTag* tag = nand_cache + i;
+        if (tag->last_use && (tag->sector == sector) && (tag->keyslot == keyslot)) {
+            lru = i; // already in cache, just refresh
+            break;
+        } else if (tag->last_use < nand_cache[lru].last_use) {
+            lru = i;
+        }
+    }
+    nand_cache[lru].sector = sector;
+    nand_cache[lru].keyslot = keyslot;
+    nand_cache[lru].last_use = ++nand_cache_clock;
+    memcpy(NAND_CACHE_ADDRESS + (lru * NAND_SECTOR_SIZE), data, NAND_SECTOR_SIZE);
+}
+
 
 u32 GetEmuNandMultiSectors(void)
 {
@@ -115,6 +180,10 @@ u32 CheckEmuNand(void)
 
 u32 SetNand(bool set_emunand, bool force_emunand)
 {
+    MountNandFS(); // NAND volumes have to be remounted on the selected NAND
+    FlushNandCache();
+    nand_cache_hits = nand_cache_misses = 0; // stats are per feature, see menu.c
+    InvalidateNandIndices();
     if (set_emunand) {
         u32 emunand_state = CheckEmuNand();
         u32 emunand_count = 0;
@@ -189,6 +258,9 @@ static inline int ReadNandSectors(u32 sector_no, u32 numsectors, u8 *out)
 
 static inline int WriteNandSectors(u32 sector_no, u32 numsectors, u8 *in)
 {
+    MountNandFS(); // cached FAT data of the NAND volumes may be stale after this
+    FlushNandCache(); // same for the sector cache
+    InvalidateNandIndices(); // and for title.db / seedsave derived data
     if (emunand_header) {
         if (sector_no == 0) {
             int errorcode = sdmmc_sdcard_writesectors(emunand_header, 1, in);
@@ -630,11 +702,35 @@ u32 DecryptNandToMem(u8* buffer, u32 offset, u32 size, PartitionInfo* partition)
 
     u32 n_sectors = (size + NAND_SECTOR_SIZE - 1) / NAND_SECTOR_SIZE;
     u32 start_sector = offset / NAND_SECTOR_SIZE;
+    bool use_cache = (n_sectors <= NAND_CACHE_MAX_READ);
+    
+    // try serving small reads from the sector cache first
+    if (use_cache) {
+        u32 s;
+        for (s = 0; s < n_sectors; s++) {
+            u8* cached = NandCacheLookup(start_sector + s, partition->keyslot);
+            if (!cached) break;
+            memcpy(buffer + (s * NAND_SECTOR_SIZE), cached, min(NAND_SECTOR_SIZE, size - (s * NAND_SECTOR_SIZE)));
+        }
+        if (s == n_sectors) {
+            nand_cache_hits += n_sectors;
+            return 0;
+        }
+        nand_cache_misses += n_sectors - s;
+        nand_cache_hits += s;
+        info.size = n_sectors * NAND_SECTOR_SIZE; // decrypt full sectors for the cache
+    }
+    
     if (ReadNandSectors(start_sector, n_sectors, buffer) != 0) {
         Debug("%sNAND read error", (emunand_header) ? "Emu" : "Sys");
         return 1;
     }
     CryptBuffer(&info);
+    
+    if (use_cache) {
+        for (u32 s = 0; s < n_sectors; s++)
+            NandCacheInsert(start_sector + s, partition->keyslot, buffer + (s * NAND_SECTOR_SIZE));
+    }
 
     return 0;
 }
@@ -677,6 +773,7 @@ u32 DumpNand(u32 param)
     char filename[64];
     u8* buffer = BUFFER_ADDRESS;
     u32 nand_size = (param & NB_MINSIZE) ? NAND_MIN_SIZE : getMMCDevice(0)->total_size * NAND_SECTOR_SIZE;
+    u32 resume_offset = 0;
     u32 result = 0;
     
     
@@ -688,15 +785,42 @@ u32 DumpNand(u32 param)
     
     if (OutputFileNameSelector(filename, (param & NB_MINSIZE) ? "NANDmin.bin" : "NAND.bin", NULL) != 0)
         return 2;
-    if (!DebugFileCreate(filename, true))
+    
+    // source identity: NAND header, CID and EmuNAND location
+    u8 source_id[32];
+    if (ReadNandSectors(0, 1, buffer) != 0) {
+        Debug("%sNAND read error", (emunand_header) ? "Emu" : "Sys");
         return 1;
+    }
+    sdmmc_get_cid(1, (uint32_t*) (buffer + NAND_SECTOR_SIZE));
+    memcpy(buffer + NAND_SECTOR_SIZE + 0x10, &emunand_offset, 4);
+    sha_quick(source_id, buffer, NAND_SECTOR_SIZE + 0x14, SHA256_MODE);
+    
+    resume_offset = CheckpointOpen(filename, source_id, nand_size, param);
+    if (resume_offset) {
+        Debug("Resuming %s at %uMB ...", filename, resume_offset / (1024 * 1024));
+        if (!FileOpen(filename) || (CheckpointRehash(resume_offset) != 0)) {
+            Debug("Could not resume, starting over");
+            FileClose();
+            resume_offset = 0;
+        }
+    }
+    if (!resume_offset) {
+        sha_init(SHA256_MODE);
+        if (!DebugFileCreate(filename, true)) {
+            CheckpointClose(false);
+            return 1;
+        }
+    }
     
-    if (!DebugCheckFreeSpace(nand_size))
+    if (!DebugCheckFreeSpace(nand_size - resume_offset)) {
+        FileClose();
+        CheckpointClose(false);
         return 1;
+    }
 
-    sha_init(SHA256_MODE);
     u32 n_sectors = nand_size / NAND_SECTOR_SIZE;
-    for (u32 i = 0; i < n_sectors; i += SECTORS_PER_READ) {
+    for (u32 i = resume_offset / NAND_SECTOR_SIZE; i < n_sectors; i += SECTORS_PER_READ) {
         u32 read_sectors = min(SECTORS_PER_READ, (n_sectors - i));
         ShowProgress(i, n_sectors);
         if (ReadNandSectors(i, read_sectors, buffer) != 0)  {
@@ -709,10 +833,12 @@ u32 DumpNand(u32 param)
             break;
         }
         sha_update(buffer, NAND_SECTOR_SIZE * read_sectors);
+        CheckpointUpdate((i + read_sectors) * NAND_SECTOR_SIZE);
     }
     if (FileGetSize() < NAND_MIN_SIZE) result = 1; // very improbable
     ShowProgress(0, 0);
     FileClose();
+    CheckpointClose(result == 0);
     
     if (result == 0) {
         char hashname[64];
@@ -726,6 +852,157 @@ u32 DumpNand(u32 param)
     return result;
 }
 
+u32 DumpNandArchive(u32 param)
+{
+    // one pass over the NAND: raw backup plus the decrypted partitions selected in param
+    // every chunk is hashed & written raw first, then decrypted in place for its partition
+    const char* p_names[6] = { "TWLN", "TWLP", "AGBSAVE", "FIRM0", "FIRM1", "CTRNAND" };
+    PartitionInfo* p_info[6];
+    char p_filenames[6][64];
+    char filename[64];
+    u8* buffer = BUFFER_ADDRESS;
+    u32 nand_size = getMMCDevice(0)->total_size * NAND_SECTOR_SIZE;
+    u64 total_size = 0;
+    u32 n_parts = 0;
+    u32 result = 0;
+    
+    // check actual EmuNAND size
+    if (emunand_header && (emunand_offset + getMMCDevice(0)->total_size > NumHiddenSectors()))
+        nand_size = NAND_MIN_SIZE;
+    
+    Debug("Dumping %sNAND & partitions. Size (MB): %u", (param & N_EMUNAND) ? "Emu" : "Sys", nand_size / (1024 * 1024));
+    
+    if (OutputFileNameSelector(filename, "NAND.bin", NULL) != 0)
+        return 2;
+    
+    // check selected partitions (these are in offset order), build names from the backup name
+    total_size = nand_size;
+    for (u32 i = 0; i < 6; i++) {
+        u8 magic[NAND_SECTOR_SIZE];
+        PartitionInfo* info = (param & (1<<i)) ? GetPartitionInfo(1<<i) : NULL;
+        if (!info)
+            continue;
+        if (info->offset + info->size > nand_size) {
+            Debug("%s is outside of the NAND, skipped", p_names[i]);
+            continue;
+        }
+        if (DecryptNandToMem(magic, info->offset, 16, info) != 0)
+            return 1;
+        if ((info->magic[0] != 0xFF) && (memcmp(info->magic, magic, 8) != 0)) {
+            Debug("%s: corrupt partition or decryption error", p_names[i]);
+            if (info->keyslot == 0x05)
+                Debug("(or slot0x05keyY not set up)");
+            return 1;
+        }
+        char* dotpos = strrchr(filename, '.');
+        u32 base_len = (dotpos) ? (u32) (dotpos - filename) : strnlen(filename, 64);
+        snprintf(p_filenames[n_parts], 64, "%.*s_%s.bin", (int) base_len, filename, p_names[i]);
+        Debug("%s -> %s", p_names[i], p_filenames[n_parts]);
+        p_info[n_parts++] = info;
+        total_size += info->size;
+    }
+    
+    if (total_size > RemainingStorageSpace()) {
+        Debug("Not enough space left on SD card");
+        return 1;
+    }
+    
+    // raw backup in OutFile slot 0, the current partition in slot 1
+    OutFileSelect(0);
+    if (!OutFileCreate(filename, nand_size)) {
+        Debug("Could not create %s", filename);
+        return 1;
+    }
+    sha_init(SHA256_MODE);
+    
+    u32 p = 0;
+    bool p_open = false;
+    for (u32 offset = 0; offset < nand_size;) {
+        PartitionInfo* info = (p < n_parts) ? p_info[p] : NULL;
+        bool in_partition = info && (offset >= info->offset);
+        // chunks never cross partition boundaries
+        u32 end = min(offset + (NAND_SECTOR_SIZE * SECTORS_PER_READ), nand_size);
+        if (info)
+            end = min(end, (in_partition) ? info->offset + info->size : info->offset);
+        u32 size = end - offset;
+        
+        ShowProgress(offset, nand_size);
+        if (ReadNandSectors(offset / NAND_SECTOR_SIZE, size / NAND_SECTOR_SIZE, buffer) != 0) {
+            Debug("%sNAND read error", (emunand_header) ? "Emu" : "Sys");
+            result = 1;
+            break;
+        }
+        sha_update(buffer, size);
+        OutFileSelect(0);
+        if (OutFileAppend(buffer, size) != size) {
+            Debug("SD failure or SD full");
+            result = 1;
+            break;
+        }
+        
+        if (in_partition) {
+            CryptBufferInfo crypt = {.keyslot = info->keyslot, .setKeyY = 0, .size = size, .buffer = buffer, .mode = info->mode};
+            GetNandCtr(crypt.ctr, offset);
+            CryptBuffer(&crypt);
+            OutFileSelect(1);
+            if (!p_open && !(p_open = OutFileCreate(p_filenames[p], info->size))) {
+                Debug("Could not create %s", p_filenames[p]);
+                result = 1;
+                break;
+            }
+            if (OutFileAppend(buffer, size) != size) {
+                Debug("SD failure or SD full");
+                result = 1;
+                break;
+            }
+            if (end == info->offset + info->size) {
+                p_open = false;
+                if (!OutFileCommit()) {
+                    Debug("Could not finalize %s", p_filenames[p]);
+                    result = 1;
+                    break;
+                }
+                p++;
+            }
+        }
+        offset = end;
+    }
+    ShowProgress(0, 0);
+    
+    if (p_open) {
+        OutFileSelect(1);
+        OutFileAbort();
+    }
+    OutFileSelect(0);
+    if (result != 0) {
+        OutFileAbort();
+        return 1;
+    } else if (!OutFileCommit()) {
+        Debug("Could not finalize %s", filename);
+        return 1;
+    }
+    
+    // hashes: raw backup from the pass, partitions from their files (the SHA engine has one context)
+    u8 shasum[32];
+    char hashname[64];
+    sha_get(shasum);
+    Debug("NAND dump SHA256: %08X...", getbe32(shasum));
+    snprintf(hashname, 64, "%s.sha", filename);
+    Debug("Store to %s: %s", hashname, (FileDumpData(hashname, shasum, 32) == 32) ? "ok" : "failed");
+    for (u32 i = 0; i < n_parts; i++) {
+        if (GetHashFromFile(p_filenames[i], 0, 0, shasum) != 0) {
+            result = 1;
+            continue;
+        }
+        snprintf(hashname, 64, "%s.sha", p_filenames[i]);
+        Debug("%s SHA256: %08X...", p_filenames[i], getbe32(shasum));
+        if (FileDumpData(hashname, shasum, 32) != 32)
+            result = 1;
+    }
+    
+    return result;
+}
+
 u32 GetNandHeader(u8* header)
 {
     if (ReadNandSectors(0, 1, header) != 0)  {
@@ -19,6 +19,9 @@
 #define NR_NOCHECKS (1<<11)
 #define NR_KEEPA9LH (1<<12)
 
+// partitions exported by DumpNandArchive()
+#define NA_PARTITIONS (P_TWLN | P_TWLP | P_AGBSAVE | P_FIRM0 | P_FIRM1 | P_CTRNAND)
+
 // these three are not handled by the feature functions
 // they have to be handled by the menu system
 #define N_EMUNAND   (1<<28)
@@ -44,6 +47,9 @@ typedef struct {
 PartitionInfo* GetPartitionInfo(u32 partition_id);
 u32 GetNandCtr(u8* ctr, u32 offset);
 
+void FlushNandCache(void);
+void GetNandCacheStats(u32* hits, u32* misses);
+
 u32 CheckFirmSize(const u8* firm, u32 f_size);
 u32 DecryptFirmArm9Mem(u8* firm, u32 f_size);
 
@@ -63,6 +69,7 @@ u32 CheckEmuNand(void);
 u32 SetNand(bool set_emunand, bool force_emunand);
 
 u32 DumpNand(u32 param);
+u32 DumpNandArchive(u32 param);
 u32 DumpNandHeader(u32 param);
 u32 RestoreNand(u32 param);
 u32 RestoreNandHeader(u32 param);
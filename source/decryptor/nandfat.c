@@ -13,6 +13,20 @@
 #define TL_HS      (titleList +  3)
 #define TL_HS_N    (titleList +  4)
 
+// seed store, seeddb.bin merged with the NAND seedsave - right behind the NAND sector cache
+#define SEED_STORE          ((SeedInfo*) 0x22440000)
+#define SEED_SRC_SEEDDB     (1<<0)
+#define SEED_SRC_NAND       (1<<1)
+#define SEED_SRC_BAD_SEEDDB (1<<2)
+#define SEED_SRC_INVALID    0xFFFFFFFF
+
+static u32 seed_store_src = SEED_SRC_INVALID;
+
+// title index, parsed from title.db - right behind the seed store
+#define TITLE_INDEX         ((TitleIndex*) 0x22490000)
+
+static bool title_index_ready = false;
+
 // only a subset, see http://3dbrew.org/wiki/Title_list
 // regions: JPN, USA, EUR, CHN, KOR, TWN
 TitleListInfo titleList[] = {
@@ -43,21 +57,21 @@ TitleListInfo firms[] = {
 };
 
 NandFileInfo fileList[] = { // first six entries are .dbs, placement corresponds to id
-    { "ticket.db",             "ticket.db",             "DBS        TICKET  DB ",                P_CTRNAND },
-    { "certs.db",              "certs.db",              "DBS        CERTS   DB ",                P_CTRNAND },
-    { "title.db",              "title.db",              "DBS        TITLE   DB ",                P_CTRNAND },
-    { "import.db",             "import.db",             "DBS        IMPORT  DB ",                P_CTRNAND },
-    { "tmp_t.db",              "tmp_t.db",              "DBS        TMP_T   DB ",                P_CTRNAND },
-    { "tmp_i.db",              "tmp_i.db",              "DBS        TMP_I   DB ",                P_CTRNAND },
-    { "SecureInfo_A",          "SecureInfo",            "RW         SYS        SECURE~?   ",     P_CTRNAND },
-    { "LocalFriendCodeSeed_B", "LocalFriendCodeSeed",   "RW         SYS        LOCALF~?   ",     P_CTRNAND },
-    { "rand_seed",             "rand_seed",             "RW         SYS        RAND_S~?   ",     P_CTRNAND },
-    { "movable.sed",           "movable.sed",           "PRIVATE    MOVABLE SED",                P_CTRNAND },
-    { "seedsave.bin", "seedsave.bin", "DATA       ???????????SYSDATA    0001000F   00000000   ", P_CTRNAND },
-    { "nagsave.bin",  "nagsave.bin",  "DATA       ???????????SYSDATA    0001002C   00000000   ", P_CTRNAND },
-    { "nnidsave.bin", "nnidsave.bin", "DATA       ???????????SYSDATA    00010038   00000000   ", P_CTRNAND },
-    { "friendsave.bin", "friendsave.bin", "DATA       ???????????SYSDATA    00010032   00000000   ", P_CTRNAND },
-    { "configsave.bin", "configsave.bin", "DATA       ???????????SYSDATA    00010017   00000000   ", P_CTRNAND }
+    { "ticket.db",             "ticket.db",             "DBS        TICKET  DB ",                CTRNAND_DRV "/dbs/ticket.db",               P_CTRNAND },
+    { "certs.db",              "certs.db",              "DBS        CERTS   DB ",                CTRNAND_DRV "/dbs/certs.db",                P_CTRNAND },
+    { "title.db",              "title.db",              "DBS        TITLE   DB ",                CTRNAND_DRV "/dbs/title.db",                P_CTRNAND },
+    { "import.db",             "import.db",             "DBS        IMPORT  DB ",                CTRNAND_DRV "/dbs/import.db",               P_CTRNAND },
+    { "tmp_t.db",              "tmp_t.db",              "DBS        TMP_T   DB ",                CTRNAND_DRV "/dbs/tmp_t.db",                P_CTRNAND },
+    { "tmp_i.db",              "tmp_i.db",              "DBS        TMP_I   DB ",                CTRNAND_DRV "/dbs/tmp_i.db",                P_CTRNAND },
+    { "SecureInfo_A",          "SecureInfo",            "RW         SYS        SECURE~?   ",     CTRNAND_DRV "/rw/sys/SecureInfo_?",         P_CTRNAND },
+    { "LocalFriendCodeSeed_B", "LocalFriendCodeSeed",   "RW         SYS        LOCALF~?   ",     CTRNAND_DRV "/rw/sys/LocalFriendCodeSeed_?", P_CTRNAND },
+    { "rand_seed",             "rand_seed",             "RW         SYS        RAND_S~?   ",     CTRNAND_DRV "/rw/sys/rand_seed",            P_CTRNAND },
+    { "movable.sed",           "movable.sed",           "PRIVATE    MOVABLE SED",                CTRNAND_DRV "/private/movable.sed",         P_CTRNAND },
+    { "seedsave.bin", "seedsave.bin", "DATA       ???????????SYSDATA    0001000F   00000000   ", CTRNAND_DRV "/data/*/sysdata/0001000f/00000000", P_CTRNAND },
+    { "nagsave.bin",  "nagsave.bin",  "DATA       ???????????SYSDATA    0001002C   00000000   ", CTRNAND_DRV "/data/*/sysdata/0001002c/00000000", P_CTRNAND },
+    { "nnidsave.bin", "nnidsave.bin", "DATA       ???????????SYSDATA    00010038   00000000   ", CTRNAND_DRV "/data/*/sysdata/00010038/00000000", P_CTRNAND },
+    { "friendsave.bin", "friendsave.bin", "DATA       ???????????SYSDATA    00010032   00000000   ", CTRNAND_DRV "/data/*/sysdata/00010032/00000000", P_CTRNAND },
+    { "configsave.bin", "configsave.bin", "DATA       ???????????SYSDATA    00010017   00000000   ", CTRNAND_DRV "/data/*/sysdata/00010017/00000000", P_CTRNAND }
 };
 
 
@@ -123,16 +137,19 @@ u32 SeekFileInNand(u32* offset, u32* size, const char* path, PartitionInfo* part
         if (!found) break;
     }
     
-    // check for fragmentation
+    // check for fragmentation, only the FAT sectors covering the file are needed
     if (found && (*size > cluster_size)) {  
-        if (fat_size / fat_count > 0x100000) // prevent buffer overflow
+        u32 n_clusters = (*size - 1) / cluster_size; // no need to check the files last FAT table entry
+        u32 fat_offset = ((fat_pos * 2) / NAND_SECTOR_SIZE) * NAND_SECTOR_SIZE;
+        u32 fat_read = align(((fat_pos + n_clusters) * 2) - fat_offset, NAND_SECTOR_SIZE);
+        if ((fat_offset + fat_read > fat_size / fat_count) || (fat_read > 0x100000)) // prevent buffer overflow
             return 1; // fishy FAT table size - should never happen
-        if (DecryptNandToMem(buffer, p_offset + fat_start, fat_size / fat_count, partition) != 0)
+        if (DecryptNandToMem(buffer, p_offset + fat_start + fat_offset, fat_read, partition) != 0)
             return 1;
-        for (u32 i = 0; i < (*size - 1) / cluster_size; i++) {
-            if (*(((u16*) buffer) + fat_pos + i) != fat_pos + i + 1)
+        for (u32 i = 0; i < n_clusters; i++) {
+            if (*(((u16*) buffer) + fat_pos + i - (fat_offset / 2)) != fat_pos + i + 1)
                 return 1;
-        } // no need to check the files last FAT table entry
+        }
     }
     
     return (found) ? 0 : 1;
@@ -155,36 +172,98 @@ u32 DebugSeekFileInNand(u32* offset, u32* size, const char* filename, const char
     return 0;
 }
 
-u32 SeekTitleInNandDb(u32 tid_high, u32 tid_low, u32* tmd_id)
+u32 GetNandFilePath(char* path, NandFileInfo* f_info)
 {
-    PartitionInfo* ctrnand_info = GetPartitionInfo(P_CTRNAND);
-    u8* titledb = (u8*) 0x20316000;
+    // path must be able to hold 256 chars
+    return (FileFindPath(path, f_info->fat_path, 256)) ? 0 : 1;
+}
+
+u32 DebugOpenNandFile(u32* size, NandFileInfo* f_info)
+{
+    // opens a file from the mounted NAND volumes as the current file
+    // handles long filenames and fragmented files
+    char path[256];
     
-    u32 offset_db;
-    u32 size_db;
-    if (SeekFileInNand(&offset_db, &size_db, "DBS        TITLE   DB ", ctrnand_info) != 0)
-        return 1; // database not found
-    if (size_db != 0x64C00)
-        return 1; // bad database size
-    if (DecryptNandToMem(titledb, offset_db, size_db, ctrnand_info) != 0)
+    Debug("Searching for %s...", f_info->name_l);
+    if ((GetNandFilePath(path, f_info) != 0) || !FileOpen(path)) {
+        Debug("Failed!");
         return 1;
+    }
+    *size = FileGetSize();
+    if (*size < 1024)
+        Debug("Found %s, size %ub", path, *size);
+    else if (*size < 1024 * 1024)
+        Debug("Found %s, size %ukB", path, *size / 1024);
+    else
+        Debug("Found %s, size %uMB", path, *size / (1024*1024));
+    
+    return 0;
+}
+
+static u32 BuildTitleIndex(void)
+{
+    // parses title.db into a title id sorted index, once per NAND selection
+    TitleIndex* index = TITLE_INDEX;
+    u8* titledb = (u8*) 0x20316000;
+    char path[256];
+    
+    if (title_index_ready)
+        return 0;
+    index->n_titles = 0;
+    if ((GetNandFilePath(path, GetNandFileInfo(F_TITLE)) != 0) || (FileGetData(path, titledb, 0x64C00, 0) != 0x64C00))
+        return 1; // database not found / bad database size
     
     u8* entry_table = titledb + 0x39A80;
     u8* info_data = titledb + 0x44B80;
     if ((getle32(entry_table + 0) != 2) || (getle32(entry_table + 4) != 3))
         return 1; // magic number not found
-    *tmd_id = (u32) -1;
-    for (u32 i = 0; i < 1000; i++) {
+    for (u32 i = 0; i < TITLE_INDEX_MAX; i++) {
         u8* entry = entry_table + 0xA8 + (0x2C * i);
         u8* info = info_data + (0x80 * i);
-        if ((getle32(entry + 0xC) != tid_high) || (getle32(entry + 0x8) != tid_low)) continue; // not a title id match
         if (getle32(entry + 0x4) != 1) continue; // not an active entry
         if ((getle32(entry + 0x18) - i != 0x162) || (getle32(entry + 0x1C) != 0x80) || (getle32(info + 0x08) != 0x40)) continue; // fishy title info / offset
-        *tmd_id = getle32(info + 0x14);
-        break; 
+        // insertion sort, title.db is mostly in order already
+        TitleIndexEntry* title = index->titles + index->n_titles;
+        u64 title_id = getle64(entry + 0x8);
+        for (; (title > index->titles) && ((title - 1)->title_id > title_id); title--)
+            memcpy(title, title - 1, sizeof(TitleIndexEntry));
+        title->title_id = title_id;
+        title->tmd_id = getle32(info + 0x14);
+        index->n_titles++;
+    }
+    title_index_ready = true;
+    
+    return 0;
+}
+
+void InvalidateNandIndices(void)
+{
+    // title index and seed store are derived from NAND content
+    title_index_ready = false;
+    seed_store_src = SEED_SRC_INVALID;
+}
+
+u32 SeekTitleInNandDb(u32 tid_high, u32 tid_low, u32* tmd_id)
+{
+    TitleIndex* index = TITLE_INDEX;
+    u64 title_id = ((u64) tid_high << 32) | tid_low;
+    u32 lo = 0;
+    u32 hi;
+    
+    if (BuildTitleIndex() != 0)
+        return 1;
+    hi = index->n_titles;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        if (index->titles[mid].title_id < title_id)
+            lo = mid + 1;
+        else hi = mid;
     }
+    if ((lo >= index->n_titles) || (index->titles[lo].title_id != title_id))
+        return 1;
+    *tmd_id = index->titles[lo].tmd_id;
     
-    return (*tmd_id != (u32) -1) ? 0 : 1;
+    return 0;
 }
 
 u32 DebugSeekTitleInNand(u32* offset_tmd, u32* size_tmd, u32* offset_app, u32* size_app, TitleListInfo* title_info, u32 max_cnt)
@@ -403,13 +482,11 @@ u32 GetSerial(char* serial)
 {
     static char serial_store[16] = { 0 };
     if (!(*serial_store)) {
-        PartitionInfo* p_info = GetPartitionInfo(P_CTRNAND);
+        char path[256];
         u8 secureinfo[0x200];
-        u32 offset;
-        u32 size;
         
-        if ((SeekFileInNand(&offset, &size, "RW         SYS        SECURE~?   ", p_info) == 0) &&
-            (DecryptNandToMem(secureinfo, offset, size, p_info) == 0)) {
+        if ((GetNandFilePath(path, GetNandFileInfo(F_SECUREINFO)) == 0) &&
+            (FileGetData(path, secureinfo, 0x200, 0) >= 0x111)) {
             snprintf(serial_store, 16, "%.15s", (char*) (secureinfo + 0x102));
         } else {
             snprintf(serial_store, 16, "UNKNOWN");
@@ -520,13 +597,9 @@ u32 CheckNandFile(u32 param) {
 u32 DumpNandFile(u32 param)
 {
     NandFileInfo* f_info = GetNandFileInfo(param);
-    PartitionInfo* p_info = GetPartitionInfo(f_info->partition_id);
     char filename[64];
-    u32 offset;
     u32 size;
     
-    if (DebugSeekFileInNand(&offset, &size, f_info->name_l, f_info->path, p_info) != 0)
-        return 1;
     if (!(param & FF_AUTONAME)) {
         if (OutputFileNameSelector(filename, f_info->name_l, NULL) != 0)
             return 1;
@@ -535,8 +608,19 @@ u32 DumpNandFile(u32 param)
         GetNandCtr((u8*) fileid, 0);
         snprintf(filename, 64, "%08X_%s", *fileid, f_info->name_l);
     }
-    if (DecryptNandToFile(filename, offset, size, p_info, NULL) != 0)
+    if (DebugOpenNandFile(&size, f_info) != 0)
         return 1;
+    if (!DebugCheckFreeSpace(size)) {
+        FileClose();
+        return 1;
+    }
+    Debug("Creating %s ...", filename);
+    if (FileCopyTo(filename, BUFFER_ADDRESS, BUFFER_MAX_SIZE) != size) {
+        Debug("Could not write %s", filename);
+        FileClose();
+        return 1;
+    }
+    FileClose();
     
     return 0;
 }
@@ -872,44 +956,128 @@ u32 DumpCitraConfig(u32 param)
     return 1; // failed if arriving here
 }
 
-u32 FindSeedInSeedSave(u8* seed, u64 titleId, u8* hash)
+static int CompareSeedEntries(const void* a, const void* b)
+{
+    const SeedInfoEntry* entry_a = (const SeedInfoEntry*) a;
+    const SeedInfoEntry* entry_b = (const SeedInfoEntry*) b;
+    if (entry_a->titleId != entry_b->titleId)
+        return (entry_a->titleId < entry_b->titleId) ? -1 : 1;
+    return memcmp(entry_a->external_seed, entry_b->external_seed, 16);
+}
+
+static void InvalidateSeedStore(void)
 {
+    seed_store_src = SEED_SRC_INVALID;
+}
+
+static u32 LoadSeedStore(void)
+{
+    // loads seeddb.bin and the NAND seedsave into one sorted list, once per session
+    // returns the seed sources that were available
     // there are two offsets where seeds can be found - 0x07000 & 0x5C000
     static const u32 seed_offset[2] = {0x7000, 0x5C000};
     
-    NandFileInfo* f_info = GetNandFileInfo(F_SEEDSAVE);
-    PartitionInfo* p_info = GetPartitionInfo(f_info->partition_id);
+    SeedInfo* store = SEED_STORE;
     u8* buffer = BUFFER_ADDRESS;
+    char path[256];
+    u32 n_entries = 0;
+    u32 n_dropped = 0;
+    
+    if (seed_store_src != SEED_SRC_INVALID)
+        return seed_store_src;
+    seed_store_src = 0;
+    
+    // seeds from seeddb.bin
+    if (FileGetData("seeddb.bin", store, 16, 0) == 16) {
+        n_entries = store->n_entries;
+        if ((n_entries > SEEDDB_MAX_ENTRIES) ||
+            (FileGetData("seeddb.bin", store->entries, n_entries * sizeof(SeedInfoEntry), 16) != n_entries * sizeof(SeedInfoEntry))) {
+            Debug("seeddb.bin found, but seems corrupt");
+            seed_store_src |= SEED_SRC_BAD_SEEDDB;
+            n_entries = 0;
+        } else seed_store_src |= SEED_SRC_SEEDDB;
+        for (u32 i = 0; i < n_entries; i++) {
+            memset(store->entries[i].reserved, 0x00, 8);
+            store->entries[i].reserved[0] = SEED_SRC_SEEDDB;
+        }
+    }
     
-    u32 p_active = 0;
-    u32 offset;
-    u32 size;
-    
-    // load full seedsave to memory
-    if (SeekFileInNand(&offset, &size, f_info->path, p_info) != 0)
-        return 1;
-    if (size != 0xAC000) {
-        Debug("Expected %ukB, failed!", 0xAC000 / 1024);
-        return 1;
+    // seeds from the NAND seedsave
+    if ((GetNandFilePath(path, GetNandFileInfo(F_SEEDSAVE)) == 0) && (FileGetData(path, buffer, BUFFER_MAX_SIZE, 0) == 0xAC000)) {
+        u32 p_active = (getle32(buffer + 0x168)) ? 1 : 0;
+        seed_store_src |= SEED_SRC_NAND;
+        for ( int n = 0; n < 2; n++ ) {
+            u8* seed_data = buffer + seed_offset[(n + p_active) % 2];
+            for ( size_t i = 0; i < 2000; i++ ) {
+                static const u8 zeroes[16] = { 0x00 };
+                // magic number is the reversed first 4 byte of a title id
+                static const u8 magic[4] = { 0x00, 0x00, 0x04, 0x00 };
+                // 2000 seed entries max, splitted into title id and seed area
+                u8* titleId = seed_data + (i*8);
+                u8* seed = seed_data + (2000*8) + (i*16);
+                if (memcmp(titleId + 4, magic, 4) != 0)
+                    continue;
+                // Bravely Second demo seed workaround
+                if (memcmp(seed, zeroes, 16) == 0)
+                    seed = buffer + seed_offset[(n + p_active + 1) % 2] + (2000 * 8) + (i*16); // other slot
+                if (memcmp(seed, zeroes, 16) == 0)
+                    continue;
+                if (n_entries >= SEEDDB_MAX_ENTRIES) {
+                    n_dropped++;
+                    continue;
+                }
+                SeedInfoEntry* entry = &(store->entries[n_entries++]);
+                memset(entry, 0x00, sizeof(SeedInfoEntry));
+                entry->titleId = getle64(titleId);
+                memcpy(entry->external_seed, seed, 16);
+                entry->reserved[0] = SEED_SRC_NAND;
+            }
+        }
     }
-    if (DecryptNandToMem(buffer, offset, size, p_info) != 0)
-        return 1;
-    p_active = (getle32(buffer + 0x168)) ? 1 : 0;
     
-    // search and extract seeds
-    for ( int n = 0; n < 2; n++ ) {
-        u8* seed_data = buffer + seed_offset[(n + p_active) % 2];
-        for ( size_t i = 0; i < 2000; i++ ) {
-            // 2000 seed entries max, splitted into title id and seed area
-            u8* ltitleId = seed_data + (i*8);
-            u8* lseed = seed_data + (2000*8) + (i*16);
-            if (titleId != getle64(ltitleId))
-                continue;
-            if (hash && (ValidateSeed(lseed, titleId, hash) != 0))
-                continue;
-            memcpy(seed, lseed, 16);
-            return 0;
+    if (n_dropped)
+        Debug("Seed store full, %i NAND seeds dropped", n_dropped);
+    
+    // sort by title id, merge identical entries
+    // differing seeds for the same title id are kept, lookups validate them
+    qsort(store->entries, n_entries, sizeof(SeedInfoEntry), CompareSeedEntries);
+    u32 n_unique = 0;
+    for (u32 i = 0; i < n_entries; i++) {
+        SeedInfoEntry* entry = &(store->entries[i]);
+        if (n_unique && (CompareSeedEntries(&(store->entries[n_unique - 1]), entry) == 0)) {
+            store->entries[n_unique - 1].reserved[0] |= entry->reserved[0];
+            continue;
         }
+        if (i != n_unique)
+            memcpy(&(store->entries[n_unique]), entry, sizeof(SeedInfoEntry));
+        n_unique++;
+    }
+    store->n_entries = n_unique;
+    
+    return seed_store_src;
+}
+
+u32 FindSeed(u8* seed, u64 titleId, u8* hash)
+{
+    // looks up a seed from seeddb.bin or the NAND seedsave
+    // only seeds matching the hash are returned (if provided)
+    SeedInfo* store = SEED_STORE;
+    u32 lo = 0;
+    u32 hi;
+    
+    LoadSeedStore();
+    hi = store->n_entries;
+    while (lo < hi) { // first entry with a matching title id
+        u32 mid = (lo + hi) / 2;
+        if (store->entries[mid].titleId < titleId)
+            lo = mid + 1;
+        else hi = mid;
+    }
+    for (u32 i = lo; (i < store->n_entries) && (store->entries[i].titleId == titleId); i++) {
+        if (hash && (ValidateSeed(store->entries[i].external_seed, titleId, hash) != 0))
+            continue;
+        memcpy(seed, store->entries[i].external_seed, 16);
+        return 0;
     }
     
     // not found if arriving here
@@ -919,90 +1087,47 @@ u32 FindSeedInSeedSave(u8* seed, u64 titleId, u8* hash)
 u32 UpdateSeedDb(u32 param)
 {
     (void) (param); // param is unused here
-    // there are two offsets where seeds can be found - 0x07000 & 0x5C000
-    static const u32 seed_offset[2] = {0x7000, 0x5C000};
-    
-    NandFileInfo* f_info = GetNandFileInfo(F_SEEDSAVE);
-    PartitionInfo* p_info = GetPartitionInfo(f_info->partition_id);
-    u8* buffer = BUFFER_ADDRESS;
-    SeedInfo *seedinfo = (SeedInfo*) 0x20400000;
-    
+    SeedInfo* store = SEED_STORE;
     u32 nNewSeeds = 0;
-    u32 p_active = 0;
-    u32 offset;
-    u32 size;
     
-    // load full seedsave to memory
-    if (DebugSeekFileInNand(&offset, &size, f_info->name_l, f_info->path, p_info) != 0)
-        return 1;
-    if (size != 0xAC000) {
-        Debug("Expected %ukB, failed!", 0xAC000 / 1024);
+    // reload, seeddb.bin or the seedsave may have changed since
+    InvalidateSeedStore();
+    Debug("Loading seeds from seeddb.bin & NAND...");
+    u32 seed_src = LoadSeedStore();
+    if (seed_src & SEED_SRC_BAD_SEEDDB) {
+        Debug("Not touching seeddb.bin, fix or remove it first");
         return 1;
     }
-    if (DecryptNandToMem(buffer, offset, size, p_info) != 0)
+    if (!(seed_src & SEED_SRC_NAND)) {
+        Debug("Failed loading %s", GetNandFileInfo(F_SEEDSAVE)->name_l);
         return 1;
-    p_active = (getle32(buffer + 0x168)) ? 1 : 0;
+    }
     
-    // load / create seeddb.bin
-    u32 size_seeddb;
-    if ((size_seeddb = FileGetData("seeddb.bin", seedinfo, sizeof(SeedInfo), 0))) {
-        if ((seedinfo->n_entries > MAX_ENTRIES) || (size_seeddb != 16 + seedinfo->n_entries * sizeof(SeedInfoEntry))) {
-            Debug("seeddb.bin found, but seems corrupt");
-            return 1;
-        } else {
-            Debug("Using existing seeddb.bin");
-        }
-    } else {
-        Debug("Creating new seeddb.bin");
-        memset(seedinfo, 0x00, 16);
-    }
-    
-    // search and extract seeds
-    for ( int n = 0; n < 2; n++ ) {
-        u8* seed_data = buffer + seed_offset[(n + p_active) % 2];
-        for ( size_t i = 0; i < 2000; i++ ) {
-            static const u8 zeroes[16] = { 0x00 };
-            // magic number is the reversed first 4 byte of a title id
-            static const u8 magic[4] = { 0x00, 0x00, 0x04, 0x00 };
-            // 2000 seed entries max, splitted into title id and seed area
-            u8* titleId = seed_data + (i*8);
-            u8* seed = seed_data + (2000*8) + (i*16);
-            if (memcmp(titleId + 4, magic, 4) != 0)
-                continue;
-            // Bravely Second demo seed workaround
-            if (memcmp(seed, zeroes, 16) == 0)
-                seed = buffer + seed_offset[(n+1)%2] + (2000 * 8) + (i*16);
-            if (memcmp(seed, zeroes, 16) == 0)
-                continue;
-            // seed found, check if it already exists
-            u32 entryPos = 0;
-            for (entryPos = 0; entryPos < seedinfo->n_entries; entryPos++)
-                if (memcmp(titleId, &(seedinfo->entries[entryPos].titleId), 8) == 0)
-                    break;
-            if (entryPos < seedinfo->n_entries) {
-                Debug("Found %08X%08X seed (duplicate)", getle32(titleId + 4), getle32(titleId));
-                continue;
-            }
-            // seed is new, create a new entry
-            Debug("Found %08X%08X seed (new)", getle32(titleId + 4), getle32(titleId));
-            memset(&(seedinfo->entries[entryPos]), 0x00, sizeof(SeedInfoEntry));
-            memcpy(&(seedinfo->entries[entryPos].titleId), titleId, 8);
-            memcpy(&(seedinfo->entries[entryPos].external_seed), seed, 16);
-            seedinfo->n_entries++;
-            nNewSeeds++;
-        }
+    // seeds only found in NAND are new
+    for (u32 i = 0; i < store->n_entries; i++) {
+        SeedInfoEntry* entry = &(store->entries[i]);
+        if (entry->reserved[0] != SEED_SRC_NAND)
+            continue;
+        Debug("Found %08X%08X seed (new)", (u32) (entry->titleId >> 32), (u32) entry->titleId);
+        nNewSeeds++;
     }
     
     if (nNewSeeds == 0) {
-        Debug("Found no new seeds, %i total", seedinfo->n_entries);
+        Debug("Found no new seeds, %i total", store->n_entries);
         return 0;
     }
     
-    Debug("Found %i new seeds, %i total", nNewSeeds, seedinfo->n_entries);
-    if (!FileDumpData("seeddb.bin", seedinfo, 16 + seedinfo->n_entries * sizeof(SeedInfoEntry))) {
+    // seeddb.bin is written sorted, without the in-memory source markers
+    Debug("Found %i new seeds, %i total", nNewSeeds, store->n_entries);
+    for (u32 i = 0; i < store->n_entries; i++)
+        store->entries[i].reserved[0] = 0;
+    if (!FileDumpData("seeddb.bin", store, 16 + store->n_entries * sizeof(SeedInfoEntry))) {
         Debug("Failed writing file");
+        InvalidateSeedStore();
         return 1;
     }
+    for (u32 i = 0; i < store->n_entries; i++)
+        store->entries[i].reserved[0] = SEED_SRC_SEEDDB;
     
     return 0;
 }
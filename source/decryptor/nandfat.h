@@ -22,21 +22,38 @@
 #define F_CONFIGSAVE  (1<<14)
 #define FF_AUTONAME   (1<<20)
 
+#define TITLE_INDEX_MAX 1000
+
 typedef struct {
     char name[32];
     u32 tid_high;
     u32 tid_low[6];
 } TitleListInfo;
 
+typedef struct {
+    u64 title_id;
+    u32 tmd_id;
+} __attribute__((packed)) TitleIndexEntry;
+
+typedef struct {
+    u32 n_titles;
+    TitleIndexEntry titles[TITLE_INDEX_MAX];
+} __attribute__((packed)) TitleIndex;
+
 typedef struct {
     char name_l[32];
     char name_s[32];
     char path[64];
+    char fat_path[64];
     u32 partition_id;
 } NandFileInfo;
 
 u32 SeekFileInNand(u32* offset, u32* size, const char* path, PartitionInfo* partition);
 u32 DebugSeekFileInNand(u32* offset, u32* size, const char* filename, const char* path, PartitionInfo* partition);
+NandFileInfo* GetNandFileInfo(u32 file_id);
+u32 GetNandFilePath(char* path, NandFileInfo* f_info);
+u32 DebugOpenNandFile(u32* size, NandFileInfo* f_info);
+void InvalidateNandIndices(void);
 u32 SeekTitleInNandDb(u32 tid_high, u32 tid_low, u32* tmd_id);
 u32 DebugSeekTitleInNand(u32* offset_tmd, u32* size_tmd, u32* offset_app, u32* size_app, TitleListInfo* title_info, u32 max_cnt);
 u32 FixCmac(u8* cmac, u8* data, u32 size, u32 keyslot);
@@ -46,7 +63,7 @@ u32 GetSystemId0(u8* id0);
 u32 ValidateSeed(u8* seed, u64 titleId, u8* hash);
 u32 DumpNcchFirm(u32 firm_idx, bool version, bool a9l_decrypt);
 u32 CheckNandFile(u32 param);
-u32 FindSeedInSeedSave(u8* seed, u64 titleId, u8* hash);
+u32 FindSeed(u8* seed, u64 titleId, u8* hash);
 
 // --> FEATURE FUNCTIONS <--
 u32 DumpNandFile(u32 param);
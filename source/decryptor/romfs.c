@@ -0,0 +1,575 @@
+#include "fs.h"
+#include "draw.h"
+#include "timer.h"
+#include "decryptor/sha.h"
+#include "decryptor/hashfile.h"
+#include "decryptor/game.h"
+#include "decryptor/cryptstream.h"
+#include "decryptor/romfs.h"
+
+#define CRYPT_STREAM    ((CryptStream*) 0x224A0000)
+#define ROMFS_DIRMETA   ((u8*) 0x20400000) // allow using 0x80000 byte
+#define ROMFS_FILEMETA  ((u8*) 0x20480000) // allow using 0x80000 byte
+#define ROMFS_FILELIST  ((RomFsFileRef*) 0x20500000) // allow using 0xC0000 byte
+#define ROMFS_MAX_FILES 0x10000
+#define EXTRACT_PATTERNS ((char*) 0x205C0000) // allow using 0x10000 byte
+#define EXTRACT_DIRLIST  ((char*) 0x205D0000) // allow using 0x30000 byte
+#define IVFC_HASH_BUFFER (BUFFER_ADDRESS + 0xF0000) // hashes go behind the data
+#define IVFC_DATA_MAX    0xF0000
+#define IVFC_HASH_MAX    0x10000
+#define IVFC_QUICK_SAMPLES 256
+
+typedef struct {
+    u32 offset_data;
+    u32 size_data;
+    u32 offset_meta;
+} RomFsFileRef;
+
+typedef struct {
+    u32 offset_data;
+    u32 size_data;
+    u32 offset_hash;
+    u32 log_block;
+    u32 n_blocks;
+} IvfcVerifyLevel;
+
+
+static bool MatchPattern(const char* pattern, const char* str)
+{
+    // '*' matches any number of chars (including '/'), '?' matches one char
+    for (; *pattern; pattern++, str++) {
+        if (*pattern == '*') {
+            for (; *str; str++)
+                if (MatchPattern(pattern + 1, str))
+                    return true;
+            return MatchPattern(pattern + 1, str);
+        }
+        if (!*str || ((*pattern != '?') && (tolower((int) *pattern) != tolower((int) *str))))
+            return false;
+    }
+    return !*str;
+}
+
+static bool IsSelected(const char* path, const char* patterns)
+{
+    // patterns is a list of lines, NULL selects everything
+    if (!patterns)
+        return true;
+    for (const char* line = patterns; *line; ) {
+        char pattern[256];
+        u32 len = strcspn(line, "\r\n");
+        if (len && (len < 256)) {
+            memcpy(pattern, line, len);
+            pattern[len] = '\0';
+            if (MatchPattern(pattern, path))
+                return true;
+        }
+        line += len;
+        line += strspn(line, "\r\n");
+    }
+    return false;
+}
+
+static void SanitizeName(char* name)
+{
+    // names from the image must stay inside the output dir: no separators, no "." / ".."
+    for (char* c = name; *c; c++)
+        if ((*c == '/') || (*c == '\\') || (*c == ':')) *c = '_';
+    if (!*name || (strncmp(name, ".", 2) == 0))
+        strcpy(name, "_");
+    else if (strncmp(name, "..", 3) == 0)
+        strcpy(name, "__");
+}
+
+static void GetRomFsName(char* name, const u8* name16, u32 name_len)
+{
+    // UTF-16 -> ASCII, anything else becomes '_'
+    u32 len = min(name_len / 2, 255);
+    for (u32 i = 0; i < len; i++) {
+        u16 c = getle16(name16 + (2*i));
+        name[i] = ((c >= 0x20) && (c < 0x80)) ? (char) c : '_';
+    }
+    name[len] = '\0';
+    SanitizeName(name);
+}
+
+static u32 GetRomFsFilePath(char* path, u32 size, u8* dirmeta, u32 size_dirmeta, RomFsLv3FileMeta* file)
+{
+    // builds "romfs/<dirs>/<file>", returns 1 if the tables are inconsistent
+    u32 chain[32];
+    u32 depth = 0;
+    char name[256];
+    
+    for (u32 offset = file->offset_parent; offset != 0; ) {
+        if ((depth >= 32) || ((u64) offset + sizeof(RomFsLv3DirMeta) > size_dirmeta))
+            return 1;
+        chain[depth++] = offset;
+        offset = ((RomFsLv3DirMeta*) (dirmeta + offset))->offset_parent;
+    }
+    
+    snprintf(path, size, "romfs");
+    while (depth--) {
+        RomFsLv3DirMeta* dir = (RomFsLv3DirMeta*) (dirmeta + chain[depth]);
+        if ((u64) chain[depth] + sizeof(RomFsLv3DirMeta) + dir->name_len > size_dirmeta)
+            return 1;
+        GetRomFsName(name, (u8*) dir + sizeof(RomFsLv3DirMeta), dir->name_len);
+        u32 plen = strnlen(path, size);
+        snprintf(path + plen, size - plen, "/%s", name);
+    }
+    GetRomFsName(name, (u8*) file + sizeof(RomFsLv3FileMeta), file->name_len);
+    u32 plen = strnlen(path, size);
+    snprintf(path + plen, size - plen, "/%s", name);
+    
+    return 0;
+}
+
+static int CompareFileRefs(const void* a, const void* b)
+{
+    const RomFsFileRef* ref_a = (const RomFsFileRef*) a;
+    const RomFsFileRef* ref_b = (const RomFsFileRef*) b;
+    return (ref_a->offset_data < ref_b->offset_data) ? -1 : (ref_a->offset_data > ref_b->offset_data) ? 1 : 0;
+}
+
+static bool GetGameNcchOffsets(CryptStream* stream, const char* path, u8* header, u32* offsets)
+{
+    // finds the NCCHs inside a NCCH / NCSD / CIA file, unused offsets are (u32) -1
+    // header receives the first 0x200 byte of the file
+    memset(offsets, 0xFF, 8 * sizeof(u32));
+    
+    if (FileGetData(path, header, 0x200, 0) != 0x200)
+        return false;
+    if (memcmp(header + 0x100, "NCCH", 4) == 0) {
+        offsets[0] = 0;
+    } else if ((memcmp(header + 0x100, "NCSD", 4) == 0) && (getle64(header + 0x110) == 0)) {
+        NcsdHeader* ncsd = (NcsdHeader*) header;
+        for (u32 p = 0; p < 8; p++)
+            if (ncsd->partitions[p].size)
+                offsets[p] = ncsd->partitions[p].offset * 0x200;
+    } else if (memcmp(header, "\x20\x20", 2) == 0) {
+        for (u32 c = 0; (c < 8) && (CryptStreamOpenCia(stream, path, c) == 0); c++)
+            offsets[c] = stream->offset;
+    } else return false;
+    
+    return true;
+}
+
+static u32 OpenGameNcch(CryptStream* stream, const char* path, u8* header, u32 index, u32 offset)
+{
+    // NCSD partitions use the media id as seed id, CIA contents may still be titlekey encrypted
+    if (memcmp(header, "\x20\x20", 2) == 0)
+        return CryptStreamOpenCiaNcch(stream, path, index, 0);
+    u64 seedId = ((index > 0) && (memcmp(header + 0x100, "NCSD", 4) == 0)) ? getle64(header + 0x108) : 0;
+    return CryptStreamOpenNcch(stream, path, offset, seedId);
+}
+
+static u32 VerifyIvfcBlocks(CryptStream* stream, IvfcVerifyLevel* lvl, u32 limit, u32 first, u32 count)
+{
+    // checks count blocks starting at first against their hashes from the level above
+    // limit is the end of the RomFS, block parts behind it are zero padded
+    u8* buffer = BUFFER_ADDRESS;
+    u8* hashes = IVFC_HASH_BUFFER;
+    u32 block_size = 1 << lvl->log_block;
+    u32 offset = lvl->offset_data + (first << lvl->log_block);
+    u32 size = count << lvl->log_block;
+    u32 read_bytes = min(size, limit - offset);
+    
+    if ((CryptStreamRead(stream, hashes, lvl->offset_hash + (first * 0x20), count * 0x20) != 0) ||
+        (CryptStreamRead(stream, buffer, offset, read_bytes) != 0))
+        return 1;
+    if (read_bytes < size)
+        memset(buffer + read_bytes, 0x00, size - read_bytes);
+    for (u32 i = 0; i < count; i++) {
+        u8 digest[32];
+        sha_quick(digest, buffer + (i * block_size), block_size, SHA256_MODE);
+        if (memcmp(digest, hashes + (i * 0x20), 32) != 0) {
+            Debug("Hash mismatch in block %lu", first + i);
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+static u32 VerifyIvfcLevel(CryptStream* stream, IvfcVerifyLevel* lvl, u32 limit, u32 n_samples)
+{
+    // n_samples == 0 checks all blocks, otherwise one random block per 1/n_samples of the level
+    u32 chunk_blocks = min(IVFC_DATA_MAX >> lvl->log_block, IVFC_HASH_MAX / 0x20);
+    
+    if (n_samples && (n_samples < lvl->n_blocks)) {
+        u32 rng = (u32) timer_ticks() ^ lvl->offset_data ^ 0x9E3779B9;
+        for (u32 s = 0; s < n_samples; s++) {
+            u32 first = (u32) (((u64) s * lvl->n_blocks) / n_samples);
+            u32 last = (u32) (((u64) (s + 1) * lvl->n_blocks) / n_samples);
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            if (VerifyIvfcBlocks(stream, lvl, limit, first + (rng % (last - first)), 1) != 0)
+                return 1;
+        }
+        return 0;
+    }
+    
+    for (u32 b = 0; b < lvl->n_blocks; b += chunk_blocks) {
+        u32 count = min(chunk_blocks, lvl->n_blocks - b);
+        if (lvl->size_data >= 0x100000) ShowProgress(b, lvl->n_blocks);
+        if (VerifyIvfcBlocks(stream, lvl, limit, b, count) != 0) {
+            ShowProgress(0, 0);
+            return 1;
+        }
+    }
+    ShowProgress(0, 0);
+    
+    return 0;
+}
+
+static u32 ExtractStreamToFile(CryptStream* stream, const char* path, u32 offset, u32 size)
+{
+    u8* buffer = BUFFER_ADDRESS;
+    u32 result = 0;
+    
+    if (!OutFileCreate(path, size)) {
+        Debug("Could not create %s", path);
+        return 1;
+    }
+    for (u32 i = 0; i < size; i += BUFFER_MAX_SIZE) {
+        u32 read_bytes = min(BUFFER_MAX_SIZE, size - i);
+        if ((CryptStreamRead(stream, buffer, offset + i, read_bytes) != 0) ||
+            (OutFileAppend(buffer, read_bytes) != read_bytes)) {
+            result = 1;
+            break;
+        }
+    }
+    if (result != 0) {
+        OutFileAbort();
+        return 1;
+    }
+    
+    return (OutFileCommit()) ? 0 : 1;
+}
+
+u32 GetRomFsLv3Offset(RomFsIvfcHeader* ivfc)
+{
+    // returns 0 if this is not a valid IVFC header
+    if ((memcmp(ivfc->magic, "IVFC", 4) != 0) || (ivfc->magic_number != 0x10000) ||
+        (ivfc->level[2].log_block < 4) || (ivfc->level[2].log_block > 24))
+        return 0;
+    return align(sizeof(RomFsIvfcHeader) + ivfc->size_masterhash, 1 << ivfc->level[2].log_block);
+}
+
+u32 ExtractNcchFiles(CryptStream* stream, const char* outdir, const char* patterns)
+{
+    // extracts ExeFS and RomFS files selected by patterns (one per line, NULL for all)
+    // only the metadata and the selected files are read / decrypted
+    NcchHeader ncch;
+    char path[256];
+    u32 n_extracted = 0;
+    u32 n_failed = 0;
+    
+    if ((CryptStreamRead(stream, &ncch, 0, 0x200) != 0) || (memcmp(ncch.magic, "NCCH", 4) != 0))
+        return 1;
+    
+    // ExeFS, files in header order (that is also their data order)
+    if (ncch.size_exefs > 0) {
+        u8 exefs_hdr[0x200];
+        u32 offset_exefs = ncch.offset_exefs * 0x200;
+        if (CryptStreamRead(stream, exefs_hdr, offset_exefs, 0x200) != 0)
+            return 1;
+        for (u32 i = 0; i < 10; i++) {
+            char name[9] = { 0 };
+            u32 offset_file = getle32(exefs_hdr + (i*0x10) + 0x8) + 0x200;
+            u32 size_file = getle32(exefs_hdr + (i*0x10) + 0xC);
+            memcpy(name, exefs_hdr + (i*0x10), 8);
+            if (!*name || !size_file)
+                continue;
+            SanitizeName(name);
+            snprintf(path, 256, "exefs/%s", name);
+            if (!IsSelected(path, patterns))
+                continue;
+            if ((u64) offset_file + size_file > (u64) ncch.size_exefs * 0x200) {
+                Debug("ExeFS %s out of bounds", name);
+                n_failed++;
+                continue;
+            }
+            Debug("%s", path);
+            snprintf(path, 256, "%s/exefs/%s.bin", outdir, name);
+            if (ExtractStreamToFile(stream, path, offset_exefs + offset_file, size_file) == 0) n_extracted++;
+            else n_failed++;
+        }
+    }
+    
+    // RomFS, files sorted by their data offset for sequential reads
+    if (ncch.size_romfs > 0) {
+        u8* dirmeta = ROMFS_DIRMETA;
+        u8* filemeta = ROMFS_FILEMETA;
+        RomFsFileRef* files = ROMFS_FILELIST;
+        RomFsIvfcHeader ivfc;
+        RomFsLv3Header lv3;
+        u32 offset_romfs = ncch.offset_romfs * 0x200;
+        u32 offset_lv3;
+        u32 n_files = 0;
+        
+        if ((CryptStreamRead(stream, &ivfc, offset_romfs, sizeof(RomFsIvfcHeader)) != 0) ||
+            !(offset_lv3 = GetRomFsLv3Offset(&ivfc))) {
+            Debug("Bad RomFS IVFC header");
+            return 1;
+        }
+        offset_lv3 += offset_romfs;
+        if ((CryptStreamRead(stream, &lv3, offset_lv3, sizeof(RomFsLv3Header)) != 0) ||
+            (lv3.size_header != sizeof(RomFsLv3Header)) || (lv3.size_dirmeta > 0x80000) || (lv3.size_filemeta > 0x80000)) {
+            Debug("Bad RomFS level 3 header");
+            return 1;
+        }
+        if ((CryptStreamRead(stream, dirmeta, offset_lv3 + lv3.offset_dirmeta, lv3.size_dirmeta) != 0) ||
+            (CryptStreamRead(stream, filemeta, offset_lv3 + lv3.offset_filemeta, lv3.size_filemeta) != 0))
+            return 1;
+        
+        // select files, file data has to be inside the NCCH
+        u64 offset_filedata = (u64) offset_lv3 + lv3.offset_filedata;
+        u64 size_filedata = ((u64) ncch.size * 0x200 > offset_filedata) ? ((u64) ncch.size * 0x200) - offset_filedata : 0;
+        for (u32 offset = 0; offset + sizeof(RomFsLv3FileMeta) <= lv3.size_filemeta; ) {
+            RomFsLv3FileMeta* file = (RomFsLv3FileMeta*) (filemeta + offset);
+            if ((u64) offset + sizeof(RomFsLv3FileMeta) + file->name_len > lv3.size_filemeta)
+                break;
+            if ((GetRomFsFilePath(path, 256, dirmeta, lv3.size_dirmeta, file) == 0) && IsSelected(path, patterns)) {
+                if (n_files >= ROMFS_MAX_FILES) {
+                    Debug("Too many files selected");
+                    break;
+                }
+                if ((file->offset_data > size_filedata) || (file->size_data > size_filedata - file->offset_data)) {
+                    Debug("%s out of bounds", path);
+                    n_failed++;
+                } else {
+                    files[n_files].offset_data = lv3.offset_filedata + file->offset_data;
+                    files[n_files].size_data = file->size_data;
+                    files[n_files].offset_meta = offset;
+                    n_files++;
+                }
+            }
+            offset += sizeof(RomFsLv3FileMeta) + align(file->name_len, 4);
+        }
+        qsort(files, n_files, sizeof(RomFsFileRef), CompareFileRefs);
+        
+        // extract files
+        for (u32 i = 0; i < n_files; i++) {
+            RomFsLv3FileMeta* file = (RomFsLv3FileMeta*) (filemeta + files[i].offset_meta);
+            char* subpath = path + snprintf(path, 256, "%s/", outdir);
+            GetRomFsFilePath(subpath, 256 - (subpath - path), dirmeta, lv3.size_dirmeta, file);
+            if ((u64) offset_lv3 + files[i].offset_data + files[i].size_data > (u64) ncch.size * 0x200) {
+                Debug("%s out of bounds", subpath);
+                n_failed++;
+                continue;
+            }
+            Debug("%s (%lukB)", subpath, files[i].size_data / 1024);
+            if (ExtractStreamToFile(stream, path, offset_lv3 + files[i].offset_data, files[i].size_data) == 0) n_extracted++;
+            else n_failed++;
+            if (DebugCheckCancel())
+                return 1;
+        }
+    }
+    
+    Debug("%lu files extracted / %lu failed", n_extracted, n_failed);
+    return (n_failed) ? 1 : 0;
+}
+
+u32 VerifyRomFs(CryptStream* stream, bool quick)
+{
+    // checks the whole IVFC hash tree of a NCCH RomFS, aborts at the first mismatch
+    // superblock -> master hash -> level 1 -> level 2 -> level 3 (the actual data)
+    // quick mode checks levels 1 and 2 in full, but only a random sample of level 3
+    NcchHeader ncch;
+    RomFsIvfcHeader ivfc;
+    IvfcVerifyLevel lvl[3];
+    u8 digest[32];
+    
+    if ((CryptStreamRead(stream, &ncch, 0, 0x200) != 0) || (memcmp(ncch.magic, "NCCH", 4) != 0))
+        return HASH_FAILED;
+    if ((ncch.size_romfs == 0) || (ncch.size_romfs_hash == 0))
+        return HASH_NOT_FOUND;
+    
+    u32 offset_romfs = ncch.offset_romfs * 0x200;
+    u32 size_romfs = ncch.size_romfs * 0x200;
+    u32 size_super = ncch.size_romfs_hash * 0x200;
+    u32 offset_lv3;
+    if ((offset_romfs + size_romfs > stream->size) || (size_super > min(size_romfs, IVFC_DATA_MAX)) ||
+        (CryptStreamRead(stream, &ivfc, offset_romfs, sizeof(RomFsIvfcHeader)) != 0) ||
+        !(offset_lv3 = GetRomFsLv3Offset(&ivfc)) || (sizeof(RomFsIvfcHeader) + ivfc.size_masterhash > size_super)) {
+        Debug("Bad RomFS IVFC header");
+        return HASH_FAILED;
+    }
+    
+    // superblock (IVFC header + master hash) against the NCCH header
+    if (CryptStreamRead(stream, BUFFER_ADDRESS, offset_romfs, size_super) != 0)
+        return HASH_FAILED;
+    sha_quick(digest, BUFFER_ADDRESS, size_super, SHA256_MODE);
+    if (memcmp(digest, ncch.hash_romfs, 32) != 0) {
+        Debug("RomFS superblock hash mismatch");
+        return HASH_FAILED;
+    }
+    
+    // level layout: level 3 first, then levels 1 and 2, each aligned to its block size
+    for (u32 i = 0; i < 3; i++) {
+        lvl[i].log_block = ivfc.level[i].log_block;
+        if ((lvl[i].log_block < 4) || (lvl[i].log_block > 19) || (ivfc.level[i].size > size_romfs)) {
+            Debug("Bad RomFS IVFC level %lu", i + 1);
+            return HASH_FAILED;
+        }
+        lvl[i].size_data = ivfc.level[i].size;
+        lvl[i].n_blocks = (lvl[i].size_data + (1 << lvl[i].log_block) - 1) >> lvl[i].log_block;
+    }
+    lvl[2].offset_data = offset_romfs + offset_lv3;
+    lvl[0].offset_data = lvl[2].offset_data + align(lvl[2].size_data, 1 << lvl[2].log_block);
+    lvl[1].offset_data = lvl[0].offset_data + align(lvl[0].size_data, 1 << lvl[0].log_block);
+    lvl[0].offset_hash = offset_romfs + sizeof(RomFsIvfcHeader);
+    lvl[1].offset_hash = lvl[0].offset_data;
+    lvl[2].offset_hash = lvl[1].offset_data;
+    if ((lvl[1].offset_data + lvl[1].size_data > offset_romfs + size_romfs) ||
+        (lvl[0].n_blocks * 0x20 > ivfc.size_masterhash) ||
+        (lvl[1].n_blocks * 0x20 > lvl[0].size_data) ||
+        (lvl[2].n_blocks * 0x20 > lvl[1].size_data)) {
+        Debug("RomFS IVFC levels out of bounds");
+        return HASH_FAILED;
+    }
+    
+    // top to bottom, so every level is checked against already verified hashes
+    for (u32 i = 0; i < 3; i++) {
+        u32 n_samples = (quick && (i == 2)) ? IVFC_QUICK_SAMPLES : 0;
+        if (VerifyIvfcLevel(stream, lvl + i, offset_romfs + size_romfs, n_samples) != 0) {
+            Debug("RomFS IVFC level %lu verification failed", i + 1);
+            return HASH_FAILED;
+        }
+    }
+    
+    return HASH_VERIFIED;
+}
+
+u32 VerifyNcchRomFs(const char* filename, u32 offset, bool quick)
+{
+    CryptStream* stream = CRYPT_STREAM;
+    
+    if (CryptStreamOpenNcch(stream, filename, offset, 0) != 0)
+        return HASH_FAILED;
+    
+    return VerifyRomFs(stream, quick);
+}
+
+u32 ExtractGameFiles(u32 param)
+{
+    (void) (param); // param is unused here
+    CryptStream* stream = CRYPT_STREAM;
+    char* patterns = EXTRACT_PATTERNS;
+    char* filelist = EXTRACT_DIRLIST;
+    const char* batch_dir = GetGameDir();
+    u8 header[0x200];
+    u32 n_processed = 0;
+    u32 n_failed = 0;
+    
+    if (!batch_dir || !GetFileList(batch_dir, filelist, 0x30000, false, true, false)) {
+        Debug("Game directory not found!");
+        Debug("(check readme for more info)");
+        return 1;
+    }
+    
+    // optional file selection, one pattern per line (f.e. "romfs/sound/*.bcstm")
+    u32 psize = FileGetData("extract.txt", patterns, 0x10000 - 1, 0);
+    patterns[psize] = '\0';
+    if (psize) Debug("Using file selection from extract.txt");
+    Debug("");
+    
+    u32 path_len = strnlen(batch_dir, 128) + 1;
+    for (char* path = strtok(filelist, "\n"); path != NULL; path = strtok(NULL, "\n")) {
+        char outdir[256];
+        u32 offsets[8];
+        
+        if (!GetGameNcchOffsets(stream, path, header, offsets))
+            continue;
+        
+        Debug("Extracting \"%s\"", path + path_len);
+        u32 result = 0;
+        u32 n_found = 0;
+        for (u32 i = 0; i < 8; i++) {
+            if (offsets[i] == (u32) -1)
+                continue;
+            if (OpenGameNcch(stream, path, header, i, offsets[i]) != 0)
+                continue;
+            if (i == 0) snprintf(outdir, 256, "%s_extracted", path);
+            else snprintf(outdir, 256, "%s_extracted/%lu", path, i);
+            result |= ExtractNcchFiles(stream, outdir, (psize) ? patterns : NULL);
+            n_found++;
+        }
+        if (n_found && (result == 0)) {
+            Debug("Success!");
+            n_processed++;
+        } else {
+            Debug("Failed!");
+            n_failed++;
+        }
+        Debug("");
+    }
+    
+    if (n_processed) {
+        Debug("%ux processed / %ux failed ", n_processed, n_failed);
+    } else if (!n_failed) {
+        Debug("Nothing found in %s/!", batch_dir);
+    }
+    
+    return !n_processed;
+}
+
+u32 VerifyGameFiles(u32 param)
+{
+    CryptStream* stream = CRYPT_STREAM;
+    char* filelist = EXTRACT_DIRLIST;
+    const char* batch_dir = GetGameDir();
+    bool quick = param & RV_QUICK;
+    u8 header[0x200];
+    u32 n_processed = 0;
+    u32 n_failed = 0;
+    
+    if (!batch_dir || !GetFileList(batch_dir, filelist, 0x30000, false, true, false)) {
+        Debug("Game directory not found!");
+        Debug("(check readme for more info)");
+        return 1;
+    }
+    
+    u32 path_len = strnlen(batch_dir, 128) + 1;
+    for (char* path = strtok(filelist, "\n"); path != NULL; path = strtok(NULL, "\n")) {
+        u32 offsets[8];
+        
+        if (!GetGameNcchOffsets(stream, path, header, offsets))
+            continue;
+        
+        Debug("Verifying \"%s\" (%s)", path + path_len, (quick) ? "quick" : "full");
+        u32 result = 0;
+        u32 n_found = 0;
+        for (u32 i = 0; i < 8; i++) {
+            if (offsets[i] == (u32) -1)
+                continue;
+            if (OpenGameNcch(stream, path, header, i, offsets[i]) != 0)
+                continue;
+            u32 ver_romfs = VerifyRomFs(stream, quick);
+            Debug("Partition / content %lu RomFS: %s", i, (ver_romfs == HASH_VERIFIED) ? "OK" :
+                (ver_romfs == HASH_NOT_FOUND) ? "-" : "Fail");
+            if (ver_romfs == HASH_FAILED)
+                result = 1;
+            n_found++;
+            if (DebugCheckCancel())
+                return 1;
+        }
+        if (n_found && (result == 0)) {
+            Debug("Verified!");
+            n_processed++;
+        } else {
+            Debug("Failed!");
+            n_failed++;
+        }
+        Debug("");
+    }
+    
+    if (n_processed || n_failed) {
+        Debug("%ux verified / %ux failed ", n_processed, n_failed);
+    } else {
+        Debug("Nothing found in %s/!", batch_dir);
+    }
+    
+    return (n_failed || !n_processed) ? 1 : 0;
+}
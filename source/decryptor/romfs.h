@@ -0,0 +1,66 @@
+#pragma once
+
+#include "common.h"
+#include "decryptor/cryptstream.h"
+
+#define RV_QUICK (1<<0)
+
+// see: https://www.3dbrew.org/wiki/RomFS
+typedef struct {
+    u64 offset;
+    u64 size;
+    u32 log_block;
+    u8  reserved[4];
+} __attribute__((packed)) IvfcLevel;
+
+typedef struct {
+    u8  magic[4]; // "IVFC"
+    u32 magic_number; // 0x10000
+    u32 size_masterhash;
+    IvfcLevel level[3];
+    u32 size_header;
+    u8  reserved[4];
+    u8  padding[4];
+} __attribute__((packed)) RomFsIvfcHeader;
+
+typedef struct {
+    u32 size_header;
+    u32 offset_dirhash;
+    u32 size_dirhash;
+    u32 offset_dirmeta;
+    u32 size_dirmeta;
+    u32 offset_filehash;
+    u32 size_filehash;
+    u32 offset_filemeta;
+    u32 size_filemeta;
+    u32 offset_filedata;
+} __attribute__((packed)) RomFsLv3Header;
+
+typedef struct {
+    u32 offset_parent;
+    u32 offset_sibling;
+    u32 offset_child;
+    u32 offset_file;
+    u32 offset_samehash;
+    u32 name_len;
+    u16 name[];
+} __attribute__((packed)) RomFsLv3DirMeta;
+
+typedef struct {
+    u32 offset_parent;
+    u32 offset_sibling;
+    u64 offset_data;
+    u64 size_data;
+    u32 offset_samehash;
+    u32 name_len;
+    u16 name[];
+} __attribute__((packed)) RomFsLv3FileMeta;
+
+u32 GetRomFsLv3Offset(RomFsIvfcHeader* ivfc);
+u32 ExtractNcchFiles(CryptStream* stream, const char* outdir, const char* patterns);
+u32 VerifyRomFs(CryptStream* stream, bool quick);
+u32 VerifyNcchRomFs(const char* filename, u32 offset, bool quick);
+
+// --> FEATURE FUNCTIONS <--
+u32 ExtractGameFiles(u32 param);
+u32 VerifyGameFiles(u32 param);
@@ -36,7 +36,7 @@ u32 CryptTitlekeysFile(u32 param)
         FileClose();
         return 1;
     }
-    if (!info->n_entries || info->n_entries > 16384) {
+    if (!info->n_entries || info->n_entries > TK_MAX_ENTRIES) {
         Debug("Too many/few entries specified: %i", info->n_entries);
         FileClose();
         return 1;
@@ -66,71 +66,208 @@ u32 CryptTitlekeysFile(u32 param)
     return 0;
 }
 
-u32 DumpTicketsTitlekeys(u32 param)
+// hash set of title ids (stored as entry index + 1) for the ticket dedupe
+#define TK_HASH_SLOTS   0x10000 // power of two, at least twice TK_MAX_ENTRIES
+#define TK_TICKET_SIZE  (0x140 + 0x210) // signature + ticket data
+
+static u32* FindTitleIdSlot(u32* table, TitleKeysInfo* info, const u8* titleId)
 {
+    // returns the matching slot or the first free one
+    u64 hash = getle64(titleId);
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    for (u32 h = hash & (TK_HASH_SLOTS - 1);; h = (h + 1) & (TK_HASH_SLOTS - 1)) {
+        if (!table[h] || (memcmp(info->entries[table[h] - 1].titleId, titleId, 8) == 0))
+            return table + h;
+    }
+}
+
+static u32 ProcessTicket(u8* ticket, TitleKeysInfo* info, u32* table, u32 param)
+{
+    // returns 0 if added, 1 if skipped, 2 if this is not a valid ticket
     const u8 sig_type[4] =  { 0x00, 0x01, 0x00, 0x04 };
+    u8* tdata = ticket + 0x140;
+    char filename[64];
+    
+    if ((memcmp(ticket, sig_type, 4) != 0) ||
+        ((memcmp(tdata, (u8*) "Root-CA00000003-XS0000000c", 26) != 0) &&  // retail tickets
+         (memcmp(tdata, (u8*) "Root-CA00000004-XS00000009", 26) != 0)))   // devkit tickets
+        return 2;
+    
+    u32 consoleId = getle32(tdata + 0x98);
+    u8* titleId = tdata + 0x9C;
+    u32 commonKeyIndex = *(tdata + 0xB1);
+    u8* titlekey = tdata + 0x7F;
+    u32* slot = FindTitleIdSlot(table, info, titleId);
+    if ((!consoleId && !(param & TK_TICKETS)) || *slot)
+        return 1; // skip duplicates / invalid
+    
+    u32 n = info->n_entries;
+    memset(&(info->entries[n]), 0, sizeof(TitleKeyEntry));
+    memcpy(info->entries[n].titleId, titleId, 8);
+    memcpy(info->entries[n].titleKey, titlekey, 16);
+    info->entries[n].commonKeyIndex = commonKeyIndex;
+    if (param & TK_TICKETS) {
+        snprintf(filename, 64, "%02lX-%08lX-%016llX.tik",
+            commonKeyIndex, consoleId, getbe64(titleId));
+        Debug("Dumping %s...", filename);
+        FileDumpData(filename, ticket, TK_TICKET_SIZE);
+    } else if (!(param & TK_ENCRYPTED)) {
+        CryptTitlekey(&(info->entries[n]), false);
+    }
+    *slot = ++(info->n_entries);
+    
+    return 0;
+}
+
+static u32 ReadBdriFileStart(u8* out, u32 size, u32 block, u32 offset_data, u32 block_size, u32* fat, u32 n_fat)
+{
+    // follows the FAT chain of a file in the inner filesystem, reads its first size bytes
+    // see: https://www.3dbrew.org/wiki/Inner_FAT#File_Allocation_Table
+    u32 node = block + 1; // FAT entries are 1-based
+    while (size && node && (node <= n_fat)) {
+        u32 node_end = node;
+        if (fat[(node * 2) + 1] & 0x80000000) { // multi block node
+            if ((node + 1 > n_fat) || !(fat[(node + 1) * 2] & 0x80000000))
+                return 1;
+            node_end = fat[((node + 1) * 2) + 1] & 0x7FFFFFFF;
+            if ((node_end < node) || (node_end > n_fat))
+                return 1;
+        }
+        u32 read_bytes = min(size, (node_end - node + 1) * block_size);
+        if (FileRead(out, read_bytes, offset_data + ((node - 1) * block_size)) != read_bytes)
+            return 1;
+        out += read_bytes;
+        size -= read_bytes;
+        node = fat[(node * 2) + 1] & 0x7FFFFFFF;
+    }
     
-    PartitionInfo* ctrnand_info = GetPartitionInfo(P_CTRNAND);;
+    return (size) ? 1 : 0;
+}
+
+static u32 ParseTicketDb(u32 size, TitleKeysInfo* info, u32* table, u32 param, u32* nSkipped)
+{
+    // walks the ticket.db entry tables, this assumes the ticket.db to be opened
+    // returns 1 if the structure was not recognized (nothing processed in that case), 2 if cancelled
     u8* buffer = BUFFER_ADDRESS;
-    TitleKeysInfo *info = (TitleKeysInfo*) 0x20316000;
-    char filename[64];
+    u32* fat = (u32*) 0x20440000; // allow using 0x100000 byte
+    BdriHeader* bdri = NULL;
+    u32 offset_bdri = 0;
     
-    u32 nKeys = 0;
-    u32 nSkipped = 0;
-    u32 offset = 0;
-    u32 size = 0;
+    // find the 'TICK' preheader / BDRI header inside the DIFF container
+    u32 read_bytes = min(BUFFER_MAX_SIZE, size);
+    if (FileRead(buffer, read_bytes, 0) != read_bytes)
+        return 1;
+    for (u32 i = 0; i + 0x10 + sizeof(BdriHeader) <= read_bytes; i += 0x10) {
+        if ((memcmp(buffer + i, "TICK", 4) == 0) && (memcmp(buffer + i + 0x10, "BDRI", 4) == 0)) {
+            offset_bdri = i + 0x10;
+            bdri = (BdriHeader*) (buffer + offset_bdri);
+            break;
+        }
+    }
+    if (!bdri || (bdri->version != 0x30000) || !bdri->data_block_size ||
+        (bdri->data_block_size > 0x1000) || ((bdri->fat_entry_count + 1) * 8 > 0x100000))
+        return 1;
     
-    if (DebugSeekFileInNand(&offset, &size, "ticket.db", "DBS        TICKET  DB ", ctrnand_info) != 0)
+    u32 block_size = bdri->data_block_size;
+    u32 n_fat = bdri->fat_entry_count;
+    u32 offset_fat = offset_bdri + bdri->fat_offset;
+    u32 offset_data = offset_bdri + bdri->data_offset;
+    u32 offset_fet = offset_data + (bdri->fet_start_block * block_size);
+    u32 size_fet = bdri->fet_block_count * block_size;
+    u32 n_files = bdri->max_file_count;
+    if ((offset_fet + size_fet > size) || (size_fet > BUFFER_MAX_SIZE) ||
+        ((n_files + 1) * sizeof(BdriFileEntry) > size_fet))
         return 1;
     
-    Debug("%s %s...", (param & (TK_ENCRYPTED|TK_TICKETS)) ? "Dumping" : "Decrypting", (param & TK_TICKETS) ? "tickets" : "titlekeys");
-    memset(info, 0, 0x10);
+    // load FAT and file entry table (buffer is overwritten here)
+    if ((FileRead(fat, (n_fat + 1) * 8, offset_fat) != (n_fat + 1) * 8) ||
+        (FileRead(buffer, size_fet, offset_fet) != size_fet))
+        return 1;
+    
+    // process all tickets, entry #0 is a dummy
+    BdriFileEntry* entries = (BdriFileEntry*) buffer;
+    for (u32 i = 1; i <= n_files; i++) {
+        u8 ticket[8 + TK_TICKET_SIZE];
+        BdriFileEntry* entry = entries + i;
+        if ((entry->parent_index != 1) || (entry->size < sizeof(ticket)) || (entry->size > 0x10000))
+            continue; // not a ticket / unused entry
+        if (!(i % 0x100)) {
+            ShowProgress(i, n_files);
+            if (DebugCheckCancel())
+                return 2;
+        }
+        if (ReadBdriFileStart(ticket, sizeof(ticket), entry->start_block_index, offset_data, block_size, fat, n_fat) != 0)
+            continue;
+        // ticket is preceeded by 8 bytes (u32 unknown, u32 ticket size)
+        u32 res = ProcessTicket(ticket + 8, info, table, param);
+        if (res == 1)
+            (*nSkipped)++;
+        if (info->n_entries >= TK_MAX_ENTRIES)
+            break;
+    }
+    ShowProgress(0, 0);
+    
+    return 0;
+}
+
+static u32 ScanTicketDb(u32 size, TitleKeysInfo* info, u32* table, u32 param, u32* nSkipped)
+{
+    // fallback: brute force scan for tickets, windows overlap by more than one ticket
+    u8* buffer = BUFFER_ADDRESS;
+    
     for (u32 t_offset = 0; t_offset < size; t_offset += BUFFER_MAX_SIZE - (2 * NAND_SECTOR_SIZE)) {
         u32 read_bytes = min(BUFFER_MAX_SIZE, (size - t_offset));
         ShowProgress(t_offset, size);
-        if (DecryptNandToMem(buffer, offset + t_offset, read_bytes, ctrnand_info) != 0)
+        if (!DebugFileRead(buffer, read_bytes, t_offset))
             return 1;
-        for (u32 i = 0x140; i < read_bytes - 0x210; i++) {
-            if (((memcmp(buffer + i, (u8*) "Root-CA00000003-XS0000000c", 26) == 0) ||  // retail tickets
-                (memcmp(buffer + i, (u8*) "Root-CA00000004-XS00000009", 26) == 0)) && // devkit tickets
-                (memcmp(buffer + i - 0x140, sig_type, 4) == 0)) {
-                u32 exid;
-                u32 consoleId = getle32(buffer + i + 0x98);
-                u8* titleId = buffer + i + 0x9C;
-                u32 commonKeyIndex = *(buffer + i + 0xB1);
-                u8* titlekey = buffer + i + 0x7F;
-                for (exid = 0; exid < nKeys; exid++)
-                    if (memcmp(titleId, info->entries[exid].titleId, 8) == 0)
-                        break;
-                if ((!consoleId && !(param & TK_TICKETS)) || (exid < nKeys)) {
-                    nSkipped++;
-                    continue; // skip duplicates / invalid
-                }
-                memset(&(info->entries[nKeys]), 0, sizeof(TitleKeyEntry));
-                memcpy(info->entries[nKeys].titleId, titleId, 8);
-                memcpy(info->entries[nKeys].titleKey, titlekey, 16);
-                info->entries[nKeys].commonKeyIndex = commonKeyIndex;
-                if (param & TK_TICKETS) {
-                    snprintf(filename, 64, "%02lX-%08lX-%016llX.tik",
-                        commonKeyIndex, consoleId, getbe64(titleId));
-                    Debug("Dumping %s...", filename);
-                    FileDumpData(filename, buffer + i - 0x140, 0x140 + 0x210);
-                } else if (!(param & TK_ENCRYPTED)) {
-                    CryptTitlekey(&(info->entries[nKeys]), false);
-                }
-                nKeys++;
-            }
+        for (u32 i = 0x140; i + 0x210 <= read_bytes; i++) {
+            if (buffer[i] != 'R')
+                continue;
+            // no skipping ahead after a hit, ticket data is not contiguous in fragmented files
+            if (ProcessTicket(buffer + i - 0x140, info, table, param) == 1)
+                (*nSkipped)++;
             if (DebugCheckCancel())
                 return 1;
         }
-        if (nKeys == MAX_ENTRIES) {
-            Debug("Maximum number of %s found", (param & TK_TICKETS) ? "tickets" : "titlekeys");
+        if (info->n_entries >= TK_MAX_ENTRIES)
             break;
-        }
     }
-    info->n_entries = nKeys;
     ShowProgress(0, 0);
     
+    return 0;
+}
+
+u32 DumpTicketsTitlekeys(u32 param)
+{
+    TitleKeysInfo *info = (TitleKeysInfo*) 0x20316000;
+    u32* table = (u32*) 0x20400000; // allow using 0x40000 byte
+    char filename[64];
+    
+    u32 nSkipped = 0;
+    u32 size = 0;
+    
+    if (DebugOpenNandFile(&size, GetNandFileInfo(F_TICKET)) != 0)
+        return 1;
+    
+    Debug("%s %s...", (param & (TK_ENCRYPTED|TK_TICKETS)) ? "Dumping" : "Decrypting", (param & TK_TICKETS) ? "tickets" : "titlekeys");
+    memset(info, 0, 0x10);
+    memset(table, 0, TK_HASH_SLOTS * sizeof(u32));
+    u32 res = ParseTicketDb(size, info, table, param, &nSkipped);
+    if (res == 1) {
+        Debug("Unknown ticket.db structure, scanning...");
+        res = ScanTicketDb(size, info, table, param, &nSkipped);
+    }
+    if (res != 0) {
+        FileClose();
+        return 1;
+    }
+    FileClose();
+    u32 nKeys = info->n_entries;
+    if (nKeys >= TK_MAX_ENTRIES)
+        Debug("Maximum number of %s found", (param & TK_TICKETS) ? "tickets" : "titlekeys");
+    
     if (!(param & TK_TICKETS)) {
         Debug("%s %u unique Titlekeys", (param & TK_ENCRYPTED) ? "Dumped" : "Decrypted", nKeys);
         Debug("Skipped %u useless Titlekeys", nSkipped);
@@ -2,7 +2,7 @@
 
 #include "common.h"
 
-#define MAX_ENTRIES 1024
+#define TK_MAX_ENTRIES 0x7000 // 28672 entries, still fits into the standard buffer
 
 #define TK_ENCRYPTED (1<<0)
 #define TK_TICKETS   (1<<1)
@@ -17,9 +17,53 @@ typedef struct {
 typedef struct {
     u32 n_entries;
     u8  reserved[12];
-    TitleKeyEntry entries[MAX_ENTRIES];
+    TitleKeyEntry entries[TK_MAX_ENTRIES];
 } __attribute__((packed, aligned(16))) TitleKeysInfo;
 
+// ticket.db inner filesystem header, see: https://www.3dbrew.org/wiki/Inner_FAT
+// all offsets are relative to the start of this header
+typedef struct {
+    char magic[4]; // "BDRI"
+    u32 version; // 0x30000
+    u64 info_offset; // 0x20
+    u64 image_size;
+    u32 image_block_size;
+    u8  padding0[4];
+    u8  unknown[4];
+    u32 data_block_size;
+    u64 dht_offset;
+    u32 dht_bucket_count;
+    u8  padding1[4];
+    u64 fht_offset;
+    u32 fht_bucket_count;
+    u8  padding2[4];
+    u64 fat_offset;
+    u32 fat_entry_count;
+    u8  padding3[4];
+    u64 data_offset;
+    u32 data_block_count;
+    u8  padding4[4];
+    u32 det_start_block;
+    u32 det_block_count;
+    u32 max_dir_count;
+    u8  padding5[4];
+    u32 fet_start_block;
+    u32 fet_block_count;
+    u32 max_file_count;
+    u8  padding6[4];
+} __attribute__((packed)) BdriHeader;
+
+typedef struct {
+    u32 parent_index;
+    u8  title_id[8];
+    u32 next_sibling_index;
+    u8  padding0[4];
+    u32 start_block_index;
+    u64 size;
+    u8  padding1[8];
+    u32 hash_bucket_next_index;
+} __attribute__((packed)) BdriFileEntry;
+
 
 u32 CryptTitlekey(TitleKeyEntry* entry, bool encrypt);
 
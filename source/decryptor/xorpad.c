@@ -7,6 +7,7 @@
 #include "decryptor/keys.h"
 #include "decryptor/nand.h"
 #include "decryptor/game.h"
+#include "decryptor/nandfat.h"
 #include "decryptor/xorpad.h"
 #include "fatfs/sdmmc.h"
 
@@ -91,44 +92,101 @@ u32 SdInfoGen(SdInfo* info, const char* base_path)
     return (n_entries > 0) ? 0 : 1;
 }
 
-u32 NcchPadgen(u32 param)
+static u32 NcchInfoAdd(NcchInfo* info, NcchHeader* ncch, u64 titleId, const char* partition)
 {
-    (void) (param); // param is unused here
-    NcchInfo *info = (NcchInfo*)0x20316000;
-    SeedInfo *seedinfo = (SeedInfo*)0x20400000;
-
-    if (CheckKeySlot(0x25, 'X') != 0) {
-        Debug("slot0x25KeyX not set up");
-        Debug("7.x crypto will fail on O3DS < 7.x or A9LH");
-    }
-    if ((GetUnitPlatform() == PLATFORM_3DS) && (CheckKeySlot(0x18, 'X') != 0)) {
-        Debug("slot0x18KeyX not set up");
-        Debug("Secure3 crypto will fail");
-    }
-    if (CheckKeySlot(0x1B, 'X') != 0) {
-        Debug("slot0x1BKeyX not set up");
-        Debug("Secure4 crypto will fail");
-    }
-       
-    if (DebugFileOpen("seeddb.bin")) {
-        if (!DebugFileRead(seedinfo, 16, 0)) {
-            FileClose();
-            return 1;
-        }
-        if (!seedinfo->n_entries || seedinfo->n_entries > MAX_ENTRIES) {
-            FileClose();
-            Debug("Bad number of seeddb entries");
+    const char* section_name[4] = { "exheader", "exefs_norm", "exefs_7x", "romfs" };
+    const u32 section_ctr[4] = { 1, 2, 2, 3 };
+    u32 section_size[4] = {
+        (ncch->size_exthdr) ? 0x800 : 0,
+        ncch->size_exefs * 0x200,
+        ncch->size_exefs * 0x200,
+        ncch->size_romfs * 0x200
+    };
+    u32 ncchFlag3 = ncch->flags[3];
+    u32 ncchFlag7 = ncch->flags[7];
+    
+    // same flag handling as tools/ncchinfo_gen, unknown flags mean standard crypto
+    if ((ncchFlag7 != 0x01) && (ncchFlag7 != 0x20))
+        ncchFlag7 = 0;
+    if (!ncchFlag3 && (ncchFlag7 != 0x20))
+        section_size[2] = 0; // no 7x / seed ExeFS pad needed
+    
+    for (u32 s = 0; s < 4; s++) {
+        if (!section_size[s])
+            continue;
+        if (info->n_entries >= MAX_ENTRIES) {
+            Debug("Too many entries, skipping the rest");
             return 1;
         }
-        if (!DebugFileRead(seedinfo->entries, seedinfo->n_entries * sizeof(SeedInfoEntry), 16)) {
-            FileClose();
-            return 1;
+        NcchInfoEntry* entry = info->entries + info->n_entries;
+        memset(entry, 0x00, sizeof(NcchInfoEntry));
+        GetNcchCtr(entry->ctr, ncch, section_ctr[s]);
+        memcpy(entry->keyY, ncch->signature, 16);
+        entry->size_mb = (section_size[s] + (1024 * 1024) - 1) / (1024 * 1024);
+        entry->size_b = section_size[s];
+        // exheader and standard ExeFS pads only ever use the fixed key flag
+        entry->ncchFlag7 = (s >= 2) ? ncchFlag7 : (ncchFlag7 == 0x01) ? 0x01 : 0;
+        entry->ncchFlag3 = (s >= 2) ? ncchFlag3 : 0;
+        entry->titleId = ncch->programId;
+        snprintf(entry->filename, 112, "/%016llX.%s.%s.xorpad", titleId, partition, section_name[s]);
+        info->n_entries++;
+    }
+    
+    return 0;
+}
+
+u32 NcchInfoGen(NcchInfo* info, const char* base_path)
+{
+    const char* partition_name[8] = NCSD_PARTITION_NAMES;
+    char* filelist = (char*) 0x20400000;
+    u8 header[0x200] __attribute__((aligned(16)));
+    NcchHeader* ncch = (NcchHeader*) header;
+    NcsdHeader* ncsd = (NcsdHeader*) header;
+    
+    memset(info, 0x00, 16);
+    info->padding = 0xFFFFFFFF;
+    info->ncch_info_version = 0xF0000004;
+    
+    Debug("Generating ncchinfo.bin in memory...");
+    if (!base_path || !GetFileList(base_path, filelist, 0x100000, false, true, false)) {
+        Debug("Game directory not found!");
+        return 1;
+    }
+    
+    // only the headers are read, this is a lot faster than the Python script
+    u32 path_len = strnlen(base_path, 128) + 1;
+    u32 result = 0;
+    for (char* path = strtok(filelist, "\n"); (path != NULL) && (result == 0); path = strtok(NULL, "\n")) {
+        if (FileGetData(path, header, 0x200, 0) != 0x200)
+            continue;
+        if (memcmp(ncch->magic, "NCCH", 4) == 0) {
+            Debug("NCCH \"%s\"", path + path_len);
+            result = NcchInfoAdd(info, ncch, ncch->partitionId, partition_name[0]);
+        } else if (memcmp(ncsd->magic, "NCSD", 4) == 0) {
+            Debug("NCSD \"%s\"", path + path_len);
+            u64 mediaId = ncsd->mediaId;
+            NcchPartition partitions[8];
+            memcpy(partitions, ncsd->partitions, sizeof(partitions));
+            for (u32 p = 0; (p < 8) && (result == 0); p++) {
+                if (!partitions[p].offset)
+                    continue;
+                if ((FileGetData(path, header, 0x200, partitions[p].offset * 0x200) != 0x200) ||
+                    (memcmp(ncch->magic, "NCCH", 4) != 0))
+                    continue;
+                result = NcchInfoAdd(info, ncch, mediaId, partition_name[p]);
+            }
         }
-        FileClose();
-    } else {
-        Debug("9.x seed crypto will fail");
     }
+    if (!info->n_entries) {
+        Debug("No NCCH / NCSD files found");
+        return 1;
+    }
+    
+    return 0;
+}
 
+static u32 LoadNcchInfo(NcchInfo* info)
+{
     if (!DebugFileOpen("ncchinfo.bin"))
         return 1;
     if (!DebugFileRead(info, 16, 0)) {
@@ -163,8 +221,6 @@ u32 NcchPadgen(u32 param)
     }
     FileClose();
 
-    Debug("Number of entries: %i", info->n_entries);
-
     for (u32 i = 0; i < info->n_entries; i++) { // check and fix filenames
         char* filename = info->entries[i].filename;
         if (filename[1] == 0x00) { // convert UTF-16 -> UTF-8
@@ -175,6 +231,35 @@ u32 NcchPadgen(u32 param)
             memmove(filename, filename + 5, 112 - 5);
     }
     
+    return 0;
+}
+
+u32 NcchPadgen(u32 param)
+{
+    NcchInfo *info = (NcchInfo*)0x20316000;
+
+    if (CheckKeySlot(0x25, 'X') != 0) {
+        Debug("slot0x25KeyX not set up");
+        Debug("7.x crypto will fail on O3DS < 7.x or A9LH");
+    }
+    if ((GetUnitPlatform() == PLATFORM_3DS) && (CheckKeySlot(0x18, 'X') != 0)) {
+        Debug("slot0x18KeyX not set up");
+        Debug("Secure3 crypto will fail");
+    }
+    if (CheckKeySlot(0x1B, 'X') != 0) {
+        Debug("slot0x1BKeyX not set up");
+        Debug("Secure4 crypto will fail");
+    }
+
+    if (param & PG_GAMEDIR) {
+        if (NcchInfoGen(info, GetGameDir()) != 0)
+            return 1;
+    } else if (LoadNcchInfo(info) != 0) {
+        return 1;
+    }
+    
+    Debug("Number of entries: %i", info->n_entries);
+    
     for (u32 i = 0; i < info->n_entries; i++) {
         PadInfo padInfo = {.setKeyY = 1, .size_mb = 0, .size_b = info->entries[i].size_b, .mode = AES_CNT_CTRNAND_MODE};
         memcpy(padInfo.ctr, info->entries[i].ctr, 16);
@@ -189,16 +274,8 @@ u32 NcchPadgen(u32 param)
         if (info->entries[i].ncchFlag7 & 0x20) { // seed crypto
             u8 keydata[32];
             memcpy(keydata, info->entries[i].keyY, 16);
-            u32 found_seed = 0;
-            for (u32 j = 0; j < seedinfo->n_entries; j++) {
-                if (seedinfo->entries[j].titleId == info->entries[i].titleId) {
-                    found_seed = 1;
-                    memcpy(&keydata[16], seedinfo->entries[j].external_seed, 16);
-                    break;
-                }
-            }
-            if (!found_seed) {
-                Debug("Failed to find seed in seeddb.bin");
+            if (FindSeed(&keydata[16], info->entries[i].titleId, NULL) != 0) {
+                Debug("Failed to find seed in seeddb.bin or NAND");
                 return 1;
             }
             u8 sha256sum[32];
@@ -339,6 +416,8 @@ u32 AnyPadgen(u32 param)
         if (entry->setKeyY)
             setup_aeskeyY(entry->keyslot, entry->keyY);
         use_aeskey(entry->keyslot);
+        if (entry->keyslot < 0x08) // NAND keyslot, cached NAND data may be invalid
+            FlushNandCache();
         // process flags
         if (entry->flags & (AP_USE_NAND_CTR|AP_USE_SD_CTR)) {
             u32 ctr_add = getbe32(padInfo.ctr + 12);
@@ -441,3 +520,130 @@ u32 Firm0Firm1Padgen(u32 param)
 
     return CreatePad(&padInfo);
 }
+
+static PartitionInfo* GetNandRangePartition(u32 offset, u32 size)
+{
+    // the partition containing the whole range, CTRFULL only as last resort
+    const u32 partition_ids[] = { P_TWLN, P_TWLP, P_AGBSAVE, P_FIRM0, P_FIRM1, P_CTRNAND, P_CTRFULL };
+    for (u32 i = 0; i < sizeof(partition_ids) / sizeof(u32); i++) {
+        PartitionInfo* partition = GetPartitionInfo(partition_ids[i]);
+        if ((offset >= partition->offset) && (size <= partition->size) &&
+            (offset - partition->offset <= partition->size - size))
+            return partition;
+    }
+    return NULL;
+}
+
+static u32 GetFatAreaSize(PartitionInfo* partition)
+{
+    // size of boot sector(s), FATs and root directory of a FAT partition
+    u8* bpb = (u8*) 0x20316000;
+    if (DecryptNandToMem(bpb, partition->offset, NAND_SECTOR_SIZE, partition) != 0)
+        return 0;
+    u32 sector_size = getle16(bpb + 0x0B);
+    u32 n_reserved = getle16(bpb + 0x0E);
+    u32 n_fats = bpb[0x10];
+    u32 n_root_entries = getle16(bpb + 0x11);
+    u32 fat_size = getle16(bpb + 0x16);
+    if (!fat_size)
+        fat_size = getle32(bpb + 0x24);
+    if ((getle16(bpb + 0x1FE) != 0xAA55) || !sector_size || (sector_size % NAND_SECTOR_SIZE))
+        return 0;
+    u32 size = ((n_reserved + (n_fats * fat_size)) * sector_size) + (n_root_entries * 0x20);
+    return align(size, NAND_SECTOR_SIZE);
+}
+
+u32 NandRangePadgen(u32 param)
+{
+    NandPadRanges* ranges = (NandPadRanges*) 0x20320000;
+    NandPadIndex* index = (NandPadIndex*) 0x20330000;
+    u8* buffer = BUFFER_ADDRESS;
+    const char* filename = "nand.ranges.xorpad";
+    u32 result = 0;
+    
+    // get the list of ranges
+    memset(ranges, 0x00, 16);
+    if (param & PG_FATONLY) {
+        const u32 partition_ids[] = { P_TWLN, P_CTRNAND };
+        for (u32 i = 0; i < 2; i++) {
+            PartitionInfo* partition = GetPartitionInfo(partition_ids[i]);
+            u32 size = GetFatAreaSize(partition);
+            if (!size) {
+                Debug("%s has no valid FAT", partition->name);
+                return 1;
+            }
+            ranges->entries[ranges->n_entries].offset = partition->offset;
+            ranges->entries[ranges->n_entries++].size = min(size, partition->size);
+        }
+    } else {
+        if ((FileGetData("nandpad_ranges.bin", ranges, 16, 0) != 16) || !ranges->n_entries || ranges->n_entries > MAX_ENTRIES) {
+            Debug("Corrupt or not existing: nandpad_ranges.bin");
+            return 1;
+        }
+        u32 data_size = ranges->n_entries * sizeof(NandPadRange);
+        if (FileGetData("nandpad_ranges.bin", (u8*) ranges + 16, data_size, 16) != data_size) {
+            Debug("File is missing data: nandpad_ranges.bin");
+            return 1;
+        }
+    }
+    
+    // build the index, check ranges
+    u32 n_entries = ranges->n_entries;
+    u64 offset_pad = align(16 + (n_entries * sizeof(NandPadIndexEntry)), 0x200);
+    memset(index, 0x00, sizeof(NandPadIndex));
+    memcpy(index->magic, "NPAD", 4);
+    index->n_entries = n_entries;
+    for (u32 i = 0; i < n_entries; i++) {
+        NandPadRange* range = ranges->entries + i;
+        PartitionInfo* partition = GetNandRangePartition(range->offset, range->size);
+        if ((range->offset % 0x10) || (range->size % 0x10) || !range->size || !partition) {
+            Debug("Bad range: %08X (%08X byte)", range->offset, range->size);
+            return 1;
+        }
+        index->entries[i] = (NandPadIndexEntry) {
+            .offset = range->offset, .size = range->size, .offset_pad = (u32) offset_pad, .keyslot = partition->keyslot };
+        offset_pad = align(offset_pad + range->size, 0x200);
+        if (offset_pad > 0xFFFFFFFF) { // pad offsets are stored as u32 (and FAT32 can't go beyond)
+            Debug("Ranges too big for one xorpad (>= 4GB)");
+            return 1;
+        }
+    }
+    
+    Debug("Creating NAND xorpad for %lu range(s). Size (kB): %lu", n_entries, (u32) (offset_pad / 1024));
+    Debug("Filename: %s", filename);
+    if (!DebugCheckFreeSpace(offset_pad))
+        return 1;
+    if (!FileCreate(filename, true))
+        return 1;
+    if (!DebugFileWrite(index, 16 + (n_entries * sizeof(NandPadIndexEntry)), 0)) {
+        FileClose();
+        return 1;
+    }
+    
+    // generate the pads, CTR for each range straight from its NAND offset
+    for (u32 i = 0; (i < n_entries) && (result == 0); i++) {
+        NandPadIndexEntry* entry = index->entries + i;
+        PartitionInfo* partition = GetNandRangePartition(entry->offset, entry->size);
+        CryptBufferInfo info = {.keyslot = partition->keyslot, .setKeyY = 0, .mode = partition->mode, .buffer = buffer};
+        if (GetNandCtr(info.ctr, entry->offset) != 0) {
+            result = 1;
+            break;
+        }
+        Debug("%s: %08X (%lukB)", partition->name, entry->offset, entry->size / 1024);
+        for (u32 j = 0; j < entry->size; j += BUFFER_MAX_SIZE) {
+            info.size = min(BUFFER_MAX_SIZE, entry->size - j);
+            memset(buffer, 0x00, info.size);
+            ShowProgress(j, entry->size);
+            CryptBuffer(&info);
+            if (!DebugFileWrite(buffer, info.size, entry->offset_pad + j)) {
+                result = 1;
+                break;
+            }
+        }
+    }
+    
+    ShowProgress(0, 0);
+    FileClose();
+    
+    return result;
+}
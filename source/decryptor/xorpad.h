@@ -4,6 +4,10 @@
 
 // force slot 0x04 for CTRNAND padgen
 #define PG_FORCESLOT4 (1<<0)
+// NAND range padgen: only the FAT areas of TWLNAND / CTRNAND
+#define PG_FATONLY    (1<<1)
+// NCCH padgen: generate ncchinfo.bin in memory from the game directory
+#define PG_GAMEDIR    (1<<2)
 
 // anypadgen tags
 #define AP_USE_NAND_CTR     (1<<0)
@@ -71,9 +75,37 @@ typedef struct {
     AnyPadInfoEntry entries[MAX_ENTRIES];
 } __attribute__((packed, aligned(16))) AnyPadInfo;
 
+// nandpad_ranges.bin, offsets are absolute NAND byte offsets (16 byte aligned)
+typedef struct {
+    u32 offset;
+    u32 size;
+} __attribute__((packed)) NandPadRange;
+
+typedef struct {
+    u32 n_entries;
+    u8  reserved[12];
+    NandPadRange entries[MAX_ENTRIES];
+} __attribute__((packed, aligned(16))) NandPadRanges;
+
+// nand.ranges.xorpad: header, index, then all pads (each 0x200 aligned)
+typedef struct {
+    u32 offset; // NAND offset
+    u32 size;
+    u32 offset_pad; // offset of the pad in this file
+    u32 keyslot;
+} __attribute__((packed)) NandPadIndexEntry;
+
+typedef struct {
+    u8  magic[4]; // "NPAD"
+    u32 n_entries;
+    u8  reserved[8];
+    NandPadIndexEntry entries[MAX_ENTRIES];
+} __attribute__((packed, aligned(16))) NandPadIndex;
+
 
 u32 CreatePad(PadInfo *info);
 u32 SdInfoGen(SdInfo* info, const char* base_path);
+u32 NcchInfoGen(NcchInfo* info, const char* base_path);
 
 // --> FEATURE FUNCTIONS <--
 u32 NcchPadgen(u32 param);
@@ -84,3 +116,4 @@ u32 AnyPadgen(u32 param);
 u32 CtrNandPadgen(u32 param);
 u32 TwlNandPadgen(u32 param);
 u32 Firm0Firm1Padgen(u32 param);
+u32 NandRangePadgen(u32 param);
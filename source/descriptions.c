@@ -3,14 +3,19 @@
 const char *NcchPadgenDesc        = "Generate XORpads from the contents of "
                                     "ncchinfo.bin in the Work directory.\n\n"
 
-                                    "You can generate this file using ncchinfo_gen.py "
-                                    "in the scripts directory.",
+                                    "You can generate this file using ncchinfo_gen "
+                                    "in the tools directory.",
+
+           *NcchPadgenDirectDesc  = "Generate XORpads for all NCCH / NCSD files in "
+                                    "the Game directory, without ncchinfo.bin.\n\n"
+
+                                    "Only the headers of the files are read.",
 
            *SdPadgenDesc          = "Generate XORpads from the contents of sdinfo.bin "
                                     "in the Work directory.\n\n"
 
-                                    "You can generate this file using sdinfo_gen.py in "
-                                    "the scripts directory.",
+                                    "You can generate this file using sdinfo_gen in "
+                                    "the tools directory.",
 
            *SdPadgenDirectDesc    = "Generate XORpads for the contents under "
                                     "\"Nintendo 3DS\" based on the target NAND.",
@@ -45,7 +50,18 @@ const char *NcchPadgenDesc        = "Generate XORpads from the contents of "
                                     "of this 3DS system.\n\n"
 
                                     "You can extract these partitions from a "
-                                    "NAND dump using 3DSFAT16Tool.";
+                                    "NAND dump using 3DSFAT16Tool.",
+
+           *NandRangePadgenDesc   = "Generate one XORpad file for the NAND ranges "
+                                    "listed in nandpad_ranges.bin in the Work "
+                                    "directory.\n\n"
+
+                                    "Refer to xorpad.h on the format of this file "
+                                    "and of the output.",
+
+           *NandRangePadgenFatDesc = "Generate one XORpad file for only the FAT areas "
+                                     "(boot sector, FATs, root directory) of the "
+                                     "TWLNAND and CTRNAND partitions.";
 
 
 // Ticket/Titlekey Options
@@ -90,6 +106,10 @@ const char *DumpGameCartFullDesc    = "Dump the inserted gamecart to the Game di
            *DumpGameCartCIADesc     = "Dump and decrypt the inserted gamecart to the "
                                       "Game directory as a ready-to-install CIA file.",
 
+           *DumpGameCartAllDesc     = "Dump the inserted gamecart to the Game directory "
+                                      "as encrypted .3DS, decrypted .3DS and decrypted CIA "
+                                      "at the same time, reading the cart only once.",
+
            *DumpPrivateHeaderDesc   = "Dump the private header of the inserted gamecart "
                                       "to the Game directory, for use with flashcarts.",
                                       
@@ -133,6 +153,12 @@ const char *DumpNandFullDesc       = "Dump the full target NAND to the Work dire
                                      "This is about 1GB for an O3DS/2DS and 1.2GB for "
                                      "a N3DS",
 
+           *DumpNandArchiveDesc    = "Dump the full target NAND and all its decrypted "
+                                     "partitions (TWLN, TWLP, AGBSAVE, FIRM0/1, CTRNAND) "
+                                     "to the Work directory, reading the NAND only once.\n\n"
+
+                                     "SHA256 files are stored for all dumps.",
+
            *RestoreNandDesc        = "Restore target NAND from a file in the Work "
                                      "directory.",
 
@@ -276,6 +302,27 @@ const char *NcchNcsdCryptoDesc  = "Files with .3DS and .APP extension are typica
                                   "while encryption can be done on any FW version.";
 
 
+const char *ExtractGameFilesDesc = "Extract ExeFS and RomFS files from all NCCH / NCSD "
+                                   "/ CIA files in the Game directory, without decrypting "
+                                   "the whole file first.\n\n"
+
+                                   "Put patterns (f.e. romfs/sound/*) into extract.txt "
+                                   "to only extract some files.";
+
+const char *VerifyGameFilesDesc = "Verify the RomFS of all NCCH / NCSD / CIA files in "
+                                  "the Game directory against its full IVFC hash tree. "
+                                  "Encrypted files are fine, too.\n\n"
+
+                                  "Quick mode only checks a random sample of the "
+                                  "RomFS data blocks.";
+
+const char *NcsdSplitDesc = "Split all NCSD (.3DS) files in the Game directory into "
+                            "one CXI / CFA file per partition, in a single pass over "
+                            "the source.\n\n"
+
+                            "The (decrypt) variant also decrypts the partitions on the way.";
+
+
 const char *CiaDecryptShallowDesc = "Decrypt all CIAs in the Game directory. Decrypts "
                                     "the titlekey layer of CIA crypto, leaves the NCCH "
                                     "untouched.",
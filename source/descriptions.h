@@ -2,13 +2,16 @@
 
 // XORpad Generator Options
 extern char *NcchPadgenDesc,
+            *NcchPadgenDirectDesc,
             *SdPadgenDesc,
             *SdPadgenDirectDesc,
             *AnyPadgenDesc,
             *CtrNandPadgenDesc,
             *CtrNandPadgen0x04Desc,
             *TwlNandPadgenDesc,
-            *Firm0Firm1PadgenDesc;
+            *Firm0Firm1PadgenDesc,
+            *NandRangePadgenDesc,
+            *NandRangePadgenFatDesc;
 
 // Ticket/Titlekey Options
 extern char *CryptTitlekeysFileDesc,
@@ -29,6 +32,7 @@ extern char *DumpGameCartFullDesc,
             *DumpGameCartDecFullDesc,
             *DumpGameCartDecTrimDesc,
             *DumpGameCartCIADesc,
+            *DumpGameCartAllDesc,
             *DumpPrivateHeaderDesc,
             *DumpCartSaveDesc,
             *FlashCartSaveDesc;
@@ -43,6 +47,7 @@ extern char *AK2iDumpDesc,
 // SysNAND/EmuNAND Backup/Restore Options
 extern char *DumpNandFullDesc,
             *DumpNandMinDesc,
+            *DumpNandArchiveDesc,
             *RestoreNandDesc,
             *RestoreNandForcedDesc,
             *RestoreNandKeepHaxDesc,
@@ -89,6 +94,10 @@ extern char *HealthAndSafetyDesc,
 
 extern char *NcchNcsdCryptoDesc;
 
+extern char *ExtractGameFilesDesc;
+extern char *VerifyGameFilesDesc;
+extern char *NcsdSplitDesc;
+
 extern char *CiaDecryptShallowDesc,
             *CiaDecryptDeepDesc,
             *CiaDecryptCXIDesc,
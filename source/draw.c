@@ -16,6 +16,8 @@
 
 static char debugstr[DBG_N_CHARS_X * DBG_N_CHARS_Y] = { 0 };
 static u32 debugcol[DBG_N_CHARS_Y] = { DBG_COLOR_FONT };
+static u32 debug_n_lines = 0; // number of lines on screen
+static u32 debug_n_redraw = 0; // full redraws left, set when a line does not fit into its row
 
 void ClearScreen(u8* screen, int width, int color)
 {
@@ -179,6 +181,8 @@ void DebugClear()
     memset(debugstr, 0x00, DBG_N_CHARS_X * DBG_N_CHARS_Y);
     for (u32 y = 0; y < DBG_N_CHARS_Y; y++)
         debugcol[y] = DBG_COLOR_FONT;
+    debug_n_lines = 0;
+    debug_n_redraw = 0;
     ClearScreen(TOP_SCREEN, SCREEN_WIDTH_TOP, DBG_COLOR_BG);
     #if defined USE_THEME && defined GFX_DEBUG_BG
     LoadThemeGfx(GFX_DEBUG_BG, true);
@@ -187,13 +191,25 @@ void DebugClear()
     LogWrite(NULL);
 }
 
+static bool DebugLineBreaks(u32 line)
+{
+    // DrawString() steps over the terminator if the line ends inside a word and goes on with the next line
+    char* str = debugstr + (DBG_N_CHARS_X * line);
+    return memchr(str, '\n', DBG_N_CHARS_X) || memchr(str, '\r', DBG_N_CHARS_X) ||
+        IsCharPartOfWord(str[DBG_N_CHARS_X - 2]);
+}
+
 void DebugSet(const char **strs)
 {
     if (strs != NULL) for (int y = 0; y < DBG_N_CHARS_Y; y++) {
         int pos_dbgstr = DBG_N_CHARS_X * (DBG_N_CHARS_Y - 1 - y);
         snprintf(debugstr + pos_dbgstr, DBG_N_CHARS_X, "%-*.*s", DBG_N_CHARS_X - 1, DBG_N_CHARS_X - 1, strs[y]);
         debugcol[y] = DBG_COLOR_FONT;
+        if (DebugLineBreaks(DBG_N_CHARS_Y - 1 - y))
+            debug_n_redraw = DBG_N_CHARS_Y + 1;
     }
+    if (strs != NULL)
+        debug_n_lines = DBG_N_CHARS_Y;
     
     int pos_y = DBG_START_Y;
     u32* col = debugcol + (DBG_N_CHARS_Y - 1);
@@ -206,9 +222,54 @@ void DebugSet(const char **strs)
     }
 }
 
+static void DebugDrawLine(u32 row, u32 line)
+{
+    DrawString(TOP_SCREEN, debugstr + (DBG_N_CHARS_X * line), DBG_START_X, DBG_START_Y + (row * DBG_STEP_Y),
+        debugcol[line], DBG_COLOR_BG);
+}
+
+static void DebugScroll(u32 n_rows)
+{
+    // move the character cells of rows 1 ... n_rows up by one row, gaps between rows are left alone
+    const u32 x0 = DBG_START_X;
+    const u32 x1 = DBG_START_X + ((DBG_N_CHARS_X - 1) * FONT_WIDTH);
+    for (u32 x = x0; x < x1; x++) {
+        u8* column = TOP_SCREEN + (x * BYTES_PER_PIXEL * SCREEN_HEIGHT);
+        for (u32 row = 0; row < n_rows; row++) {
+            u32 y = DBG_START_Y + ((row + 1) * DBG_STEP_Y);
+            u8* src = column + ((SCREEN_HEIGHT - y - FONT_HEIGHT) * BYTES_PER_PIXEL);
+            memmove(src + (DBG_STEP_Y * BYTES_PER_PIXEL), src, FONT_HEIGHT * BYTES_PER_PIXEL);
+        }
+    }
+}
+
+static void DebugUpdate(bool advance)
+{
+    // same output as DebugSet(NULL), but only the changed lines are drawn
+    if (DebugLineBreaks(0))
+        debug_n_redraw = DBG_N_CHARS_Y + 1; // until that line has scrolled out
+    if (debug_n_redraw || (DBG_COLOR_BG == COLOR_TRANSPARENT)) {
+        if (advance && debug_n_redraw)
+            debug_n_redraw--;
+        if (advance && (debug_n_lines < DBG_N_CHARS_Y))
+            debug_n_lines++;
+        DebugSet(NULL);
+    } else if (!advance && debug_n_lines) {
+        DebugDrawLine(debug_n_lines - 1, 0);
+    } else if (debug_n_lines < DBG_N_CHARS_Y) {
+        DebugDrawLine(debug_n_lines++, 0);
+    } else {
+        // the last row may be overlapped by ShowProgress(), so it is not moved but redrawn
+        DebugScroll(DBG_N_CHARS_Y - 2);
+        DebugDrawLine(DBG_N_CHARS_Y - 2, 1);
+        DebugDrawLine(DBG_N_CHARS_Y - 1, 0);
+    }
+}
+
 void DebugColor(u32 color, const char *format, ...)
 {
     static bool adv_output = true;
+    bool advance = adv_output;
     char tempstr[128] = { 0 }; // 128 instead of DBG_N_CHARS_X for log file 
     va_list va;
     
@@ -216,7 +277,7 @@ void DebugColor(u32 color, const char *format, ...)
     vsnprintf(tempstr, 128, format, va);
     va_end(va);
     
-    if (adv_output) {
+    if (advance) {
         memmove(debugstr + DBG_N_CHARS_X, debugstr, DBG_N_CHARS_X * (DBG_N_CHARS_Y - 1));
         memmove(debugcol + 1, debugcol, (DBG_N_CHARS_Y - 1) * sizeof(u32));
     } else {
@@ -232,7 +293,7 @@ void DebugColor(u32 color, const char *format, ...)
         adv_output = false;
     }
     
-    DebugSet(NULL);
+    DebugUpdate(advance);
 }
 
 void Debug(const char *format, ...)
@@ -9,6 +9,13 @@
 
 #include "diskio.h"		/* FatFs lower layer API */
 #include "sdmmc.h"
+#include "decryptor/nand.h"
+
+/* Drive 0 is the SD card, drives 1 / 2 are the decrypted CTRNAND / TWLN partitions */
+#define SD_DRV      0
+#define NAND_DRVS   2
+
+static PartitionInfo* nand_vol[NAND_DRVS] = { NULL };
 
 
 /*-----------------------------------------------------------------------*/
@@ -16,11 +23,15 @@
 /*-----------------------------------------------------------------------*/
 
 DSTATUS disk_status (
-	__attribute__((unused))
 	BYTE pdrv		/* Physical drive nmuber to identify the drive */
 )
 {
-	return RES_OK;
+	if (pdrv == SD_DRV)
+		return RES_OK;
+	if (pdrv > NAND_DRVS)
+		return STA_NOINIT|STA_NODISK;
+	/* NAND volumes are read only, writes go through EncryptMemToNand() */
+	return (nand_vol[pdrv-1]) ? STA_PROTECT : STA_NOINIT|STA_PROTECT;
 }
 
 
@@ -30,13 +41,19 @@ DSTATUS disk_status (
 /*-----------------------------------------------------------------------*/
 
 DSTATUS disk_initialize (
-	__attribute__((unused))
 	BYTE pdrv				/* Physical drive nmuber to identify the drive */
 )
 {
-	if (sdmmc_sdcard_init() != 0)
-        return STA_NODISK|STA_NOINIT;
-	return RES_OK;
+	if (pdrv == SD_DRV) {
+		if (sdmmc_sdcard_init() != 0)
+			return STA_NODISK|STA_NOINIT;
+		return RES_OK;
+	}
+	if (pdrv > NAND_DRVS)
+		return STA_NODISK|STA_NOINIT;
+	/* (re)checked on every mount, the NAND in use may have changed */
+	nand_vol[pdrv-1] = GetPartitionInfo((pdrv == 1) ? P_CTRNAND : P_TWLN);
+	return (nand_vol[pdrv-1]) ? STA_PROTECT : STA_NODISK|STA_NOINIT;
 }
 
 
@@ -46,17 +63,28 @@ DSTATUS disk_initialize (
 /*-----------------------------------------------------------------------*/
 
 DRESULT disk_read (
-	__attribute__((unused))
 	BYTE pdrv,		/* Physical drive nmuber to identify the drive */
 	BYTE *buff,		/* Data buffer to store read data */
 	DWORD sector,	/* Sector address in LBA */
 	UINT count		/* Number of sectors to read */
 )
 {
-	if (sdmmc_sdcard_readsectors(sector, count, buff)) {
-		return RES_PARERR;
+	if (pdrv == SD_DRV) {
+		if (sdmmc_sdcard_readsectors(sector, count, buff)) {
+			return RES_PARERR;
+		}
+		return RES_OK;
 	}
 
+	/* NAND volumes: map to partition offset, decrypt on the fly */
+	PartitionInfo* partition = (pdrv <= NAND_DRVS) ? nand_vol[pdrv-1] : NULL;
+	if (!partition)
+		return RES_NOTRDY;
+	if ((sector + count) * NAND_SECTOR_SIZE > partition->size)
+		return RES_PARERR;
+	if (DecryptNandToMem(buff, partition->offset + (sector * NAND_SECTOR_SIZE), count * NAND_SECTOR_SIZE, partition))
+		return RES_ERROR;
+
 	return RES_OK;
 }
 
@@ -68,13 +96,14 @@ DRESULT disk_read (
 
 #if _USE_WRITE
 DRESULT disk_write (
-	__attribute__((unused))
 	BYTE pdrv,			/* Physical drive nmuber to identify the drive */
 	const BYTE *buff,	/* Data to be written */
 	DWORD sector,		/* Sector address in LBA */
 	UINT count			/* Number of sectors to write */
 )
 {
+	if (pdrv != SD_DRV)
+		return RES_WRPRT;
 	if (sdmmc_sdcard_writesectors(sector, count, (BYTE *)buff)) {
 		return RES_PARERR;
 	}
@@ -91,7 +120,6 @@ DRESULT disk_write (
 
 #if _USE_IOCTL
 DRESULT disk_ioctl (
-	__attribute__((unused))
 	BYTE pdrv,		/* Physical drive nmuber (0..) */
 	__attribute__((unused))
 	BYTE cmd,		/* Control code */
@@ -104,7 +132,12 @@ DRESULT disk_ioctl (
             *((DWORD*) buff) = 0x200;
             return RES_OK;
         case GET_SECTOR_COUNT:
-            *((DWORD*) buff) = getMMCDevice(1)->total_size;
+            if (pdrv == SD_DRV)
+                *((DWORD*) buff) = getMMCDevice(1)->total_size;
+            else if ((pdrv <= NAND_DRVS) && nand_vol[pdrv-1])
+                *((DWORD*) buff) = nand_vol[pdrv-1]->size / NAND_SECTOR_SIZE;
+            else
+                return RES_NOTRDY;
             return RES_OK;
         case GET_BLOCK_SIZE:
             *((DWORD*) buff) = 0x2000;
@@ -5,14 +5,21 @@
 #include "hid.h"
 
 static FATFS fs;
+static FATFS nandfs[2];
 static FIL file;
+static FIL ofiles[OUT_FILES_MAX];
+static FIL* ofile = ofiles;
 static DIR dir;
+static char opaths[OUT_FILES_MAX][256];
+static char* opath = opaths[0];
 
 bool InitFS()
 {
     bool ret = (f_mount(&fs, "0:", 1) == FR_OK);
-    if (ret)
+    if (ret) {
         f_chdir(GetWorkDir());
+        MountNandFS();
+    }
 
     return ret;
 }
@@ -20,9 +27,19 @@ bool InitFS()
 void DeinitFS()
 {
     LogWrite(NULL);
+    f_mount(NULL, CTRNAND_DRV, 1);
+    f_mount(NULL, TWLN_DRV, 1);
     f_mount(NULL, "0:", 1);
 }
 
+void MountNandFS()
+{
+    // delayed mount, this only (re)registers the volumes and drops cached FAT data
+    // actual mounting happens on first access, against the currently selected NAND
+    f_mount(nandfs + 0, CTRNAND_DRV, 0);
+    f_mount(nandfs + 1, TWLN_DRV, 0);
+}
+
 const char* GetWorkDir()
 {
     const char* root = "/";
@@ -317,6 +334,48 @@ bool GetFileList(const char* path, char* list, int lsize, bool recursive, bool i
     return GetFileListWorker(&list, &lsize, fpath, 256, recursive, inc_files, inc_dirs);
 }
 
+bool FileFindPath(char* path, const char* pattern, size_t size)
+{
+    // resolves '?' / '*' wildcards in the path components, first match wins
+    const char* src = pattern;
+    char* dest = path;
+    
+    while (*src) {
+        char component[256];
+        const char* next = strchr(src, '/');
+        size_t len = (next) ? (size_t) (next - src) : strnlen(src, 255);
+        if (len >= 256)
+            return false;
+        memcpy(component, src, len);
+        component[len] = '\0';
+        if (strpbrk(component, "?*")) {
+            DIR pdir;
+            FILINFO fno;
+            char* end = dest;
+            // no trailing slash for the parent dir, except for the root dir
+            if ((end - path > 1) && (*(end - 1) == '/') && (*(end - 2) != ':'))
+                end--;
+            *end = '\0';
+            bool found = (f_findfirst(&pdir, &fno, path, component) == FR_OK) && *(fno.fname);
+            f_closedir(&pdir);
+            if (end != dest) *end = '/';
+            if (!found)
+                return false;
+            strncpy(component, fno.fname, 255);
+            len = strnlen(component, 255);
+        }
+        if ((size_t) (dest - path) + len + 2 > size)
+            return false;
+        memcpy(dest, component, len);
+        dest += len;
+        if (next) *(dest++) = '/';
+        src = (next) ? next + 1 : src + len;
+    }
+    *dest = '\0';
+    
+    return true;
+}
+
 size_t FileGetData(const char* path, void* buf, size_t size, size_t foffset)
 {
     unsigned flags = FA_READ | FA_OPEN_EXISTING;
@@ -360,6 +419,73 @@ size_t FileDumpData(const char* path, void* buf, size_t size)
     return (res) ? bytes_written : 0;
 }
 
+bool FileDelete(const char* path)
+{
+    if (*path == '/')
+        path++;
+    return (f_unlink(path) == FR_OK);
+}
+
+void OutFileSelect(u32 slot)
+{
+    if (slot >= OUT_FILES_MAX)
+        slot = 0;
+    ofile = ofiles + slot;
+    opath = opaths[slot];
+}
+
+bool OutFileCreate(const char* path, size_t size)
+{
+    if (*path == '/')
+        path++;
+    snprintf(opath, 256, "%s.tmp", path);
+    // make sure the containing folder exists
+    for (char* p = opath + 1; *p; p++) {
+        if (*p == '/') {
+            *p = 0;
+            f_mkdir(opath);
+            *p = '/';
+        }
+    }
+    if (f_open(ofile, opath, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+        return false;
+    // try to get one contiguous block, any allocation is fine otherwise
+    if ((f_expand(ofile, size, 1) != FR_OK) && (f_lseek(ofile, size) != FR_OK)) {
+        OutFileAbort();
+        return false;
+    }
+    f_lseek(ofile, 0);
+    return true;
+}
+
+size_t OutFileAppend(void* buf, size_t size)
+{
+    UINT bytes_written = 0;
+    if (f_write(ofile, buf, size, &bytes_written) != FR_OK)
+        return 0;
+    return bytes_written;
+}
+
+bool OutFileCommit()
+{
+    char path[256];
+    strncpy(path, opath, sizeof(path));
+    path[strnlen(path, sizeof(path)) - 4] = '\0'; // cut ".tmp"
+    f_truncate(ofile);
+    if (f_close(ofile) != FR_OK) {
+        f_unlink(opath);
+        return false;
+    }
+    f_unlink(path);
+    return (f_rename(opath, path) == FR_OK);
+}
+
+void OutFileAbort()
+{
+    f_close(ofile);
+    f_unlink(opath);
+}
+
 size_t LogWrite(const char* text)
 {
     #ifdef LOG_FILE
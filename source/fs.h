@@ -5,9 +5,19 @@
 #define WORK_DIRS   "/files9", "/Decrypt9"
 #define GAME_DIRS   "/files9/D9Game", "/Decrypt9/D9Game", "/D9Game", WORK_DIRS
 
+// decrypted NAND partitions, mounted read only as additional volumes
+#define CTRNAND_DRV "1:"
+#define TWLN_DRV    "2:"
+
+// number of independent OutFile*() output slots
+#define OUT_FILES_MAX 3
+
 bool InitFS();
 void DeinitFS();
 
+/** (Re)mounts the CTRNAND / TWLN volumes of the currently selected NAND **/
+void MountNandFS();
+
 /** Work directory handling **/
 const char* GetWorkDir();
 const char* GetGameDir();
@@ -55,12 +65,27 @@ bool DirRead(char* fname, int fsize);
 /** Get list of files under a given path **/
 bool GetFileList(const char* path, char* list, int lsize, bool recursive, bool inc_files, bool inc_dirs);
 
+/** Resolves wildcards in a path pattern (first match for each component) **/
+bool FileFindPath(char* path, const char* pattern, size_t size);
+
 /** Quickly opens a secondary file, gets some data, and closes it again **/
 size_t FileGetData(const char* path, void* buf, size_t size, size_t foffset);
 
 /** Quickly opens a secondary file, dumps some data, and closes it again **/
 size_t FileDumpData(const char* path, void* buf, size_t size);
 
+/** Deletes a file, must not be the currently opened one **/
+bool FileDelete(const char* path);
+
+/** Sequential output to <path>.tmp, preallocated to size, which replaces path on commit
+    path must not be the currently opened file when committing
+    OutFileSelect() switches between OUT_FILES_MAX independent output slots (default: 0) **/
+void OutFileSelect(u32 slot);
+bool OutFileCreate(const char* path, size_t size);
+size_t OutFileAppend(void* buf, size_t size);
+bool OutFileCommit();
+void OutFileAbort();
+
 /** Writes text to a constantly open log file **/
 size_t LogWrite(const char* text);
 
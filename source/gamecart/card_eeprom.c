@@ -83,84 +83,6 @@ int cardEepromGetType(void) {
 	return 0;
 }
 
-//---------------------------------------------------------------------------------
-u32 cardEepromGetSize() {
-//---------------------------------------------------------------------------------
-
-	int type = cardEepromGetType();
-
-	if(type == -1)
-		return 0;
-	if(type == 0)
-		return 8192;
-	if(type == 1)
-		return 512;
-	if(type == 2) {
-		u32 buf1,buf2,buf3;
-		cardReadEeprom(0,(u8*)&buf1,4,type);
-		if ( !(buf1 != 0 || buf1 != 0xffffffff) ) {
-			buf3 = ~buf1;
-			cardWriteEeprom(0,(u8*)&buf3,4,type);
-		} else {
-			buf3 = buf1;
-		}
-		int size = 8192;
-		while (1) {
-			cardReadEeprom(size,(u8*)&buf2,4,type);
-			if ( buf2 == buf3 ) break;
-			size += 8192;
-		};
-
-		if ( buf1 != buf3 ) cardWriteEeprom(0,(u8*)&buf1,4,type);
-
-		return size;
-	}
-
-	int device;
-
-	if(type == 3) {
-		int id = cardEepromReadID();
-
-		device = id & 0xffff;
-
-		if ( ((id >> 16) & 0xff) == 0x20 ) { // ST
-
-			switch(device) {
-
-			case 0x4014:
-				return 1024*1024;		//	8Mbit(1 meg)
-				break;
-			case 0x4013:
-			case 0x8013:				// M25PE40
-				return 512*1024;		//	4Mbit(512KByte)
-				break;
-			case 0x2017:
-				return 8*1024*1024;		//	64Mbit(8 meg)
-				break;
-			}
-		}
-
-		if ( ((id >> 16) & 0xff) == 0x62 ) { // Sanyo
-
-			if (device == 0x1100)
-				return 512*1024;		//	4Mbit(512KByte)
-
-		}
-
-		if ( ((id >> 16) & 0xff) == 0xC2 ) { // Macronix
-
-			if (device == 0x2211)
-				return 128*1024;		//	1Mbit(128KByte) - MX25L1021E
-		}
-
-
-		return 256*1024;		//	2Mbit(256KByte)
-	}
-
-	return 0;
-}
-
-
 //---------------------------------------------------------------------------------
 void cardReadEeprom(u32 address, u8 *data, u32 length, u32 addrtype) {
 //---------------------------------------------------------------------------------
@@ -1,5 +1,10 @@
 #include "ndscard.h"
 
+typedef struct {
+	u32 n_erased;
+	u32 n_programmed;
+} CardEepromStats;
+
 //---------------------------------------------------------------------------------
 static inline void eepromWaitBusy() {
 //---------------------------------------------------------------------------------
@@ -28,7 +33,7 @@ u8 cardEepromCommand(u8 command);
  */
 int cardEepromGetType(void);
 
-// Returns the size in bytes of EEPROM
+// Returns the size in bytes of EEPROM (read only probe, cached per cart ID)
 u32 cardEepromGetSize();
 
 // Erases the entire chip. TYPE 3 chips MUST be erased before writing to them. (I think?)
@@ -36,3 +41,7 @@ void cardEepromChipErase(void);
 
 // Erases a single sector of the TYPE 3 chip
 void cardEepromSectorErase(u32 address);
+
+// Writes the whole save, but only erases / programs where the chip contents differ
+// Returns the number of bytes that failed verification
+u32 cardWriteEepromDiff(u8 *data, u32 length, u32 addrtype, u8 *scratch, CardEepromStats *stats);
@@ -0,0 +1,158 @@
+// NDS save chips: read only size probe and differential writer
+// built on the SPI access in card_eeprom.c (the host tests replace that with a chip model)
+#include <string.h>
+#include "card_eeprom.h"
+#include "protocol.h"
+
+// known FLASH chips (JEDEC ID -> size)
+static const struct {
+	u32 id;
+	u32 size;
+} flash_sizes[] = {
+	{ 0x204012, 256*1024 },		// ST M45PE20
+	{ 0x204013, 512*1024 },		// ST M45PE40
+	{ 0x204014, 1024*1024 },	// ST M45PE80
+	{ 0x208012, 256*1024 },		// ST M25PE20
+	{ 0x208013, 512*1024 },		// ST M25PE40
+	{ 0x208014, 1024*1024 },	// ST M25PE80
+	{ 0x202017, 8*1024*1024 },	// ST M25P64
+	{ 0x621100, 512*1024 },		// Sanyo LE25FW403
+	{ 0xC22012, 256*1024 },		// Macronix MX25L2005
+	{ 0xC22013, 512*1024 },		// Macronix MX25L4005
+	{ 0xC22014, 1024*1024 },	// Macronix MX25L8005
+	{ 0xC22211, 128*1024 }		// Macronix MX25L1021E
+};
+
+// size probe result for this session, keyed by cart ID and chip type / ID
+static u32 probe_cart_id = 0;
+static u32 probe_chip_id = 0;
+static int probe_type = -1;
+static u32 probe_size = 0;
+
+//---------------------------------------------------------------------------------
+//	TYPE 2 EEPROMs mirror their contents past the end of the chip. The first
+//	8KB are compared to the 8KB at each possible size, read only, in windows.
+//	Windows of a single repeated byte (blank areas) match at any size, so a size
+//	only counts if at least one differing window matched too. A chip that is
+//	blank in its first 8KB can't be told apart from its mirrors, it is assumed to
+//	be the largest size.
+//---------------------------------------------------------------------------------
+static u32 eepromProbeMirror(void) {
+//---------------------------------------------------------------------------------
+	u8 ref[0x200];
+	u8 cmp[0x200];
+	u32 size;
+
+	for (size = 8192; size < 64*1024; size <<= 1) {
+		bool conclusive = false;
+		u32 offset;
+		for (offset = 0; offset < 8192; offset += sizeof(ref)) {
+			cardReadEeprom(offset, ref, sizeof(ref), 2);
+			cardReadEeprom(size + offset, cmp, sizeof(cmp), 2);
+			if (memcmp(ref, cmp, sizeof(ref)) != 0) break;
+			if (!conclusive)
+				conclusive = (memcmp(ref, ref + 1, sizeof(ref) - 1) != 0);
+		}
+		if ((offset == 8192) && conclusive) break; // mirror found
+	}
+
+	return size;
+}
+
+//---------------------------------------------------------------------------------
+//	TYPE 3 FLASH size from the JEDEC ID, the last ID byte usually is log2(size)
+//---------------------------------------------------------------------------------
+static u32 flashSizeFromID(u32 id) {
+//---------------------------------------------------------------------------------
+	for (u32 i = 0; i < sizeof(flash_sizes) / sizeof(flash_sizes[0]); i++)
+		if (flash_sizes[i].id == id) return flash_sizes[i].size;
+
+	if (((id & 0xff) >= 0x11) && ((id & 0xff) <= 0x17))
+		return 1 << (id & 0xff);
+
+	return 256*1024;		//	2Mbit(256KByte)
+}
+
+//---------------------------------------------------------------------------------
+u32 cardEepromGetSize() {
+//---------------------------------------------------------------------------------
+
+	int type = cardEepromGetType();
+
+	if(type == -1)
+		return 0;
+	if(type == 0)
+		return 8192;
+	if(type == 1)
+		return 512;
+
+	// probing is read only, but may take a while - reuse the result for the same cart
+	u32 cart_id = Cart_GetID();
+	u32 chip_id = (type == 3) ? cardEepromReadID() : 0xffffff; // JEDEC ID, FLASH only
+	if ((type == probe_type) && (cart_id == probe_cart_id) && (chip_id == probe_chip_id))
+		return probe_size;
+
+	u32 size = 0;
+	if(type == 2)
+		size = eepromProbeMirror();
+	if(type == 3)
+		size = flashSizeFromID(chip_id);
+
+	probe_type = type;
+	probe_cart_id = cart_id;
+	probe_chip_id = chip_id;
+	probe_size = size;
+
+	return size;
+}
+
+
+//---------------------------------------------------------------------------------
+//	Differential write: only erases sectors / programs pages that differ from the
+//	current chip contents, then reads them back. scratch needs 0x10000 byte.
+//	Returns the number of bytes that still differ after writing (0 -> verified).
+//---------------------------------------------------------------------------------
+u32 cardWriteEepromDiff(u8 *data, u32 length, u32 addrtype, u8 *scratch, CardEepromStats *stats) {
+//---------------------------------------------------------------------------------
+	u32 page = (addrtype == 1) ? 16 : (addrtype == 2) ? 32 : 256;
+	u32 sector = 0x10000; // erase sector size for TYPE 3, block size for others
+	u32 n_bad = 0;
+
+	memset(stats, 0, sizeof(CardEepromStats));
+	for (u32 address = 0; address < length; address += sector) {
+		u32 size = (length - address < sector) ? length - address : sector;
+		u8 *src = data + address;
+
+		cardReadEeprom(address, scratch, size, addrtype);
+		if (memcmp(scratch, src, size) == 0)
+			continue;
+
+		// FLASH can only clear bits when programming, setting any bit needs an erase
+		bool erase = false;
+		if (addrtype == 3) {
+			for (u32 i = 0; (i < size) && !erase; i++)
+				erase = (~scratch[i] & src[i]);
+		}
+		if (erase) {
+			cardEepromSectorErase(address);
+			memset(scratch, 0xFF, size);
+			stats->n_erased++;
+		}
+
+		// program only dirty pages
+		for (u32 i = 0; i < size; i += page) {
+			u32 n = (size - i < page) ? size - i : page;
+			if (memcmp(scratch + i, src + i, n) == 0)
+				continue;
+			cardWriteEeprom(address + i, src + i, n, addrtype);
+			stats->n_programmed++;
+		}
+
+		// verify
+		cardReadEeprom(address, scratch, size, addrtype);
+		for (u32 i = 0; i < size; i++)
+			n_bad += (scratch[i] != src[i]);
+	}
+
+	return n_bad;
+}
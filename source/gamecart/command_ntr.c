@@ -12,6 +12,7 @@
 
 
 u32 ReadDataFlags = 0;
+bool ReadDataLarge = false;
 
 void NTR_CmdReset(void)
 {
@@ -64,4 +65,36 @@ void NTR_CmdReadData (u32 offset, void* buffer)
     cardParamCommand (NTRCARD_CMD_DATA_READ, offset, ReadDataFlags | NTRCARD_ACTIVATE | NTRCARD_nRESET | NTRCARD_BLK_SIZE(1), (u32*)buffer, 0x200 / 4);
 }
 
+void NTR_CmdCheckDataBlock (u32 CartID, u32 offset, u8* buffer)
+{
+    // one NTR_DATA_BLOCK_SIZE byte read vs. the same data in 0x200 byte reads, large reads are
+    // only used if the cart returns the same, cheap carts never use them
+    u8* block_large = buffer;
+    u8* block_small = buffer + NTR_DATA_BLOCK_SIZE;
+    
+    ReadDataLarge = false;
+    if (CartID & 0x80000000)
+        return;
+    NTR_CmdReadDataBlock (offset, block_small);
+    cardParamCommand (NTRCARD_CMD_DATA_READ, offset, ReadDataFlags | NTRCARD_ACTIVATE | NTRCARD_nRESET | NTRCARD_BLK_SIZE(4), (u32*)block_large, NTR_DATA_BLOCK_SIZE / 4);
+    if (memcmp(block_large, block_small, NTR_DATA_BLOCK_SIZE) != 0)
+        return;
+    // uniform data is inconclusive
+    for (u32 i = 1; i < NTR_DATA_BLOCK_SIZE; i++) {
+        if (block_small[i] != block_small[0]) {
+            ReadDataLarge = true;
+            break;
+        }
+    }
+}
 
+void NTR_CmdReadDataBlock (u32 offset, void* buffer)
+{
+    // reads NTR_DATA_BLOCK_SIZE byte (offset aligned), in one command if NTR_CmdCheckDataBlock() allows it
+    if (!ReadDataLarge) {
+        for (u32 i = 0; i < NTR_DATA_BLOCK_SIZE; i += 0x200)
+            NTR_CmdReadData (offset + i, (u8*) buffer + i);
+        return;
+    }
+    cardParamCommand (NTRCARD_CMD_DATA_READ, offset, ReadDataFlags | NTRCARD_ACTIVATE | NTRCARD_nRESET | NTRCARD_BLK_SIZE(4), (u32*)buffer, NTR_DATA_BLOCK_SIZE / 4);
+}
@@ -9,11 +9,15 @@
 
 #include "common.h"
 
+#define NTR_DATA_BLOCK_SIZE 0x1000
+
 void NTR_CmdReset(void);
 u32 NTR_CmdGetCartId(void);
 void NTR_CmdEnter16ByteMode(void);
 void NTR_CmdReadHeader (u8* buffer);
 void NTR_CmdReadData (u32 offset, void* buffer);
+void NTR_CmdCheckDataBlock (u32 CartID, u32 offset, u8* buffer);
+void NTR_CmdReadDataBlock (u32 offset, void* buffer);
 
 bool NTR_Secure_Init (u8* buffer, u32 CartID, int iCardDevice);
 
@@ -28,6 +28,13 @@
 
 extern u32 ReadDataFlags;
 
+// key1 schedule after the level 1 / 2 steps, cached for the last game code
+static u32 key1CacheHash[0x412];
+static u32 key1CacheCode[3];
+static u32 key1CacheGameCode = 0;
+static int key1CacheLevel = -1;
+static int key1CacheDevice = -1;
+
 void NTR_CryptUp (u32* pCardHash, u32* aPtr)
 {
     u32 x = aPtr[1];
@@ -118,23 +125,43 @@ void NTR_ApplyKey (u32* pCardHash, int nCardHash, u32* pKeyCode)
 
 void NTR_InitKey (u32 aGameCode, u32* pCardHash, int nCardHash, u32* pKeyCode, int level, int iCardDevice)
 {
-	if(iCardDevice)
-	{
-		const u8* BlowfishTwl = (const u8*)0x01FFD3E0;
-		memcpy (pCardHash, BlowfishTwl, 0x1048);
-	}
-	else
+    int baseLevel = (level >= 2) ? 2 : level;
+    bool cacheable = (nCardHash == sizeof(key1CacheHash) / sizeof(u32));
+
+    if (cacheable && (aGameCode == key1CacheGameCode) && (baseLevel == key1CacheLevel) && (iCardDevice == key1CacheDevice))
     {
-		const u8* BlowfishNtr = (const u8*)0x01FFE428;
-		memcpy (pCardHash, BlowfishNtr, 0x1048);
-	}
-	
-    pKeyCode[0] = aGameCode;
-    pKeyCode[1] = aGameCode/2;
-    pKeyCode[2] = aGameCode*2;
+        memcpy (pCardHash, key1CacheHash, sizeof(key1CacheHash));
+        memcpy (pKeyCode, key1CacheCode, sizeof(key1CacheCode));
+    }
+    else
+    {
+        if(iCardDevice)
+        {
+            const u8* BlowfishTwl = (const u8*)0x01FFD3E0;
+            memcpy (pCardHash, BlowfishTwl, 0x1048);
+        }
+        else
+        {
+            const u8* BlowfishNtr = (const u8*)0x01FFE428;
+            memcpy (pCardHash, BlowfishNtr, 0x1048);
+        }
+
+        pKeyCode[0] = aGameCode;
+        pKeyCode[1] = aGameCode/2;
+        pKeyCode[2] = aGameCode*2;
 
-	if (level >= 1) NTR_ApplyKey (pCardHash, nCardHash, pKeyCode);
-    if (level >= 2) NTR_ApplyKey (pCardHash, nCardHash, pKeyCode);
+        if (level >= 1) NTR_ApplyKey (pCardHash, nCardHash, pKeyCode);
+        if (level >= 2) NTR_ApplyKey (pCardHash, nCardHash, pKeyCode);
+
+        if (cacheable)
+        {
+            memcpy (key1CacheHash, pCardHash, sizeof(key1CacheHash));
+            memcpy (key1CacheCode, pKeyCode, sizeof(key1CacheCode));
+            key1CacheGameCode = aGameCode;
+            key1CacheLevel = baseLevel;
+            key1CacheDevice = iCardDevice;
+        }
+    }
 
     pKeyCode[1] = pKeyCode[1]*2;
     pKeyCode[2] = pKeyCode[2]/2;
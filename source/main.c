@@ -12,6 +12,7 @@
 #include "decryptor/nand.h"
 #include "decryptor/nandfat.h"
 #include "decryptor/titlekey.h"
+#include "decryptor/romfs.h"
 #include "decryptor/selftest.h"
 #include "decryptor/xorpad.h"
 #include "decryptor/transfer.h"
@@ -116,9 +117,10 @@ void main(int argc, char** argv)
     MenuInfo menu[] =
     {
         {
-            "XORpad Generator Options", 9,
+            "XORpad Generator Options", 12,
             {
                 { "NCCH Padgen",               NcchPadgenDesc,             &NcchPadgen,            0 },
+                { "NCCH Padgen (game dir)",    NcchPadgenDirectDesc,       &NcchPadgen,            PG_GAMEDIR },
                 { "SD Padgen (SDinfo.bin)",    SdPadgenDesc,               &SdPadgen,              0 },
                 { "SD Padgen (SysNAND dir)",   SdPadgenDirectDesc,         &SdPadgenDirect,        0 },
                 { "SD Padgen (EmuNAND dir)",   SdPadgenDirectDesc,         &SdPadgenDirect,        N_EMUNAND },
@@ -126,7 +128,9 @@ void main(int argc, char** argv)
                 { "CTRNAND Padgen",            CtrNandPadgenDesc,          &CtrNandPadgen,         0 },
                 { "CTRNAND Padgen (slot0x4)",  CtrNandPadgen0x04Desc,      &CtrNandPadgen,         PG_FORCESLOT4 },
                 { "TWLNAND Padgen",            TwlNandPadgenDesc,          &TwlNandPadgen,         0 },
-                { "FIRM0FIRM1 Padgen",         Firm0Firm1PadgenDesc,       &Firm0Firm1Padgen,      0 }
+                { "FIRM0FIRM1 Padgen",         Firm0Firm1PadgenDesc,       &Firm0Firm1Padgen,      0 },
+                { "NAND Padgen (ranges)",      NandRangePadgenDesc,        &NandRangePadgen,       0 },
+                { "NAND Padgen (FAT only)",    NandRangePadgenFatDesc,     &NandRangePadgen,       PG_FATONLY }
             }
         },
         {
@@ -181,13 +185,15 @@ void main(int argc, char** argv)
             }
         },
         {
-            "Gamecart Dumper Options", 7,
+            "Gamecart Dumper Options", 9,
             {
                 { "Dump Cart (full)",             DumpGameCartFullDesc,    &DumpGameCart,          0 },
                 { "Dump Cart (trim)",             DumpGameCartTrimDesc,    &DumpGameCart,          CD_TRIM },
                 { "Dump & Decrypt Cart (full)",   DumpGameCartDecFullDesc, &DumpGameCart,          CD_DECRYPT },
                 { "Dump & Decrypt Cart (trim)",   DumpGameCartDecTrimDesc, &DumpGameCart,          CD_DECRYPT | CD_TRIM },
                 { "Dump Cart to CIA",             DumpGameCartCIADesc,     &DumpGameCart,          CD_DECRYPT | CD_MAKECIA },
+                { "Dump Cart (all, full)",        DumpGameCartAllDesc,     &DumpGameCart,          CD_TEE },
+                { "Dump Cart (all, trim)",        DumpGameCartAllDesc,     &DumpGameCart,          CD_TEE | CD_TRIM },
                 { "Dump Private Header",          DumpPrivateHeaderDesc,   &DumpPrivateHeader,     0 },
                 // { "Dump Savegame from Cart",      DumpCartSaveDesc,        &ProcessCartSave,       0 },
                 { "Flash Savegame to Cart",       DumpCartSaveDesc,        &ProcessCartSave,       CD_FLASH }
@@ -215,10 +221,11 @@ void main(int argc, char** argv)
         },
         // everything below is not contained in the main menu
         {
-            "SysNAND Backup/Restore Options", 6, // ID 0
+            "SysNAND Backup/Restore Options", 7, // ID 0
             {
                 { "NAND Backup",                  DumpNandFullDesc,        &DumpNand,              0 },
                 { "NAND Backup (min size)",       DumpNandMinDesc,         &DumpNand,              NB_MINSIZE },
+                { "NAND Backup & Partitions",     DumpNandArchiveDesc,     &DumpNandArchive,       NA_PARTITIONS },
                 { "NAND Restore",                 RestoreNandDesc,         &RestoreNand,           N_NANDWRITE | N_A9LHWRITE },
                 { "NAND Restore (forced)",        RestoreNandForcedDesc,   &RestoreNand,           N_NANDWRITE | N_A9LHWRITE | NR_NOCHECKS },
                 { "NAND Restore (keep hax)",      RestoreNandKeepHaxDesc,  &RestoreNand,           N_NANDWRITE | NR_KEEPA9LH },
@@ -226,10 +233,11 @@ void main(int argc, char** argv)
             }
         },
         {
-            "EmuNAND Backup/Restore Options", 5, // ID 1
+            "EmuNAND Backup/Restore Options", 6, // ID 1
             {
                 { "NAND Backup",                  DumpNandFullDesc,        &DumpNand,              N_EMUNAND },
                 { "NAND Backup (min size)",       DumpNandMinDesc,         &DumpNand,              N_EMUNAND | NB_MINSIZE },
+                { "NAND Backup & Partitions",     DumpNandArchiveDesc,     &DumpNandArchive,       N_EMUNAND | NA_PARTITIONS },
                 { "NAND Restore",                 RestoreNandDesc,         &RestoreNand,           N_NANDWRITE | N_EMUNAND | N_FORCEEMU },
                 { "NAND Restore (forced)",        RestoreNandForcedDesc,   &RestoreNand,           N_NANDWRITE | N_EMUNAND | N_FORCEEMU | NR_NOCHECKS },
                 { "Validate NAND Dump",           ValidateNandDumpDesc,    &ValidateNandDump,      0 } // same as the one in SysNAND backup & restore
@@ -418,10 +426,15 @@ void main(int argc, char** argv)
             }
         },
         {
-            "NCCH/NCSD File Options", 2, // ID 18
+            "NCCH/NCSD File Options", 7, // ID 18
             {
                 { "NCCH/NCSD Decryptor",          NcchNcsdCryptoDesc,  &CryptGameFiles,        GC_NCCH_PROCESS },
-                { "NCCH/NCSD Encryptor",          NcchNcsdCryptoDesc,  &CryptGameFiles,        GC_NCCH_PROCESS | GC_NCCH_ENC0x2C }
+                { "NCCH/NCSD Encryptor",          NcchNcsdCryptoDesc,  &CryptGameFiles,        GC_NCCH_PROCESS | GC_NCCH_ENC0x2C },
+                { "NCCH/NCSD/CIA File Extractor", ExtractGameFilesDesc, &ExtractGameFiles,     0 },
+                { "RomFS Verifier (full)",        VerifyGameFilesDesc, &VerifyGameFiles,       0 },
+                { "RomFS Verifier (quick)",       VerifyGameFilesDesc, &VerifyGameFiles,       RV_QUICK },
+                { "NCSD Splitter",                NcsdSplitDesc,       &SplitNcsdFiles,        0 },
+                { "NCSD Splitter (decrypt)",      NcsdSplitDesc,       &SplitNcsdFiles,        SP_DECRYPT }
             }
         },
         {
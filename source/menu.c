@@ -143,6 +143,7 @@ u32 ProcessEntry(MenuEntry* entry)
     
     u32 pad_state;
     u32 res = 0;
+    u32 cache_hits, cache_misses;
     
     // unlock sequence for dangerous features
     if (nand_write || a9lh_write) {
@@ -201,6 +202,10 @@ u32 ProcessEntry(MenuEntry* entry)
     DebugColor(entryColor, "Selected: [%s]", entry->name);
     res = (SetNand(emunand, nand_force) == 0) ? (*(entry->function))(entry->param) : 1;
     DebugColor((res == 0) ? COLOR_GREEN : COLOR_RED, "%s: %s!", entry->name, (res == 0) ? "succeeded" : "failed");
+    GetNandCacheStats(&cache_hits, &cache_misses);
+    if (cache_hits + cache_misses)
+        Debug("NAND cache: %lu of %lu sectors hit (%llu%%)", cache_hits, cache_hits + cache_misses,
+            ((u64) cache_hits * 100) / (cache_hits + cache_misses));
     Debug("");
     Debug("Press B to return, START to reboot.");
     #ifdef USE_THEME
@@ -0,0 +1,1201 @@
+// batch_decrypt: decrypts NCCH / NCSD / CIA / BOSS files on PC, same results as the
+// "Content Decryptor" (CryptGameFiles()) on the 3DS
+//
+// Keys come from the key folder (-k): slot0x2CKeyX.bin (plus slot0x25KeyX.bin,
+// slot0x18KeyX.bin, slot0x1BKeyX.bin for 7x / Secure3 / Secure4 NCCHs),
+// slot0x3DKeyX.bin for CIAs, slot0x38Key.bin for BOSS files and seeddb.bin for
+// seed crypto. Only retail keys are supported.
+//
+// Every file is split into its crypto ranges (NCCH crypto plan, CIA contents,
+// BOSS payload), ranges are cut into chunks and run on a work stealing thread pool.
+// Results are written to the output folder (-o), the CIA CBC layer needs the
+// original ciphertext next to the result.
+
+#define _FILE_OFFSET_BITS 64
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "decryptor/game.h"
+#include "hostcrypto.h"
+#include "hostio.h"
+
+#define CHUNK_SIZE  (4 * 1024 * 1024)
+#define MAX_THREADS 64
+#define MAX_FILES   4096
+
+enum { FILE_NCCH, FILE_NCSD, FILE_CIA, FILE_BOSS };
+enum { TASK_STAGE, TASK_COPY, TASK_CRYPT, TASK_HASH };
+
+// one encrypted range of a file, CTR ranges start with ctr = iv
+typedef struct {
+    u64 offset;
+    u64 size;
+    bool cbc;
+    u8 iv[16];
+    AesKey key;
+} CryptRange;
+
+// one NCCH of a job, the header is written back after decryption
+typedef struct {
+    u64 offset;
+    u32 state; // same as CryptNcch(): 0 -> decrypted, 1 -> failed, 2 -> not encrypted
+    NcchHeader header;
+} JobNcch;
+
+typedef struct Job Job;
+
+typedef struct {
+    Job* job;
+    u32 type;
+    u32 index;
+    u64 offset;
+    u64 size;
+} Task;
+
+struct Job {
+    const char* path;
+    char out_path[1024];
+    u32 type;
+    u32 stage;
+    u32 result;
+    u32 n_left; // tasks left in the current stage
+    MapFile src;
+    MapFile dst;
+    bool created;
+    const u8* in; // data the current stage reads from (src or dst)
+    // crypto ranges of the current stage, sorted by offset
+    CryptRange* ranges;
+    u32 n_ranges;
+    // NCCHs (NCSD partitions / CIA contents), CIA data
+    JobNcch* ncch;
+    u32 n_ncch;
+    u8* ticktmd;
+    CiaInfo cia;
+    u64* content_offset;
+    u8 (*hashes)[32];
+    u32 content_count;
+    u32 n_processed;
+    bool untouched;
+    // tasks of the next stage, pushed all at once
+    Task* staged;
+    u32 n_staged;
+    u32 max_staged;
+    // log, printed in input order when everything is done
+    char* log;
+    size_t log_size;
+};
+
+typedef struct {
+    pthread_mutex_t lock;
+    Task* tasks;
+    u32 head;
+    u32 tail;
+    u32 size;
+} TaskDeque;
+
+static const char* ncsd_partitions[8] = NCSD_PARTITION_NAMES;
+static const char* key_dir = ".";
+static const char* out_dir = NULL;
+static bool cia_deep = false;
+
+static u8 keyx[0x40][16];
+static bool has_keyx[0x40];
+static u8 boss_key[16];
+static bool has_boss_key = false;
+static SeedInfo* seeddb = NULL;
+
+static TaskDeque deques[MAX_THREADS];
+static u32 n_workers = 1;
+static u32 n_jobs_left = 0;
+
+
+static void JobLog(Job* job, const char* format, ...)
+{
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+    len = min(max(len, 0), (int) sizeof(line) - 2);
+    line[len++] = '\n';
+    char* log = realloc(job->log, job->log_size + len + 1);
+    if (!log)
+        return;
+    memcpy(log + job->log_size, line, len);
+    job->log = log;
+    job->log_size += len;
+    job->log[job->log_size] = '\0';
+}
+
+static void StageTask(Job* job, u32 type, u32 index, u64 offset, u64 size)
+{
+    if (job->n_staged >= job->max_staged) {
+        u32 max_staged = (job->max_staged) ? job->max_staged * 2 : 64;
+        Task* staged = realloc(job->staged, max_staged * sizeof(Task));
+        if (!staged) {
+            printf("Out of memory\n");
+            exit(1);
+        }
+        job->staged = staged;
+        job->max_staged = max_staged;
+    }
+    job->staged[job->n_staged++] = (Task) { .job = job, .type = type, .index = index, .offset = offset, .size = size };
+}
+
+static void StageChunks(Job* job, u32 type, u32 index, u64 offset, u64 size)
+{
+    for (u64 pos = 0; pos < size; pos += CHUNK_SIZE)
+        StageTask(job, type, index, offset + pos, min((u64) CHUNK_SIZE, size - pos));
+}
+
+static CryptRange* AddRange(Job* job, u64 offset, u64 size, bool cbc, const u8* iv, const u8* normal_key)
+{
+    CryptRange* ranges = realloc(job->ranges, (job->n_ranges + 1) * sizeof(CryptRange));
+    if (!ranges)
+        return NULL;
+    job->ranges = ranges;
+    CryptRange* range = ranges + job->n_ranges++;
+    *range = (CryptRange) { .offset = offset, .size = size, .cbc = cbc };
+    memcpy(range->iv, iv, 16);
+    AesSetKey(&(range->key), normal_key);
+    return range;
+}
+
+static int CompareRanges(const void* a, const void* b)
+{
+    u64 offset_a = ((const CryptRange*) a)->offset;
+    u64 offset_b = ((const CryptRange*) b)->offset;
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+static u32 StageRanges(Job* job, bool copy)
+{
+    // chunks for all ranges, with copy also for everything in between
+    qsort(job->ranges, job->n_ranges, sizeof(CryptRange), CompareRanges);
+    u64 pos = 0;
+    for (u32 i = 0; i <= job->n_ranges; i++) {
+        CryptRange* range = job->ranges + i;
+        u64 end = (i < job->n_ranges) ? range->offset : job->src.size;
+        if (i < job->n_ranges) {
+            if ((range->offset > job->src.size) || (range->size > job->src.size - range->offset)) {
+                JobLog(job, "Crypto range is out of bounds");
+                return 1;
+            }
+            if (range->offset < pos) {
+                JobLog(job, "Crypto ranges overlap");
+                return 1;
+            }
+        }
+        if (copy && (end > pos))
+            StageChunks(job, TASK_COPY, 0, pos, end - pos);
+        if (i < job->n_ranges) {
+            StageChunks(job, TASK_CRYPT, i, range->offset, range->size);
+            pos = range->offset + range->size;
+        }
+    }
+    return 0;
+}
+
+static u32 CheckHash(const Job* job, u64 offset, u64 size, const u8* expected)
+{
+    u8 hash[32];
+    if ((offset > job->dst.size) || (size > job->dst.size - offset))
+        return 1;
+    Sha256(hash, job->dst.data + offset, size);
+    return (memcmp(hash, expected, 32) == 0) ? 0 : 1;
+}
+
+
+static u32 LoadKeyFile(u8* key, const char* name)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", key_dir, name);
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return 1;
+    u32 size = fread(key, 1, 16, fp);
+    fclose(fp);
+    return (size == 16) ? 0 : 1;
+}
+
+static void LoadKeys(void)
+{
+    const u32 slots[] = { 0x18, 0x1B, 0x25, 0x2C, 0x3D };
+    char name[32];
+    for (u32 i = 0; i < sizeof(slots) / sizeof(u32); i++) {
+        snprintf(name, sizeof(name), "slot0x%02XKeyX.bin", slots[i]);
+        has_keyx[slots[i]] = (LoadKeyFile(keyx[slots[i]], name) == 0);
+    }
+    has_boss_key = (LoadKeyFile(boss_key, "slot0x38Key.bin") == 0);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/seeddb.bin", key_dir);
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return;
+    seeddb = calloc(1, sizeof(SeedInfo));
+    if (seeddb) {
+        u32 size = fread(seeddb, 1, sizeof(SeedInfo), fp);
+        if ((size < 16) || (seeddb->n_entries > SEEDDB_MAX_ENTRIES) ||
+            (size < 16 + (seeddb->n_entries * sizeof(SeedInfoEntry)))) {
+            printf("Corrupt seeddb.bin, ignored\n");
+            seeddb->n_entries = 0;
+        }
+    }
+    fclose(fp);
+}
+
+static u32 FindSeed(u8* seed, u64 titleId, const u8* hash)
+{
+    // same as FindSeed() in the firmware, seeddb.bin only
+    for (u32 i = 0; seeddb && (i < seeddb->n_entries); i++) {
+        SeedInfoEntry* entry = seeddb->entries + i;
+        if (entry->titleId != titleId)
+            continue;
+        if (hash) {
+            u8 data[16 + 8];
+            u8 sha[32];
+            memcpy(data, entry->external_seed, 16);
+            memcpy(data + 16, &titleId, 8);
+            Sha256(sha, data, 16 + 8);
+            if (memcmp(sha, hash, 4) != 0)
+                continue;
+        }
+        memcpy(seed, entry->external_seed, 16);
+        return 0;
+    }
+    return 1;
+}
+
+
+static void NcchCtr(u8* ctr, const NcchHeader* ncch, u8 sub_id)
+{
+    // same as GetNcchCtr() in game.c
+    memset(ctr, 0x00, 16);
+    if (ncch->version == 1) {
+        memcpy(ctr, &(ncch->partitionId), 8);
+        if (sub_id == 1)
+            AddCtr(ctr, 0x200);
+        else if (sub_id == 2)
+            AddCtr(ctr, ncch->offset_exefs * 0x200);
+        else if (sub_id == 3)
+            AddCtr(ctr, ncch->offset_romfs * 0x200);
+    } else {
+        for (u32 i = 0; i < 8; i++)
+            ctr[i] = ((const u8*) &(ncch->partitionId))[7-i];
+        ctr[8] = sub_id;
+    }
+}
+
+static u32 NcchCryptPlan(NcchCryptRegion* plan, u32* n_regions, const NcchHeader* ncch, const u8* exefs_hdr, bool split_exefs)
+{
+    // same as GetNcchCryptPlan() in game.c, sorting is left to StageRanges()
+    u32 n = 0;
+    if (ncch->size_exthdr > 0) {
+        plan[n] = (NcchCryptRegion) {.offset = 0x200, .size = 0x800, .key_id = 0};
+        NcchCtr(plan[n++].ctr, ncch, 1);
+    }
+    if ((ncch->size_exefs > 0) && split_exefs) {
+        u32 offset_exefs = ncch->offset_exefs * 0x200;
+        plan[n] = (NcchCryptRegion) {.offset = offset_exefs, .size = 0x200, .key_id = 0};
+        NcchCtr(plan[n++].ctr, ncch, 2);
+        for (u32 i = 0; i < 10; i++) {
+            const char* name_exefs_file = (const char*) exefs_hdr + (i*0x10);
+            u32 offset_exefs_file = getle32(exefs_hdr + (i*0x10) + 0x8) + 0x200;
+            u32 size_exefs_file = align(getle32(exefs_hdr + (i*0x10) + 0xC), 0x200);
+            if (size_exefs_file == 0)
+                continue;
+            if (offset_exefs_file % 16)
+                return 1;
+            NcchCryptRegion* region = plan + n++;
+            region->offset = offset_exefs + offset_exefs_file;
+            region->size = size_exefs_file;
+            region->key_id = ((strncmp(name_exefs_file, "banner", 8) == 0) ||
+                (strncmp(name_exefs_file, "icon", 8) == 0)) ? 0 : 1;
+            NcchCtr(region->ctr, ncch, 2);
+            AddCtr(region->ctr, offset_exefs_file / 0x10);
+        }
+    } else if (ncch->size_exefs > 0) {
+        plan[n] = (NcchCryptRegion) {.offset = ncch->offset_exefs * 0x200, .size = ncch->size_exefs * 0x200, .key_id = 0};
+        NcchCtr(plan[n++].ctr, ncch, 2);
+    }
+    if (ncch->size_romfs > 0) {
+        plan[n] = (NcchCryptRegion) {.offset = ncch->offset_romfs * 0x200, .size = ncch->size_romfs * 0x200, .key_id = 1};
+        NcchCtr(plan[n++].ctr, ncch, 3);
+    }
+    *n_regions = n;
+    return 0;
+}
+
+static u32 SetupNcchKeys(Job* job, const NcchHeader* ncch, u64 seedId, u8* key0, u8* key1)
+{
+    // same as SetupNcchCrypto() in game.c, but with normal keys from the key files
+    bool uses7xCrypto = ncch->flags[3];
+    bool usesSeedCrypto = ncch->flags[7] & 0x20;
+    bool usesSec3Crypto = (ncch->flags[3] == 0x0A);
+    bool usesSec4Crypto = (ncch->flags[3] == 0x0B);
+    bool usesFixedKey = ncch->flags[7] & 0x01;
+    u8 keyY[16];
+
+    JobLog(job, "Code / Crypto: %.16s / %s%s%s%s", ncch->productcode, (usesFixedKey) ? "FixedKey " : "", (usesSec4Crypto) ? "Secure4 " : (usesSec3Crypto) ? "Secure3 " : (uses7xCrypto) ? "7x " : "", (usesSeedCrypto) ? "Seed " : "", (!uses7xCrypto && !usesSeedCrypto && !usesFixedKey) ? "Standard" : "");
+
+    if (usesFixedKey) {
+        const u8 sysKey[16] = {0x52, 0x7C, 0xE6, 0x30, 0xA9, 0xCA, 0x30, 0x5F, 0x36, 0x96, 0xF3, 0xCD, 0xE9, 0x54, 0x19, 0x4B};
+        memset(key0, 0x00, 16);
+        if (ncch->programId & ((u64) 0x10 << 32))
+            memcpy(key0, sysKey, 16);
+        memcpy(key1, key0, 16);
+        return 0;
+    }
+
+    u32 slot1 = (usesSec4Crypto) ? 0x1B : ((usesSec3Crypto) ? 0x18 : ((uses7xCrypto) ? 0x25 : 0x2C));
+    if (!has_keyx[0x2C] || !has_keyx[slot1]) {
+        JobLog(job, "slot0x%02XKeyX.bin not found", (has_keyx[0x2C]) ? slot1 : 0x2C);
+        return 1;
+    }
+    memcpy(keyY, ncch->signature, 16);
+    if (usesSeedCrypto) {
+        u8 seed[16];
+        u8 keydata[32];
+        u8 sha256sum[32];
+        if (FindSeed(seed, seedId, NULL) != 0) {
+            JobLog(job, "Seed not found in seeddb.bin!");
+            return 1;
+        }
+        if (FindSeed(seed, seedId, ncch->hash_seed) != 0) {
+            JobLog(job, "Seed found, but validation failed!");
+            return 1;
+        }
+        memcpy(keydata, ncch->signature, 16);
+        memcpy(keydata + 16, seed, 16);
+        Sha256(sha256sum, keydata, 32);
+        memcpy(keyY, sha256sum, 16);
+    }
+    KeyScramble(key0, keyx[0x2C], ncch->signature);
+    KeyScramble(key1, keyx[slot1], keyY);
+    return 0;
+}
+
+static u32 PlanNcch(Job* job, u64 offset, u64 size, u64 seedId)
+{
+    // adds the crypto ranges of the NCCH at offset (CryptNcchTo() up to the crypto plan)
+    // returns the same as CryptNcch(), the header is kept for FinalizeNcch()
+    JobNcch* list = realloc(job->ncch, (job->n_ncch + 1) * sizeof(JobNcch));
+    if (!list)
+        return 1;
+    job->ncch = list;
+    JobNcch* jn = list + job->n_ncch++;
+    NcchHeader* ncch = &(jn->header);
+    u64 size_file = job->src.size;
+
+    jn->offset = offset;
+    jn->state = 1;
+    if ((offset > size_file) || (size_file - offset < 0x200))
+        return 1;
+    memcpy(ncch, job->in + offset, 0x200);
+    jn->state = 2;
+
+    if (memcmp(ncch->magic, "NCCH", 4) != 0) {
+        JobLog(job, "Not a NCCH container");
+        return 2;
+    }
+    u32 size_sum = 0x200 + ((ncch->size_exthdr) ? 0x800 : 0x0) + 0x200 *
+        (ncch->size_plain + ncch->size_logo + ncch->size_exefs + ncch->size_romfs);
+    if (ncch->size * 0x200 < size_sum) {
+        JobLog(job, "Probably not a NCCH container");
+        return 2;
+    }
+    if (ncch->flags[7] & 0x04) {
+        JobLog(job, "NCCH is not encrypted");
+        return 2;
+    }
+    if ((size > 0) && ((u64) ncch->size * 0x200 > size)) {
+        JobLog(job, "NCCH size is out of bounds");
+        return (jn->state = 1);
+    }
+    if (seedId == 0) seedId = ncch->programId;
+
+    u8 key0[16];
+    u8 key1[16];
+    if (SetupNcchKeys(job, ncch, seedId, key0, key1) != 0)
+        return (jn->state = 1);
+    JobLog(job, "Decrypt ExHdr/ExeFS/RomFS (%ukB/%ukB/%uMB)",
+        (ncch->size_exthdr > 0) ? 0x800 / 1024 : 0,
+        (ncch->size_exefs * 0x200) / 1024,
+        (ncch->size_romfs * 0x200) / (1024*1024));
+
+    // plain ExeFS header, needed for the special ExeFS crypto
+    // differing normal keys <-> differing keyslots / keyYs in CryptNcchTo()
+    u8 exefs_hdr[0x200] = { 0 };
+    bool split_exefs = (memcmp(key0, key1, 16) != 0);
+    if ((ncch->size_exefs > 0) && split_exefs) {
+        u64 offset_exefs = offset + ((u64) ncch->offset_exefs * 0x200);
+        u8 ctr[16];
+        AesKey key;
+        if ((offset_exefs > size_file) || (size_file - offset_exefs < 0x200)) {
+            JobLog(job, "Bad ExeFS / NCCH layout!");
+            return (jn->state = 1);
+        }
+        NcchCtr(ctr, ncch, 2);
+        AesSetKey(&key, key0);
+        AesCtr(&key, ctr, 0, exefs_hdr, job->in + offset_exefs, 0x200);
+    }
+
+    NcchCryptRegion plan[NCCH_PLAN_MAX];
+    u32 n_regions = 0;
+    if (NcchCryptPlan(plan, &n_regions, ncch, exefs_hdr, split_exefs) != 0) {
+        JobLog(job, "Bad ExeFS / NCCH layout!");
+        return (jn->state = 1);
+    }
+    for (u32 i = 0; i < n_regions; i++) {
+        if (!AddRange(job, offset + plan[i].offset, plan[i].size, false, plan[i].ctr, (plan[i].key_id) ? key1 : key0)) {
+            JobLog(job, "Out of memory");
+            return (jn->state = 1);
+        }
+    }
+
+    ncch->flags[3] = 0x00;
+    ncch->flags[7] &= (0x01|0x20)^0xFF;
+    ncch->flags[7] |= 0x04;
+    return (jn->state = 0);
+}
+
+static u32 FinalizeNcch(Job* job, JobNcch* jn)
+{
+    // writes the header, then the same checks as VerifyNcch()
+    const char* status_str[3] = { "OK", "Fail", "-" };
+    NcchHeader* ncch = &(jn->header);
+    u32 ver_exthdr = 2;
+    u32 ver_exefs = 2;
+    u32 ver_romfs = 2;
+
+    memcpy(job->dst.data + jn->offset, ncch, 0x200);
+    if (ncch->size_exthdr > 0)
+        ver_exthdr = CheckHash(job, jn->offset + 0x200, 0x400, ncch->hash_exthdr);
+    if (ncch->size_exefs_hash > 0)
+        ver_exefs = CheckHash(job, jn->offset + ((u64) ncch->offset_exefs * 0x200), (u64) ncch->size_exefs_hash * 0x200, ncch->hash_exefs);
+    if (ncch->size_romfs_hash > 0)
+        ver_romfs = CheckHash(job, jn->offset + ((u64) ncch->offset_romfs * 0x200), (u64) ncch->size_romfs_hash * 0x200, ncch->hash_romfs);
+    if (ncch->size_exefs > 0) {
+        u64 offset_exefs = jn->offset + ((u64) ncch->offset_exefs * 0x200);
+        const u8* exefs = job->dst.data + offset_exefs;
+        if ((offset_exefs > job->dst.size) || (job->dst.size - offset_exefs < 0x200))
+            ver_exefs = 1;
+        for (u32 i = 0; (i < 10) && (ver_exefs != 1); i++) {
+            u64 offset_exefs_file = offset_exefs + getle32(exefs + (i*0x10) + 0x8) + 0x200;
+            u32 size_exefs_file = getle32(exefs + (i*0x10) + 0xC);
+            const u8* hash_exefs_file = exefs + 0x200 - ((i+1)*0x20);
+            if (size_exefs_file == 0)
+                break;
+            ver_exefs = CheckHash(job, offset_exefs_file, size_exefs_file, hash_exefs_file);
+        }
+    }
+    JobLog(job, "Verify ExHdr/ExeFS/RomFS: %s/%s/%s", status_str[ver_exthdr], status_str[ver_exefs], status_str[ver_romfs]);
+
+    jn->state = (((ver_exthdr | ver_exefs | ver_romfs) & 1) == 0) ? 0 : 1;
+    return jn->state;
+}
+
+
+// stages return 0 with tasks staged, 0 without tasks to go on to the next stage right away,
+// 1 when the job is done (job->result is set)
+static u32 StageNcch(Job* job)
+{
+    if (job->stage == 0) {
+        if ((PlanNcch(job, 0, 0, 0) == 1) || (StageRanges(job, true) != 0))
+            return (job->result = 1);
+        return 0;
+    }
+    job->result = (job->ncch[0].state == 0) ? FinalizeNcch(job, job->ncch) : 0;
+    return 1;
+}
+
+static u32 StageNcsd(Job* job)
+{
+    if (job->stage == 0) {
+        const NcsdHeader* ncsd = (const NcsdHeader*) job->src.data;
+        for (u32 p = 0; p < 8; p++) {
+            u64 seedId = (p) ? ncsd->mediaId : 0;
+            u64 offset = (u64) ncsd->partitions[p].offset * 0x200;
+            u64 size = (u64) ncsd->partitions[p].size * 0x200;
+            if (size == 0)
+                continue;
+            JobLog(job, "Partition %u (%s)", p, ncsd_partitions[p]);
+            if (PlanNcch(job, offset, size, seedId) == 1)
+                return (job->result = 1);
+        }
+        return (StageRanges(job, true) != 0) ? (job->result = 1) : 0;
+    }
+    for (u32 i = 0; i < job->n_ncch; i++)
+        if ((job->ncch[i].state == 0) && (FinalizeNcch(job, job->ncch + i) != 0))
+            job->result = 1;
+    return 1;
+}
+
+static u32 StageCia(Job* job)
+{
+    const u8 sig_type[4] =  { 0x00, 0x01, 0x00, 0x04 };
+    // from https://github.com/profi200/Project_CTR/blob/master/makerom/pki/prod.h#L19, same as keys.c
+    static const u8 common_keyy[6][16] = {
+        {0xD0, 0x7B, 0x33, 0x7F, 0x9C, 0xA4, 0x38, 0x59, 0x32, 0xA2, 0xE2, 0x57, 0x23, 0x23, 0x2E, 0xB9} , // 0 - eShop Titles
+        {0x0C, 0x76, 0x72, 0x30, 0xF0, 0x99, 0x8F, 0x1C, 0x46, 0x82, 0x82, 0x02, 0xFA, 0xAC, 0xBE, 0x4C} , // 1 - System Titles
+        {0xC4, 0x75, 0xCB, 0x3A, 0xB8, 0xC7, 0x88, 0xBB, 0x57, 0x5E, 0x12, 0xA1, 0x09, 0x07, 0xB8, 0xA4} , // 2
+        {0xE4, 0x86, 0xEE, 0xE3, 0xD0, 0xC0, 0x9C, 0x90, 0x2F, 0x66, 0x86, 0xD4, 0xC0, 0x6F, 0x64, 0x9F} , // 3
+        {0xED, 0x31, 0xBA, 0x9C, 0x04, 0xB0, 0x67, 0x50, 0x6C, 0x44, 0x97, 0xA3, 0x5B, 0x78, 0x04, 0xFC} , // 4
+        {0x5E, 0x66, 0x99, 0x8A, 0xB4, 0xE8, 0x93, 0x16, 0x06, 0x85, 0x0F, 0xD7, 0xA1, 0x6D, 0xD7, 0x55} , // 5
+    };
+    CiaInfo* cia = &(job->cia);
+    TitleMetaData* tmd = (job->ticktmd) ? (TitleMetaData*) (job->ticktmd + align(cia->size_ticket, 64)) : NULL;
+    TmdContentChunk* content_list = (TmdContentChunk*) (tmd + 1);
+
+    if (job->stage == 0) { // checks, titlekey, pass #1 (CIA decryption)
+        CiaHeader* header = (CiaHeader*) job->src.data;
+        // same as GetCiaInfo()
+        cia->offset_cert = align(header->size_header, 64);
+        cia->offset_ticket = cia->offset_cert + align(header->size_cert, 64);
+        cia->offset_tmd = cia->offset_ticket + align(header->size_ticket, 64);
+        cia->offset_content = cia->offset_tmd + align(header->size_tmd, 64);
+        cia->offset_meta = (header->size_meta) ? cia->offset_content + align(header->size_content, 64) : 0;
+        cia->offset_ticktmd = cia->offset_ticket;
+        cia->size_ticket = header->size_ticket;
+        cia->size_tmd = header->size_tmd;
+        cia->size_content = header->size_content;
+        cia->size_meta = header->size_meta;
+        cia->size_ticktmd = cia->offset_content - cia->offset_ticket;
+        cia->size_cia = (header->size_meta) ? cia->offset_meta + cia->size_meta :
+            cia->offset_content + cia->size_content;
+        if (job->src.size < cia->size_cia) {
+            JobLog(job, "Not a CIA or corrupt file");
+            return (job->result = 1);
+        }
+        if (cia->size_ticktmd > 0x10000) {
+            JobLog(job, "Ticket/TMD too big");
+            return (job->result = 1);
+        }
+        if (!(job->ticktmd = calloc(1, 0x10000)))
+            return (job->result = 1);
+        memcpy(job->ticktmd, job->src.data + cia->offset_ticktmd, cia->size_ticktmd);
+        Ticket* ticket = (Ticket*) job->ticktmd;
+        tmd = (TitleMetaData*) (job->ticktmd + align(cia->size_ticket, 64));
+        content_list = (TmdContentChunk*) (tmd + 1);
+        if (memcmp(ticket->sig_type, sig_type, 4) != 0) {
+            JobLog(job, "Bad ticket signature type");
+            return (job->result = 1);
+        }
+        if (memcmp(tmd->sig_type, sig_type, 4) != 0) {
+            JobLog(job, "Bad TMD signature type");
+            return (job->result = 1);
+        }
+        if (cia->size_ticket != 0x140 + 0x210) {
+            JobLog(job, "Ticket is too small (%u byte)", cia->size_ticket);
+            return (job->result = 1);
+        }
+        if ((ticket->commonkey_idx >= 6) || !has_keyx[0x3D]) {
+            JobLog(job, "%s", (has_keyx[0x3D]) ? "Unknown common key" : "slot0x3DKeyX.bin not found");
+            return (job->result = 1);
+        }
+
+        // decrypt titlekey
+        u8 titlekey[16];
+        u8 iv[16] = { 0 };
+        AesKey key;
+        KeyScramble(titlekey, keyx[0x3D], common_keyy[ticket->commonkey_idx]);
+        AesSetKey(&key, titlekey);
+        memcpy(iv, ticket->title_id, 8);
+        AesCbcDecrypt(&key, iv, titlekey, ticket->titlekey, 16);
+
+        job->content_count = getbe16(tmd->content_count);
+        if (job->content_count * 0x30 != cia->size_tmd - (0x140 + 0xC4 + (64 * 0x24))) {
+            JobLog(job, "TMD content count (%u) / list size mismatch", job->content_count);
+            return (job->result = 1);
+        }
+        u64 size_tmd_content = 0;
+        for (u32 i = 0; i < job->content_count; i++)
+            size_tmd_content += getbe64(content_list[i].size);
+        if (size_tmd_content != cia->size_content) {
+            JobLog(job, "TMD content size / actual size mismatch");
+            return (job->result = 1);
+        }
+
+        job->content_offset = calloc(job->content_count + 1, sizeof(u64));
+        job->hashes = calloc(job->content_count + 1, 32);
+        if (!job->content_offset || !job->hashes)
+            return (job->result = 1);
+        job->untouched = true;
+        job->content_offset[0] = cia->offset_content;
+        for (u32 i = 0; i < job->content_count; i++) {
+            u64 size = getbe64(content_list[i].size);
+            job->content_offset[i+1] = job->content_offset[i] + size;
+            if (!(content_list[i].type[1] & 0x1))
+                continue;
+            job->untouched = false;
+            JobLog(job, "Decrypting Content %u of %u (%lluMB)...", i + 1, job->content_count,
+                (unsigned long long) size / (1024*1024));
+            memset(iv, 0x00, 16);
+            memcpy(iv, content_list[i].index, 2);
+            if ((size % 16) || (job->content_offset[i] % 16)) {
+                JobLog(job, "Decryption failed!");
+                return (job->result = 1);
+            }
+            if (!AddRange(job, job->content_offset[i], size, true, iv, titlekey))
+                return (job->result = 1);
+        }
+        return (StageRanges(job, true) != 0) ? (job->result = 1) : 0;
+    } else if (job->stage == 1) { // verify decrypted contents
+        for (u32 i = 0; i < job->content_count; i++)
+            if (content_list[i].type[1] & 0x1)
+                StageTask(job, TASK_HASH, i, job->content_offset[i], job->content_offset[i+1] - job->content_offset[i]);
+        return 0;
+    } else if (job->stage == 2) { // pass #2 (NCCH decryption), in place on the output
+        for (u32 i = 0; i < job->content_count; i++) {
+            if (!(content_list[i].type[1] & 0x1))
+                continue;
+            if (memcmp(job->hashes[i], content_list[i].hash, 32) != 0) {
+                JobLog(job, "Content %u verification failed!", i + 1);
+                job->result = 1;
+                continue;
+            }
+            content_list[i].type[1] ^= 0x1;
+            job->n_processed++;
+        }
+        if (!cia_deep || (job->result != 0)) {
+            job->stage = 3; // skip pass #2, next is stage 4
+            return 0;
+        }
+        job->in = job->dst.data;
+        job->n_ranges = 0;
+        for (u32 i = 0; i < job->content_count; i++) {
+            u64 size = job->content_offset[i+1] - job->content_offset[i];
+            if (content_list[i].type[1] & 0x1)
+                continue;
+            JobLog(job, "Processing Content %u of %u (%lluMB)...", i + 1, job->content_count,
+                (unsigned long long) size / (1024*1024));
+            if (PlanNcch(job, job->content_offset[i], size, getbe64(((Ticket*) job->ticktmd)->title_id)) == 1)
+                JobLog(job, "Failed decrypting NCCH!");
+        }
+        return (StageRanges(job, false) != 0) ? (job->result = 1) : 0;
+    } else if (job->stage == 3) { // finalize NCCHs, then recalculate their content hashes
+        for (u32 n = 0, i = 0; i < job->content_count; i++) {
+            if (content_list[i].type[1] & 0x1)
+                continue;
+            JobNcch* jn = job->ncch + n++;
+            if ((jn->state == 0) && (FinalizeNcch(job, jn) != 0))
+                JobLog(job, "Failed decrypting NCCH!");
+            if (jn->state == 1) {
+                job->result = 1;
+                continue;
+            }
+            if (jn->state == 0) {
+                job->untouched = false;
+                StageTask(job, TASK_HASH, i, job->content_offset[i], job->content_offset[i+1] - job->content_offset[i]);
+            }
+            job->n_processed++;
+        }
+        return 0;
+    }
+
+    // stage 4: TMD hashes, ticket / TMD
+    if (cia_deep && (job->result == 0)) {
+        for (u32 n = 0, i = 0; i < job->content_count; i++)
+            if (!(content_list[i].type[1] & 0x1) && (job->ncch[n++].state == 0))
+                memcpy(content_list[i].hash, job->hashes[i], 32);
+    }
+    if (job->untouched) {
+        JobLog(job, "CIA is not encrypted");
+    } else if (job->n_processed > 0) {
+        JobLog(job, "Recalculating TMD hashes...");
+        u8* end = job->ticktmd + 0x10000;
+        for (u32 i = 0, kc = 0; i < 64 && kc < job->content_count; i++) {
+            TmdContentInfo* cntinfo = tmd->contentinfo + i;
+            u32 k = getbe16(cntinfo->cmd_count);
+            if ((u8*) (content_list + kc + k) > end)
+                break;
+            Sha256(cntinfo->hash, (u8*) (content_list + kc), k * sizeof(TmdContentChunk));
+            kc += k;
+        }
+        Sha256(tmd->contentinfo_hash, (u8*) tmd->contentinfo, 64 * sizeof(TmdContentInfo));
+        memcpy(job->dst.data + cia->offset_ticktmd, job->ticktmd, cia->size_ticktmd);
+    }
+    return 1;
+}
+
+static u32 StageBoss(Job* job)
+{
+    const u8* boss = job->src.data;
+    u8 content_header[0x14] = { 0x00 };
+    u8 sha256[0x20];
+
+    if (job->stage == 0) {
+        u32 fsize = getbe32(boss + 8);
+        u8 ctr[16] = { 0x00 };
+        if ((fsize != job->src.size) || (fsize < 0x52)) {
+            JobLog(job, "BOSS file has bad size");
+            return (job->result = 1);
+        }
+        memcpy(content_header, boss + 0x28, 0x12);
+        Sha256(sha256, content_header, 0x14);
+        if (memcmp(boss + 0x3A, sha256, 0x20) == 0) {
+            JobLog(job, "BOSS is already decrypted");
+            return (job->result = 1);
+        }
+        if (!has_boss_key) {
+            JobLog(job, "slot0x38Key.bin not found");
+            return (job->result = 1);
+        }
+        JobLog(job, "Decrypting BOSS...");
+        memcpy(ctr, boss + 0x1C, 12);
+        ctr[15] = 0x01;
+        JobLog(job, "CTR: %08X%08X%08X%08X", getbe32(ctr), getbe32(ctr + 4), getbe32(ctr + 8), getbe32(ctr + 12));
+        if (!AddRange(job, 0x28, fsize - 0x28, false, ctr, boss_key))
+            return (job->result = 1);
+        return (StageRanges(job, true) != 0) ? (job->result = 1) : 0;
+    }
+
+    memcpy(content_header, job->dst.data + 0x28, 0x12);
+    Sha256(sha256, content_header, 0x14);
+    job->result = (memcmp(job->dst.data + 0x3A, sha256, 0x20) == 0) ? 0 : 1;
+    JobLog(job, "BOSS verification: %s", (job->result == 0) ? "OK" : "Failed");
+    return 1;
+}
+
+
+static void PushTask(u32 id, const Task* task)
+{
+    TaskDeque* deque = deques + id;
+    pthread_mutex_lock(&(deque->lock));
+    if (deque->tail >= deque->size) {
+        u32 size = (deque->size) ? deque->size * 2 : 256;
+        Task* tasks = realloc(deque->tasks, size * sizeof(Task));
+        if (!tasks) {
+            printf("Out of memory\n");
+            exit(1);
+        }
+        deque->tasks = tasks;
+        deque->size = size;
+    }
+    deque->tasks[deque->tail++] = *task;
+    pthread_mutex_unlock(&(deque->lock));
+}
+
+static bool GetTask(u32 id, Task* task)
+{
+    // own tasks newest first, stolen tasks oldest first
+    for (u32 i = 0; i < n_workers; i++) {
+        TaskDeque* deque = deques + ((id + i) % n_workers);
+        bool found = false;
+        pthread_mutex_lock(&(deque->lock));
+        if (deque->head < deque->tail) {
+            *task = (i == 0) ? deque->tasks[--deque->tail] : deque->tasks[deque->head++];
+            found = true;
+        }
+        if (deque->head == deque->tail)
+            deque->head = deque->tail = 0;
+        pthread_mutex_unlock(&(deque->lock));
+        if (found)
+            return true;
+    }
+    return false;
+}
+
+static void FinishJob(Job* job)
+{
+    // failed jobs leave no output behind
+    MapClose(&(job->dst));
+    MapClose(&(job->src));
+    if ((job->result != 0) && job->created)
+        unlink(job->out_path);
+    JobLog(job, "%s", (job->result == 0) ? "Success!" : "Failed!");
+    free(job->ncch);
+    free(job->ranges);
+    free(job->ticktmd);
+    free(job->content_offset);
+    free(job->hashes);
+    free(job->staged);
+    job->ncch = NULL;
+    job->ranges = NULL;
+    job->ticktmd = NULL;
+    job->content_offset = NULL;
+    job->hashes = NULL;
+    job->staged = NULL;
+    __atomic_sub_fetch(&n_jobs_left, 1, __ATOMIC_RELEASE);
+}
+
+static u32 OpenJob(Job* job)
+{
+    struct stat st_in, st_out;
+    if (MapOpen(&(job->src), job->path, false) != 0)
+        return 1;
+    if ((stat(job->out_path, &st_out) == 0) && (stat(job->path, &st_in) == 0) &&
+        (st_in.st_dev == st_out.st_dev) && (st_in.st_ino == st_out.st_ino)) {
+        JobLog(job, "Output would overwrite the input");
+        return 1;
+    }
+    job->created = true;
+    if (MapCreate(&(job->dst), job->out_path, job->src.size) != 0)
+        return 1;
+    job->in = job->src.data;
+    return 0;
+}
+
+static void AdvanceJob(Job* job, u32 id)
+{
+    // runs stages until one has tasks, the last task of that stage gets back here
+    while (true) {
+        u32 done = 0;
+        job->n_staged = 0;
+        if ((job->stage == 0) && (OpenJob(job) != 0)) {
+            job->result = 1;
+            done = 1;
+        } else if (job->type == FILE_NCCH) {
+            done = StageNcch(job);
+        } else if (job->type == FILE_NCSD) {
+            done = StageNcsd(job);
+        } else if (job->type == FILE_CIA) {
+            done = StageCia(job);
+        } else {
+            done = StageBoss(job);
+        }
+        job->stage++;
+        if (done) {
+            FinishJob(job);
+            return;
+        }
+        if (job->n_staged) {
+            __atomic_store_n(&(job->n_left), job->n_staged, __ATOMIC_RELEASE);
+            for (u32 i = 0; i < job->n_staged; i++)
+                PushTask(id, job->staged + i);
+            return;
+        }
+    }
+}
+
+static void RunTask(const Task* task, u32 id)
+{
+    Job* job = task->job;
+    if (task->type == TASK_STAGE) {
+        AdvanceJob(job, id);
+        return;
+    } else if (task->type == TASK_COPY) {
+        memcpy(job->dst.data + task->offset, job->in + task->offset, task->size);
+    } else if (task->type == TASK_CRYPT) {
+        const CryptRange* range = job->ranges + task->index;
+        u64 pos = task->offset - range->offset;
+        if (range->cbc)
+            AesCbcDecrypt(&(range->key), (pos) ? job->in + task->offset - 16 : range->iv,
+                job->dst.data + task->offset, job->in + task->offset, task->size);
+        else AesCtr(&(range->key), range->iv, pos, job->dst.data + task->offset, job->in + task->offset, task->size);
+    } else if (task->type == TASK_HASH) {
+        Sha256(job->hashes[task->index], job->dst.data + task->offset, task->size);
+    }
+    if (__atomic_sub_fetch(&(job->n_left), 1, __ATOMIC_ACQ_REL) == 0)
+        AdvanceJob(job, id);
+}
+
+static void* Worker(void* arg)
+{
+    u32 id = (u32) (size_t) arg;
+    Task task;
+    while (true) {
+        if (GetTask(id, &task))
+            RunTask(&task, id);
+        else if (__atomic_load_n(&n_jobs_left, __ATOMIC_ACQUIRE) == 0)
+            break;
+        else sched_yield();
+    }
+    return NULL;
+}
+
+
+static u32 GetFileType(const char* path)
+{
+    // same detection as CryptGameFiles(), NAND backups are skipped
+    const u8 boss_magic[] = {0x62, 0x6F, 0x73, 0x73, 0x00, 0x01, 0x00, 0x01};
+    u8 buffer[0x200];
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return (u32) -1;
+    u32 size = fread(buffer, 1, 0x200, fp);
+    fclose(fp);
+    if (size != 0x200)
+        return (u32) -1;
+    if (memcmp(buffer + 0x100, "NCCH", 4) == 0)
+        return FILE_NCCH;
+    if ((memcmp(buffer + 0x100, "NCSD", 4) == 0) && (getle64(buffer + 0x110) == 0))
+        return FILE_NCSD;
+    if (memcmp(buffer, "\x20\x20", 2) == 0)
+        return FILE_CIA;
+    if (memcmp(buffer, boss_magic, 8) == 0)
+        return FILE_BOSS;
+    return (u32) -1;
+}
+
+static u32 RunBatch(char** files, u32 n_files, u32 n_threads, char** log_out)
+{
+    const char* type_str[4] = { "NCCH", "NCSD", "CIA", "BOSS" };
+    pthread_t threads[MAX_THREADS];
+    Job* jobs = calloc(n_files, sizeof(Job));
+    u32 n_jobs = 0;
+    u32 n_processed = 0;
+    u32 n_failed = 0;
+
+    if (!jobs)
+        return 1;
+    for (u32 i = 0; i < n_files; i++) {
+        u32 type = GetFileType(files[i]);
+        if (type == (u32) -1)
+            continue;
+        Job* job = jobs + n_jobs++;
+        char name[1024];
+        *job = (Job) { .path = files[i], .type = type };
+        job->src = job->dst = (MapFile) { .fd = -1 };
+        snprintf(name, sizeof(name), "%s", files[i]);
+        snprintf(job->out_path, sizeof(job->out_path), "%s/%s", out_dir, basename(name));
+        JobLog(job, "Processing %s \"%s\"", type_str[type], basename(name));
+    }
+
+    // jobs start round robin, their chunks are stolen by idle workers
+    // (also the tasks of workers that failed to start)
+    n_workers = n_threads;
+    n_jobs_left = n_jobs;
+    for (u32 i = 0; i < n_threads; i++)
+        deques[i] = (TaskDeque) { .lock = PTHREAD_MUTEX_INITIALIZER };
+    for (u32 i = 0; i < n_jobs; i++)
+        PushTask(i % n_threads, &(Task) { .job = jobs + i, .type = TASK_STAGE });
+    u32 n_started = 1;
+    for (; n_started < n_threads; n_started++)
+        if (pthread_create(threads + n_started, NULL, Worker, (void*) (size_t) n_started) != 0)
+            break;
+    Worker((void*) 0);
+    for (u32 i = 1; i < n_started; i++)
+        pthread_join(threads[i], NULL);
+    for (u32 i = 0; i < n_threads; i++)
+        free(deques[i].tasks);
+
+    // logs in input order
+    size_t log_size = 0;
+    *log_out = NULL;
+    for (u32 i = 0; i <= n_jobs; i++) {
+        char summary[64];
+        const char* text = summary;
+        if (i < n_jobs) {
+            Job* job = jobs + i;
+            text = (job->log) ? job->log : "";
+            if (job->result == 0) n_processed++;
+            else n_failed++;
+        } else if (n_processed || n_failed) {
+            snprintf(summary, sizeof(summary), "%ux processed / %ux failed\n", n_processed, n_failed);
+        } else {
+            snprintf(summary, sizeof(summary), "Nothing found!\n");
+        }
+        size_t len = strlen(text);
+        char* log = realloc(*log_out, log_size + len + 2);
+        if (log) {
+            memcpy(log + log_size, text, len);
+            log_size += len;
+            if (i < n_jobs)
+                log[log_size++] = '\n';
+            log[log_size] = '\0';
+            *log_out = log;
+        }
+        if (i < n_jobs)
+            free(jobs[i].log);
+    }
+    free(jobs);
+
+    return (n_processed && !n_failed) ? 0 : 1;
+}
+
+static u64 GetInputSize(char** files, u32 n_files)
+{
+    u64 size = 0;
+    struct stat st;
+    for (u32 i = 0; i < n_files; i++)
+        if ((GetFileType(files[i]) != (u32) -1) && (stat(files[i], &st) == 0))
+            size += st.st_size;
+    return size;
+}
+
+static u32 HashOutputs(u8* hashes, char** files, u32 n_files)
+{
+    // output fingerprints for the benchmark, every thread count has to give the same results
+    for (u32 i = 0; i < n_files; i++) {
+        char name[1024];
+        char path[1024];
+        MapFile map;
+        snprintf(name, sizeof(name), "%s", files[i]);
+        snprintf(path, sizeof(path), "%s/%s", out_dir, basename(name));
+        memset(hashes + (i*32), 0x00, 32);
+        if (access(path, F_OK) != 0)
+            continue;
+        if (MapOpen(&map, path, false) != 0) {
+            MapClose(&map);
+            return 1;
+        }
+        Sha256(hashes + (i*32), map.data, map.size);
+        MapClose(&map);
+    }
+    return 0;
+}
+
+static u32 Benchmark(char** files, u32 n_files, u32 n_threads)
+{
+    // same batch at 1, 2, 4, ... n_threads, logs and outputs have to match the single thread run
+    u8* hashes_ref = malloc(n_files * 32);
+    u8* hashes = malloc(n_files * 32);
+    char* log_ref = NULL;
+    double time_ref = 0;
+    u64 size = GetInputSize(files, n_files);
+    u32 result = 0;
+
+    if (!hashes_ref || !hashes)
+        return 1;
+    printf("Input: %llu MB in %u file(s)\n", (unsigned long long) size / (1024*1024), n_files);
+    printf("threads      time      MB/s   speedup\n");
+    for (u32 t = 1; t <= n_threads; t = (t < n_threads && t * 2 > n_threads) ? n_threads : t * 2) {
+        struct timespec t0, t1;
+        char* log;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        u32 res = RunBatch(files, n_files, t, &log);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double time = (t1.tv_sec - t0.tv_sec) + ((t1.tv_nsec - t0.tv_nsec) / 1e9);
+        if (t == 1) time_ref = time;
+        printf("%7u %8.3fs %9.1f %8.2fx\n", t, time, (size / (1024.0*1024.0)) / time, time_ref / time);
+        if (HashOutputs((t == 1) ? hashes_ref : hashes, files, n_files) != 0)
+            result = 1;
+        if (t == 1) {
+            log_ref = log;
+            result |= res;
+            continue;
+        }
+        if ((strcmp(log, log_ref) != 0) || (memcmp(hashes, hashes_ref, n_files * 32) != 0)) {
+            printf("Results differ from the single thread run!\n");
+            result = 1;
+        }
+        free(log);
+        if (t == n_threads)
+            break;
+    }
+    if (log_ref)
+        printf("\n%s", log_ref);
+    free(log_ref);
+    free(hashes_ref);
+    free(hashes);
+    return result;
+}
+
+
+static int CompareNames(const void* a, const void* b)
+{
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+static u32 AddInput(char** files, u32* n_files, const char* path)
+{
+    // files are taken as is, folders contribute their files (not recursive) in sorted order
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        printf("Can't open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        if (*n_files >= MAX_FILES)
+            return 1;
+        files[(*n_files)++] = strdup(path);
+        return 0;
+    }
+    DIR* dir = opendir(path);
+    if (!dir)
+        return 1;
+    u32 first = *n_files;
+    for (struct dirent* entry = readdir(dir); entry; entry = readdir(dir)) {
+        char file[1024];
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        if ((entry->d_name[0] == '.') || (stat(file, &st) != 0) || !S_ISREG(st.st_mode))
+            continue;
+        if (*n_files >= MAX_FILES)
+            break;
+        files[(*n_files)++] = strdup(file);
+    }
+    closedir(dir);
+    qsort(files + first, *n_files - first, sizeof(char*), CompareNames);
+    return 0;
+}
+
+static void Usage(void)
+{
+    printf("usage: batch_decrypt [-k keydir] [-j threads] [-d] [-b] -o outdir files/folders..\n");
+    printf("  keydir:  folder containing the slot0x??Key?.bin files and seeddb.bin (default: current folder)\n");
+    printf("  outdir:  output folder, required (CIA decryption needs the original data)\n");
+    printf("  threads: number of worker threads (default: all cores)\n");
+    printf("  -d:      deep CIA decryption, also decrypts the NCCHs inside CIAs\n");
+    printf("  -b:      benchmark with 1, 2, 4... threads, checks that all results are the same\n");
+    printf("  Example: batch_decrypt -k keys -o decrypted -d D9Game\n");
+}
+
+int main(int argc, char** argv)
+{
+    long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 n_threads = (n_cores > 0) ? (u32) n_cores : 1;
+    bool benchmark = false;
+    char** files = calloc(MAX_FILES, sizeof(char*));
+    u32 n_files = 0;
+    u32 result = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:o:j:db")) != -1) {
+        if (opt == 'k') {
+            key_dir = optarg;
+        } else if (opt == 'o') {
+            out_dir = optarg;
+        } else if (opt == 'j') {
+            n_threads = atoi(optarg);
+        } else if (opt == 'd') {
+            cia_deep = true;
+        } else if (opt == 'b') {
+            benchmark = true;
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    n_threads = min(max(n_threads, 1u), (u32) MAX_THREADS);
+    if (!out_dir || (optind >= argc) || !files) {
+        Usage();
+        return 1;
+    }
+    if ((mkdir(out_dir, 0755) != 0) && (errno != EEXIST)) {
+        printf("Can't create %s\n", out_dir);
+        return 1;
+    }
+    for (int i = optind; i < argc; i++)
+        if (AddInput(files, &n_files, argv[i]) != 0)
+            result = 1;
+    LoadKeys();
+
+    if (benchmark) {
+        result |= Benchmark(files, n_files, n_threads);
+    } else {
+        char* log;
+        result |= RunBatch(files, n_files, n_threads, &log);
+        if (log)
+            printf("%s", log);
+        free(log);
+    }
+
+    for (u32 i = 0; i < n_files; i++)
+        free(files[i]);
+    free(files);
+    free(seeddb);
+    printf((result == 0) ? "Done!\n" : "Done, with errors!\n");
+    return (result == 0) ? 0 : 1;
+}
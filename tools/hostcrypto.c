@@ -0,0 +1,266 @@
+// crypto for the host tools, see hostcrypto.h
+// AES uses 32 bit T-tables (built at startup), SHA-256 is the plain reference algorithm
+#include "hostcrypto.h"
+
+#define ror32(x,n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const u8 sbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+static u8 inv_sbox[256];
+static u32 te[256]; // SubBytes + MixColumns for one column, the other three are rotations
+static u32 td[256]; // InvSubBytes + InvMixColumns, same
+
+static u8 GfMul(u8 a, u8 b)
+{
+    u8 r = 0;
+    for (; b; b >>= 1, a = (u8) ((a << 1) ^ ((a & 0x80) ? 0x1B : 0x00)))
+        if (b & 1) r ^= a;
+    return r;
+}
+
+__attribute__((constructor)) static void AesInitTables(void)
+{
+    for (u32 i = 0; i < 256; i++) {
+        u8 s = sbox[i];
+        inv_sbox[s] = (u8) i;
+        te[i] = ((u32) GfMul(s, 2) << 24) | ((u32) s << 16) | ((u32) s << 8) | GfMul(s, 3);
+    }
+    for (u32 i = 0; i < 256; i++) {
+        u8 s = inv_sbox[i];
+        td[i] = ((u32) GfMul(s, 14) << 24) | ((u32) GfMul(s, 9) << 16) | ((u32) GfMul(s, 13) << 8) | GfMul(s, 11);
+    }
+}
+
+static u32 SubWord(u32 w)
+{
+    return ((u32) sbox[w >> 24] << 24) | ((u32) sbox[(w >> 16) & 0xFF] << 16) |
+        ((u32) sbox[(w >> 8) & 0xFF] << 8) | sbox[w & 0xFF];
+}
+
+void AesSetKey(AesKey* key, const u8* normal)
+{
+    u32* ek = key->enc;
+    u32* dk = key->dec;
+    u8 rcon = 0x01;
+    for (u32 i = 0; i < 4; i++)
+        ek[i] = getbe32(normal + (i*4));
+    for (u32 i = 4; i < 44; i++) {
+        u32 t = ek[i-1];
+        if (i % 4 == 0) {
+            t = SubWord((t << 8) | (t >> 24)) ^ ((u32) rcon << 24);
+            rcon = GfMul(rcon, 2);
+        }
+        ek[i] = ek[i-4] ^ t;
+    }
+    // equivalent inverse cipher: reversed round keys, InvMixColumns on the inner ones
+    for (u32 r = 0; r <= 10; r++) {
+        for (u32 j = 0; j < 4; j++) {
+            u32 w = ek[((10 - r) * 4) + j];
+            if ((r > 0) && (r < 10))
+                w = td[sbox[w >> 24]] ^ ror32(td[sbox[(w >> 16) & 0xFF]], 8) ^
+                    ror32(td[sbox[(w >> 8) & 0xFF]], 16) ^ ror32(td[sbox[w & 0xFF]], 24);
+            dk[(r * 4) + j] = w;
+        }
+    }
+}
+
+static void PutBe32(u8* out, u32 w)
+{
+    out[0] = (u8) (w >> 24);
+    out[1] = (u8) (w >> 16);
+    out[2] = (u8) (w >> 8);
+    out[3] = (u8) w;
+}
+
+void AesEncryptBlock(const AesKey* key, u8* out, const u8* in)
+{
+    const u32* rk = key->enc;
+    u32 s[4], t[4];
+    for (u32 j = 0; j < 4; j++)
+        s[j] = getbe32(in + (j*4)) ^ rk[j];
+    for (u32 r = 1; r < 10; r++) {
+        rk += 4;
+        for (u32 j = 0; j < 4; j++)
+            t[j] = te[s[j] >> 24] ^ ror32(te[(s[(j+1)%4] >> 16) & 0xFF], 8) ^
+                ror32(te[(s[(j+2)%4] >> 8) & 0xFF], 16) ^ ror32(te[s[(j+3)%4] & 0xFF], 24) ^ rk[j];
+        memcpy(s, t, 16);
+    }
+    rk += 4;
+    for (u32 j = 0; j < 4; j++)
+        PutBe32(out + (j*4), (((u32) sbox[s[j] >> 24] << 24) | ((u32) sbox[(s[(j+1)%4] >> 16) & 0xFF] << 16) |
+            ((u32) sbox[(s[(j+2)%4] >> 8) & 0xFF] << 8) | sbox[s[(j+3)%4] & 0xFF]) ^ rk[j]);
+}
+
+void AesDecryptBlock(const AesKey* key, u8* out, const u8* in)
+{
+    const u32* rk = key->dec;
+    u32 s[4], t[4];
+    for (u32 j = 0; j < 4; j++)
+        s[j] = getbe32(in + (j*4)) ^ rk[j];
+    for (u32 r = 1; r < 10; r++) {
+        rk += 4;
+        for (u32 j = 0; j < 4; j++)
+            t[j] = td[s[j] >> 24] ^ ror32(td[(s[(j+3)%4] >> 16) & 0xFF], 8) ^
+                ror32(td[(s[(j+2)%4] >> 8) & 0xFF], 16) ^ ror32(td[s[(j+1)%4] & 0xFF], 24) ^ rk[j];
+        memcpy(s, t, 16);
+    }
+    rk += 4;
+    for (u32 j = 0; j < 4; j++)
+        PutBe32(out + (j*4), (((u32) inv_sbox[s[j] >> 24] << 24) | ((u32) inv_sbox[(s[(j+3)%4] >> 16) & 0xFF] << 16) |
+            ((u32) inv_sbox[(s[(j+2)%4] >> 8) & 0xFF] << 8) | inv_sbox[s[(j+1)%4] & 0xFF]) ^ rk[j]);
+}
+
+void AddCtr(u8* ctr, u64 n)
+{
+    for (int i = 15; (i >= 0) && n; i--) {
+        n += ctr[i];
+        ctr[i] = (u8) n;
+        n >>= 8;
+    }
+}
+
+void AesCtr(const AesKey* key, const u8* ctr, u64 pos, u8* dst, const u8* src, u64 size)
+{
+    u8 c[16];
+    u8 pad[16];
+    u32 skip = pos % 16;
+    memcpy(c, ctr, 16);
+    AddCtr(c, pos / 16);
+    while (size) {
+        u32 n = min(16 - skip, size);
+        AesEncryptBlock(key, pad, c);
+        AddCtr(c, 1);
+        if (n == 16) {
+            u64 a[2], b[2];
+            memcpy(a, src, 16);
+            memcpy(b, pad, 16);
+            a[0] ^= b[0];
+            a[1] ^= b[1];
+            memcpy(dst, a, 16);
+        } else for (u32 i = 0; i < n; i++) {
+            dst[i] = src[i] ^ pad[skip + i];
+        }
+        dst += n;
+        src += n;
+        size -= n;
+        skip = 0;
+    }
+}
+
+void AesCbcDecrypt(const AesKey* key, const u8* iv, u8* dst, const u8* src, u64 size)
+{
+    u8 prev[16];
+    u8 block[16];
+    u8 plain[16];
+    memcpy(prev, iv, 16);
+    for (u64 i = 0; i + 16 <= size; i += 16) {
+        memcpy(block, src + i, 16);
+        AesDecryptBlock(key, plain, block);
+        for (u32 j = 0; j < 16; j++)
+            dst[i + j] = plain[j] ^ prev[j];
+        memcpy(prev, block, 16);
+    }
+}
+
+static void Rol128(u8* v, u32 n)
+{
+    // rotates a big endian 128 bit number left by n bits
+    u8 t[16];
+    u32 bytes = (n / 8) % 16;
+    u32 bits = n % 8;
+    for (u32 i = 0; i < 16; i++)
+        t[i] = v[(i + bytes) % 16];
+    for (u32 i = 0; i < 16; i++)
+        v[i] = (u8) ((t[i] << bits) | ((bits) ? (t[(i + 1) % 16] >> (8 - bits)) : 0));
+}
+
+void KeyScramble(u8* normal, const u8* keyx, const u8* keyy)
+{
+    // ((X rol 2) ^ Y) + C rol 87, see: https://www.3dbrew.org/wiki/AES_Registers#Keyslots
+    static const u8 c[16] = {
+        0x1F, 0xF9, 0xE9, 0xAA, 0xC5, 0xFE, 0x04, 0x08, 0x02, 0x45, 0x91, 0xDC, 0x5D, 0x52, 0x76, 0x8A
+    };
+    u32 carry = 0;
+    memcpy(normal, keyx, 16);
+    Rol128(normal, 2);
+    for (int i = 15; i >= 0; i--) {
+        carry += (normal[i] ^ keyy[i]) + c[i];
+        normal[i] = (u8) carry;
+        carry >>= 8;
+    }
+    Rol128(normal, 87);
+}
+
+
+static const u32 sha256_k[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static void Sha256Block(u32* state, const u8* block)
+{
+    u32 w[64];
+    u32 s[8];
+    for (u32 i = 0; i < 16; i++)
+        w[i] = getbe32(block + (i*4));
+    for (u32 i = 16; i < 64; i++) {
+        u32 s0 = ror32(w[i-15], 7) ^ ror32(w[i-15], 18) ^ (w[i-15] >> 3);
+        u32 s1 = ror32(w[i-2], 17) ^ ror32(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    memcpy(s, state, 32);
+    for (u32 i = 0; i < 64; i++) {
+        u32 t1 = s[7] + (ror32(s[4], 6) ^ ror32(s[4], 11) ^ ror32(s[4], 25)) +
+            ((s[4] & s[5]) ^ (~s[4] & s[6])) + sha256_k[i] + w[i];
+        u32 t2 = (ror32(s[0], 2) ^ ror32(s[0], 13) ^ ror32(s[0], 22)) +
+            ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+        memmove(s + 1, s, 7 * 4);
+        s[4] += t1;
+        s[0] = t1 + t2;
+    }
+    for (u32 i = 0; i < 8; i++)
+        state[i] += s[i];
+}
+
+void Sha256(u8* hash, const u8* data, u64 size)
+{
+    u32 state[8] = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+    u8 last[128] = { 0 };
+    u64 n_full = size / 64;
+    u32 n_rest = size % 64;
+    for (u64 i = 0; i < n_full; i++)
+        Sha256Block(state, data + (i*64));
+    memcpy(last, data + (n_full*64), n_rest);
+    last[n_rest] = 0x80;
+    u32 n_last = (n_rest < 56) ? 64 : 128;
+    for (u32 i = 0; i < 8; i++)
+        last[n_last - 1 - i] = (u8) ((size * 8) >> (i*8));
+    for (u32 i = 0; i < n_last; i += 64)
+        Sha256Block(state, last + i);
+    for (u32 i = 0; i < 8; i++)
+        PutBe32(hash + (i*4), state[i]);
+}
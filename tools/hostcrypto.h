@@ -0,0 +1,24 @@
+// crypto for the host tools: AES-128 (CTR / CBC), the 3DS keyscrambler and SHA-256
+// all functions are thread safe, keys are expanded once per AesKey
+#pragma once
+
+#include "common.h"
+
+typedef struct {
+    u32 enc[44];
+    u32 dec[44];
+} AesKey;
+
+void AesSetKey(AesKey* key, const u8* normal);
+void AesEncryptBlock(const AesKey* key, u8* out, const u8* in);
+void AesDecryptBlock(const AesKey* key, u8* out, const u8* in);
+// CTR mode, pos is the byte position inside the stream that starts at ctr
+void AesCtr(const AesKey* key, const u8* ctr, u64 pos, u8* dst, const u8* src, u64 size);
+// CBC decryption, size is a multiple of 16, dst may be src
+void AesCbcDecrypt(const AesKey* key, const u8* iv, u8* dst, const u8* src, u64 size);
+// adds n to a big endian 128 bit counter
+void AddCtr(u8* ctr, u64 n);
+// normal key from keyX / keyY, same as the hardware does for keyslots 0x04...0x3F
+void KeyScramble(u8* normal, const u8* keyx, const u8* keyy);
+
+void Sha256(u8* hash, const u8* data, u64 size);
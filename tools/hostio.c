@@ -0,0 +1,170 @@
+// memory mapped files, input lists and a thread pool for the host tools, see hostio.h
+#define _FILE_OFFSET_BITS 64
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hostio.h"
+
+u32 MapOpen(MapFile* map, const char* path, bool writable)
+{
+    struct stat st;
+    *map = (MapFile) { .fd = -1 };
+    map->fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if ((map->fd < 0) || (fstat(map->fd, &st) != 0)) {
+        printf("  Can't open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    map->size = st.st_size;
+    if (!map->size)
+        return 0;
+    map->data = mmap(NULL, map->size, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, map->fd, 0);
+    if (map->data == MAP_FAILED) {
+        printf("  Can't map %s: %s\n", path, strerror(errno));
+        map->data = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+u32 MapCreate(MapFile* map, const char* path, u64 size)
+{
+    *map = (MapFile) { .fd = -1 };
+    map->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ((map->fd < 0) || (ftruncate(map->fd, size) != 0)) {
+        printf("  Can't create %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    map->size = size;
+    if (!map->size)
+        return 0;
+    map->data = mmap(NULL, map->size, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd, 0);
+    if (map->data == MAP_FAILED) {
+        printf("  Can't map %s: %s\n", path, strerror(errno));
+        map->data = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+void MapClose(MapFile* map)
+{
+    if (map->data)
+        munmap(map->data, map->size);
+    if (map->fd >= 0)
+        close(map->fd);
+    *map = (MapFile) { .fd = -1 };
+}
+
+u32 MakePath(const char* path)
+{
+    char dir[1024];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char* slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        if ((mkdir(dir, 0755) != 0) && (errno != EEXIST))
+            return 1;
+        *slash = '/';
+    }
+    return 0;
+}
+
+
+static FileList* walk_list = NULL;
+static size_t walk_root_len = 0;
+
+u32 FileListAppend(FileList* list, const char* path)
+{
+    if (list->n_paths >= list->max_paths) {
+        u32 max_paths = (list->max_paths) ? 2 * list->max_paths : 256;
+        char** paths = realloc(list->paths, max_paths * sizeof(char*));
+        if (!paths)
+            return 1;
+        list->paths = paths;
+        list->max_paths = max_paths;
+    }
+    if (!(list->paths[list->n_paths] = strdup(path)))
+        return 1;
+    list->n_paths++;
+    return 0;
+}
+
+static int FileListWalk(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+    (void) (st);
+    (void) (ftw);
+    if ((type != FTW_F) || strstr(path + walk_root_len, "/.")) // hidden files and folders
+        return 0;
+    return (FileListAppend(walk_list, path) == 0) ? 0 : 1;
+}
+
+static int CompareNames(const void* a, const void* b)
+{
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+u32 FileListAdd(FileList* list, const char* path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        printf("Can't open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (!S_ISDIR(st.st_mode))
+        return FileListAppend(list, path);
+    u32 first = list->n_paths;
+    walk_list = list;
+    walk_root_len = strlen(path);
+    if (nftw(path, FileListWalk, 16, FTW_PHYS) != 0) {
+        printf("Can't read %s\n", path);
+        return 1;
+    }
+    qsort(list->paths + first, list->n_paths - first, sizeof(char*), CompareNames);
+    return 0;
+}
+
+void FileListFree(FileList* list)
+{
+    for (u32 i = 0; i < list->n_paths; i++)
+        free(list->paths[i]);
+    free(list->paths);
+    *list = (FileList) { 0 };
+}
+
+
+typedef struct {
+    void (*fn)(u32 index, void* arg);
+    void* arg;
+    u32 n;
+    u32 next;
+} ParallelJob;
+
+static void* ParallelWorker(void* data)
+{
+    ParallelJob* job = data;
+    for (u32 i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED); i < job->n;
+        i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED))
+        job->fn(i, job->arg);
+    return NULL;
+}
+
+void ParallelFor(u32 n, u32 n_threads, void (*fn)(u32 index, void* arg), void* arg)
+{
+    pthread_t threads[64];
+    ParallelJob job = { .fn = fn, .arg = arg, .n = n, .next = 0 };
+    u32 n_started = 0;
+    n_threads = min(max(n_threads, 1u), min(n, 64u));
+    for (; n_started + 1 < n_threads; n_started++)
+        if (pthread_create(threads + n_started, NULL, ParallelWorker, &job) != 0)
+            break;
+    ParallelWorker(&job);
+    for (u32 i = 0; i < n_started; i++)
+        pthread_join(threads[i], NULL);
+}
@@ -0,0 +1,32 @@
+// memory mapped files, input lists and a thread pool for the host tools
+#pragma once
+
+#include "common.h"
+
+typedef struct {
+    int fd;
+    u8* data;
+    u64 size;
+} MapFile;
+
+// errors are printed, the map can always be passed to MapClose()
+u32 MapOpen(MapFile* map, const char* path, bool writable);
+u32 MapCreate(MapFile* map, const char* path, u64 size);
+void MapClose(MapFile* map);
+// creates all parent folders of path
+u32 MakePath(const char* path);
+
+typedef struct {
+    char** paths;
+    u32 n_paths;
+    u32 max_paths;
+} FileList;
+
+// files are taken as is, folders add all files below them (sorted, hidden ones skipped)
+u32 FileListAdd(FileList* list, const char* path);
+// adds path as is, without checking it
+u32 FileListAppend(FileList* list, const char* path);
+void FileListFree(FileList* list);
+
+// runs fn(0) ... fn(n - 1) on up to n_threads threads (the caller is one of them), in no particular order
+void ParallelFor(u32 n, u32 n_threads, void (*fn)(u32 index, void* arg), void* arg);
@@ -0,0 +1,258 @@
+// ncchinfo_gen: generates ncchinfo.bin for NCCH Padgen on PC, replaces ncchinfo_gen.py
+// (and ncchinfo_gen_exh.py with -e, ExHeader pads only)
+//
+// Entries, flags and pad names are the same as from the scripts (and NcchInfoGen() on
+// the 3DS), the output is byte identical. Only the NCSD / NCCH headers are read, files
+// are processed on all cores. Folders are scanned recursively, in sorted order. NCSD
+// partitions without a NCCH header are skipped (the scripts took them as is).
+
+#define _FILE_OFFSET_BITS 64
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "decryptor/game.h"
+#include "decryptor/xorpad.h"
+#include "hostio.h"
+
+// results for one input file, merged in input order
+typedef struct {
+    NcchInfoEntry* entries;
+    u32 n_entries;
+    char* log;
+    size_t log_size;
+    bool failed;
+} NcchInfoFile;
+
+static const char* ncsd_partitions[8] = NCSD_PARTITION_NAMES;
+
+static FileList inputs;
+static NcchInfoFile* results = NULL;
+static bool exheader_only = false;
+
+
+static void FileLog(NcchInfoFile* file, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    char* log = realloc(file->log, file->log_size + len + 1);
+    if (!log)
+        return;
+    va_start(args, format);
+    vsnprintf(log + file->log_size, len + 1, format, args);
+    va_end(args);
+    file->log = log;
+    file->log_size += len;
+}
+
+static void GetNcchInfoCtr(u8* ctr, const NcchHeader* ncch, u32 sub_id)
+{
+    // same as ncchinfo_gen.py: format version 0 / 2 and 1 are known, anything else gets a zero counter
+    u32 version = ncch->version & 0xFF;
+    memset(ctr, 0x00, 16);
+    if ((version == 0) || (version == 2)) {
+        for (u32 i = 0; i < 8; i++)
+            ctr[i] = ((const u8*) &(ncch->partitionId))[7-i];
+        ctr[8] = sub_id;
+    } else if (version == 1) {
+        u32 offset = (sub_id == 1) ? 0x200 : (sub_id == 2) ? ncch->offset_exefs * 0x200 :
+            (sub_id == 3) ? ncch->offset_romfs * 0x200 : 0;
+        memcpy(ctr, &(ncch->partitionId), 8);
+        for (u32 i = 0; i < 4; i++)
+            ctr[12+i] = (offset >> ((3-i)*8)) & 0xFF;
+    }
+}
+
+static u32 NcchInfoAdd(NcchInfoFile* file, const NcchHeader* ncch, u64 titleId, const char* partition)
+{
+    // same section and flag handling as NcchInfoAdd() in xorpad.c
+    const char* section_name[4] = { "exheader", "exefs_norm", "exefs_7x", "romfs" };
+    const u32 section_ctr[4] = { 1, 2, 2, 3 };
+    u32 section_size[4] = {
+        (ncch->size_exthdr) ? 0x800 : 0,
+        ncch->size_exefs * 0x200,
+        ncch->size_exefs * 0x200,
+        ncch->size_romfs * 0x200
+    };
+    u32 ncchFlag3 = ncch->flags[3];
+    u32 ncchFlag7 = ncch->flags[7];
+
+    // unknown flags mean standard crypto
+    if ((ncchFlag7 != 0x01) && (ncchFlag7 != 0x20))
+        ncchFlag7 = 0;
+    if (!ncchFlag3 && (ncchFlag7 != 0x20))
+        section_size[2] = 0; // no 7x / seed ExeFS pad needed
+    if (exheader_only)
+        section_size[1] = section_size[2] = section_size[3] = 0;
+
+    u32 n_new = 0;
+    for (u32 s = 0; s < 4; s++)
+        n_new += (section_size[s]) ? 1 : 0;
+    NcchInfoEntry* entries = realloc(file->entries, (file->n_entries + n_new + 1) * sizeof(NcchInfoEntry));
+    if (!entries)
+        return 1;
+    file->entries = entries;
+
+    FileLog(file, "  %s: %.16s (%016llX), %u entries\n", partition, ncch->productcode,
+        (unsigned long long) ncch->partitionId, n_new);
+    for (u32 s = 0; s < 4; s++) {
+        if (!section_size[s])
+            continue;
+        NcchInfoEntry* entry = file->entries + file->n_entries;
+        memset(entry, 0x00, sizeof(NcchInfoEntry));
+        GetNcchInfoCtr(entry->ctr, ncch, section_ctr[s]);
+        memcpy(entry->keyY, ncch->signature, 16);
+        entry->size_mb = max((section_size[s] + (1024 * 1024) - 1) / (1024 * 1024), 1u);
+        entry->size_b = section_size[s];
+        // exheader and standard ExeFS pads only ever use the fixed key flag
+        entry->ncchFlag7 = (s >= 2) ? ncchFlag7 : (ncchFlag7 == 0x01) ? 0x01 : 0;
+        entry->ncchFlag3 = (s >= 2) ? ncchFlag3 : 0;
+        entry->titleId = ncch->programId;
+        snprintf(entry->filename, 112, "/%016llX.%s.%s.xorpad", (unsigned long long) titleId, partition, section_name[s]);
+        file->n_entries++;
+    }
+
+    return 0;
+}
+
+static u32 ReadHeader(int fd, void* header, u64 offset)
+{
+    // short headers are zero padded (the scripts do the same), returns the bytes read
+    memset(header, 0x00, 0x200);
+    ssize_t size = pread(fd, header, 0x200, offset);
+    return (size > 0) ? (u32) size : 0;
+}
+
+static void ParseFile(u32 index, void* arg)
+{
+    (void) (arg);
+    const char* path = inputs.paths[index];
+    NcchInfoFile* file = results + index;
+    u8 header[0x200] __attribute__((aligned(16)));
+    NcchHeader* ncch = (NcchHeader*) header;
+    NcsdHeader* ncsd = (NcsdHeader*) header;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        FileLog(file, "Can't open %s: %s\n", path, strerror(errno));
+        file->failed = true;
+        return;
+    }
+    if (ReadHeader(fd, header, 0) < 0x104) {
+        // too small for a NCCH / NCSD, ignored
+    } else if (memcmp(ncch->magic, "NCCH", 4) == 0) {
+        FileLog(file, "NCCH \"%s\":\n", path);
+        file->failed = (NcchInfoAdd(file, ncch, ncch->partitionId, ncsd_partitions[0]) != 0);
+    } else if (memcmp(ncsd->magic, "NCSD", 4) == 0) {
+        u64 mediaId = ncsd->mediaId;
+        NcchPartition partitions[8];
+        memcpy(partitions, ncsd->partitions, sizeof(partitions));
+        FileLog(file, "NCSD \"%s\":\n", path);
+        for (u32 p = 0; (p < 8) && !file->failed; p++) {
+            if (!partitions[p].offset)
+                continue;
+            if (!ReadHeader(fd, header, (u64) partitions[p].offset * 0x200) || (memcmp(ncch->magic, "NCCH", 4) != 0)) {
+                FileLog(file, "  %s: not a NCCH, skipped\n", ncsd_partitions[p]);
+                continue;
+            }
+            file->failed = (NcchInfoAdd(file, ncch, mediaId, ncsd_partitions[p]) != 0);
+        }
+    }
+    close(fd);
+}
+
+static u32 WriteNcchInfo(const char* path, u32 n_entries)
+{
+    NcchInfo header = { .padding = 0xFFFFFFFF, .ncch_info_version = 0xF0000004, .n_entries = n_entries };
+    FILE* fp = fopen(path, "wb");
+    bool ok = fp && (fwrite(&header, 1, 16, fp) == 16);
+    for (u32 i = 0; (i < inputs.n_paths) && ok; i++)
+        ok = (fwrite(results[i].entries, sizeof(NcchInfoEntry), results[i].n_entries, fp) == results[i].n_entries);
+    if (fp && (fclose(fp) != 0))
+        ok = false;
+    if (!ok)
+        printf("Can't write %s\n", path);
+    return ok ? 0 : 1;
+}
+
+
+static void Usage(void)
+{
+    printf("usage: ncchinfo_gen [-e] [-o ncchinfo.bin] [-j threads] files/folders..\n");
+    printf("  -e:      ExHeader pads only (same as ncchinfo_gen_exh.py)\n");
+    printf("  -o:      output file (default: ncchinfo.bin in the current folder)\n");
+    printf("  threads: number of worker threads (default: all cores)\n");
+    printf("  Supports CCI (.3ds) and NCCH (.cxi / .cfa / ...) files, folders are scanned recursively\n");
+    printf("  Example: ncchinfo_gen -o /media/sd/files9/ncchinfo.bin *.3ds games/\n");
+}
+
+int main(int argc, char** argv)
+{
+    long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 n_threads = (n_cores > 0) ? (u32) n_cores : 1;
+    const char* out_path = "ncchinfo.bin";
+    u32 n_entries = 0;
+    u32 result = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "eo:j:")) != -1) {
+        if (opt == 'e') {
+            exheader_only = true;
+        } else if (opt == 'o') {
+            out_path = optarg;
+        } else if (opt == 'j') {
+            n_threads = atoi(optarg);
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        Usage();
+        return 1;
+    }
+    for (int i = optind; i < argc; i++)
+        if (FileListAdd(&inputs, argv[i]) != 0)
+            result = 1;
+    if (!inputs.n_paths || !(results = calloc(inputs.n_paths, sizeof(NcchInfoFile)))) {
+        printf("Input files don't exist\n");
+        FileListFree(&inputs);
+        return 1;
+    }
+
+    ParallelFor(inputs.n_paths, n_threads, ParseFile, NULL);
+    for (u32 i = 0; i < inputs.n_paths; i++) {
+        if (results[i].log)
+            printf("%s", results[i].log);
+        if (results[i].failed)
+            result = 1;
+        n_entries += results[i].n_entries;
+    }
+
+    if (!n_entries) {
+        printf("No NCCH / NCSD files found\n");
+        result = 1;
+    } else {
+        if (n_entries > MAX_ENTRIES)
+            printf("Warning: %u entries, NCCH Padgen only takes up to %u\n", n_entries, MAX_ENTRIES);
+        if (WriteNcchInfo(out_path, n_entries) == 0)
+            printf("%s: %u entries\n", out_path, n_entries);
+        else
+            result = 1;
+    }
+
+    for (u32 i = 0; i < inputs.n_paths; i++) {
+        free(results[i].entries);
+        free(results[i].log);
+    }
+    free(results);
+    FileListFree(&inputs);
+    printf((result == 0) ? "Done!\n" : "Done, with errors!\n");
+    return (result == 0) ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+// sdinfo_gen: generates SDinfo.bin for SD Padgen on PC, replaces sdinfo_gen.py
+//
+// Takes the folder on your SD that contains "dbs", "extdata", "title" (that is
+// "Nintendo 3DS/<ID0>/<ID1>"). Entries come in the same order as from the script
+// (directory order, files before subfolders), the output is byte identical.
+// File sizes and counters are done on all cores.
+
+#define _FILE_OFFSET_BITS 64
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "decryptor/game.h"
+#include "decryptor/xorpad.h"
+#include "hostcrypto.h"
+#include "hostio.h"
+
+static char sd_base[1024];
+static FileList sd_files; // relative to sd_base, f.e. "/title/00040000/00123400/content/00000000.app"
+static SdInfoEntry* entries = NULL;
+static bool* failed = NULL;
+
+
+static bool IsQuotaFile(const char* name)
+{
+    // quota.dat files are not encrypted, anything containing the name is skipped (same as the script)
+    char lower[256];
+    u32 i = 0;
+    for (; name[i] && (i < sizeof(lower) - 1); i++)
+        lower[i] = tolower((unsigned char) name[i]);
+    lower[i] = '\0';
+    return (strstr(lower, "quota.dat") != NULL);
+}
+
+static u32 WalkFolder(const char* path)
+{
+    // same order as os.walk(): files in directory order, then the subfolders
+    char full[2048];
+    char** subdirs = NULL;
+    u32 n_subdirs = 0;
+    u32 result = 0;
+
+    snprintf(full, sizeof(full), "%s%s", sd_base, path);
+    DIR* dir = opendir(full);
+    if (!dir)
+        return 1;
+    for (struct dirent* entry = readdir(dir); entry && (result == 0); entry = readdir(dir)) {
+        char file[1024];
+        struct stat st;
+        if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0))
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        snprintf(full, sizeof(full), "%s%s", sd_base, file);
+        bool is_link = (lstat(full, &st) == 0) && S_ISLNK(st.st_mode);
+        bool is_dir = (stat(full, &st) == 0) && S_ISDIR(st.st_mode);
+        if (is_dir && is_link)
+            continue; // links to folders are not followed, same as os.walk()
+        if (is_dir) {
+            char** list = realloc(subdirs, (n_subdirs + 1) * sizeof(char*));
+            if (list)
+                subdirs = list;
+            if (!list || !(subdirs[n_subdirs] = strdup(file))) {
+                result = 1;
+                break;
+            }
+            n_subdirs++;
+        } else if (!IsQuotaFile(entry->d_name)) {
+            result = FileListAppend(&sd_files, file);
+        }
+    }
+    closedir(dir);
+    for (u32 i = 0; i < n_subdirs; i++) {
+        if (result == 0)
+            result = WalkFolder(subdirs[i]);
+        free(subdirs[i]);
+    }
+    free(subdirs);
+
+    return result;
+}
+
+static u32 Utf8ToUtf16(u8* out, u32 max_size, const char* str)
+{
+    // UTF-16LE with terminator for the counter hash, returns the size in byte
+    const u8* in = (const u8*) str;
+    u32 size = 0;
+    while (true) {
+        u32 cp = *in;
+        u32 len = (cp < 0x80) ? 1 : ((cp & 0xE0) == 0xC0) ? 2 : ((cp & 0xF0) == 0xE0) ? 3 : 4;
+        if (len > 1)
+            cp &= (0x7F >> len);
+        for (u32 i = 1; i < len; i++)
+            cp = (cp << 6) | (in[i] & 0x3F);
+        if (size + 4 > max_size)
+            return 0;
+        if (cp >= 0x10000) { // surrogate pair
+            cp -= 0x10000;
+            u32 hi = 0xD800 | (cp >> 10);
+            u32 lo = 0xDC00 | (cp & 0x3FF);
+            out[size++] = hi & 0xFF;
+            out[size++] = hi >> 8;
+            out[size++] = lo & 0xFF;
+            out[size++] = lo >> 8;
+        } else {
+            out[size++] = cp & 0xFF;
+            out[size++] = (cp >> 8) & 0xFF;
+        }
+        if (!*in)
+            return size;
+        for (u32 i = 0; (i < len) && *in; i++)
+            in++;
+    }
+}
+
+static void ParseFile(u32 index, void* arg)
+{
+    (void) (arg);
+    const char* path = sd_files.paths[index];
+    SdInfoEntry* entry = entries + index;
+    char full[2048];
+    u8 hashstr[1024];
+    u8 hash[32];
+    struct stat st;
+
+    // size in MB (rounded up)
+    snprintf(full, sizeof(full), "%s%s", sd_base, path);
+    if (stat(full, &st) != 0) {
+        printf("Can't open %s: %s\n", full, strerror(errno));
+        failed[index] = true;
+        return;
+    }
+    entry->size_mb = ((u64) st.st_size + (1024 * 1024) - 1) / (1024 * 1024);
+
+    // AES counter, see GetSdCtr() (the path is taken as is here, as in the script)
+    u32 hashlen = Utf8ToUtf16(hashstr, sizeof(hashstr), path);
+    if (!hashlen) {
+        printf("Path too long: %s\n", path);
+        failed[index] = true;
+        return;
+    }
+    Sha256(hash, hashstr, hashlen);
+    for (u32 i = 0; i < 16; i++)
+        entry->ctr[i] = hash[i] ^ hash[i+16];
+
+    // "/title/0004.../content/xxx" -> "/title.0004....content.xxx.xorpad"
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s.xorpad", path);
+    for (char* c = filename + 1; *c; c++)
+        if (*c == '/') *c = '.';
+    if (strlen(filename) > 180) {
+        printf("Filename too long: %s\n", filename);
+        failed[index] = true;
+        return;
+    }
+    memcpy(entry->filename, filename, strnlen(filename, 180));
+}
+
+static u32 WriteSdInfo(const char* path)
+{
+    u32 n_entries = sd_files.n_paths;
+    FILE* fp = fopen(path, "wb");
+    bool ok = fp && (fwrite(&n_entries, 1, 4, fp) == 4) &&
+        (fwrite(entries, sizeof(SdInfoEntry), n_entries, fp) == n_entries);
+    if (fp && (fclose(fp) != 0))
+        ok = false;
+    if (!ok)
+        printf("Can't write %s\n", path);
+    return ok ? 0 : 1;
+}
+
+
+static void Usage(void)
+{
+    printf("usage: sdinfo_gen [-o SDinfo.bin] [-j threads] folderpath\n");
+    printf("  folderpath: folder on your SD that contains \"dbs\", \"title\", etc.\n");
+    printf("  -o:         output file (default: SDinfo.bin in the current folder)\n");
+    printf("  threads:    number of worker threads (default: all cores)\n");
+    printf("  Example: sdinfo_gen \"/media/sd/Nintendo 3DS/xxxxxxxx/xxxxxxxx/\"\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* folders[3] = { "/dbs", "/extdata", "/title" };
+    long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 n_threads = (n_cores > 0) ? (u32) n_cores : 1;
+    const char* out_path = "SDinfo.bin";
+    u32 result = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:j:")) != -1) {
+        if (opt == 'o') {
+            out_path = optarg;
+        } else if (opt == 'j') {
+            n_threads = atoi(optarg);
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (optind + 1 != argc) {
+        Usage();
+        return 1;
+    }
+
+    struct stat st;
+    snprintf(sd_base, sizeof(sd_base), "%s", argv[optind]);
+    for (u32 l = strlen(sd_base); (l > 1) && (sd_base[l-1] == '/'); l--)
+        sd_base[l-1] = '\0';
+    if ((stat(sd_base, &st) != 0) || !S_ISDIR(st.st_mode)) {
+        printf("Can't open %s\n", sd_base);
+        return 1;
+    }
+    for (u32 i = 0; (i < 3) && (result == 0); i++) {
+        char folder[1024];
+        snprintf(folder, sizeof(folder), "%s%s", sd_base, folders[i]);
+        if ((stat(folder, &st) == 0) && S_ISDIR(st.st_mode))
+            result = WalkFolder(folders[i]);
+    }
+
+    if (result != 0) {
+        printf("Can't read %s\n", sd_base);
+    } else if (!sd_files.n_paths) {
+        printf("Couldn't find any content. Wrong folder?\n");
+        result = 1;
+    } else if (!(entries = calloc(sd_files.n_paths, sizeof(SdInfoEntry))) ||
+        !(failed = calloc(sd_files.n_paths, sizeof(bool)))) {
+        result = 1;
+    } else {
+        ParallelFor(sd_files.n_paths, n_threads, ParseFile, NULL);
+        for (u32 i = 0; i < sd_files.n_paths; i++)
+            if (failed[i])
+                result = 1;
+        if (sd_files.n_paths > MAX_ENTRIES)
+            printf("Warning: %u entries, SD Padgen only takes up to %u\n", sd_files.n_paths, MAX_ENTRIES);
+        if ((result == 0) && (WriteSdInfo(out_path) == 0))
+            printf("%s: %u entries\n", out_path, sd_files.n_paths);
+        else
+            result = 1;
+    }
+
+    free(entries);
+    free(failed);
+    FileListFree(&sd_files);
+    printf((result == 0) ? "Done!\n" : "Done, with errors!\n");
+    return (result == 0) ? 0 : 1;
+}
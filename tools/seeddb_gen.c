@@ -0,0 +1,202 @@
+// seeddb_gen: generates seeddb.bin from decrypted NAND seedsaves on PC, replaces seeddb_gen.py
+//
+// Takes the seedsave files dumped from "nand:/data/<ID0>/sysdata/0001000f/". Every
+// SEEDDB found in a file is read, title IDs are unique per file, as in the script.
+// The output is byte identical, the files are processed on all cores.
+
+#define _FILE_OFFSET_BITS 64
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "decryptor/game.h"
+#include "hostio.h"
+
+#define SEEDDB_TITLE_SLOTS  2000 // title IDs first, then the seeds
+
+// results for one input file, merged in input order
+typedef struct {
+    SeedInfoEntry* entries;
+    u32 n_entries;
+    char* log;
+    size_t log_size;
+    bool failed;
+} SeedDbFile;
+
+static FileList inputs;
+static SeedDbFile* results = NULL;
+
+
+static void FileLog(SeedDbFile* file, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    char* log = realloc(file->log, file->log_size + len + 1);
+    if (!log)
+        return;
+    va_start(args, format);
+    vsnprintf(log + file->log_size, len + 1, format, args);
+    va_end(args);
+    file->log = log;
+    file->log_size += len;
+}
+
+static u32 SeedDbAdd(SeedDbFile* file, const u8* titleId, const u8* seed)
+{
+    // title IDs already taken from this file are skipped (first one wins)
+    u64 tid = getle64(titleId);
+    for (u32 i = 0; i < file->n_entries; i++)
+        if (file->entries[i].titleId == tid)
+            return 0;
+    SeedInfoEntry* entries = realloc(file->entries, (file->n_entries + 1) * sizeof(SeedInfoEntry));
+    if (!entries)
+        return 1;
+    file->entries = entries;
+    SeedInfoEntry* entry = file->entries + file->n_entries++;
+    memset(entry, 0x00, sizeof(SeedInfoEntry));
+    entry->titleId = tid;
+    memcpy(entry->external_seed, seed, 16);
+
+    FileLog(file, "TitleID: %016llx  SEED: ", (unsigned long long) tid);
+    for (u32 i = 0; i < 16; i++)
+        FileLog(file, "%02x", seed[i]);
+    FileLog(file, "\n");
+    return 0;
+}
+
+static void ParseFile(u32 index, void* arg)
+{
+    (void) (arg);
+    SeedDbFile* file = results + index;
+    MapFile map;
+
+    if (MapOpen(&map, inputs.paths[index], false) != 0) {
+        file->failed = true;
+        MapClose(&map);
+        return;
+    }
+
+    // same offsets as the script: the title ID and seed tables follow the SEEDDB header
+    const u8* data = map.data;
+    u64 size = map.size;
+    u64 pos = 0;
+    while (!file->failed && (pos + 6 <= size)) {
+        u64 sb = pos;
+        while ((sb + 6 <= size) && (memcmp(data + sb, "SEEDDB", 6) != 0))
+            sb++;
+        if (sb + 6 > size)
+            break;
+        if (sb + 28 > size) {
+            FileLog(file, "No SEED found in this partition.\n");
+            break;
+        }
+        int64_t tid_offset = ((int64_t) getle32(data + sb + 24) - 1) * 4096 + (int64_t) sb - 52 + 4096;
+        int64_t seed_offset = tid_offset + (SEEDDB_TITLE_SLOTS * 8);
+        if ((tid_offset < 4092) || ((u64) tid_offset - 4088 > size)) {
+            FileLog(file, "No SEED found in this partition.\n");
+            break;
+        }
+        u32 n_titles = getle32(data + tid_offset - 4092);
+        for (u32 i = 0; i < n_titles; i++, tid_offset += 8, seed_offset += 16) {
+            if (((u64) tid_offset + 8 > size) || ((u64) seed_offset + 16 > size)) {
+                FileLog(file, "No SEED found in this partition.\n");
+                break;
+            }
+            file->failed = (SeedDbAdd(file, data + tid_offset, data + seed_offset) != 0);
+        }
+        // continue behind the seed table, but always behind this SEEDDB
+        pos = ((u64) seed_offset > sb) ? (u64) seed_offset : sb + 6;
+    }
+    MapClose(&map);
+}
+
+static u32 WriteSeedDb(const char* path, u32 n_entries)
+{
+    u8 header[16] = { 0 };
+    memcpy(header, &n_entries, 4);
+    FILE* fp = fopen(path, "wb");
+    bool ok = fp && (fwrite(header, 1, 16, fp) == 16);
+    for (u32 i = 0; (i < inputs.n_paths) && ok; i++)
+        ok = (fwrite(results[i].entries, sizeof(SeedInfoEntry), results[i].n_entries, fp) == results[i].n_entries);
+    if (fp && (fclose(fp) != 0))
+        ok = false;
+    if (!ok)
+        printf("Can't write %s\n", path);
+    return ok ? 0 : 1;
+}
+
+
+static void Usage(void)
+{
+    printf("usage: seeddb_gen [-o seeddb.bin] [-j threads] files..\n");
+    printf("  files:   decrypted seedsaves from \"nand:/data/<ID0>/sysdata/0001000f/\"\n");
+    printf("  -o:      output file (default: seeddb.bin in the current folder)\n");
+    printf("  threads: number of worker threads (default: all cores)\n");
+    printf("  Example: seeddb_gen -o /media/sd/files9/seeddb.bin 0001000f/*\n");
+}
+
+int main(int argc, char** argv)
+{
+    long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 n_threads = (n_cores > 0) ? (u32) n_cores : 1;
+    const char* out_path = "seeddb.bin";
+    u32 n_entries = 0;
+    u32 result = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:j:")) != -1) {
+        if (opt == 'o') {
+            out_path = optarg;
+        } else if (opt == 'j') {
+            n_threads = atoi(optarg);
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        Usage();
+        return 1;
+    }
+    for (int i = optind; i < argc; i++)
+        if (FileListAppend(&inputs, argv[i]) != 0)
+            result = 1;
+    if (!inputs.n_paths || !(results = calloc(inputs.n_paths, sizeof(SeedDbFile)))) {
+        FileListFree(&inputs);
+        return 1;
+    }
+
+    ParallelFor(inputs.n_paths, n_threads, ParseFile, NULL);
+    for (u32 i = 0; i < inputs.n_paths; i++) {
+        if (results[i].log)
+            printf("%s", results[i].log);
+        if (results[i].failed)
+            result = 1;
+        n_entries += results[i].n_entries;
+    }
+
+    if (!n_entries) {
+        printf("No SEED found.\n");
+        result = 1;
+    } else {
+        if (n_entries > SEEDDB_MAX_ENTRIES)
+            printf("Warning: %u entries, only up to %u are loaded on the 3DS\n", n_entries, SEEDDB_MAX_ENTRIES);
+        if (WriteSeedDb(out_path, n_entries) == 0)
+            printf("%s: %u entries\n", out_path, n_entries);
+        else
+            result = 1;
+    }
+
+    for (u32 i = 0; i < inputs.n_paths; i++) {
+        free(results[i].entries);
+        free(results[i].log);
+    }
+    free(results);
+    FileListFree(&inputs);
+    printf((result == 0) ? "Done!\n" : "Done, with errors!\n");
+    return (result == 0) ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// AK2i NOR flash model for the host tests, stands in for command_ak2i.c
+// erase sets a 64KB block to 0xFF, programming only clears bits, writes need the flash unlocked
+#include "gamecart/command_ak2i.h"
+#include "hosttest.h"
+
+#define AK2I_MODEL_BLOCK_SIZE   0x10000
+
+static u32 hw_version = 0;
+static u8* nor = NULL;
+static u32 nor_size = 0;
+static u32 stuck = 0xFFFFFFFF;
+static bool unlocked = false;
+static Ak2iModelStats stats;
+
+
+void Ak2iModelInsert(u32 hw, u8* data, u32 size)
+{
+    hw_version = hw;
+    nor = data;
+    nor_size = size;
+    stuck = 0xFFFFFFFF;
+    unlocked = false;
+    Ak2iModelResetStats();
+}
+
+void Ak2iModelSetStuck(u32 address)
+{
+    stuck = address;
+}
+
+void Ak2iModelGetStats(Ak2iModelStats* out)
+{
+    *out = stats;
+    out->locked = !unlocked;
+}
+
+void Ak2iModelResetStats(void)
+{
+    memset(&stats, 0, sizeof(Ak2iModelStats));
+}
+
+static void Ak2iModelCheck(u32 address, u32 length, u32 hw)
+{
+    if (!nor || (address + length > nor_size) || (address + length < address))
+        HostFail("AK2i flash access %08X+%X outside of the flash", address, length);
+    if (hw && (hw != hw_version))
+        HostFail("AK2i HW %X command on a HW %X cart", hw, hw_version);
+}
+
+// command_ak2i.c
+u32 AK2I_CmdGetHardwareVersion(void)
+{
+    return hw_version;
+}
+
+void AK2I_CmdReadRom(u32 address, u8 *buffer, u32 length)
+{
+    // the ROM is not modeled, it reads as a pattern
+    for (u32 i = 0; i < length; i++)
+        buffer[i] = (u8) (address + i);
+}
+
+void AK2I_CmdReadFlash(u32 address, u8 *buffer, u32 length)
+{
+    Ak2iModelCheck(address, length, 0);
+    if (length > 0x200)
+        HostFail("AK2i flash read of %X byte, the ASIC reads up to 0x200", length);
+    memcpy(buffer, nor + address, length);
+    stats.n_reads++;
+    stats.n_read_bytes += length;
+}
+
+void AK2I_CmdSetMapTableAddress(u32 tableName, u32 tableInRamAddress) {}
+void AK2I_CmdSetFlash1681_81(void) {}
+void AK2I_CmdActiveFatMap(void) {}
+
+void AK2I_CmdUnlockFlash(void)
+{
+    unlocked = true;
+}
+
+void AK2I_CmdUnlockASIC(void) {}
+
+void AK2i_CmdLockFlash(void)
+{
+    unlocked = false;
+}
+
+static void Ak2iModelErase(u32 address, u32 hw)
+{
+    Ak2iModelCheck(address, 1, hw);
+    if (!unlocked)
+        HostFail("AK2i erase at %08X with the flash locked", address);
+    address -= address % AK2I_MODEL_BLOCK_SIZE;
+    for (u32 i = 0; i < AK2I_MODEL_BLOCK_SIZE; i++) {
+        if (address + i != stuck)
+            nor[address + i] = 0xFF;
+    }
+    stats.n_erases++;
+}
+
+static void Ak2iModelWrite(u32 address, const void *data, u32 length, u32 hw)
+{
+    const u8* src = data;
+    Ak2iModelCheck(address, length, hw);
+    if (!unlocked)
+        HostFail("AK2i write at %08X with the flash locked", address);
+    for (u32 i = 0; i < length; i++) {
+        if (address + i != stuck)
+            nor[address + i] &= src[i];
+    }
+    stats.n_writes++;
+    stats.n_write_bytes += length;
+}
+
+void AK2I_CmdEraseFlashBlock_44(u32 address)
+{
+    Ak2iModelErase(address, 0x44);
+}
+
+void AK2I_CmdEraseFlashBlock_81(u32 address)
+{
+    Ak2iModelErase(address, 0x81);
+}
+
+void AK2I_CmdWriteFlash_44(u32 address, const void *data, u32 length)
+{
+    Ak2iModelWrite(address, data, length, 0x44);
+}
+
+void AK2I_CmdWriteFlash_81(u32 address, const void *data, u32 length)
+{
+    Ak2iModelWrite(address, data, length, 0x81);
+}
+
+bool AK2I_CmdVerifyFlash(void *src, u32 dest, u32 length)
+{
+    u8 buffer[0x200];
+    for (u32 i = 0; i < length; i += 0x200) {
+        u32 size = (length - i < 0x200) ? length - i : 0x200;
+        AK2I_CmdReadFlash(dest + i, buffer, size);
+        if (memcmp(buffer, (u8*) src + i, size) != 0)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,249 @@
+// gamecart model for the host tests, stands in for protocol*.c, card_ntr.c and NTR_Secure_Init()
+// serves a .3ds / .nds image, counts commands and estimates the transfer time on a real cart
+#include "gamecart/protocol.h"
+#include "gamecart/protocol_ctr.h"
+#include "gamecart/protocol_ntr.h"
+#include "gamecart/card_ntr.h"
+#include "gamecart/command_ctr.h"
+#include "gamecart/command_ntr.h"
+#include "hosttest.h"
+
+// cart IDs reported for images (bit 28: CTR, bit 31: cheap NTR card)
+#define CART_MODEL_ID_CTR   0x90000FC2
+#define CART_MODEL_ID_NTR   0x00000FC2
+
+// transfer timing: per command, per page, per 0x200 byte of data
+#define CART_MODEL_CTR_CMD_US   20
+#define CART_MODEL_CTR_PAGE_US  8
+#define CART_MODEL_CTR_DATA_US  32
+#define CART_MODEL_NTR_CMD_US   30
+#define CART_MODEL_NTR_PAGE_US  20
+#define CART_MODEL_NTR_DATA_US  70
+
+static const u8* image = NULL;
+static u32 image_size = 0;
+static u32 image_flags = 0;
+static u32 cart_id = 0;
+static u32 n_guard = 0; // 0xA2 commands since the last other command
+static CartModelStats stats;
+static u8* read_map = NULL;
+
+extern u32 ReadDataFlags;
+
+
+void CartModelInsert(const u8* data, u32 size, u32 flags)
+{
+    image = data;
+    image_size = size;
+    image_flags = flags;
+    cart_id = (memcmp(data + 0x100, "NCSD", 4) == 0) ? CART_MODEL_ID_CTR : CART_MODEL_ID_NTR;
+    if (flags & CART_MODEL_CHEAP)
+        cart_id |= 0x80000000;
+    free(read_map);
+    read_map = calloc(size / 0x200 + 1, 1);
+    CartModelResetStats();
+    REG_CARDCONF2 = 0x0; // inserted
+}
+
+void CartModelEject(void)
+{
+    image = NULL;
+    REG_CARDCONF2 = 0x1;
+}
+
+void CartModelGetStats(CartModelStats* out)
+{
+    *out = stats;
+}
+
+void CartModelResetStats(void)
+{
+    memset(&stats, 0, sizeof(CartModelStats));
+    if (read_map)
+        memset(read_map, 0, image_size / 0x200 + 1);
+}
+
+const u8* CartModelReadMap(void)
+{
+    return read_map;
+}
+
+static void CartModelRead(u32 offset, u32 size, u32 page_size, void* buffer, bool data)
+{
+    // unused cart space reads as 0xFF
+    u8* out = buffer;
+    for (u32 i = 0; i < size; i++)
+        out[i] = (offset + i < image_size) ? image[offset + i] : 0xFF;
+    if (data && (page_size >= 0x1000) && (image_flags & CART_MODEL_NO_LARGE_PAGES)) {
+        // unsupported page size for data reads: only the first 0x200 byte of each page are valid
+        for (u32 p = 0; p < size; p += page_size) {
+            for (u32 i = 0x200; i < page_size; i += 0x200)
+                memcpy(out + p + i, out + p, 0x200);
+        }
+    }
+    if (data) {
+        for (u32 s = offset / 0x200; (s < (offset + size) / 0x200) && (s < image_size / 0x200); s++)
+            if (read_map[s] < 0xFF) read_map[s]++;
+    }
+}
+
+static void CartModelCount(bool ntr, u32 page_size, u32 size)
+{
+    u32 n_pages = (page_size) ? (size + page_size - 1) / page_size : 0;
+    stats.n_commands++;
+    stats.n_bytes += size;
+    stats.model_us += (ntr) ?
+        CART_MODEL_NTR_CMD_US + (n_pages * CART_MODEL_NTR_PAGE_US) + ((size * CART_MODEL_NTR_DATA_US) / 0x200) :
+        CART_MODEL_CTR_CMD_US + (n_pages * CART_MODEL_CTR_PAGE_US) + ((size * CART_MODEL_CTR_DATA_US) / 0x200);
+}
+
+// protocol.c
+u32 BSWAP32(u32 val)
+{
+    return __builtin_bswap32(val);
+}
+
+int Cart_IsInserted(void)
+{
+    return (image != NULL);
+}
+
+u32 Cart_GetID(void)
+{
+    return cart_id;
+}
+
+void Cart_Reset(void)
+{
+    n_guard = 0;
+}
+
+void Cart_Init(void)
+{
+    if (!image)
+        HostFail("Cart_Init() without a cart");
+    Cart_Reset();
+}
+
+void Cart_Secure_Init(u32* buf, u32* out)
+{
+    // same command sequence as the real thing, crypto is not modelled
+    const u32 A2_cmd[4] = { 0xA2000000, 0x00000000, 0x42434445, 0x46474849 };
+    const u32 A3_cmd[4] = { 0xA3000000, 0x00000000, 0x42434445, 0x46474849 };
+    const u32 C5_cmd[4] = { 0xC5000000, 0x00000000, 0x42434445, 0x46474849 };
+    u32 test;
+    (void) buf;
+    memset(out, 0, 16);
+    CTR_CmdSeed(0x42434445, 0x46474849);
+    CTR_SendCommand(A2_cmd, 4, 1, 0x701002C, &test);
+    CTR_SendCommand(A3_cmd, 4, 1, 0x701002C, &test);
+    CTR_SendCommand(C5_cmd, 0, 1, 0x100002C, NULL);
+    for (int i = 0; i < 5; ++i)
+        CTR_SendCommand(A2_cmd, 4, 1, 0x701002C, &test);
+}
+
+void Cart_Dummy(void)
+{
+    u32 test;
+    const u32 A2_cmd[4] = { 0xA2000000, 0x00000000, 0x42434445, 0x46474849 };
+    CTR_SendCommand(A2_cmd, 4, 1, 0x701002C, &test);
+}
+
+// protocol_ctr.c
+void CTR_SetSecKey(u32 value) { (void) value; }
+void CTR_SetSecSeed(const u32* seed, bool flag) { (void) seed; (void) flag; }
+
+void CTR_SendCommand(const u32 command[4], u32 pageSize, u32 blocks, u32 latency, void* buffer)
+{
+    u32 size = pageSize * blocks;
+    u8 cmd = command[0] >> 24;
+    (void) latency;
+    if (!image)
+        HostFail("CTR command %02X without a cart", cmd);
+    CartModelCount(false, pageSize, size);
+    switch (cmd) {
+        case 0xA2: // secure ID, used as dummy command
+            stats.n_dummies++;
+            n_guard++;
+            *(u32*) buffer = cart_id;
+            return;
+        case 0xBF: { // data read
+            u32 sector = ((command[0] & 0xFF) << 23) | (command[1] >> 9);
+            stats.n_reads++;
+            stats.n_large += (pageSize >= 0x1000);
+            if (n_guard < 2)
+                stats.n_unguarded++;
+            CartModelRead(sector * 0x200, size, pageSize, buffer, true);
+            break;
+        }
+        case 0x82: // header, stored at 0x1000 in .3ds images
+            CartModelRead(0x1000, size, pageSize, buffer, false);
+            break;
+        case 0xC6: // unique ID
+            memset(buffer, 0xC6, size);
+            break;
+        case 0x83: case 0xA3: case 0xC5:
+            if (buffer)
+                memset(buffer, 0, size);
+            break;
+        default:
+            HostFail("unknown CTR command %02X", cmd);
+    }
+    n_guard = 0;
+}
+
+// protocol_ntr.c
+void NTR_SendCommand(const u32 command[2], u32 pageSize, u32 latency, void* buffer)
+{
+    (void) command; (void) latency;
+    CartModelCount(true, pageSize, pageSize);
+    if (buffer)
+        memset(buffer, 0xFF, pageSize);
+}
+
+// card_ntr.c
+void cardReset()
+{
+    CartModelCount(true, 0, 0);
+}
+
+u32 cardReadID(u32 flags)
+{
+    (void) flags;
+    CartModelCount(true, 4, 4);
+    return cart_id;
+}
+
+void cardParamCommand(u8 command, u32 parameter, u32 flags, u32* destination, u32 length)
+{
+    u32 blk = (flags >> 24) & 0x7;
+    u32 page_size = (blk == 7) ? 4 : (blk) ? (0x100u << blk) : 0;
+    u32 size = length * 4;
+    if (!image)
+        HostFail("NTR command %02X without a cart", command);
+    if (size != page_size)
+        HostFail("NTR command %02X: transfer size %X vs block size %X", command, size, page_size);
+    CartModelCount(true, page_size, size);
+    if (command == NTRCARD_CMD_HEADER_READ) {
+        CartModelRead(parameter, size, page_size, destination, false);
+    } else if (command == NTRCARD_CMD_DATA_READ) {
+        stats.n_reads++;
+        stats.n_large += (page_size >= 0x1000);
+        CartModelRead(parameter, size, page_size, destination, true);
+    } else {
+        HostFail("unknown NTR command %02X", command);
+    }
+}
+
+// secure_ntr.c
+bool NTR_Secure_Init(u8* header, u32 CartID, int iCardDevice)
+{
+    // the secure area is stored decrypted in .nds images, the ARM9i one at its ROM offset
+    bool iCheapCard = (CartID & 0x80000000) != 0;
+    u32 offset = (iCardDevice) ? getle32(header + 0x1C0) : 0x4000;
+    ReadDataFlags = getle32(header + 0x60) & ~NTRCARD_BLK_SIZE(7);
+    for (u32 i = 0; i < 0x4000; i += (iCheapCard) ? 0x200 : 0x1000)
+        CartModelCount(true, (iCheapCard) ? 0x200 : 0x1000, (iCheapCard) ? 0x200 : 0x1000);
+    CartModelRead(offset, 0x4000, 0x200, header + 0x4000, false);
+    return true;
+}
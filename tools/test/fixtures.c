@@ -0,0 +1,421 @@
+// synthetic NCCH / cart images for the host tests
+#include "decryptor/decryptor.h"
+#include "decryptor/game.h"
+#include "decryptor/nand.h"
+#include "decryptor/romfs.h"
+#include "decryptor/sha.h"
+#include "decryptor/titlekey.h"
+#include "fs.h"
+#include "hosttest.h"
+
+#define FIXTURE_NAND_SIZE   0x3AF00000 // O3DS minimum size
+
+// O3DS NCSD NAND header (@0x100) and the TWL MBR (encrypted @0x1BE), as in nand.c
+static const u8 fixture_nand_magic[0x60] = {
+    0x4E, 0x43, 0x53, 0x44, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x04, 0x03, 0x03, 0x01, 0x00, 0x00, 0x00, 0x01, 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x88, 0x05, 0x00, 0x00, 0x88, 0x05, 0x00, 0x80, 0x01, 0x00, 0x00,
+    0x80, 0x89, 0x05, 0x00, 0x00, 0x20, 0x00, 0x00, 0x80, 0xA9, 0x05, 0x00, 0x00, 0x20, 0x00, 0x00,
+    0x80, 0xC9, 0x05, 0x00, 0x80, 0xAE, 0x17, 0x00
+};
+static const u8 fixture_twl_mbr[0x42] = {
+    0x00, 0x04, 0x18, 0x00, 0x06, 0x01, 0xA0, 0x3F, 0x97, 0x00, 0x00, 0x00, 0xA9, 0x7D, 0x04, 0x00,
+    0x00, 0x04, 0x8E, 0x40, 0x06, 0x01, 0xA0, 0xC3, 0x8D, 0x80, 0x04, 0x00, 0xB3, 0x05, 0x01, 0x00,
+    [0x40] = 0x55, 0xAA
+};
+
+u32 FixtureNcch(u8* out, u32 size, u64 title_id, const char* productcode, u32 seed)
+{
+    NcchHeader* ncch = (NcchHeader*) out;
+    size = align(size, 0x200);
+    HostRandom(out, size, seed);
+    memset(out + 0x100, 0, sizeof(NcchHeader) - 0x100);
+    memcpy(ncch->magic, "NCCH", 4);
+    ncch->size = size / 0x200;
+    ncch->partitionId = title_id;
+    ncch->programId = title_id;
+    ncch->version = 2;
+    strncpy(ncch->productcode, productcode, 0x10);
+    ncch->flags[7] = 0x04; // NoCrypto
+    return size;
+}
+
+u32 FixtureCxi(u8* out, u32 size_romfs, u64 title_id, u32 seed)
+{
+    // ExHeader, ExeFS (".code", "banner", "icon") and RomFS, all hashes set
+    const char* names[3] = { ".code", "banner", "icon" };
+    const u32 sizes[3] = { 0x1234, 0x300, 0x36C0 };
+    NcchHeader* ncch = (NcchHeader*) out;
+    u32 offset_exefs = 0xA00;
+    u32 size_exefs = 0x200;
+    for (u32 i = 0; i < 3; i++)
+        size_exefs += align(sizes[i], 0x200);
+    u32 offset_romfs = offset_exefs + size_exefs;
+    size_romfs = align(size_romfs, 0x200);
+    u32 size = FixtureNcch(out, offset_romfs + size_romfs, title_id, "CTR-P-BTCH", seed);
+
+    u8* exefs = out + offset_exefs;
+    memset(exefs, 0x00, 0x200);
+    for (u32 i = 0, offset = 0; i < 3; i++) {
+        strncpy((char*) exefs + (i*0x10), names[i], 8);
+        memcpy(exefs + (i*0x10) + 0x8, &offset, 4);
+        memcpy(exefs + (i*0x10) + 0xC, sizes + i, 4);
+        sha_quick(exefs + 0x200 - ((i+1)*0x20), exefs + 0x200 + offset, sizes[i], SHA256_MODE);
+        offset += align(sizes[i], 0x200);
+    }
+    ncch->size_exthdr = 0x400;
+    ncch->offset_exefs = offset_exefs / 0x200;
+    ncch->size_exefs = size_exefs / 0x200;
+    ncch->size_exefs_hash = 1;
+    ncch->offset_romfs = offset_romfs / 0x200;
+    ncch->size_romfs = size_romfs / 0x200;
+    ncch->size_romfs_hash = 1;
+    sha_quick(ncch->hash_exthdr, out + 0x200, 0x400, SHA256_MODE);
+    sha_quick(ncch->hash_exefs, exefs, 0x200, SHA256_MODE);
+    sha_quick(ncch->hash_romfs, out + offset_romfs, 0x200, SHA256_MODE);
+    return size;
+}
+
+static u32 FixtureRomFsName(u8* out, const char* name, u32 len)
+{
+    // UTF-16 name, returns the padded size
+    for (u32 i = 0; i < len; i++) {
+        out[2*i] = (u8) name[i];
+        out[2*i+1] = 0x00;
+    }
+    return align(2 * len, 4);
+}
+
+u32 FixtureRomFs(u8* out, const FixtureFile* files, u32 n_files)
+{
+    // IVFC levels (0x1000 byte blocks) and the level 3 tables, the hash tables have one empty bucket
+    // file data is stored in reverse table order, so table order and data order differ
+    const u32 bsize = 0x1000;
+    const char* dir_names[64];
+    u32 dir_lens[64];
+    u32 dir_parent[64];
+    u32 dir_offset[64];
+    u32 file_dir[256];
+    u32 file_offset[256];
+    u64 data_offset[256];
+    u32 n_dirs = 1;
+    CHECK(n_files <= 256);
+    
+    // directory tree from the paths ("/dir/sub/file")
+    dir_names[0] = "";
+    dir_lens[0] = 0;
+    dir_parent[0] = 0;
+    for (u32 f = 0; f < n_files; f++) {
+        const char* name = files[f].path + 1;
+        u32 d = 0;
+        for (const char* sep; (sep = strchr(name, '/')) != NULL; name = sep + 1) {
+            u32 len = sep - name;
+            u32 c;
+            for (c = 1; c < n_dirs; c++)
+                if ((dir_parent[c] == d) && (dir_lens[c] == len) && (strncmp(dir_names[c], name, len) == 0))
+                    break;
+            if (c == n_dirs) {
+                CHECK(n_dirs < 64);
+                dir_names[n_dirs] = name;
+                dir_lens[n_dirs] = len;
+                dir_parent[n_dirs++] = d;
+            }
+            d = c;
+        }
+        file_dir[f] = d;
+    }
+    
+    // level 3 layout
+    u32 size_dirmeta = 0;
+    u32 size_filemeta = 0;
+    for (u32 d = 0; d < n_dirs; d++) {
+        dir_offset[d] = size_dirmeta;
+        size_dirmeta += sizeof(RomFsLv3DirMeta) + align(2 * dir_lens[d], 4);
+    }
+    for (u32 f = 0; f < n_files; f++) {
+        file_offset[f] = size_filemeta;
+        size_filemeta += sizeof(RomFsLv3FileMeta) + align(2 * strlen(strrchr(files[f].path, '/') + 1), 4);
+    }
+    RomFsLv3Header lv3 = { .size_header = sizeof(RomFsLv3Header) };
+    lv3.offset_dirhash = sizeof(RomFsLv3Header);
+    lv3.size_dirhash = 4;
+    lv3.offset_dirmeta = lv3.offset_dirhash + lv3.size_dirhash;
+    lv3.size_dirmeta = size_dirmeta;
+    lv3.offset_filehash = lv3.offset_dirmeta + size_dirmeta;
+    lv3.size_filehash = 4;
+    lv3.offset_filemeta = lv3.offset_filehash + lv3.size_filehash;
+    lv3.size_filemeta = size_filemeta;
+    lv3.offset_filedata = align(lv3.offset_filemeta + size_filemeta, 0x10);
+    u64 size_filedata = 0;
+    for (u32 f = n_files; f > 0; f--) {
+        data_offset[f-1] = size_filedata;
+        size_filedata = align(size_filedata + files[f-1].size, 0x10);
+    }
+    
+    // IVFC sizes, the superblock (header and master hash) goes before level 3
+    u64 size_lv[3];
+    size_lv[2] = lv3.offset_filedata + size_filedata;
+    size_lv[1] = ((size_lv[2] + bsize - 1) / bsize) * 0x20;
+    size_lv[0] = ((size_lv[1] + bsize - 1) / bsize) * 0x20;
+    u32 size_master = ((size_lv[0] + bsize - 1) / bsize) * 0x20;
+    u32 offset_lv3 = align(sizeof(RomFsIvfcHeader) + size_master, bsize);
+    u32 offset_lv1 = offset_lv3 + align(size_lv[2], bsize);
+    u32 offset_lv2 = offset_lv1 + align(size_lv[0], bsize);
+    u32 size_romfs = offset_lv2 + align(size_lv[1], bsize);
+    memset(out, 0x00, size_romfs);
+    
+    // level 3: header, tables, data
+    u8* l3 = out + offset_lv3;
+    memcpy(l3, &lv3, sizeof(RomFsLv3Header));
+    memset(l3 + lv3.offset_dirhash, 0xFF, 4);
+    memset(l3 + lv3.offset_filehash, 0xFF, 4);
+    for (u32 d = 0; d < n_dirs; d++) {
+        RomFsLv3DirMeta* dir = (RomFsLv3DirMeta*) (l3 + lv3.offset_dirmeta + dir_offset[d]);
+        dir->offset_parent = dir_offset[dir_parent[d]];
+        dir->offset_sibling = dir->offset_child = dir->offset_file = dir->offset_samehash = (u32) -1;
+        for (u32 c = d + 1; (c < n_dirs) && (d > 0); c++)
+            if (dir_parent[c] == dir_parent[d]) { dir->offset_sibling = dir_offset[c]; break; }
+        for (u32 c = 1; c < n_dirs; c++)
+            if ((c != d) && (dir_parent[c] == d)) { dir->offset_child = dir_offset[c]; break; }
+        for (u32 f = 0; f < n_files; f++)
+            if (file_dir[f] == d) { dir->offset_file = file_offset[f]; break; }
+        dir->name_len = 2 * dir_lens[d];
+        FixtureRomFsName((u8*) dir + sizeof(RomFsLv3DirMeta), dir_names[d], dir_lens[d]);
+    }
+    for (u32 f = 0; f < n_files; f++) {
+        RomFsLv3FileMeta* file = (RomFsLv3FileMeta*) (l3 + lv3.offset_filemeta + file_offset[f]);
+        const char* name = strrchr(files[f].path, '/') + 1;
+        file->offset_parent = dir_offset[file_dir[f]];
+        file->offset_sibling = file->offset_samehash = (u32) -1;
+        for (u32 c = f + 1; c < n_files; c++)
+            if (file_dir[c] == file_dir[f]) { file->offset_sibling = file_offset[c]; break; }
+        file->offset_data = data_offset[f];
+        file->size_data = files[f].size;
+        file->name_len = 2 * strlen(name);
+        FixtureRomFsName((u8*) file + sizeof(RomFsLv3FileMeta), name, strlen(name));
+        memcpy(l3 + lv3.offset_filedata + data_offset[f], files[f].data, files[f].size);
+    }
+    
+    // hash levels bottom up: level 2 hashes level 3, level 1 hashes level 2, master hashes level 1
+    u8* data_lv[3] = { out + offset_lv1, out + offset_lv2, l3 };
+    u8* hash_lv[3] = { out + sizeof(RomFsIvfcHeader), out + offset_lv1, out + offset_lv2 };
+    for (u32 i = 3; i > 0; i--)
+        for (u32 b = 0; b * bsize < size_lv[i-1]; b++)
+            sha_quick(hash_lv[i-1] + (b * 0x20), data_lv[i-1] + (b * bsize), bsize, SHA256_MODE);
+    
+    RomFsIvfcHeader* ivfc = (RomFsIvfcHeader*) out;
+    memcpy(ivfc->magic, "IVFC", 4);
+    ivfc->magic_number = 0x10000;
+    ivfc->size_masterhash = size_master;
+    for (u32 i = 0, offset = 0; i < 3; i++) {
+        ivfc->level[i].offset = offset;
+        ivfc->level[i].size = size_lv[i];
+        ivfc->level[i].log_block = 12;
+        offset += align(size_lv[i], bsize);
+    }
+    ivfc->size_header = 0x5C;
+    
+    return size_romfs;
+}
+
+u32 FixtureCxiRomFs(u8* out, const u8* romfs, u32 size_romfs, u64 title_id, u32 seed)
+{
+    // FixtureCxi() with the given RomFS, the superblock hash covers IVFC header and master hash
+    u32 size = FixtureCxi(out, size_romfs, title_id, seed);
+    NcchHeader* ncch = (NcchHeader*) out;
+    RomFsIvfcHeader* ivfc = (RomFsIvfcHeader*) romfs;
+    memcpy(out + (ncch->offset_romfs * 0x200), romfs, size_romfs);
+    ncch->size_romfs_hash = align(sizeof(RomFsIvfcHeader) + ivfc->size_masterhash, 0x200) / 0x200;
+    sha_quick(ncch->hash_romfs, romfs, ncch->size_romfs_hash * 0x200, SHA256_MODE);
+    return size;
+}
+
+void FixtureNcchEncrypt(u8* ncch, u32 size, const u8* crypt)
+{
+    // through the firmware NCCH Encryptor, this needs the SD image
+    size_t fsize;
+    HostPut("/fixture.cxi", ncch, size);
+    CHECK_EQ(CryptNcch("/fixture.cxi", 0, 0, 0, (u8*) crypt), 0);
+    u8* data = HostGet("/fixture.cxi", &fsize);
+    CHECK(data && (fsize == size) && (memcmp(data, ncch, size) != 0));
+    memcpy(ncch, data, size);
+    free(data);
+    FileDelete("/fixture.cxi");
+}
+
+void FixtureSeedDb(u64 title_id, u8* hash_seed)
+{
+    // seeddb.bin with one random seed, hash_seed: the NCCH header check value (4 bytes)
+    SeedInfo* db = calloc(1, 16 + sizeof(SeedInfoEntry));
+    u8 data[16 + 8];
+    u8 hash[32];
+    CHECK(db);
+    db->n_entries = 1;
+    db->entries[0].titleId = title_id;
+    HostRandom(db->entries[0].external_seed, 16, 0x5EED);
+    HostPut("/seeddb.bin", db, 16 + sizeof(SeedInfoEntry));
+    memcpy(data, db->entries[0].external_seed, 16);
+    memcpy(data + 16, &title_id, 8);
+    sha_quick(hash, data, 16 + 8, SHA256_MODE);
+    memcpy(hash_seed, hash, 4);
+    free(db);
+}
+
+u8* FixtureCia(const u8* contents, const u32* sizes, u32 n_contents, u64 title_id, u32* cia_size)
+{
+    u32 size_content = 0;
+    for (u32 i = 0; i < n_contents; i++)
+        size_content += sizes[i];
+    CiaHeader header = { .size_header = 0x2020, .size_cert = CIA_CERT_SIZE, .size_ticket = 0x350,
+        .size_tmd = sizeof(TitleMetaData) + (n_contents * sizeof(TmdContentChunk)), .size_content = size_content };
+    CiaInfo info;
+    header.content_index[0] = 0xE0;
+    GetCiaInfo(&info, &header);
+    u8* cia = calloc(1, info.offset_content + size_content);
+    CHECK(cia && (n_contents <= 64));
+    memcpy(cia, &header, sizeof(CiaHeader));
+    HostRandom(cia + info.offset_cert, CIA_CERT_SIZE, 0xCE27);
+    memcpy(cia + info.offset_content, contents, size_content);
+
+    // ticket with the encrypted titlekey
+    Ticket* ticket = (Ticket*) (cia + info.offset_ticket);
+    TitleKeyEntry entry = { .commonKeyIndex = 1 };
+    u64 tid_be = __builtin_bswap64(title_id);
+    memcpy(ticket->sig_type, "\x00\x01\x00\x04", 4);
+    memcpy(ticket->title_id, &tid_be, 8);
+    memcpy(entry.titleId, ticket->title_id, 8);
+    HostRandom(entry.titleKey, 16, 0x717E);
+    CryptTitlekey(&entry, true);
+    memcpy(ticket->titlekey, entry.titleKey, 16);
+    ticket->commonkey_idx = 1;
+
+    // TMD, one content info record for all contents
+    TitleMetaData* tmd = (TitleMetaData*) (cia + info.offset_tmd);
+    TmdContentChunk* chunk = (TmdContentChunk*) (tmd + 1);
+    memcpy(tmd->sig_type, "\x00\x01\x00\x04", 4);
+    memcpy(tmd->title_id, &tid_be, 8);
+    tmd->content_count[1] = n_contents;
+    tmd->contentinfo[0].cmd_count[1] = n_contents;
+    for (u32 i = 0, offset = info.offset_content; i < n_contents; offset += sizes[i++]) {
+        u64 size_be = __builtin_bswap64((u64) sizes[i]);
+        chunk[i].id[3] = i;
+        chunk[i].index[1] = i;
+        memcpy(chunk[i].size, &size_be, 8);
+        sha_quick(chunk[i].hash, cia + offset, sizes[i], SHA256_MODE);
+    }
+    sha_quick(tmd->contentinfo[0].hash, chunk, n_contents * sizeof(TmdContentChunk), SHA256_MODE);
+    sha_quick(tmd->contentinfo_hash, tmd->contentinfo, 64 * sizeof(TmdContentInfo), SHA256_MODE);
+
+    // CIA encryption through the firmware
+    *cia_size = info.offset_content + size_content;
+    HostPut("/fixture.cia", cia, *cia_size);
+    CHECK_EQ(CryptCia("/fixture.cia", NULL, true, false), 0);
+    free(cia);
+    cia = HostGet("/fixture.cia", NULL);
+    CHECK(cia);
+    FileDelete("/fixture.cia");
+    return cia;
+}
+
+u8* FixtureCtrCart(u32 cart_size, const u32* part_sizes, u32 n_parts, u32* data_size)
+{
+    u8* cart = malloc(cart_size);
+    NcsdHeader* ncsd = (NcsdHeader*) cart;
+    u32 offset = 0x4000;
+    CHECK(cart && (n_parts <= 8));
+    memset(cart, 0xFF, cart_size);
+    HostRandom(cart, 0x1200, 0x3D5);
+    memset(cart + 0x100, 0, sizeof(NcsdHeader) - 0x100);
+    memcpy(ncsd->magic, "NCSD", 4);
+    ncsd->size = cart_size / 0x200;
+    ncsd->mediaId = 0x0004000000123400;
+    ncsd->partition_flags[5] = 0x01; // CARD1, no writable area
+    memset(cart + 0x200, 0xFF, 4);
+    cart[0x312] = 0x00; // version
+    for (u32 p = 0; p < n_parts; p++) {
+        u32 size = FixtureNcch(cart + offset, part_sizes[p], 0x0004000000123400 | p,
+            (p == 0) ? "CTR-P-TEST" : "CTR-M-TEST", 0x1000 + p);
+        ncsd->partitions[p].offset = offset / 0x200;
+        ncsd->partitions[p].size = size / 0x200;
+        if (p == 0) // cart header, as returned by the 0x82 command
+            memcpy(cart + 0x1000, cart + offset, 0x200);
+        offset += align(size, 0x100000);
+        CHECK(offset <= cart_size);
+    }
+    if (data_size)
+        *data_size = (ncsd->partitions[n_parts-1].offset + ncsd->partitions[n_parts-1].size) * 0x200;
+    return cart;
+}
+
+u8* FixtureNtrCart(u32 cart_size, u32 data_size, bool dsi)
+{
+    u8* cart = malloc(cart_size);
+    u32 capacity = 0;
+    CHECK(cart && (data_size <= cart_size) && (data_size > 0x10000));
+    while ((0x20000u << capacity) < cart_size)
+        capacity++;
+    memset(cart, 0xFF, cart_size);
+    memset(cart, 0x00, 0x8000);
+    HostRandom(cart + 0x4000, data_size - 0x4000, 0xD5);
+    memcpy(cart, "HOSTTESTCART" "ATSE01", 18);
+    cart[0x12] = (dsi) ? 0x02 : 0x00;
+    cart[0x14] = capacity;
+    cart[0x1E] = 0x01; // version
+    memcpy(cart + 0x60, "\x57\x76\x1F\x00", 4); // ROMCTRL, normal commands
+    memcpy(cart + 0x80, &data_size, 4);
+    if (dsi) {
+        u32 arm9i_offset = 0x10000;
+        memcpy(cart + 0x1C0, &arm9i_offset, 4);
+        memcpy(cart + 0x210, &data_size, 4);
+    }
+    return cart;
+}
+
+static void FixtureNandEncrypt(u8* nand, u8* data, u32 offset, u32 size, PartitionInfo* partition)
+{
+    CryptBufferInfo info = {.keyslot = partition->keyslot, .setKeyY = 0, .size = size, .buffer = data, .mode = partition->mode};
+    GetNandCtr(info.ctr, offset);
+    CryptBuffer(&info);
+    memcpy(nand + offset, data, size);
+}
+
+u8* FixtureNand(const FixtureFile* files, u32 n_files)
+{
+    // untouched parts of the image stay unallocated
+    u8* nand = calloc(1, FIXTURE_NAND_SIZE);
+    u8* buffer = malloc(0x100000);
+    CHECK(nand && buffer);
+    HostRandom(nand, 0x100, 0x5A5A);
+    memcpy(nand + 0x100, fixture_nand_magic, sizeof(fixture_nand_magic));
+    HostNandAttach(nand, FIXTURE_NAND_SIZE);
+    PartitionInfo* twln = GetPartitionInfo(P_TWLN);
+    PartitionInfo* ctrnand = GetPartitionInfo(P_CTRNAND);
+    CHECK(twln && ctrnand && (ctrnand->offset == 0x0B95CA00));
+
+    memset(buffer, 0x00, 0xA0);
+    memcpy(buffer + 0x5E, fixture_twl_mbr, sizeof(fixture_twl_mbr));
+    FixtureNandEncrypt(nand, buffer, 0x160, 0xA0, twln);
+
+    // partition magic (boot sector / FIRM header start), as checked by the partition dumpers
+    const u32 p_magic[4] = { P_TWLN, P_TWLP, P_FIRM0, P_FIRM1 };
+    for (u32 i = 0; i < 4; i++) {
+        PartitionInfo* info = GetPartitionInfo(p_magic[i]);
+        memset(buffer, 0x00, 0x10);
+        memcpy(buffer, info->magic, 8);
+        FixtureNandEncrypt(nand, buffer, info->offset, 0x10, info);
+    }
+
+    // CTRNAND: FAT32 volume built on the SD image, encrypted up to its last written sector
+    HostSdCreate(ctrnand->size / 0x100000);
+    for (u32 i = 0; i < n_files; i++)
+        HostPut(files[i].path, files[i].data, files[i].size);
+    u32 used = align(HostSdUsedSize(), 0x100000);
+    for (u32 i = 0; i < used; i += 0x100000) {
+        HostSdRead(i, buffer, 0x100000);
+        FixtureNandEncrypt(nand, buffer, ctrnand->offset + i, 0x100000, ctrnand);
+    }
+    HostSdClose();
+    free(buffer);
+
+    return nand;
+}
@@ -0,0 +1,370 @@
+// host side of the firmware test build: fixed memory, screens, input, SD / NAND images
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "fs.h"
+#include "draw.h"
+#include "hid.h"
+#include "fatfs/ff.h"
+#include "fatfs/sdmmc.h"
+#include "hosttest.h"
+
+#define HOST_SD_SECTOR  0x200
+
+u8 *top_screen, *bottom_screen;
+
+// fixed addresses the firmware uses directly, mapped as plain memory
+static const struct {
+    uintptr_t address;
+    size_t size;
+} host_regions[] = {
+    { 0x01FF0000, 0x00010000 }, // ARM9 ITCM (NTR blowfish tables)
+    { 0x10000000, 0x00200000 }, // IO registers
+    { 0x20000000, 0x10000000 }, // FCRAM (work buffers)
+};
+
+static char temp_dir[64];
+static int sd_fd = -1;
+static u32 sd_write_budget = 0;
+static u64 sd_written = 0;
+static const u8* nand_image = NULL;
+static u64 nand_read = 0;
+static mmcdevice host_mmc[2]; // 0: NAND, 1: SD
+
+static u32 input_queue[16];
+static u32 input_count = 0;
+static u32 input_held = 0;
+
+
+void HostFail(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+    HostDumpLog();
+    _exit(1);
+}
+
+void HostInit(void)
+{
+    for (u32 i = 0; i < sizeof(host_regions) / sizeof(host_regions[0]); i++) {
+        void* mem = mmap((void*) host_regions[i].address, host_regions[i].size, PROT_READ|PROT_WRITE,
+            MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED_NOREPLACE|MAP_NORESERVE, -1, 0);
+        if (mem != (void*) host_regions[i].address) {
+            fprintf(stderr, "could not map %08lX: %s\n", (unsigned long) host_regions[i].address, strerror(errno));
+            exit(1);
+        }
+    }
+    top_screen = calloc(SCREEN_WIDTH_TOP * SCREEN_HEIGHT, BYTES_PER_PIXEL);
+    bottom_screen = calloc(SCREEN_WIDTH_BOT * SCREEN_HEIGHT, BYTES_PER_PIXEL);
+    strcpy(temp_dir, "/tmp/d9test.XXXXXX");
+    if (!mkdtemp(temp_dir)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+}
+
+const char* HostTempPath(const char* name)
+{
+    static char path[2][128];
+    static u32 idx = 0;
+    idx ^= 1;
+    if (!name) { // remove the temp dir
+        snprintf(path[idx], 128, "rm -rf %s", temp_dir);
+        if (system(path[idx]) != 0)
+            fprintf(stderr, "could not remove %s\n", temp_dir);
+        return NULL;
+    }
+    snprintf(path[idx], 128, "%s/%s", temp_dir, name);
+    return path[idx];
+}
+
+void HostRandom(void* buf, size_t size, u32 seed)
+{
+    // xorshift, reproducible test data
+    u32 x = seed ? seed : 0x9E3779B9;
+    for (size_t i = 0; i < size; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        ((u8*) buf)[i] = x >> 24;
+    }
+}
+
+static void HostSdFormat(u32 n_sectors)
+{
+    // minimal FAT32, no MBR, 4KB clusters
+    const u32 spc = 8;
+    const u32 rsvd = 32;
+    u32 fat_size = ((n_sectors - rsvd) / (spc * 128 + 2)) + 1;
+    u8 sector[HOST_SD_SECTOR];
+
+    memset(sector, 0, HOST_SD_SECTOR);
+    memcpy(sector, "\xEB\x58\x90" "MSWIN4.1", 11);
+    sector[0x0C] = HOST_SD_SECTOR >> 8;
+    sector[0x0D] = spc;
+    sector[0x0E] = rsvd;
+    sector[0x10] = 2; // number of FATs
+    sector[0x15] = 0xF8;
+    sector[0x18] = 63;
+    sector[0x1A] = 255;
+    memcpy(sector + 0x20, &n_sectors, 4);
+    memcpy(sector + 0x24, &fat_size, 4);
+    sector[0x2C] = 2; // root dir cluster
+    sector[0x30] = 1; // FSInfo sector
+    sector[0x32] = 6; // backup boot sector
+    sector[0x40] = 0x80;
+    sector[0x42] = 0x29;
+    memcpy(sector + 0x47, "NO NAME    FAT32   ", 19);
+    sector[0x1FE] = 0x55;
+    sector[0x1FF] = 0xAA;
+    if ((pwrite(sd_fd, sector, HOST_SD_SECTOR, 0) != HOST_SD_SECTOR) ||
+        (pwrite(sd_fd, sector, HOST_SD_SECTOR, 6 * HOST_SD_SECTOR) != HOST_SD_SECTOR))
+        HostFail("could not format the SD image");
+
+    memset(sector, 0, HOST_SD_SECTOR);
+    memcpy(sector + 0x000, "RRaA", 4);
+    memcpy(sector + 0x1E4, "rrAa", 4);
+    memset(sector + 0x1E8, 0xFF, 8); // free count / next free unknown
+    sector[0x1FE] = 0x55;
+    sector[0x1FF] = 0xAA;
+    if (pwrite(sd_fd, sector, HOST_SD_SECTOR, 1 * HOST_SD_SECTOR) != HOST_SD_SECTOR)
+        HostFail("could not format the SD image");
+
+    // FAT entries 0 / 1 and the root directory cluster, in both FATs
+    const u32 fat_start[3] = { 0x0FFFFFF8, 0x0FFFFFFF, 0x0FFFFFFF };
+    for (u32 f = 0; f < 2; f++) {
+        if (pwrite(sd_fd, fat_start, sizeof(fat_start), (u64) (rsvd + (f * fat_size)) * HOST_SD_SECTOR) != sizeof(fat_start))
+            HostFail("could not format the SD image");
+    }
+}
+
+void HostSdCreate(u32 size_mb)
+{
+    u32 n_sectors = size_mb * (0x100000 / HOST_SD_SECTOR);
+    HostSdClose();
+    sd_fd = open(HostTempPath("sd.img"), O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if ((sd_fd < 0) || (ftruncate(sd_fd, (u64) n_sectors * HOST_SD_SECTOR) != 0))
+        HostFail("could not create the SD image");
+    HostSdFormat(n_sectors);
+    host_mmc[1].total_size = n_sectors;
+    if (!InitFS())
+        HostFail("could not mount the SD image");
+}
+
+void HostSdRemount(void)
+{
+    // drops all cached FAT state, needed after a child process wrote to the image
+    f_mount(NULL, "0:", 1);
+    if (!InitFS())
+        HostFail("could not mount the SD image");
+}
+
+void HostSdClose(void)
+{
+    if (sd_fd < 0)
+        return;
+    DeinitFS();
+    close(sd_fd);
+    sd_fd = -1;
+}
+
+void HostSdRead(u64 offset, void* buf, size_t size)
+{
+    if ((sd_fd < 0) || (pread(sd_fd, buf, size, offset) != (ssize_t) size))
+        HostFail("could not read the SD image at %llX", (unsigned long long) offset);
+}
+
+u64 HostSdUsedSize(void)
+{
+    // the image is sparse, everything past the last written extent reads as zero
+    off_t end = 0;
+    for (off_t data = lseek(sd_fd, 0, SEEK_DATA); data >= 0; data = lseek(sd_fd, end, SEEK_DATA))
+        end = lseek(sd_fd, data, SEEK_HOLE);
+    return end;
+}
+
+void HostSetPowerLoss(u32 n_writes)
+{
+    sd_write_budget = n_writes;
+}
+
+u64 HostSdWritten(void)
+{
+    return sd_written;
+}
+
+u64 HostNandRead(void)
+{
+    return nand_read;
+}
+
+void HostNandAttach(const void* image, u32 size)
+{
+    nand_image = image;
+    host_mmc[0].total_size = (image) ? size / HOST_SD_SECTOR : 0;
+}
+
+int HostRun(void (*fn)(void*), void* arg)
+{
+    int status;
+    // anything cached on the parent side would be stale after the child ran
+    LogWrite(NULL);
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0)
+        HostFail("fork failed");
+    if (pid == 0) {
+        fn(arg);
+        LogWrite(NULL);
+        _exit(0);
+    }
+    if (waitpid(pid, &status, 0) != pid)
+        HostFail("waitpid failed");
+    if (sd_fd >= 0)
+        HostSdRemount();
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+void HostPut(const char* path, const void* data, size_t size)
+{
+    FIL fil;
+    UINT bw;
+    char dir[256];
+    // create parent directories as needed
+    strncpy(dir, path, 255);
+    dir[255] = '\0';
+    for (char* slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        f_mkdir(dir);
+        *slash = '/';
+    }
+    if ((f_open(&fil, path, FA_WRITE|FA_CREATE_ALWAYS) != FR_OK) ||
+        (f_write(&fil, data, size, &bw) != FR_OK) || (bw != size) ||
+        (f_close(&fil) != FR_OK))
+        HostFail("could not write %s", path);
+}
+
+u8* HostGet(const char* path, size_t* size)
+{
+    FIL fil;
+    UINT br;
+    if (f_open(&fil, path, FA_READ|FA_OPEN_EXISTING) != FR_OK)
+        return NULL;
+    size_t fsize = f_size(&fil);
+    u8* data = malloc(fsize + 1);
+    if (!data || (f_read(&fil, data, fsize, &br) != FR_OK) || (br != fsize))
+        HostFail("could not read %s", path);
+    f_close(&fil);
+    data[fsize] = '\0';
+    if (size)
+        *size = fsize;
+    return data;
+}
+
+bool HostExists(const char* path)
+{
+    FILINFO fno;
+    return (f_stat(path, &fno) == FR_OK);
+}
+
+void HostDumpLog(void)
+{
+    if (sd_fd < 0)
+        return;
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    if (!log)
+        return;
+    fprintf(stderr, "--- %s ---\n%s", LOG_FILE, log);
+    free(log);
+}
+
+void HostQueueInput(u32 buttons)
+{
+    if (input_count >= sizeof(input_queue) / sizeof(u32))
+        HostFail("input queue full");
+    input_queue[input_count++] = buttons;
+}
+
+void HostHoldButtons(u32 buttons)
+{
+    input_held = buttons;
+}
+
+// hid.c
+u32 InputWait()
+{
+    if (!input_count)
+        HostFail("unexpected user prompt");
+    u32 buttons = input_queue[0];
+    memmove(input_queue, input_queue + 1, --input_count * sizeof(u32));
+    return buttons;
+}
+
+bool CheckButton(u32 button)
+{
+    return ((input_held & button) == button);
+}
+
+// iodelay.s
+void ioDelay(u32 us) { (void) us; }
+void ioDelay2(u32 us) { (void) us; }
+
+// sdmmc.c, drive 0 (NAND) and 1 (SD)
+static int HostSdAccess(u32 sector_no, u32 numsectors, void* buf, bool write)
+{
+    size_t size = (size_t) numsectors * HOST_SD_SECTOR;
+    off_t offset = (off_t) sector_no * HOST_SD_SECTOR;
+    if ((sd_fd < 0) || (sector_no + numsectors > host_mmc[1].total_size))
+        return -1;
+    if (write && sd_write_budget && (--sd_write_budget == 0))
+        _exit(HOST_EXIT_POWERLOSS);
+    if (write)
+        sd_written += numsectors;
+    ssize_t res = (write) ? pwrite(sd_fd, buf, size, offset) : pread(sd_fd, buf, size, offset);
+    return (res == (ssize_t) size) ? 0 : -1;
+}
+
+int sdmmc_sdcard_init() { return (sd_fd < 0) ? -1 : 0; }
+int sdmmc_sdcard_readsectors(uint32_t sector_no, uint32_t numsectors, uint8_t *out)
+{
+    return HostSdAccess(sector_no, numsectors, out, false);
+}
+
+int sdmmc_sdcard_writesectors(uint32_t sector_no, uint32_t numsectors, const uint8_t *in)
+{
+    return HostSdAccess(sector_no, numsectors, (void*) in, true);
+}
+
+int sdmmc_nand_readsectors(uint32_t sector_no, uint32_t numsectors, uint8_t *out)
+{
+    if (!nand_image || (sector_no + numsectors > host_mmc[0].total_size))
+        return -1;
+    memcpy(out, nand_image + (size_t) sector_no * HOST_SD_SECTOR, (size_t) numsectors * HOST_SD_SECTOR);
+    nand_read += numsectors;
+    return 0;
+}
+
+int sdmmc_nand_writesectors(uint32_t sector_no, uint32_t numsectors, const uint8_t *in)
+{
+    (void) sector_no; (void) numsectors; (void) in;
+    return -1; // the NAND image is read only
+}
+
+int sdmmc_get_cid(bool isNand, uint32_t *info)
+{
+    memset(info, isNand ? 0x4E : 0x53, 16);
+    return 0;
+}
+
+mmcdevice *getMMCDevice(int drive)
+{
+    return host_mmc + (drive ? 1 : 0);
+}
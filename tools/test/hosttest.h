@@ -0,0 +1,147 @@
+// host test build of the ARM9 firmware
+// the firmware sources are compiled unchanged, hardware access goes to the stand-ins here
+#pragma once
+
+#include "common.h"
+
+// exit status of a test child that ran out of its SD write budget (simulated power loss)
+#define HOST_EXIT_POWERLOSS 86
+
+void HostFail(const char* format, ...) __attribute__((noreturn, format(printf, 1, 2)));
+
+#define CHECK(cond) \
+    do { if (!(cond)) HostFail("%s:%d: check failed: %s", __FILE__, __LINE__, #cond); } while (0)
+#define CHECK_EQ(a, b) \
+    do { unsigned long long _a = (a), _b = (b); if (_a != _b) \
+        HostFail("%s:%d: %s == %s failed (0x%llX vs 0x%llX)", __FILE__, __LINE__, #a, #b, _a, _b); } while (0)
+
+/** Fixed memory regions, screens, temp directory **/
+void HostInit(void);
+const char* HostTempPath(const char* name);
+void HostRandom(void* buf, size_t size, u32 seed);
+
+/** SD card image, freshly formatted FAT32 (size in MB), mounted through the firmware InitFS() **/
+void HostSdCreate(u32 size_mb);
+void HostSdRemount(void);
+void HostSdClose(void);
+// raw image access, size of the image up to its last written sector
+void HostSdRead(u64 offset, void* buf, size_t size);
+u64 HostSdUsedSize(void);
+// the test child exits with HOST_EXIT_POWERLOSS on the n-th SD write from now (0: unlimited)
+void HostSetPowerLoss(u32 n_writes);
+// sectors written to the SD image so far
+u64 HostSdWritten(void);
+
+/** NAND image (raw, as dumped), 0 to detach **/
+void HostNandAttach(const void* image, u32 size);
+// sectors read from the NAND image so far
+u64 HostNandRead(void);
+
+/** AES stand-in (soft_aes.c): 16 byte blocks processed so far **/
+u64 HostAesBlocks(void);
+// plain AES-128 and the normal key of a keyslot, for reference results
+void soft_aes_encrypt_block(const uint8_t* key, const uint8_t* in, uint8_t* out);
+const uint8_t* soft_aes_normal_key(uint32_t keyslot);
+
+/** Runs fn in a child process, returns its exit status (0 on success) **/
+int HostRun(void (*fn)(void*), void* arg);
+
+/** Files on the SD image **/
+void HostPut(const char* path, const void* data, size_t size);
+u8* HostGet(const char* path, size_t* size); // malloc()ed, NULL if not found
+bool HostExists(const char* path);
+void HostDumpLog(void);
+
+/** Scripted input: buttons returned by the next InputWait() calls / held for CheckButton() **/
+void HostQueueInput(u32 buttons);
+void HostHoldButtons(u32 buttons);
+
+/** Gamecart model (cart_model.c), serves a .3ds / .nds image **/
+#define CART_MODEL_NO_LARGE_PAGES (1<<0) // data reads in 0x1000 byte pages / blocks return garbage
+#define CART_MODEL_CHEAP          (1<<1) // NTR: cheap card (ID bit 31)
+
+typedef struct {
+    u32 n_commands;     // all commands sent to the cart
+    u32 n_reads;        // data read commands (CTR 0xBF / NTR 0xB7)
+    u32 n_dummies;      // CTR 0xA2 commands
+    u32 n_unguarded;    // CTR data reads without two 0xA2 commands right before them
+    u32 n_large;        // data reads with 0x1000 byte pages / blocks
+    u64 n_bytes;        // bytes transferred
+    u64 model_us;       // transfer time estimate for a real cart
+} CartModelStats;
+
+void CartModelInsert(const u8* image, u32 size, u32 flags);
+void CartModelEject(void);
+void CartModelGetStats(CartModelStats* stats);
+void CartModelResetStats(void);
+// read count for each 0x200 byte sector of the image, sectors outside are not counted
+const u8* CartModelReadMap(void);
+
+/** NDS save chip model (spi_model.c), type as for cardEepromGetType(), data: chip contents (size byte) **/
+typedef struct {
+    u32 n_commands;     // all SPI commands
+    u32 n_rdid;         // JEDEC ID reads (0x9F)
+    u32 n_erases;       // sector erases
+    u32 n_programs;     // program / write commands
+    u32 n_wraps;        // program commands that wrapped around inside their page
+    u64 n_read_bytes;
+    u64 n_program_bytes;
+} SpiModelStats;
+
+void SpiModelInsert(int type, u32 size, u32 jedec_id, u8* data);
+// the byte at address keeps its value on program and erase (0xFFFFFFFF: none)
+void SpiModelSetStuck(u32 address);
+void SpiModelGetStats(SpiModelStats* stats);
+void SpiModelResetStats(void);
+
+/** AK2i NOR flash model (ak2i_model.c), hw: 0x44 / 0x81, the cart itself comes from the gamecart model **/
+typedef struct {
+    u32 n_reads;        // flash read commands
+    u32 n_erases;       // 64KB block erases
+    u32 n_writes;       // program commands
+    u64 n_read_bytes;
+    u64 n_write_bytes;
+    bool locked;        // flash write protection
+} Ak2iModelStats;
+
+void Ak2iModelInsert(u32 hw, u8* data, u32 size);
+// the byte at address keeps its value on program and erase (0xFFFFFFFF: none)
+void Ak2iModelSetStuck(u32 address);
+void Ak2iModelGetStats(Ak2iModelStats* stats);
+void Ak2iModelResetStats(void);
+
+/** Synthetic test images (fixtures.c) **/
+typedef struct {
+    const char* path; // inside CTRNAND / RomFS, e.g. "/dbs/ticket.db"
+    const void* data;
+    u32 size;
+} FixtureFile;
+// plain (NoCrypto) NCCH with random contents, returns its size
+u32 FixtureNcch(u8* out, u32 size, u64 title_id, const char* productcode, u32 seed);
+// CXI with ExHeader, ExeFS and RomFS (NoCrypto), hashes are valid, returns its size
+u32 FixtureCxi(u8* out, u32 size_romfs, u64 title_id, u32 seed);
+// RomFS (IVFC hash tree and level 3 tables) holding the given files (path: "/dir/file"), returns its size
+u32 FixtureRomFs(u8* out, const FixtureFile* files, u32 n_files);
+// FixtureCxi() with the given RomFS
+u32 FixtureCxiRomFs(u8* out, const u8* romfs, u32 size_romfs, u64 title_id, u32 seed);
+// encrypts an NCCH in memory through the firmware (crypt: flags as for CryptNcch()), needs the SD image
+void FixtureNcchEncrypt(u8* ncch, u32 size, const u8* crypt);
+// seeddb.bin (SD root) with a random seed for title_id, hash_seed: the 4 byte NCCH header check value
+void FixtureSeedDb(u64 title_id, u8* hash_seed);
+// CIA from the given contents, valid TMD, titlekey (common key 1) encrypted by the firmware, malloc()ed
+u8* FixtureCia(const u8* contents, const u32* sizes, u32 n_contents, u64 title_id, u32* cia_size);
+// CTR cart image: NCSD header, partitions of the given sizes, 0xFF padding to cart_size
+u8* FixtureCtrCart(u32 cart_size, const u32* part_sizes, u32 n_parts, u32* data_size);
+// NTR / TWL cart image: header, secure area, random data up to data_size, 0xFF padding
+u8* FixtureNtrCart(u32 cart_size, u32 data_size, bool dsi);
+// O3DS NAND image holding the given files in CTRNAND, attached as SysNAND
+// this uses the SD image for building the volume, create the SD image afterwards
+u8* FixtureNand(const FixtureFile* files, u32 n_files);
+
+/** Test registration **/
+typedef void (*HostTestFn)(void);
+void HostRegisterTest(const char* name, HostTestFn fn);
+#define HOST_TEST(name) \
+    static void name(void); \
+    __attribute__((constructor)) static void register_##name(void) { HostRegisterTest(#name, name); } \
+    static void name(void)
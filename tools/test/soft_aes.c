@@ -0,0 +1,328 @@
+// software replacement for the ARM9 AES engine (decryptor/aes.c) in the host tests
+// keyslots hold keyX / keyY / normal key, normal keys get derived via the keyscrambler
+#include "decryptor/aes.h"
+#include "hosttest.h"
+
+typedef struct {
+    uint8_t x[16];
+    uint8_t y[16];
+    uint8_t normal[16];
+} AesKeySlot;
+
+static AesKeySlot keyslots[0x40];
+static uint32_t keysel = 0;
+static uint8_t ctr_reg[16];
+static u64 n_blocks = 0;
+
+static const uint8_t sbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+static uint8_t inv_sbox[256];
+
+static uint8_t xtime(uint8_t b)
+{
+    return (uint8_t) ((b << 1) ^ ((b & 0x80) ? 0x1B : 0x00));
+}
+
+static uint8_t gmul(uint8_t a, uint8_t b)
+{
+    uint8_t r = 0;
+    for (; b; b >>= 1, a = xtime(a))
+        if (b & 1) r ^= a;
+    return r;
+}
+
+static void ExpandKey(const uint8_t* key, uint8_t* rk)
+{
+    uint8_t rcon = 0x01;
+    memcpy(rk, key, 16);
+    for (uint32_t i = 16; i < 176; i += 4) {
+        uint8_t t[4];
+        memcpy(t, rk + i - 4, 4);
+        if (i % 16 == 0) {
+            uint8_t t0 = t[0];
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[t0];
+            rcon = xtime(rcon);
+        }
+        for (uint32_t j = 0; j < 4; j++)
+            rk[i + j] = rk[i + j - 16] ^ t[j];
+    }
+}
+
+static const uint8_t* GetRoundKeys(const uint8_t* key)
+{
+    // the last expanded key is cached, most requests use the same key over and over
+    static uint8_t last_key[16];
+    static uint8_t rk[176];
+    static bool valid = false;
+    if (!valid || (memcmp(last_key, key, 16) != 0)) {
+        memcpy(last_key, key, 16);
+        ExpandKey(key, rk);
+        valid = true;
+    }
+    return rk;
+}
+
+void soft_aes_encrypt_block(const uint8_t* key, const uint8_t* in, uint8_t* out)
+{
+    const uint8_t* rk = GetRoundKeys(key);
+    uint8_t s[16];
+    for (uint32_t i = 0; i < 16; i++)
+        s[i] = in[i] ^ rk[i];
+    for (uint32_t r = 1; r <= 10; r++) {
+        uint8_t t[16];
+        for (uint32_t c = 0; c < 4; c++) // sub bytes + shift rows
+            for (uint32_t j = 0; j < 4; j++)
+                t[c*4 + j] = sbox[s[((c + j) % 4)*4 + j]];
+        if (r < 10) { // mix columns
+            for (uint32_t c = 0; c < 4; c++) {
+                uint8_t* a = t + c*4;
+                uint8_t a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+                uint8_t x = a0 ^ a1 ^ a2 ^ a3;
+                a[0] ^= x ^ xtime(a0 ^ a1);
+                a[1] ^= x ^ xtime(a1 ^ a2);
+                a[2] ^= x ^ xtime(a2 ^ a3);
+                a[3] ^= x ^ xtime(a3 ^ a0);
+            }
+        }
+        for (uint32_t i = 0; i < 16; i++)
+            s[i] = t[i] ^ rk[r*16 + i];
+    }
+    memcpy(out, s, 16);
+}
+
+void soft_aes_decrypt_block(const uint8_t* key, const uint8_t* in, uint8_t* out)
+{
+    const uint8_t* rk = GetRoundKeys(key);
+    uint8_t s[16];
+    if (!inv_sbox[sbox[1]])
+        for (uint32_t i = 0; i < 256; i++)
+            inv_sbox[sbox[i]] = (uint8_t) i;
+    for (uint32_t i = 0; i < 16; i++)
+        s[i] = in[i] ^ rk[160 + i];
+    for (int r = 9; r >= 0; r--) {
+        uint8_t t[16];
+        for (uint32_t c = 0; c < 4; c++) // inverse shift rows + sub bytes
+            for (uint32_t j = 0; j < 4; j++)
+                t[((c + j) % 4)*4 + j] = inv_sbox[s[c*4 + j]];
+        for (uint32_t i = 0; i < 16; i++)
+            t[i] ^= rk[r*16 + i];
+        if (r > 0) { // inverse mix columns
+            for (uint32_t c = 0; c < 4; c++) {
+                uint8_t* a = t + c*4;
+                uint8_t a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+                a[0] = gmul(a0, 14) ^ gmul(a1, 11) ^ gmul(a2, 13) ^ gmul(a3, 9);
+                a[1] = gmul(a0, 9) ^ gmul(a1, 14) ^ gmul(a2, 11) ^ gmul(a3, 13);
+                a[2] = gmul(a0, 13) ^ gmul(a1, 9) ^ gmul(a2, 14) ^ gmul(a3, 11);
+                a[3] = gmul(a0, 11) ^ gmul(a1, 13) ^ gmul(a2, 9) ^ gmul(a3, 14);
+            }
+        }
+        memcpy(s, t, 16);
+    }
+    memcpy(out, s, 16);
+}
+
+static void Rol128(uint8_t* v, uint32_t n)
+{
+    // rotate a big endian 128 bit number left by n bits
+    uint8_t t[16];
+    uint32_t bytes = (n / 8) % 16;
+    uint32_t bits = n % 8;
+    for (uint32_t i = 0; i < 16; i++)
+        t[i] = v[(i + bytes) % 16];
+    for (uint32_t i = 0; i < 16; i++)
+        v[i] = (uint8_t) ((t[i] << bits) | ((bits) ? (t[(i + 1) % 16] >> (8 - bits)) : 0));
+}
+
+static void Add128(uint8_t* v, const uint8_t* a)
+{
+    uint32_t carry = 0;
+    for (int i = 15; i >= 0; i--) {
+        uint32_t sum = v[i] + a[i] + carry;
+        v[i] = (uint8_t) sum;
+        carry = sum >> 8;
+    }
+}
+
+void soft_aes_scramble(uint8_t* normal, const uint8_t* keyx, const uint8_t* keyy, bool twl)
+{
+    // see: https://www.3dbrew.org/wiki/AES_Registers#Keyslots
+    static const uint8_t c_ctr[16] = {
+        0x1F, 0xF9, 0xE9, 0xAA, 0xC5, 0xFE, 0x04, 0x08, 0x02, 0x45, 0x91, 0xDC, 0x5D, 0x52, 0x76, 0x8A
+    };
+    static const uint8_t c_twl[16] = {
+        0xFF, 0xFE, 0xFB, 0x4E, 0x29, 0x59, 0x02, 0x58, 0x2A, 0x68, 0x0F, 0x5F, 0x1A, 0x4F, 0x3E, 0x79
+    };
+    memcpy(normal, keyx, 16);
+    if (twl) { // TWL: (X ^ Y) + C rol 42
+        for (uint32_t i = 0; i < 16; i++)
+            normal[i] ^= keyy[i];
+        Add128(normal, c_twl);
+        Rol128(normal, 42);
+    } else { // CTR: ((X rol 2) ^ Y) + C rol 87
+        Rol128(normal, 2);
+        for (uint32_t i = 0; i < 16; i++)
+            normal[i] ^= keyy[i];
+        Add128(normal, c_ctr);
+        Rol128(normal, 87);
+    }
+}
+
+const uint8_t* soft_aes_normal_key(uint32_t keyslot)
+{
+    return keyslots[keyslot & 0x3F].normal;
+}
+
+void setup_aeskeyX(uint8_t keyslot, void* keyx)
+{
+    memcpy(keyslots[keyslot & 0x3F].x, keyx, 16);
+}
+
+void setup_aeskeyY(uint8_t keyslot, void* keyy)
+{
+    // writing keyY is what triggers the keyscrambler on hardware
+    AesKeySlot* slot = keyslots + (keyslot & 0x3F);
+    memcpy(slot->y, keyy, 16);
+    soft_aes_scramble(slot->normal, slot->x, slot->y, keyslot < 4);
+}
+
+void setup_aeskey(uint8_t keyslot, void* key)
+{
+    memcpy(keyslots[keyslot & 0x3F].normal, key, 16);
+}
+
+void use_aeskey(uint32_t keyno)
+{
+    if (keyno > 0x3F)
+        return;
+    keysel = keyno;
+}
+
+void set_ctr(void* iv)
+{
+    memcpy(ctr_reg, iv, 16);
+}
+
+void add_ctr(void* ctr, uint32_t carry)
+{
+    uint8_t* outctr = (uint8_t*) ctr;
+    for (int i = 15; (i >= 0) && carry; i--) {
+        uint32_t sum = outctr[i] + (carry & 0xFF);
+        outctr[i] = (uint8_t) sum;
+        carry = (carry >> 8) + (sum >> 8);
+    }
+}
+
+static void Reverse16(uint8_t* dst, const uint8_t* src)
+{
+    uint8_t t[16];
+    for (uint32_t i = 0; i < 16; i++)
+        t[i] = src[15 - i];
+    memcpy(dst, t, 16);
+}
+
+void aes_decrypt(void* inbuf, void* outbuf, size_t size, uint32_t mode)
+{
+    // modes without input / output order flags (TWL) see their blocks reversed
+    const uint8_t* key = keyslots[keysel].normal;
+    bool reversed = !(mode & AES_CNT_INPUT_ORDER);
+    uint8_t* in = inbuf;
+    uint8_t* out = outbuf;
+
+    n_blocks += size;
+    for (size_t b = 0; b < size; b++, in += 16, out += 16) {
+        uint8_t blk[16];
+        uint8_t res[16];
+        if (reversed) Reverse16(blk, in);
+        else memcpy(blk, in, 16);
+        switch (mode & (7u << 27)) {
+            case AES_CTR_MODE:
+                soft_aes_encrypt_block(key, ctr_reg, res);
+                for (uint32_t i = 0; i < 16; i++)
+                    res[i] ^= blk[i];
+                add_ctr(ctr_reg, 1);
+                break;
+            case AES_CBC_DECRYPT_MODE:
+                soft_aes_decrypt_block(key, blk, res);
+                for (uint32_t i = 0; i < 16; i++)
+                    res[i] ^= ctr_reg[i];
+                memcpy(ctr_reg, blk, 16);
+                break;
+            case AES_CBC_ENCRYPT_MODE:
+                for (uint32_t i = 0; i < 16; i++)
+                    blk[i] ^= ctr_reg[i];
+                soft_aes_encrypt_block(key, blk, res);
+                memcpy(ctr_reg, res, 16);
+                break;
+            case AES_ECB_DECRYPT_MODE:
+                soft_aes_decrypt_block(key, blk, res);
+                break;
+            case AES_ECB_ENCRYPT_MODE:
+                soft_aes_encrypt_block(key, blk, res);
+                break;
+            default:
+                HostFail("AES mode %08X not supported on host", mode);
+        }
+        if (reversed) Reverse16(out, res);
+        else memcpy(out, res, 16);
+    }
+}
+
+u64 HostAesBlocks(void)
+{
+    return n_blocks;
+}
+
+void ctr_decrypt(void* inbuf, void* outbuf, size_t size, uint32_t mode, uint8_t* ctr)
+{
+    set_ctr(ctr);
+    aes_decrypt(inbuf, outbuf, size, mode);
+    add_ctr(ctr, size);
+}
+
+void aes_cmac(void* inbuf, void* outbuf, size_t size)
+{
+    // same construction as decryptor/aes.c, on full blocks
+    uint8_t zeroes[16] = { 0 };
+    uint8_t xorpad[16] = { 0 };
+    uint32_t mode = AES_CNT_TITLEKEY_ENCRYPT_MODE;
+    uint8_t* out = outbuf;
+    uint8_t* in = inbuf;
+
+    set_ctr(zeroes);
+    aes_decrypt(xorpad, xorpad, 1, mode);
+    uint8_t finalxor = (xorpad[0] & 0x80) ? 0x87 : 0x00;
+    for (uint32_t i = 0; i < 15; i++)
+        xorpad[i] = (uint8_t) ((xorpad[i] << 1) | (xorpad[i+1] >> 7));
+    xorpad[15] = (uint8_t) ((xorpad[15] << 1) ^ finalxor);
+
+    memset(out, 0, 16);
+    while (size-- > 0) {
+        for (uint32_t i = 0; i < 16; i++)
+            out[i] ^= *(in++);
+        if (!size)
+            for (uint32_t i = 0; i < 16; i++)
+                out[i] ^= xorpad[i];
+        set_ctr(zeroes);
+        aes_decrypt(out, out, 1, mode);
+    }
+}
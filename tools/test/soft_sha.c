@@ -0,0 +1,139 @@
+// software replacement for the ARM9 SHA engine (decryptor/sha.c) in the host tests
+// like the hardware, there is only one context
+#include "decryptor/sha.h"
+
+static u32 sha_mode;
+static u32 state[8];
+static u8 block[64];
+static u32 block_len;
+static u64 total_len;
+
+#define ROR(x,n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROL(x,n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void Sha256Block(const u8* p)
+{
+    static const u32 k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    u32 w[64];
+    u32 s[8];
+    for (u32 i = 0; i < 16; i++)
+        w[i] = getbe32(p + i*4);
+    for (u32 i = 16; i < 64; i++) {
+        u32 s0 = ROR(w[i-15], 7) ^ ROR(w[i-15], 18) ^ (w[i-15] >> 3);
+        u32 s1 = ROR(w[i-2], 17) ^ ROR(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    memcpy(s, state, sizeof(s));
+    for (u32 i = 0; i < 64; i++) {
+        u32 t1 = s[7] + (ROR(s[4], 6) ^ ROR(s[4], 11) ^ ROR(s[4], 25)) + ((s[4] & s[5]) ^ (~s[4] & s[6])) + k[i] + w[i];
+        u32 t2 = (ROR(s[0], 2) ^ ROR(s[0], 13) ^ ROR(s[0], 22)) + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+        memmove(s + 1, s, 7 * sizeof(u32));
+        s[4] += t1;
+        s[0] = t1 + t2;
+    }
+    for (u32 i = 0; i < 8; i++)
+        state[i] += s[i];
+}
+
+static void Sha1Block(const u8* p)
+{
+    u32 w[80];
+    u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (u32 i = 0; i < 16; i++)
+        w[i] = getbe32(p + i*4);
+    for (u32 i = 16; i < 80; i++)
+        w[i] = ROL(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    for (u32 i = 0; i < 80; i++) {
+        u32 f, k;
+        if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+        else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+        else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+        u32 t = ROL(a, 5) + f + e + k + w[i];
+        e = d; d = c; c = ROL(b, 30); b = a; a = t;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+}
+
+static void ShaBlock(const u8* p)
+{
+    if (sha_mode == SHA1_MODE) Sha1Block(p);
+    else Sha256Block(p);
+}
+
+void sha_init(u32 mode)
+{
+    static const u32 iv256[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    static const u32 iv224[8] = { 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4 };
+    static const u32 iv1[8] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0, 0, 0, 0 };
+    sha_mode = mode & SHA_CNT_MODE;
+    memcpy(state, (sha_mode == SHA1_MODE) ? iv1 : (sha_mode == SHA224_MODE) ? iv224 : iv256, sizeof(state));
+    block_len = 0;
+    total_len = 0;
+}
+
+void sha_update(const void* src, u32 size)
+{
+    const u8* p = src;
+    total_len += size;
+    if (block_len) {
+        u32 fill = min(64 - block_len, size);
+        memcpy(block + block_len, p, fill);
+        block_len += fill;
+        p += fill;
+        size -= fill;
+        if (block_len < 64)
+            return;
+        ShaBlock(block);
+        block_len = 0;
+    }
+    for (; size >= 64; p += 64, size -= 64)
+        ShaBlock(p);
+    memcpy(block, p, size);
+    block_len = size;
+}
+
+void sha_get(void* res)
+{
+    u32 saved[8];
+    u8 pad[72] = { 0x80 };
+    u32 pad_len = ((block_len < 56) ? 56 : 120) - block_len;
+    u64 bits = total_len * 8;
+    u32 n_words = (sha_mode == SHA1_MODE) ? 5 : (sha_mode == SHA224_MODE) ? 7 : 8;
+
+    // the hash can be read at any time, keep the running state
+    memcpy(saved, state, sizeof(state));
+    u8 saved_block[64];
+    u32 saved_len = block_len;
+    u64 saved_total = total_len;
+    memcpy(saved_block, block, 64);
+    for (u32 i = 0; i < 8; i++)
+        pad[pad_len + i] = (u8) (bits >> (56 - i*8));
+    sha_update(pad, pad_len + 8);
+    for (u32 i = 0; i < n_words; i++) {
+        ((u8*) res)[i*4+0] = state[i] >> 24;
+        ((u8*) res)[i*4+1] = state[i] >> 16;
+        ((u8*) res)[i*4+2] = state[i] >> 8;
+        ((u8*) res)[i*4+3] = state[i] >> 0;
+    }
+    memcpy(state, saved, sizeof(state));
+    memcpy(block, saved_block, 64);
+    block_len = saved_len;
+    total_len = saved_total;
+}
+
+void sha_quick(void* res, const void* src, u32 size, u32 mode)
+{
+    sha_init(mode);
+    sha_update(src, size);
+    sha_get(res);
+}
@@ -0,0 +1,134 @@
+// NDS save chip model for the host tests, stands in for the SPI access in card_eeprom.c
+// EEPROMs mirror their contents past the end of the chip, FLASH programming only clears bits
+#include "gamecart/card_eeprom.h"
+#include "hosttest.h"
+
+static int chip_type = -1;
+static u32 chip_size = 0;
+static u32 chip_id = 0xFFFFFF;
+static u8* chip = NULL;
+static u32 stuck = 0xFFFFFFFF;
+static SpiModelStats stats;
+
+
+void SpiModelInsert(int type, u32 size, u32 jedec_id, u8* data)
+{
+    chip_type = type;
+    chip_size = size;
+    chip_id = (type == 3) ? jedec_id : 0xFFFFFF;
+    chip = data;
+    stuck = 0xFFFFFFFF;
+    SpiModelResetStats();
+}
+
+void SpiModelSetStuck(u32 address)
+{
+    stuck = address;
+}
+
+void SpiModelGetStats(SpiModelStats* out)
+{
+    *out = stats;
+}
+
+void SpiModelResetStats(void)
+{
+    memset(&stats, 0, sizeof(SpiModelStats));
+}
+
+static u32 SpiModelPage(void)
+{
+    return (chip_type == 1) ? 16 : (chip_type == 2) ? 32 : 256;
+}
+
+static void SpiModelCheckAddrType(u32 addrtype)
+{
+    // address bytes sent for each chip type, see cardEepromGetSize() callers
+    if ((chip_type < 1) || ((int) addrtype != chip_type))
+        HostFail("SPI access with address type %u on a type %d chip", addrtype, chip_type);
+}
+
+// card_eeprom.c
+u8 cardEepromCommand(u8 command)
+{
+    stats.n_commands++;
+    if (chip_type < 1)
+        return 0xFF;
+    if (command == SPI_EEPROM_RDSR)
+        return (chip_type == 1) ? 0xF0 : 0x00;
+    return 0xFF;
+}
+
+u32 cardEepromReadID()
+{
+    stats.n_commands++;
+    stats.n_rdid++;
+    return (chip_type < 1) ? 0xFFFFFF : chip_id;
+}
+
+int cardEepromGetType(void)
+{
+    int sr = cardEepromCommand(SPI_EEPROM_RDSR);
+    int id = cardEepromReadID();
+
+    if ((sr == 0xff && id == 0xffffff) || (sr == 0 && id == 0)) return -1;
+    if (sr == 0xf0 && id == 0xffffff) return 1;
+    if (sr == 0x00 && id == 0xffffff) return 2;
+    if (id != 0xffffff) return 3;
+
+    return 0;
+}
+
+void cardReadEeprom(u32 address, u8 *data, u32 length, u32 addrtype)
+{
+    SpiModelCheckAddrType(addrtype);
+    stats.n_commands++;
+    stats.n_read_bytes += length;
+    for (u32 i = 0; i < length; i++)
+        data[i] = chip[(address + i) % chip_size];
+}
+
+void cardWriteEeprom(u32 address, u8 *data, u32 length, u32 addrtype)
+{
+    // same command split as the real thing, a command wraps around inside its page
+    u32 maxblocks = (addrtype == 1) ? 16 : (addrtype == 3) ? 256 : 32;
+    u32 page = SpiModelPage();
+    SpiModelCheckAddrType(addrtype);
+    while (length > 0) {
+        u32 n = (length < maxblocks) ? length : maxblocks;
+        u32 page_start = address - (address % page);
+        stats.n_commands += 3; // WREN, program, RDSR
+        stats.n_programs++;
+        stats.n_program_bytes += n;
+        if ((address % page) + n > page)
+            stats.n_wraps++;
+        for (u32 i = 0; i < n; i++) {
+            u32 a = (page_start + ((address - page_start + i) % page)) % chip_size;
+            if (a == stuck)
+                continue;
+            chip[a] = (chip_type == 3) ? (chip[a] & data[i]) : data[i];
+        }
+        address += n;
+        data += n;
+        length -= n;
+    }
+}
+
+void cardEepromSectorErase(u32 address)
+{
+    if (chip_type != 3)
+        HostFail("sector erase on a type %d chip", chip_type);
+    stats.n_commands += 3; // WREN, erase, RDSR
+    stats.n_erases++;
+    address -= address % 0x10000;
+    for (u32 i = 0; i < 0x10000; i++) {
+        if (((address + i) % chip_size) != stuck)
+            chip[(address + i) % chip_size] = 0xFF;
+    }
+}
+
+void cardEepromChipErase(void)
+{
+    for (u32 sector = 0; sector < chip_size; sector += 0x10000)
+        cardEepromSectorErase(sector);
+}
@@ -0,0 +1,99 @@
+// AK2i flasher and dumper tests, against the NOR flash model
+#include "fs.h"
+#include "decryptor/ak2i.h"
+#include "hosttest.h"
+
+#define AK2I_PATCH_SIZE 0x20000
+
+static u8* InsertAk2i(u32 hw, u32 size)
+{
+    // NTR cart model for the cart ID, NOR flash with random contents
+    u8* cart = FixtureNtrCart(0x100000, 0x20000, false);
+    u8* nor = malloc(size);
+    CHECK(nor);
+    HostRandom(nor, size, 0xA2 + hw);
+    CartModelInsert(cart, 0x100000, 0);
+    Ak2iModelInsert(hw, nor, size);
+    return nor;
+}
+
+static void CheckAk2iStats(u32 n_erases, u32 n_writes)
+{
+    Ak2iModelStats stats;
+    Ak2iModelGetStats(&stats);
+    CHECK(stats.locked);
+    CHECK_EQ(stats.n_erases, n_erases);
+    CHECK_EQ(stats.n_writes, n_writes);
+}
+
+HOST_TEST(ak2i_inject)
+{
+    // only changed blocks are erased, blank pages are not programmed
+    u8* patch = malloc(AK2I_PATCH_SIZE);
+    CHECK(patch);
+    HostSdCreate(512);
+    u8* nor = InsertAk2i(0x81, 0x1000000);
+    memcpy(patch, nor, AK2I_PATCH_SIZE);
+    HostPut("/ak2i_patch.bin", patch, AK2I_PATCH_SIZE);
+    CHECK_EQ(InjectAk2iCart(0), 0);
+    CheckAk2iStats(0, 0);
+
+    patch[0x12345] ^= 0x10;
+    memset(patch + 0x18000, 0xFF, 0x1000); // 8 blank pages
+    HostPut("/ak2i_patch.bin", patch, AK2I_PATCH_SIZE);
+    Ak2iModelResetStats();
+    CHECK_EQ(InjectAk2iCart(0), 0);
+    CHECK(memcmp(nor, patch, AK2I_PATCH_SIZE) == 0);
+    CheckAk2iStats(1, (0x10000 - 0x1000) / 0x200);
+    // both blocks read once, the flashed one read back once more
+    Ak2iModelStats stats;
+    Ak2iModelGetStats(&stats);
+    CHECK_EQ(stats.n_read_bytes, AK2I_PATCH_SIZE + 0x10000);
+    free(nor);
+    free(patch);
+}
+
+HOST_TEST(ak2i_inject_verify)
+{
+    // a block that doesn't take the data stops the flasher, the flash is locked again
+    u8* patch = malloc(AK2I_PATCH_SIZE);
+    CHECK(patch);
+    HostSdCreate(512);
+    u8* nor = InsertAk2i(0x44, 0x200000);
+    HostRandom(patch, AK2I_PATCH_SIZE, 0xA2A2);
+    patch[0x4000] = nor[0x4000] ^ 0xFF;
+    HostPut("/ak2i_patch.bin", patch, AK2I_PATCH_SIZE);
+    Ak2iModelSetStuck(0x4000);
+    CHECK(InjectAk2iCart(0) != 0);
+    CheckAk2iStats(1, 0x10000 / 0x200);
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(log && strstr(log, "verify failed at 00000000"));
+    free(log);
+    free(nor);
+    free(patch);
+}
+
+HOST_TEST(ak2i_dump_restore)
+{
+    // full flash dump, then the original header goes back through the flasher
+    size_t size;
+    HostSdCreate(512);
+    u8* nor = InsertAk2i(0x44, 0x200000);
+    CHECK_EQ(DumpAk2iCart(0), 0);
+    u8* dump = HostGet("/ak2i_flash.bin", &size);
+    CHECK(dump && (size == 0x200000) && (memcmp(dump, nor, size) == 0));
+    CHECK(HostExists("/ak2i_rom_0x4000.bin"));
+    CheckAk2iStats(0, 0);
+
+    // header at 0x2000, block 0 only
+    CHECK_EQ(RestoreAk2iCart(0), 0);
+    CHECK(memcmp(nor + 0x10000, dump + 0x10000, size - 0x10000) == 0);
+    CHECK(memcmp(nor + 0x2000, dump + 0x2000, 0x1000) != 0);
+    CheckAk2iStats(1, 0x10000 / 0x200);
+    u8* patch = HostGet("/ak2i_patch.bin", &size);
+    CHECK(patch && (size == AK2I_PATCH_SIZE) && (memcmp(nor, patch, size) == 0));
+    free(patch);
+    free(dump);
+    free(nor);
+}
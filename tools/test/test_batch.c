@@ -0,0 +1,281 @@
+// tools/batch_decrypt against the firmware Content Decryptor, results have to be byte identical
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fs.h"
+#include "decryptor/aes.h"
+#include "decryptor/game.h"
+#include "decryptor/sha.h"
+#include "hosttest.h"
+
+#define BATCH_TID       0x0004000000BA7C00ULL
+#define BATCH_CIA_TID   0x0004000000BA7D00ULL
+#define BATCH_NCSD_SIZE (4 * 0x100000)
+#define BATCH_BOSS_SIZE 50001
+
+static u8 key_2c[16];
+static u8 key_3d[16];
+static u8 key_38[16];
+static u8 seed_hash[4];
+
+static const char* batch_names[] = { "standard.cxi", "seed.cxi", "cart.3ds", "title.cia", "data.boss" };
+#define N_BATCH_FILES (sizeof(batch_names) / sizeof(batch_names[0]))
+
+static void SetupKeys(void)
+{
+    u8 hash[32];
+    u8 data[16 + 8];
+    u8 seed[16];
+    u64 tid = BATCH_TID + 1;
+    SeedInfo* db = calloc(1, 16 + sizeof(SeedInfoEntry));
+    HostRandom(key_2c, 16, 0x2C);
+    HostRandom(key_3d, 16, 0x3D);
+    HostRandom(key_38, 16, 0x38);
+    HostRandom(seed, 16, 0x5EED);
+    setup_aeskeyX(0x2C, key_2c);
+    setup_aeskeyX(0x3D, key_3d);
+    setup_aeskey(0x38, key_38);
+
+    // seeddb.bin with the seed of the seed crypto CXI
+    CHECK(db);
+    db->n_entries = 1;
+    db->entries[0].titleId = tid;
+    memcpy(db->entries[0].external_seed, seed, 16);
+    HostPut("/seeddb.bin", db, 16 + sizeof(SeedInfoEntry));
+    free(db);
+    memcpy(data, seed, 16);
+    memcpy(data + 16, &tid, 8);
+    sha_quick(hash, data, 16 + 8, SHA256_MODE);
+    memcpy(seed_hash, hash, 4);
+}
+
+static u32 EncryptedCxi(u8* out, u32 size_romfs, u64 tid, u8 flag7, u16 version, u32 rnd)
+{
+    // NoCrypto CXI, encrypted by the firmware
+    u8 crypt[8] = { 0 };
+    u32 size = FixtureCxi(out, size_romfs, tid, rnd);
+    NcchHeader* ncch = (NcchHeader*) out;
+    ncch->version = version;
+    if (flag7 & 0x20)
+        memcpy(ncch->hash_seed, seed_hash, 4);
+    crypt[7] = flag7;
+    FixtureNcchEncrypt(out, size, crypt);
+    return size;
+}
+
+static u8* MakeNcsd(void)
+{
+    // two CXI partitions (version 2 / version 1 counters), random gaps
+    u8* ncsd = malloc(BATCH_NCSD_SIZE);
+    NcsdHeader* hdr = (NcsdHeader*) ncsd;
+    u32 offsets[2] = { 0x4000, 0x200000 };
+    CHECK(ncsd);
+    HostRandom(ncsd, BATCH_NCSD_SIZE, 0x3D5);
+    memset(ncsd + 0x100, 0, sizeof(NcsdHeader) - 0x100);
+    memcpy(hdr->magic, "NCSD", 4);
+    hdr->size = BATCH_NCSD_SIZE / 0x200;
+    hdr->mediaId = BATCH_TID + 2;
+    for (u32 p = 0; p < 2; p++) {
+        u32 size = EncryptedCxi(ncsd + offsets[p], 0x100000 + (p * 0x1000), BATCH_TID + 2, 0x00, 2 - p, 0x300 + p);
+        hdr->partitions[p].offset = offsets[p] / 0x200;
+        hdr->partitions[p].size = size / 0x200;
+    }
+    return ncsd;
+}
+
+static u8* MakeCia(u32* cia_size)
+{
+    // contents: NoCrypto NCCH, raw data, encrypted CXI
+    // the encrypted CXI comes last, so its offset depends on the sizes of the other contents
+    u32 sizes[3];
+    u8* contents = malloc(0x200000);
+    CHECK(contents);
+    sizes[0] = FixtureNcch(contents, 0x10000, BATCH_CIA_TID, "CTR-M-BTCH", 0x401);
+    sizes[1] = 0x4000;
+    HostRandom(contents + sizes[0], sizes[1], 0x402);
+    sizes[2] = EncryptedCxi(contents + sizes[0] + sizes[1], 0x80000, BATCH_CIA_TID, 0x00, 2, 0x400);
+    u8* cia = FixtureCia(contents, sizes, 3, BATCH_CIA_TID, cia_size);
+    free(contents);
+    return cia;
+}
+
+static u8* MakeBoss(void)
+{
+    u8* boss = malloc(BATCH_BOSS_SIZE);
+    u8 content_header[0x14] = { 0 };
+    u32 size_be = __builtin_bswap32(BATCH_BOSS_SIZE);
+    CHECK(boss);
+    HostRandom(boss, BATCH_BOSS_SIZE, 0xB055);
+    memcpy(boss, "boss\x00\x01\x00\x01", 8);
+    memcpy(boss + 8, &size_be, 4);
+    memcpy(content_header, boss + 0x28, 0x12);
+    sha_quick(boss + 0x3A, content_header, 0x14, SHA256_MODE);
+    HostPut("/tmp.boss", boss, BATCH_BOSS_SIZE);
+    CHECK_EQ(CryptBoss("/tmp.boss", true), 0);
+    free(boss);
+    boss = HostGet("/tmp.boss", NULL);
+    CHECK(boss);
+    FileDelete("/tmp.boss");
+    return boss;
+}
+
+static void WriteHostFile(const char* dir, const char* name, const void* data, size_t size)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* fp = fopen(path, "wb");
+    CHECK(fp && (fwrite(data, 1, size, fp) == size));
+    fclose(fp);
+}
+
+static u8* ReadHostFile(const char* path, size_t* size)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    u8* data = malloc(*size + 1);
+    CHECK(data && (fread(data, 1, *size, fp) == *size));
+    data[*size] = '\0';
+    fclose(fp);
+    return data;
+}
+
+static void SetupBatch(const char* name, char* in_dir, char* key_dir, char* out_dir)
+{
+    // encrypted inputs on the SD (for the firmware) and in in_dir, keys in key_dir
+    // host folders are named after the test, the temp folder is shared
+    u8* buffer = malloc(0x200000);
+    u32 size;
+    size_t fsize;
+    CHECK(buffer);
+    HostSdCreate(512);
+    SetupKeys();
+    snprintf(in_dir, 128, "%s.in", HostTempPath(name));
+    snprintf(key_dir, 128, "%s.keys", HostTempPath(name));
+    snprintf(out_dir, 128, "%s.out", HostTempPath(name));
+    CHECK((mkdir(in_dir, 0755) == 0) && (mkdir(key_dir, 0755) == 0));
+
+    size = EncryptedCxi(buffer, 0x123400, BATCH_TID, 0x00, 2, 0x100);
+    HostPut("/D9Game/standard.cxi", buffer, size);
+    size = EncryptedCxi(buffer, 0x20000, BATCH_TID + 1, 0x20, 1, 0x200);
+    HostPut("/D9Game/seed.cxi", buffer, size);
+    u8* ncsd = MakeNcsd();
+    HostPut("/D9Game/cart.3ds", ncsd, BATCH_NCSD_SIZE);
+    free(ncsd);
+    u8* cia = MakeCia(&size);
+    HostPut("/D9Game/title.cia", cia, size);
+    free(cia);
+    u8* boss = MakeBoss();
+    HostPut("/D9Game/data.boss", boss, BATCH_BOSS_SIZE);
+    free(boss);
+    free(buffer);
+
+    for (u32 i = 0; i < N_BATCH_FILES; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/D9Game/%s", batch_names[i]);
+        u8* data = HostGet(path, &fsize);
+        CHECK(data);
+        WriteHostFile(in_dir, batch_names[i], data, fsize);
+        free(data);
+    }
+    u8* db = HostGet("/seeddb.bin", &fsize);
+    CHECK(db);
+    WriteHostFile(key_dir, "seeddb.bin", db, fsize);
+    free(db);
+    WriteHostFile(key_dir, "slot0x2CKeyX.bin", key_2c, 16);
+    WriteHostFile(key_dir, "slot0x3DKeyX.bin", key_3d, 16);
+    WriteHostFile(key_dir, "slot0x38Key.bin", key_38, 16);
+}
+
+static int RunTool(const char* args, const char* log_path)
+{
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "%s/batch_decrypt %s > %s", HOST_TOOLS, args, log_path);
+    int status = system(cmd);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+HOST_TEST(batch_identity)
+{
+    char in_dir[128];
+    char key_dir[128];
+    char out_dir[128];
+    char args[512];
+    char log_path[2][128];
+    SetupBatch("identity", in_dir, key_dir, out_dir);
+
+    // firmware first, everything is decrypted in place on the SD
+    CHECK_EQ(CryptGameFiles(GC_NCCH_PROCESS|GC_CIA_PROCESS|GC_CIA_DEEP|GC_BOSS_PROCESS), 0);
+    LogWrite(NULL);
+    char* fw_log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(fw_log && strstr(fw_log, "5x processed / 0x failed"));
+    free(fw_log);
+
+    // the tool with all cores, then single threaded
+    for (u32 j = 0; j < 2; j++) {
+        snprintf(log_path[j], 128, "%s", HostTempPath((j) ? "identity.log1" : "identity.log"));
+        snprintf(args, sizeof(args), "-d -k %s -o %s %s %s", key_dir, out_dir, (j) ? "-j 1" : "-j 8", in_dir);
+        if (RunTool(args, log_path[j]) != 0) {
+            size_t size;
+            char* log = (char*) ReadHostFile(log_path[j], &size);
+            HostFail("batch_decrypt failed:\n%s", (log) ? log : "");
+        }
+        for (u32 i = 0; i < N_BATCH_FILES; i++) {
+            char path[256];
+            size_t size_fw, size_tool;
+            snprintf(path, sizeof(path), "/D9Game/%s", batch_names[i]);
+            u8* expected = HostGet(path, &size_fw);
+            snprintf(path, sizeof(path), "%s/%s", out_dir, batch_names[i]);
+            u8* data = ReadHostFile(path, &size_tool);
+            CHECK(expected && data);
+            CHECK_EQ(size_tool, size_fw);
+            for (u32 pos = 0; pos < size_fw; pos += 0x200)
+                if (memcmp(data + pos, expected + pos, min(0x200, size_fw - pos)) != 0)
+                    HostFail("%s differs from the firmware result at %08X", batch_names[i], pos);
+            free(expected);
+            free(data);
+        }
+    }
+
+    size_t size;
+    char* log = (char*) ReadHostFile(log_path[0], &size);
+    char* log1 = (char*) ReadHostFile(log_path[1], &size);
+    CHECK(log && log1 && (strcmp(log, log1) == 0));
+    CHECK(strstr(log, "5x processed / 0x failed") && strstr(log, "Seed ") && strstr(log, "Done!"));
+    free(log);
+    free(log1);
+}
+
+HOST_TEST(batch_failure)
+{
+    // a corrupt file fails without leaving output behind, the others are not affected
+    char in_dir[128];
+    char key_dir[128];
+    char out_dir[128];
+    char args[512];
+    char path[256];
+    size_t size;
+    SetupBatch("failure", in_dir, key_dir, out_dir);
+
+    snprintf(path, sizeof(path), "%s/standard.cxi", in_dir);
+    u8* cxi = ReadHostFile(path, &size);
+    CHECK(cxi);
+    NcchHeader* ncch = (NcchHeader*) cxi;
+    cxi[(ncch->offset_romfs * 0x200) + 0x10] ^= 0xFF;
+    WriteHostFile(in_dir, "standard.cxi", cxi, size);
+    free(cxi);
+
+    snprintf(args, sizeof(args), "-d -k %s -o %s %s", key_dir, out_dir, in_dir);
+    CHECK(RunTool(args, HostTempPath("failure.log")) != 0);
+    char* log = (char*) ReadHostFile(HostTempPath("failure.log"), &size);
+    CHECK(log && strstr(log, "Verify ExHdr/ExeFS/RomFS: OK/OK/Fail") && strstr(log, "4x processed / 1x failed"));
+    free(log);
+    snprintf(path, sizeof(path), "%s/standard.cxi", out_dir);
+    CHECK(access(path, F_OK) != 0);
+    snprintf(path, sizeof(path), "%s/data.boss", out_dir);
+    CHECK(access(path, F_OK) == 0);
+}
@@ -0,0 +1,229 @@
+// gamecart dumper tests, against the cart model
+#include "decryptor/aes.h"
+#include "decryptor/game.h"
+#include "decryptor/sha.h"
+#include "fs.h"
+#include "gamecart/protocol.h"
+#include "hosttest.h"
+
+#define CART_SIZE   (8 * 0x100000)
+
+static u8* ctr_cart = NULL;
+static u32 ctr_data_size = 0;
+
+static void InsertCtrCart(u32 flags)
+{
+    const u32 part_sizes[2] = { 0x2F1200, 0x54400 };
+    ctr_cart = FixtureCtrCart(CART_SIZE, part_sizes, 2, &ctr_data_size);
+    CartModelInsert(ctr_cart, CART_SIZE, flags);
+}
+
+static void CheckDump(const char* path, const u8* expected, u32 size)
+{
+    size_t dump_size;
+    u8* dump = HostGet(path, &dump_size);
+    if (!dump)
+        HostFail("%s not found", path);
+    CHECK_EQ(dump_size, size);
+    for (u32 i = 0; i < size; i += 0x200) {
+        if (memcmp(dump + i, expected + i, min(0x200, size - i)) != 0)
+            HostFail("%s differs at %08X", path, i);
+    }
+    free(dump);
+}
+
+static void CheckReadOnce(u32 start, u32 end)
+{
+    // the 4KB page check reads the first 8 sectors at 0x4000 twice more
+    const u8* read_map = CartModelReadMap();
+    for (u32 s = start / 0x200; s < end / 0x200; s++) {
+        u32 extra = ((s >= 0x20) && (s < 0x28)) ? 2 : 0;
+        if (read_map[s] != 1 + extra)
+            HostFail("sector %08X read %u times", s, read_map[s]);
+    }
+}
+
+static void CheckCommands(u32 n_reads, u32 n_large)
+{
+    CartModelStats stats;
+    CartModelGetStats(&stats);
+    printf("     %u cart commands, %u reads, model: %llums\n",
+        stats.n_commands, stats.n_reads, (unsigned long long) stats.model_us / 1000);
+    CHECK_EQ(stats.n_unguarded, 0);
+    CHECK_EQ(stats.n_reads, n_reads);
+    CHECK_EQ(stats.n_large, n_large);
+}
+
+HOST_TEST(cart_ctr_dump)
+{
+    HostSdCreate(512);
+    InsertCtrCart(0);
+    CHECK_EQ(DumpGameCart(0), 0);
+    CheckDump("/CTR-P-TEST_00.3ds", ctr_cart, CART_SIZE);
+    // NCSD header, page check (2), one read per 1MB chunk, in 4KB pages
+    CheckReadOnce(0x4000, CART_SIZE);
+    CheckCommands(3 + 8, 1 + 8);
+}
+
+HOST_TEST(cart_ctr_dump_small_pages)
+{
+    HostSdCreate(512);
+    InsertCtrCart(CART_MODEL_NO_LARGE_PAGES);
+    CHECK_EQ(DumpGameCart(0), 0);
+    CheckDump("/CTR-P-TEST_00.3ds", ctr_cart, CART_SIZE);
+    CheckReadOnce(0x4000, CART_SIZE);
+    CheckCommands(3 + 8, 1);
+}
+
+HOST_TEST(cart_ctr_dump_decrypted)
+{
+    // unencrypted partitions, the decrypted dump equals the image
+    // except for the gap between the partitions, which is not written
+    u8* expected = malloc(CART_SIZE);
+    HostSdCreate(512);
+    InsertCtrCart(0);
+    NcsdHeader* ncsd = (NcsdHeader*) ctr_cart;
+    memcpy(expected, ctr_cart, CART_SIZE);
+    u32 gap = (ncsd->partitions[0].offset + ncsd->partitions[0].size) * 0x200;
+    memset(expected + gap, 0x00, (ncsd->partitions[1].offset * 0x200) - gap);
+    CHECK_EQ(DumpGameCart(CD_DECRYPT), 0);
+    CheckDump("/CTR-P-TEST_00-dec.3ds", expected, CART_SIZE);
+    CheckReadOnce(0x4000, gap);
+    CheckReadOnce(ncsd->partitions[1].offset * 0x200, CART_SIZE);
+}
+
+HOST_TEST(cart_ctr_dump_trimmed)
+{
+    HostSdCreate(512);
+    InsertCtrCart(0);
+    CHECK_EQ(DumpGameCart(CD_TRIM), 0);
+    CheckDump("/CTR-P-TEST_00.3ds", ctr_cart, ctr_data_size);
+}
+
+static u8* InsertCtrCartCxi(u8* plain, bool seed)
+{
+    // partition 0: CXI (standard crypto), partition 1: CXI (seed crypto if seed), plain: decrypted image
+    u8 keyx[16];
+    u8 hash_seed[4];
+    u8* ncch = malloc(0x300000);
+    CHECK(ncch);
+    HostRandom(keyx, 16, 0x2C);
+    setup_aeskeyX(0x2C, keyx);
+    InsertCtrCart(0);
+    NcsdHeader* ncsd = (NcsdHeader*) ctr_cart;
+    for (u32 p = 0; p < 2; p++) {
+        u8 crypt[8] = { 0 };
+        u64 tid = 0x0004000000123400 | p;
+        u32 offset = ncsd->partitions[p].offset * 0x200;
+        u32 size = FixtureCxi(ncch, (p == 0) ? 0x180000 : 0x20000, tid, 0x1100 + p);
+        if (seed && (p == 1)) {
+            FixtureSeedDb(tid, hash_seed);
+            memcpy(((NcchHeader*) ncch)->hash_seed, hash_seed, 4);
+            crypt[7] = 0x20;
+        }
+        memcpy(plain + offset, ncch, size);
+        FixtureNcchEncrypt(ncch, size, crypt);
+        memcpy(ctr_cart + offset, ncch, size);
+        ncsd->partitions[p].size = size / 0x200;
+        if (p == 0)
+            memcpy(ctr_cart + 0x1000, ncch, 0x200);
+    }
+    // everything outside the partitions is the same, the NCCH headers only differ in the crypto flags
+    for (u32 i = 0; i < CART_SIZE; i += 0x200) {
+        u32 p = (i < ncsd->partitions[1].offset * 0x200) ? 0 : 1;
+        u32 start = ncsd->partitions[p].offset * 0x200;
+        if ((i < start) || (i >= start + ncsd->partitions[p].size * 0x200))
+            memcpy(plain + i, ctr_cart + i, 0x200);
+    }
+    memcpy(plain + 0x1000, plain + 0x4000, 0x200);
+    CartModelInsert(ctr_cart, CART_SIZE, 0);
+    free(ncch);
+    return plain;
+}
+
+static void CheckHashFile(const char* path)
+{
+    char hashname[64];
+    size_t size;
+    u8 shasum[32];
+    snprintf(hashname, 64, "%s.sha", path);
+    u8* data = HostGet(path, &size);
+    u8* hash = HostGet(hashname, NULL);
+    CHECK(data && hash);
+    sha_quick(shasum, data, size, SHA256_MODE);
+    if (memcmp(hash, shasum, 32) != 0)
+        HostFail("%s: wrong SHA256", hashname);
+    free(hash);
+    free(data);
+}
+
+static void CheckTeeDump(bool seed)
+{
+    // one read pass, outputs as read and decrypted, both with hash files
+    // (the CIA needs the retail certificate chain from SysNAND, there is none here)
+    u8* plain = malloc(CART_SIZE);
+    CHECK(plain);
+    HostSdCreate(512);
+    InsertCtrCartCxi(plain, seed);
+    CartModelResetStats();
+    CHECK_EQ(DumpGameCart(CD_TEE), 0);
+    CheckReadOnce(0x4000, CART_SIZE);
+    CheckDump("/CTR-P-BTCH_00.3ds", ctr_cart, CART_SIZE);
+    CheckDump("/CTR-P-BTCH_00-dec.3ds", plain, CART_SIZE);
+    CheckHashFile("/CTR-P-BTCH_00.3ds");
+    CheckHashFile("/CTR-P-BTCH_00-dec.3ds");
+    CHECK(!HostExists("/CTR-P-BTCH_00-dec.cia"));
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(log && strstr(log, "CIA output skipped") && strstr(log, "Verification success!"));
+    free(log);
+    free(plain);
+}
+
+HOST_TEST(cart_ctr_dump_tee)
+{
+    CheckTeeDump(false);
+}
+
+HOST_TEST(cart_ctr_dump_tee_seed)
+{
+    // seed crypto setup resets the SHA engine, the image is hashed from its file instead
+    CheckTeeDump(true);
+}
+
+HOST_TEST(cart_ntr_dump)
+{
+    HostSdCreate(512);
+    u8* cart = FixtureNtrCart(CART_SIZE, 0x4F1234, false);
+    CartModelInsert(cart, CART_SIZE, 0);
+    CHECK_EQ(DumpGameCart(0), 0);
+    CheckDump("/ATSE01_01.nds", cart, CART_SIZE);
+    // block check (8 + 1), then 0x1000 byte blocks for the whole cart
+    CheckCommands(9 + ((CART_SIZE - 0x8000) / 0x1000) + 8, 1 + ((CART_SIZE - 0x8000) / 0x1000) + 8);
+}
+
+HOST_TEST(cart_ntr_dump_small_blocks)
+{
+    HostSdCreate(512);
+    u8* cart = FixtureNtrCart(CART_SIZE, 0x4F1234, false);
+    CartModelInsert(cart, CART_SIZE, CART_MODEL_NO_LARGE_PAGES);
+    CHECK_EQ(DumpGameCart(0), 0);
+    CheckDump("/ATSE01_01.nds", cart, CART_SIZE);
+    CheckCommands(9 + ((CART_SIZE - 0x8000) / 0x200) + 64, 1);
+}
+
+HOST_TEST(cart_twl_dump_trimmed)
+{
+    HostSdCreate(512);
+    u8* cart = FixtureNtrCart(CART_SIZE, 0x4F1234, true);
+    CartModelInsert(cart, CART_SIZE, CART_MODEL_CHEAP);
+    CHECK_EQ(DumpGameCart(CD_TRIM), 0);
+    CheckDump("/ATSE01_01.nds", cart, 0x4F1234);
+}
+
+HOST_TEST(cart_not_inserted)
+{
+    HostSdCreate(512);
+    CartModelEject();
+    CHECK(DumpGameCart(0) != 0);
+}
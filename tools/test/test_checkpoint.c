@@ -0,0 +1,153 @@
+// checkpoint / resume tests, interrupted dumps are simulated by running out of SD writes
+#include "decryptor/checkpoint.h"
+#include "decryptor/game.h"
+#include "decryptor/sha.h"
+#include "fs.h"
+#include "hosttest.h"
+
+#define RESUME_CART_SIZE    (32 * 0x100000)
+// SD writes go cluster by cluster (4KB), this runs out a bit after the first checkpoint
+#define RESUME_SD_WRITES    (24 * 256)
+
+static u8* resume_cart = NULL;
+static u32 resume_param = 0;
+
+static void DumpCartChild(void* arg)
+{
+    u32 n_writes = *(u32*) arg;
+    HostSetPowerLoss(n_writes);
+    DumpGameCart(resume_param);
+}
+
+static void CheckFile(const char* path, const u8* expected, u32 size)
+{
+    size_t fsize;
+    u8* data = HostGet(path, &fsize);
+    if (!data)
+        HostFail("%s not found", path);
+    CHECK_EQ(fsize, size);
+    for (u32 i = 0; i < size; i += 0x200) {
+        if (memcmp(data + i, expected + i, min(0x200, size - i)) != 0)
+            HostFail("%s differs at %08X", path, i);
+    }
+    free(data);
+}
+
+static void CheckLogContains(const char* text)
+{
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(log && strstr(log, text));
+    free(log);
+}
+
+static u32 InterruptedCartDump(const char* path, u32 size, u32 n_writes)
+{
+    // first run is interrupted, the second one resumes, returns the first sector read again
+    CartModelResetStats();
+    CHECK_EQ(HostRun(DumpCartChild, &n_writes), HOST_EXIT_POWERLOSS);
+
+    char ckpname[64];
+    snprintf(ckpname, 64, "%s.ckp", path);
+    CHECK(HostExists(ckpname));
+    CheckpointInfo* info = (CheckpointInfo*) HostGet(ckpname, NULL);
+    CHECK(info && (memcmp(info->magic, "D9CK", 4) == 0) && (info->size == size));
+    CHECK((info->offset >= CKP_INTERVAL) && (info->offset < size));
+    u64 offset = info->offset;
+    free(info);
+
+    CartModelResetStats();
+    CHECK_EQ(DumpGameCart(resume_param), 0);
+    CheckLogContains("Resuming");
+    CHECK(!HostExists(ckpname));
+
+    // nothing before the checkpoint is read again (header area and NTR block check aside)
+    const u8* read_map = CartModelReadMap();
+    for (u32 s = 0x10000 / 0x200; s < offset / 0x200; s++) {
+        if (read_map[s])
+            HostFail("sector %08X read again on resume", s);
+    }
+    return offset;
+}
+
+HOST_TEST(checkpoint_records)
+{
+    u8 id_a[32], id_b[32];
+    u8* data = BUFFER_ADDRESS;
+    memset(id_a, 0xAA, 32);
+    memset(id_b, 0xBB, 32);
+    memset(data, 0x5A, BUFFER_MAX_SIZE);
+    HostSdCreate(512);
+
+    // fresh start, nothing written before the first interval
+    CHECK_EQ(CheckpointOpen("/out.bin", id_a, 3 * CKP_INTERVAL, 1), 0);
+    CHECK(FileCreate("/out.bin", true));
+    for (u32 i = 0; i < CKP_INTERVAL + BUFFER_MAX_SIZE; i += BUFFER_MAX_SIZE)
+        CHECK_EQ(FileWrite(data, BUFFER_MAX_SIZE, i), BUFFER_MAX_SIZE);
+    FileClose();
+    CHECK_EQ(CheckpointUpdate(CKP_INTERVAL - BUFFER_MAX_SIZE), 0);
+    CHECK(!HostExists("/out.bin.ckp"));
+    CHECK_EQ(CheckpointUpdate(CKP_INTERVAL), 0);
+    CHECK(HostExists("/out.bin.ckp"));
+    CHECK_EQ(CheckpointUpdate(CKP_INTERVAL + BUFFER_MAX_SIZE), 0);
+    CheckpointClose(false); // keeps the last offset
+
+    // same source / size / parameters resume, anything else starts over
+    CHECK_EQ(CheckpointOpen("/out.bin", id_a, 3 * CKP_INTERVAL, 1), CKP_INTERVAL + BUFFER_MAX_SIZE);
+    CheckpointClose(false);
+    CHECK_EQ(CheckpointOpen("/out.bin", id_b, 3 * CKP_INTERVAL, 1), 0);
+    CheckpointClose(false);
+    CHECK_EQ(CheckpointOpen("/out.bin", id_a, 2 * CKP_INTERVAL, 1), 0);
+    CheckpointClose(false);
+    CHECK_EQ(CheckpointOpen("/out.bin", id_a, 3 * CKP_INTERVAL, 2), 0);
+    CheckpointClose(false);
+
+    // output shorter than the checkpoint
+    CHECK(FileCreate("/out.bin", true));
+    CHECK_EQ(FileWrite(data, BUFFER_MAX_SIZE, 0), BUFFER_MAX_SIZE);
+    FileClose();
+    CHECK_EQ(CheckpointOpen("/out.bin", id_a, 3 * CKP_INTERVAL, 1), 0);
+    CheckpointClose(true);
+    CHECK(!HostExists("/out.bin.ckp"));
+}
+
+HOST_TEST(checkpoint_cart_ctr_resume)
+{
+    const u32 part_sizes[1] = { 28 * 0x100000 };
+    HostSdCreate(512);
+    resume_cart = FixtureCtrCart(RESUME_CART_SIZE, part_sizes, 1, NULL);
+    CartModelInsert(resume_cart, RESUME_CART_SIZE, 0);
+    u32 offset = InterruptedCartDump("/CTR-P-TEST_00.3ds", RESUME_CART_SIZE, RESUME_SD_WRITES);
+    CheckFile("/CTR-P-TEST_00.3ds", resume_cart, RESUME_CART_SIZE);
+    printf("     interrupted and resumed at %luMB\n", (unsigned long) offset / 0x100000);
+}
+
+HOST_TEST(checkpoint_cart_ntr_resume)
+{
+    HostSdCreate(512);
+    resume_cart = FixtureNtrCart(RESUME_CART_SIZE, 28 * 0x100000, false);
+    CartModelInsert(resume_cart, RESUME_CART_SIZE, 0);
+    u32 offset = InterruptedCartDump("/ATSE01_01.nds", RESUME_CART_SIZE, RESUME_SD_WRITES);
+    CheckFile("/ATSE01_01.nds", resume_cart, RESUME_CART_SIZE);
+    printf("     interrupted and resumed at %luMB\n", (unsigned long) offset / 0x100000);
+}
+
+HOST_TEST(checkpoint_cart_other_cart)
+{
+    // a different cart in the same slot must not resume
+    const u32 part_sizes[1] = { 28 * 0x100000 };
+    u32 n_writes = RESUME_SD_WRITES;
+    HostSdCreate(512);
+    resume_cart = FixtureCtrCart(RESUME_CART_SIZE, part_sizes, 1, NULL);
+    CartModelInsert(resume_cart, RESUME_CART_SIZE, 0);
+    CHECK_EQ(HostRun(DumpCartChild, &n_writes), HOST_EXIT_POWERLOSS);
+    CHECK(HostExists("/CTR-P-TEST_00.3ds.ckp"));
+
+    u8* other = malloc(RESUME_CART_SIZE);
+    memcpy(other, resume_cart, RESUME_CART_SIZE);
+    other[0x400] ^= 0xFF; // NCSD header area differs
+    CartModelInsert(other, RESUME_CART_SIZE, 0);
+    CHECK_EQ(DumpGameCart(0), 0);
+    CheckFile("/CTR-P-TEST_00.3ds", other, RESUME_CART_SIZE);
+    CHECK(CartModelReadMap()[0x8000 / 0x200] == 1);
+}
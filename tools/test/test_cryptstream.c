@@ -0,0 +1,169 @@
+// decrypted stream reads at random offsets, against the plain containers
+#include "fs.h"
+#include "decryptor/aes.h"
+#include "decryptor/cryptstream.h"
+#include "decryptor/game.h"
+#include "decryptor/nand.h"
+#include "hosttest.h"
+
+#define STREAM_TID  0x0004000000C75E00ULL
+
+static CryptStream stream;
+static u8 seed_hash[4];
+
+static void CheckReads(const u8* expected, u32 size, const u32* bounds, u32 n_bounds, u32 seed)
+{
+    // reads across all given boundaries, random reads, one large read through the cache bypass
+    u8* buf = malloc(0x10000);
+    u32 rnd[2];
+    CHECK(buf);
+    for (u32 i = 0; i < n_bounds; i++) {
+        for (u32 s = 1; s <= 0x1001; s += 0x200) {
+            u32 offset = (bounds[i] > s) ? bounds[i] - s : 0;
+            u32 len = min(s + 0x1F, size - offset);
+            memset(buf, 0x00, len);
+            CHECK_EQ(CryptStreamRead(&stream, buf, offset, len), 0);
+            if (memcmp(buf, expected + offset, len) != 0)
+                HostFail("boundary 0x%X, read 0x%X+0x%X mismatch", bounds[i], offset, len);
+        }
+    }
+    for (u32 i = 0; i < 256; i++) {
+        HostRandom(rnd, sizeof(rnd), seed + i);
+        u32 offset = rnd[0] % size;
+        u32 len = min(rnd[1] % 0x3000 + 1, size - offset);
+        CHECK_EQ(CryptStreamRead(&stream, buf, offset, len), 0);
+        if (memcmp(buf, expected + offset, len) != 0)
+            HostFail("random read 0x%X+0x%X mismatch", offset, len);
+    }
+    u32 len = min(0x10000, size - 0x1000);
+    CHECK_EQ(CryptStreamRead(&stream, buf, 0x1000, len), 0);
+    CHECK(memcmp(buf, expected + 0x1000, len) == 0);
+    // nothing outside the stream
+    CHECK(CryptStreamRead(&stream, buf, stream.size - 0x10, 0x11) != 0);
+    CHECK(CryptStreamRead(&stream, buf, stream.size + 1, 0) != 0);
+    free(buf);
+}
+
+static u32 NcchBounds(u32* bounds, const u8* plain)
+{
+    // region and ExeFS file boundaries of a FixtureCxi() NCCH
+    NcchHeader* ncch = (NcchHeader*) plain;
+    const u8* exefs = plain + (ncch->offset_exefs * 0x200);
+    u32 n = 0;
+    bounds[n++] = 0x200;
+    bounds[n++] = 0x200 + 0x400;
+    bounds[n++] = ncch->offset_exefs * 0x200;
+    for (u32 i = 0; i < 3; i++) {
+        u32 offset, size;
+        memcpy(&offset, exefs + (i*0x10) + 0x8, 4);
+        memcpy(&size, exefs + (i*0x10) + 0xC, 4);
+        bounds[n++] = (ncch->offset_exefs * 0x200) + 0x200 + offset;
+        bounds[n++] = (ncch->offset_exefs * 0x200) + 0x200 + offset + size;
+    }
+    bounds[n++] = ncch->offset_romfs * 0x200;
+    bounds[n++] = (ncch->offset_romfs + ncch->size_romfs) * 0x200;
+    return n;
+}
+
+HOST_TEST(cryptstream_ncch)
+{
+    // standard crypto (v2 and v1 counters), seed crypto (split ExeFS), fixed key
+    // (7x crypto can't be tested, slot 0x25 only takes the retail keyX)
+    const u8 flag7[4] = { 0x00, 0x00, 0x20, 0x01 };
+    const u16 version[4] = { 2, 1, 2, 2 };
+    u8 keyx[16];
+    u32 bounds[16];
+    u8* plain = malloc(0x100000);
+    u8* ncch = malloc(0x100000);
+    CHECK(plain && ncch);
+    HostSdCreate(512);
+    HostRandom(keyx, 16, 0x2C);
+    setup_aeskeyX(0x2C, keyx);
+    FixtureSeedDb(STREAM_TID + 2, seed_hash);
+
+    for (u32 t = 0; t < 4; t++) {
+        u8 crypt[8] = { 0 };
+        u32 size = FixtureCxi(plain, 0x40000 + (t * 0x1000), STREAM_TID + t, 0x500 + t);
+        ((NcchHeader*) plain)->version = version[t];
+        if (flag7[t] & 0x20)
+            memcpy(((NcchHeader*) plain)->hash_seed, seed_hash, 4);
+        memcpy(ncch, plain, size);
+        crypt[7] = flag7[t];
+        FixtureNcchEncrypt(ncch, size, crypt);
+        // the NCCH header is never encrypted, but the crypto flags differ
+        memcpy(plain, ncch, 0x200);
+
+        // at an unaligned offset inside the file
+        u8* file = calloc(1, size + 0x1200);
+        CHECK(file);
+        memcpy(file + 0x1200, ncch, size);
+        HostPut("/stream.bin", file, size + 0x1200);
+        free(file);
+        CHECK_EQ(CryptStreamOpenNcch(&stream, "/stream.bin", 0x1200, 0), 0);
+        CHECK_EQ(stream.size, size);
+        CHECK_EQ(stream.n_regions, (flag7[t] & 0x20) ? 6 : 3); // ExHdr, ExeFS, RomFS / .code split off
+        CheckReads(plain, size, bounds, NcchBounds(bounds, plain), 0x5000 + (t * 0x100));
+    }
+
+    // NoCrypto NCCHs are served as they are
+    u32 size = FixtureCxi(plain, 0x8000, STREAM_TID, 0x5FF);
+    HostPut("/stream.bin", plain, size);
+    CHECK_EQ(CryptStreamOpenNcch(&stream, "/stream.bin", 0, 0), 0);
+    CHECK_EQ(stream.n_regions, 0);
+    CheckReads(plain, size, bounds, NcchBounds(bounds, plain), 0x5F00);
+    free(plain);
+    free(ncch);
+}
+
+HOST_TEST(cryptstream_cia)
+{
+    // content 0: CXI (NCCH encrypted), content 1: raw data, both under the titlekey layer
+    u8 keyx[16];
+    u32 sizes[2];
+    u32 bounds[1] = { 0x2000 };
+    u32 cia_size;
+    u8* contents = malloc(0x80000);
+    CHECK(contents);
+    HostSdCreate(512);
+    HostRandom(keyx, 16, 0x2C);
+    setup_aeskeyX(0x2C, keyx);
+    HostRandom(keyx, 16, 0x3D);
+    setup_aeskeyX(0x3D, keyx);
+    u8 crypt[8] = { 0 };
+    sizes[0] = FixtureCxi(contents, 0x20000, STREAM_TID, 0x600);
+    FixtureNcchEncrypt(contents, sizes[0], crypt);
+    sizes[1] = 0x4010;
+    HostRandom(contents + sizes[0], sizes[1], 0x601);
+    u8* cia = FixtureCia(contents, sizes, 2, STREAM_TID, &cia_size);
+    HostPut("/stream.cia", cia, cia_size);
+    free(cia);
+
+    for (u32 i = 0, offset = 0; i < 2; offset += sizes[i++]) {
+        CHECK_EQ(CryptStreamOpenCia(&stream, "/stream.cia", i), 0);
+        CHECK_EQ(stream.size, sizes[i]);
+        CheckReads(contents + offset, sizes[i], bounds, 1, 0x6000 + (i * 0x100));
+    }
+    CHECK(CryptStreamOpenCia(&stream, "/stream.cia", 2) != 0);
+    free(contents);
+}
+
+HOST_TEST(cryptstream_nand)
+{
+    // CTRNAND against a full partition read, the partition starts with its MBR
+    const u32 size = 0x40000;
+    u8* plain = malloc(size);
+    CHECK(plain);
+    FixtureNand(NULL, 0);
+    HostSdCreate(512);
+    CHECK_EQ(SetNand(false, false), 0);
+    PartitionInfo* ctrnand = GetPartitionInfo(P_CTRNAND);
+    CHECK(ctrnand);
+    CHECK_EQ(DecryptNandToMem(plain, ctrnand->offset, size, ctrnand), 0);
+    CHECK((plain[0x1FE] == 0x55) && (plain[0x1FF] == 0xAA));
+
+    CHECK_EQ(CryptStreamOpenNand(&stream, P_CTRNAND), 0);
+    CHECK_EQ(stream.size, ctrnand->size);
+    u32 bounds[2] = { 0x200, 0x1000 };
+    CheckReads(plain, size, bounds, 2, 0x7000);
+    free(plain);
+}
@@ -0,0 +1,110 @@
+// debug console tests, the line by line updates against a full redraw of the console
+#include <time.h>
+
+#include "draw.h"
+#include "hosttest.h"
+
+#define SCREEN_SIZE_TOP (SCREEN_WIDTH_TOP * SCREEN_HEIGHT * BYTES_PER_PIXEL)
+
+static u8* screen_drawn = NULL;
+
+static void CheckConsole(u32 step, const char* op)
+{
+    // what the last call drew has to be what DebugSet(NULL) (the old behaviour) draws for the same lines
+    memcpy(screen_drawn, TOP_SCREEN, SCREEN_SIZE_TOP);
+    DebugSet(NULL);
+    for (u32 i = 0; i < SCREEN_SIZE_TOP; i++) {
+        if (screen_drawn[i] != TOP_SCREEN[i]) {
+            u32 x = i / (SCREEN_HEIGHT * BYTES_PER_PIXEL);
+            u32 y = SCREEN_HEIGHT - 1 - ((i / BYTES_PER_PIXEL) % SCREEN_HEIGHT);
+            HostFail("step %u (%s): pixel %u/%u differs from a full redraw", step, op, x, y);
+        }
+    }
+}
+
+static void RandomLine(char* str, u32 size, u32 rnd)
+{
+    // words of random length, a few lines past the line end (cut inside a word) or with a line break inside
+    u8 r[128];
+    u32 len = 0;
+    HostRandom(r, sizeof(r), rnd);
+    u32 max_len = (r[0] < 12) ? size - 1 : r[1] % 56;
+    for (u32 i = 3; (len < max_len) && (i < sizeof(r)); i++) {
+        char c = 'a' + (r[i] % 26);
+        if ((r[i] % 7) == 0)
+            c = ' ';
+        else if ((r[i] % 13) == 0)
+            c = '0' + (r[i] % 10);
+        str[len++] = c;
+    }
+    str[len] = '\0';
+    if ((r[0] >= 12) && (r[0] < 20) && len)
+        str[r[2] % len] = '\n';
+}
+
+HOST_TEST(draw_console_lines)
+{
+    // random Debug() / '\r' / ShowProgress() / DebugSet() / DebugClear() sequences
+    static const u32 colors[4] = { DBG_COLOR_FONT, COLOR_RED, COLOR_GREEN, COLOR_ASK };
+    const char* set_strs[DBG_N_CHARS_Y];
+    char set_lines[DBG_N_CHARS_Y][64];
+    char line[120];
+    u8 op[1500];
+    screen_drawn = malloc(SCREEN_SIZE_TOP);
+    CHECK(screen_drawn);
+    HostSdCreate(512);
+    HostRandom(op, sizeof(op), 0xD4A3);
+
+    DebugClear();
+    for (u32 step = 0; step < sizeof(op); step++) {
+        u32 rnd = 0xC0 + step;
+        if (op[step] < 150) {
+            RandomLine(line, sizeof(line), rnd);
+            DebugColor(colors[op[step] % 4], "%s", line);
+            CheckConsole(step, "Debug");
+        } else if (op[step] < 210) {
+            RandomLine(line, sizeof(line), rnd);
+            Debug("\r%s", line);
+            CheckConsole(step, "overwrite");
+        } else if (op[step] < 240) {
+            // drawn over the last row, only checked with the next line
+            ShowProgress(step % 100, (op[step] & 1) ? 100 : 0);
+        } else if (op[step] < 250) {
+            for (u32 y = 0; y < DBG_N_CHARS_Y; y++) {
+                RandomLine(set_lines[y], sizeof(set_lines[y]), rnd + (y << 16));
+                set_strs[y] = set_lines[y];
+            }
+            DebugSet(set_strs);
+            CheckConsole(step, "DebugSet");
+        } else {
+            DebugClear();
+        }
+    }
+    free(screen_drawn);
+}
+
+HOST_TEST(draw_console_scroll)
+{
+    // a full console of plain lines, one new line each: scrolled, not redrawn
+    const u32 n_lines = 2000;
+    struct timespec t0, t1, t2;
+    screen_drawn = malloc(SCREEN_SIZE_TOP);
+    CHECK(screen_drawn);
+    HostSdCreate(512);
+
+    DebugClear();
+    for (u32 i = 0; i < DBG_N_CHARS_Y; i++)
+        Debug("line %u", i);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (u32 i = 0; i < n_lines; i++)
+        Debug("Decrypting %08X... %u%%", i * 0x200, i % 100);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    CheckConsole(n_lines, "Debug");
+    for (u32 i = 0; i < n_lines; i++)
+        DebugSet(NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    printf("     %u lines: %ldus, full redraws: %ldus\n", n_lines,
+        ((t1.tv_sec - t0.tv_sec) * 1000000) + ((t1.tv_nsec - t0.tv_nsec) / 1000),
+        ((t2.tv_sec - t1.tv_sec) * 1000000) + ((t2.tv_nsec - t1.tv_nsec) / 1000));
+    free(screen_drawn);
+}
@@ -0,0 +1,363 @@
+// tools/ncchinfo_gen, sdinfo_gen and seeddb_gen against the outputs of the scripts they replace
+// golden/ holds what ncchinfo_gen.py, ncchinfo_gen_exh.py, sdinfo_gen.py and seeddb_gen.py wrote for
+// the fixtures below, any change to the fixtures needs new golden files
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "decryptor/game.h"
+#include "decryptor/xorpad.h"
+#include "hosttest.h"
+
+#define GOLDEN(name)    HOST_TOOLS "/test/golden/" name
+
+#define INFO_TID        0x0004000000C0DE00ULL
+#define INFO_NCSD_SIZE  (64 * 0x100000)
+
+static void WriteSparse(const char* path, const void* data, u32 size, u64 offset, u64 file_size)
+{
+    // data at offset, holes up to file_size
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0);
+    CHECK(!size || (pwrite(fd, data, size, offset) == (ssize_t) size));
+    CHECK(ftruncate(fd, file_size) == 0);
+    close(fd);
+}
+
+static void MakeDirs(const char* path)
+{
+    // all parent folders of path
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char* slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        CHECK((mkdir(dir, 0755) == 0) || (errno == EEXIST));
+        *slash = '/';
+    }
+}
+
+static u8* ReadHostFile(const char* path, size_t* size)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        HostFail("%s not found", path);
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    u8* data = malloc(*size + 1);
+    CHECK(data && (fread(data, 1, *size, fp) == *size));
+    data[*size] = '\0';
+    fclose(fp);
+    return data;
+}
+
+static void CheckGolden(const char* path, const char* golden)
+{
+    size_t size, size_golden;
+    u8* data = ReadHostFile(path, &size);
+    u8* expected = ReadHostFile(golden, &size_golden);
+    CHECK_EQ(size, size_golden);
+    for (u32 i = 0; i < size; i++) {
+        if (data[i] != expected[i])
+            HostFail("%s differs from %s at %08X", path, golden, i);
+    }
+    free(data);
+    free(expected);
+}
+
+static int RunTool(const char* tool, const char* args, const char* log_path)
+{
+    char cmd[2048];
+    snprintf(cmd, sizeof(cmd), "%s/%s %s > %s", HOST_TOOLS, tool, args, log_path);
+    int status = system(cmd);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void MakeNcchHeader(u8* out, u64 tid, u16 version, u8 flag3, u8 flag7, bool exthdr, u32 size_exefs, u32 size_romfs)
+{
+    // header only, sizes in media units, ExeFS right behind the ExHeader, RomFS behind the ExeFS
+    NcchHeader* ncch = (NcchHeader*) out;
+    memset(out, 0x00, 0x200);
+    HostRandom(ncch->signature, 0x100, (u32) tid ^ version);
+    memcpy(ncch->magic, "NCCH", 4);
+    ncch->partitionId = tid;
+    ncch->programId = tid | 0x100;
+    ncch->version = version;
+    snprintf(ncch->productcode, 0x10, "CTR-P-%04X", (u32) (tid >> 8) & 0xFFFF);
+    ncch->size_exthdr = (exthdr) ? 0x400 : 0;
+    ncch->flags[3] = flag3;
+    ncch->flags[7] = flag7;
+    ncch->offset_exefs = (exthdr) ? 5 : 1;
+    ncch->size_exefs = size_exefs;
+    ncch->offset_romfs = (size_romfs) ? ncch->offset_exefs + size_exefs + 0x1F : 0;
+    ncch->size_romfs = size_romfs;
+    ncch->size = ncch->offset_romfs + size_romfs + 1;
+}
+
+static void MakeNcchFiles(const char* dir, char* args)
+{
+    // standalone NCCHs for all counter versions and crypto flags, a CCI, files that are neither
+    // args gets the files in sorted order, that is what the folder scan has to come up with
+    static const struct {
+        const char* name;
+        u16 version;
+        u8 flag3;
+        u8 flag7;
+        bool exthdr;
+        u32 size_exefs;
+        u32 size_romfs;
+    } ncchs[] = {
+        { "a_v2.cxi",       0x0002, 0x00, 0x00, true,  0x40,   0x9123 },   // 18MB RomFS
+        { "b_v1_fixed.cxi", 0x0001, 0x00, 0x01, true,  0x21,   0x800  },   // RomFS exactly 1MB
+        { "c_v0_7x.cxi",    0x0100, 0x0A, 0x00, true,  0x3,    0x7    },   // high version byte is ignored
+        { "d_seed.cxi",     0x0002, 0x00, 0x20, false, 0x10,   0x1000 },
+        { "e_v1_7x.cxi",    0x0001, 0x01, 0x01, true,  0x12,   0x0    },   // 7x with the fixed key
+        { "f_v3.cfa",       0x0003, 0x00, 0x04, false, 0x0,    0x234  },   // unknown version, no crypto flag
+        { "g_flags.cfa",    0x0002, 0x00, 0x22, false, 0x8,    0x1    },   // unknown flag
+    };
+    u8 header[0x200] __attribute__((aligned(16)));
+    char path[256];
+
+    CHECK(mkdir(dir, 0755) == 0);
+    args[0] = '\0';
+    for (u32 i = 0; i < sizeof(ncchs) / sizeof(ncchs[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, ncchs[i].name);
+        MakeNcchHeader(header, INFO_TID + (i << 8), ncchs[i].version, ncchs[i].flag3, ncchs[i].flag7,
+            ncchs[i].exthdr, ncchs[i].size_exefs, ncchs[i].size_romfs);
+        WriteSparse(path, header, 0x200, 0, ((NcchHeader*) header)->size * 0x200);
+        sprintf(args + strlen(args), " %s", path);
+    }
+
+    // CCI: game, manual and an update partition, the ExHeader-less one behind the end of the file
+    NcsdHeader ncsd;
+    const u32 part_idx[4] = { 0, 1, 7, 2 };
+    const u32 part_offset[4] = { 0x4000, 0x800000, 0x1000000, INFO_NCSD_SIZE };
+    snprintf(path, sizeof(path), "%s/h_cart.3ds", dir);
+    memset(&ncsd, 0x00, sizeof(NcsdHeader));
+    HostRandom(ncsd.signature, 0x100, 0x3D5);
+    memcpy(ncsd.magic, "NCSD", 4);
+    ncsd.size = INFO_NCSD_SIZE / 0x200;
+    ncsd.mediaId = INFO_TID + 0xF000;
+    for (u32 p = 0; p < 4; p++) {
+        ncsd.partitions[part_idx[p]].offset = part_offset[p] / 0x200;
+        ncsd.partitions[part_idx[p]].size = 0x100;
+    }
+    WriteSparse(path, &ncsd, sizeof(NcsdHeader), 0, INFO_NCSD_SIZE);
+    int fd = open(path, O_WRONLY);
+    CHECK(fd >= 0);
+    for (u32 p = 0; p < 3; p++) {
+        MakeNcchHeader(header, INFO_TID + 0xF000 + (part_idx[p] << 16), 2 - (p % 2), 0x00, 0x00, (p != 2), 0x20 + p, 0x1000 * p);
+        CHECK(pwrite(fd, header, 0x200, part_offset[p]) == 0x200);
+    }
+    close(fd);
+    sprintf(args + strlen(args), " %s", path);
+
+    // no NCCH / NCSD magic, too small for a header
+    HostRandom(header, 0x200, 0xBAD);
+    snprintf(path, sizeof(path), "%s/i_random.bin", dir);
+    WriteSparse(path, header, 0x200, 0, 0x200);
+    sprintf(args + strlen(args), " %s", path);
+    snprintf(path, sizeof(path), "%s/j_tiny.bin", dir);
+    WriteSparse(path, "NCCH", 4, 0x100, 0x102);
+    sprintf(args + strlen(args), " %s", path);
+}
+
+HOST_TEST(infogen_ncchinfo)
+{
+    // explicit file list on one thread, the folder on eight, ExHeader only
+    char dir[128];
+    char args[2048];
+    char cmd[2560];
+    snprintf(dir, sizeof(dir), "%s", HostTempPath("ncchinfo.in"));
+    MakeNcchFiles(dir, args);
+
+    snprintf(cmd, sizeof(cmd), "-j 1 -o %s %s", HostTempPath("ncchinfo1.bin"), args);
+    CHECK_EQ(RunTool("ncchinfo_gen", cmd, HostTempPath("ncchinfo.log")), 0);
+    CheckGolden(HostTempPath("ncchinfo1.bin"), GOLDEN("ncchinfo.bin"));
+    snprintf(cmd, sizeof(cmd), "-j 8 -o %s %s", HostTempPath("ncchinfo8.bin"), dir);
+    CHECK_EQ(RunTool("ncchinfo_gen", cmd, HostTempPath("ncchinfo.log")), 0);
+    CheckGolden(HostTempPath("ncchinfo8.bin"), GOLDEN("ncchinfo.bin"));
+    snprintf(cmd, sizeof(cmd), "-e -j 8 -o %s %s", HostTempPath("ncchinfo_exh.bin"), args);
+    CHECK_EQ(RunTool("ncchinfo_gen", cmd, HostTempPath("ncchinfo.log")), 0);
+    CheckGolden(HostTempPath("ncchinfo_exh.bin"), GOLDEN("ncchinfo_exh.bin"));
+
+    // partition logs come in input order
+    size_t size;
+    char* log = (char*) ReadHostFile(HostTempPath("ncchinfo.log"), &size);
+    char* part_main = strstr(log, "Main: CTR-P-");
+    char* part_update = strstr(log, "UpdateO3DS: CTR-P-");
+    CHECK(strstr(log, "a_v2.cxi") < strstr(log, "h_cart.3ds"));
+    CHECK(part_main && part_update && (part_main < part_update));
+    CHECK(strstr(log, "DownloadPlay: not a NCCH, skipped"));
+    free(log);
+
+    // nothing to do is an error, no output
+    snprintf(cmd, sizeof(cmd), "-o %s %s/i_random.bin", HostTempPath("ncchinfo_none.bin"), dir);
+    CHECK(RunTool("ncchinfo_gen", cmd, HostTempPath("ncchinfo.log")) != 0);
+    CHECK(access(HostTempPath("ncchinfo_none.bin"), F_OK) != 0);
+}
+
+static void MakeSdTree(const char* dir)
+{
+    // SD "Nintendo 3DS/<ID0>/<ID1>" folder, sparse files, quota files and folders the script doesn't look at
+    static const struct {
+        const char* path;
+        u64 size;
+    } files[] = {
+        { "/dbs/title.db",                                              0x31E400 },
+        { "/dbs/import.db",                                             0x31E400 },
+        { "/dbs/ticket.db",                                             0 },
+        { "/extdata/00000000/00000082/Quota.dat",                       0x200 },
+        { "/extdata/00000000/00000082/00000000/00000001",               0x100000 },
+        { "/extdata/00000000/00000082/00000000/00000002",               0x100001 },
+        { "/extdata/00000000/00000082/00000001/00000001",               1 },
+        { "/extdata/00000000/0000008f/quota.dat.bak",                   0x200 },
+        { "/extdata/00000000/0000008f/00000000/00000003",               0x7FF },
+        { "/title/00040000/00c0de00/content/00000000.tmd",              0xB34 },
+        { "/title/00040000/00c0de00/content/00000000.app",              0x4500000 },
+        { "/title/00040000/00c0de00/content/cmd/00000001.cmd",          0x40 },
+        { "/title/00040000/00c0de00/data/00000001.sav",                 0x80000 },
+        { "/title/0004008c/00c0de00/content/00000001/00000004.app",     0x12345 },
+        { "/title/0004000e/00c0de00/content/00000010.app",              0x2000000 },
+        { "/backups/00040000/00c0de00.bak",                             0x1000 },
+        { "/private/movable.sed",                                       0x140 },
+    };
+    char path[256];
+    for (u32 i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", dir, files[i].path);
+        MakeDirs(path);
+        WriteSparse(path, NULL, 0, 0, files[i].size);
+    }
+}
+
+static int CompareSdEntries(const void* a, const void* b)
+{
+    return strncmp(((const SdInfoEntry*) a)->filename, ((const SdInfoEntry*) b)->filename, 180);
+}
+
+static void CheckSdInfo(const char* path)
+{
+    // directory order depends on the file system, entries are compared sorted by name
+    size_t size, size_golden;
+    u8* data = ReadHostFile(path, &size);
+    u8* expected = ReadHostFile(GOLDEN("SDinfo.bin"), &size_golden);
+    CHECK_EQ(size, size_golden);
+    CHECK(memcmp(data, expected, 4) == 0);
+    u32 n_entries = getle32(data);
+    SdInfoEntry* entries = (SdInfoEntry*) (data + 4);
+    CHECK_EQ(size, 4 + (n_entries * sizeof(SdInfoEntry)));
+
+    // dbs, extdata, title, files of a folder before its subfolders
+    const char* folders[3] = { "/dbs.", "/extdata.", "/title." };
+    u32 f = 0;
+    u32 idx_app = n_entries, idx_cmd = n_entries;
+    for (u32 i = 0; i < n_entries; i++) {
+        while ((f < 3) && (strncmp(entries[i].filename, folders[f], strlen(folders[f])) != 0))
+            f++;
+        CHECK(f < 3);
+        CHECK(!strstr(entries[i].filename, "uota.dat"));
+        if (strcmp(entries[i].filename, "/title.00040000.00c0de00.content.00000000.app.xorpad") == 0)
+            idx_app = i;
+        if (strcmp(entries[i].filename, "/title.00040000.00c0de00.content.cmd.00000001.cmd.xorpad") == 0)
+            idx_cmd = i;
+    }
+    CHECK(idx_app < idx_cmd);
+    CHECK(idx_cmd < n_entries);
+
+    qsort(entries, n_entries, sizeof(SdInfoEntry), CompareSdEntries);
+    qsort(expected + 4, n_entries, sizeof(SdInfoEntry), CompareSdEntries);
+    for (u32 i = 0; i < n_entries; i++) {
+        if (memcmp(entries + i, expected + 4 + (i * sizeof(SdInfoEntry)), sizeof(SdInfoEntry)) != 0)
+            HostFail("%s: %.180s differs from the golden entry", path, entries[i].filename);
+    }
+    free(data);
+    free(expected);
+}
+
+HOST_TEST(infogen_sdinfo)
+{
+    char dir[128];
+    char cmd[512];
+    snprintf(dir, sizeof(dir), "%s/", HostTempPath("sdinfo.in"));
+    MakeSdTree(dir);
+
+    snprintf(cmd, sizeof(cmd), "-j 1 -o %s %s", HostTempPath("sdinfo1.bin"), dir);
+    CHECK_EQ(RunTool("sdinfo_gen", cmd, HostTempPath("sdinfo.log")), 0);
+    CheckSdInfo(HostTempPath("sdinfo1.bin"));
+    snprintf(cmd, sizeof(cmd), "-j 8 -o %s %s", HostTempPath("sdinfo8.bin"), dir);
+    CHECK_EQ(RunTool("sdinfo_gen", cmd, HostTempPath("sdinfo.log")), 0);
+    CheckSdInfo(HostTempPath("sdinfo8.bin"));
+
+    // a folder without dbs / extdata / title
+    snprintf(cmd, sizeof(cmd), "-o %s %sprivate", HostTempPath("sdinfo_none.bin"), dir);
+    CHECK(RunTool("sdinfo_gen", cmd, HostTempPath("sdinfo.log")) != 0);
+    CHECK(access(HostTempPath("sdinfo_none.bin"), F_OK) != 0);
+}
+
+static void PutSeedDb(u8* data, u32 sb, u32 block, const u64* tids, u32 n_titles, u32 seed)
+{
+    // SEEDDB at sb, title count and tables where seeddb_gen.py looks for them
+    u32 tid_offset = (block * 4096) + sb - 52;
+    memcpy(data + sb, "SEEDDB", 6);
+    memcpy(data + sb + 24, &block, 4);
+    memcpy(data + tid_offset - 4092, &n_titles, 4);
+    for (u32 i = 0; i < n_titles; i++) {
+        memcpy(data + tid_offset + (i * 8), tids + i, 8);
+        HostRandom(data + tid_offset + 16000 + (i * 16), 16, seed + i);
+    }
+}
+
+static void MakeSeedsaves(const char* dir, char* args)
+{
+    // two SEEDDBs in the first file, one in the second, none in the third
+    // duplicate title IDs: within one SEEDDB, across SEEDDBs of one file, across files
+    const u64 tids0[5] = { INFO_TID + 1, INFO_TID + 2, INFO_TID + 1, INFO_TID + 3, 0x000400000F700000ULL };
+    const u64 tids1[3] = { INFO_TID + 4, INFO_TID + 2, INFO_TID + 5 };
+    const u64 tids2[2] = { INFO_TID + 3, INFO_TID + 6 };
+    u8* data = calloc(1, 0x20000);
+    char path[256];
+    CHECK(data);
+    CHECK(mkdir(dir, 0755) == 0);
+    args[0] = '\0';
+
+    PutSeedDb(data, 0x1034, 1, tids0, 5, 0x5EED00);
+    PutSeedDb(data, 0x8034, 2, tids1, 3, 0x5EED10);
+    snprintf(path, sizeof(path), "%s/00000000", dir);
+    WriteSparse(path, data, 0x20000, 0, 0x20000);
+    sprintf(args + strlen(args), " %s", path);
+
+    memset(data, 0x00, 0x20000);
+    PutSeedDb(data, 0x3234, 3, tids2, 2, 0x5EED20);
+    snprintf(path, sizeof(path), "%s/00000001", dir);
+    WriteSparse(path, data, 0x10000, 0, 0x10000);
+    sprintf(args + strlen(args), " %s", path);
+
+    memset(data, 0x00, 0x20000);
+    snprintf(path, sizeof(path), "%s/00000002", dir);
+    WriteSparse(path, data, 0x1000, 0, 0x1000);
+    sprintf(args + strlen(args), " %s", path);
+    free(data);
+}
+
+HOST_TEST(infogen_seeddb)
+{
+    char dir[128];
+    char args[1024];
+    char cmd[1536];
+    snprintf(dir, sizeof(dir), "%s", HostTempPath("seeddb.in"));
+    MakeSeedsaves(dir, args);
+
+    snprintf(cmd, sizeof(cmd), "-j 1 -o %s %s", HostTempPath("seeddb1.bin"), args);
+    CHECK_EQ(RunTool("seeddb_gen", cmd, HostTempPath("seeddb.log")), 0);
+    CheckGolden(HostTempPath("seeddb1.bin"), GOLDEN("seeddb.bin"));
+    snprintf(cmd, sizeof(cmd), "-j 8 -o %s %s", HostTempPath("seeddb8.bin"), args);
+    CHECK_EQ(RunTool("seeddb_gen", cmd, HostTempPath("seeddb.log")), 0);
+    CheckGolden(HostTempPath("seeddb8.bin"), GOLDEN("seeddb.bin"));
+
+    // no SEEDDB at all, no output
+    snprintf(cmd, sizeof(cmd), "-o %s %s/00000002", HostTempPath("seeddb_none.bin"), dir);
+    CHECK(RunTool("seeddb_gen", cmd, HostTempPath("seeddb.log")) != 0);
+    CHECK(access(HostTempPath("seeddb_none.bin"), F_OK) != 0);
+}
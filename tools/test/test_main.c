@@ -0,0 +1,62 @@
+// host test runner, every test runs in its own process
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "hosttest.h"
+
+#define MAX_TESTS 64
+
+static struct {
+    const char* name;
+    HostTestFn fn;
+} tests[MAX_TESTS];
+static u32 n_tests = 0;
+
+void HostRegisterTest(const char* name, HostTestFn fn)
+{
+    if (n_tests >= MAX_TESTS) {
+        fprintf(stderr, "too many tests\n");
+        exit(1);
+    }
+    tests[n_tests].name = name;
+    tests[n_tests].fn = fn;
+    n_tests++;
+}
+
+int main(int argc, char** argv)
+{
+    u32 n_run = 0;
+    u32 n_failed = 0;
+
+    HostInit();
+    for (u32 t = 0; t < n_tests; t++) {
+        // optional arguments select tests by name prefix
+        bool selected = (argc < 2);
+        for (int a = 1; a < argc; a++)
+            selected |= (strncmp(tests[t].name, argv[a], strlen(argv[a])) == 0);
+        if (!selected)
+            continue;
+
+        int status;
+        fflush(NULL);
+        pid_t pid = fork();
+        if (pid == 0) {
+            tests[t].fn();
+            fflush(NULL);
+            _exit(0);
+        }
+        n_run++;
+        if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+            if ((pid > 0) && WIFSIGNALED(status))
+                printf("(signal %d) ", WTERMSIG(status));
+            printf("FAIL %s\n", tests[t].name);
+            n_failed++;
+        } else {
+            printf("ok   %s\n", tests[t].name);
+        }
+    }
+    HostTempPath(NULL);
+
+    printf("%u of %u tests passed\n", n_run - n_failed, n_run);
+    return (n_failed) ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+// NAND access tests, against a synthetic O3DS NAND image
+#include "fs.h"
+#include "decryptor/nand.h"
+#include "decryptor/nandfat.h"
+#include "decryptor/sha.h"
+#include "hid.h"
+#include "hosttest.h"
+
+static u8 ticketdb[0x40000];
+
+static void OpenTicketDb(void)
+{
+    u32 size;
+    CHECK_EQ(DebugOpenNandFile(&size, GetNandFileInfo(F_TICKET)), 0);
+    CHECK_EQ(size, sizeof(ticketdb));
+    FileClose();
+}
+
+HOST_TEST(nand_cache_stats)
+{
+    const FixtureFile files[] = { { "/dbs/ticket.db", ticketdb, sizeof(ticketdb) } };
+    u32 hits, misses, first_hits, first_misses;
+    HostRandom(ticketdb, sizeof(ticketdb), 0x71C);
+    FixtureNand(files, 1);
+    HostSdCreate(512);
+
+    // first lookup decrypts the volume metadata
+    CHECK_EQ(SetNand(false, false), 0);
+    GetNandCacheStats(&hits, &misses);
+    CHECK((hits == 0) && (misses == 0));
+    OpenTicketDb();
+    GetNandCacheStats(&first_hits, &first_misses);
+    CHECK(first_misses > 0);
+
+    // with the FatFs state dropped, the same lookup is served from the cache
+    MountNandFS();
+    OpenTicketDb();
+    GetNandCacheStats(&hits, &misses);
+    CHECK_EQ(misses, first_misses);
+    CHECK_EQ(hits, first_hits + first_misses);
+
+    // large reads bypass the cache, the contents are still right
+    u8* data = HostGet("1:/dbs/ticket.db", NULL);
+    CHECK(data && (memcmp(data, ticketdb, sizeof(ticketdb)) == 0));
+    free(data);
+
+    // NAND selection flushes the cache and starts new stats
+    CHECK_EQ(SetNand(false, false), 0);
+    GetNandCacheStats(&hits, &misses);
+    CHECK((hits == 0) && (misses == 0));
+    OpenTicketDb();
+    GetNandCacheStats(&hits, &misses);
+    CHECK_EQ(misses, first_misses);
+}
+
+static u8* MakeTitleDb(u32 n_titles)
+{
+    // title.db entry table and title info, see BuildTitleIndex()
+    // title ids are out of order, every 10th entry is inactive, every 13th has a bad info offset
+    u8* titledb = calloc(1, 0x64C00);
+    u8* entry_table = titledb + 0x39A80;
+    u8* info_data = titledb + 0x44B80;
+    CHECK(titledb && (n_titles <= TITLE_INDEX_MAX));
+    memcpy(entry_table, "\x02\x00\x00\x00\x03\x00\x00\x00", 8);
+    for (u32 i = 0; i < n_titles; i++) {
+        u8* entry = entry_table + 0xA8 + (0x2C * i);
+        u8* info = info_data + (0x80 * i);
+        u64 title_id = 0x0004013000000000ULL | (((i * 7) % n_titles) << 8);
+        u32 tmd_id = 0x100 + i;
+        u32 info_offset = (i % 13 == 12) ? 0x40 : 0x162 + i;
+        entry[0x4] = (i % 10 == 9) ? 0 : 1;
+        memcpy(entry + 0x8, &title_id, 8);
+        memcpy(entry + 0x18, &info_offset, 4);
+        entry[0x1C] = 0x80;
+        info[0x08] = 0x40;
+        memcpy(info + 0x14, &tmd_id, 4);
+    }
+    return titledb;
+}
+
+static void CheckTitleIndex(u32 n_titles)
+{
+    for (u32 i = 0; i < n_titles; i++) {
+        u64 title_id = 0x0004013000000000ULL | (((i * 7) % n_titles) << 8);
+        u32 tmd_id = 0;
+        u32 res = SeekTitleInNandDb(title_id >> 32, (u32) title_id, &tmd_id);
+        if ((i % 10 == 9) || (i % 13 == 12)) {
+            CHECK(res != 0);
+        } else if ((res != 0) || (tmd_id != 0x100 + i)) {
+            HostFail("title %016llX: %u / %08X", (unsigned long long) title_id, res, tmd_id);
+        }
+    }
+    CHECK(SeekTitleInNandDb(0x00040130, 0xFFFFFF00, &n_titles) != 0);
+}
+
+HOST_TEST(nand_title_index)
+{
+    const u32 n_titles = 600;
+    u8* titledb = MakeTitleDb(n_titles);
+    const FixtureFile files[] = { { "/dbs/title.db", titledb, 0x64C00 } };
+    u32 hits, misses, first_hits, first_misses;
+    FixtureNand(files, 1);
+    HostSdCreate(512);
+
+    CHECK_EQ(SetNand(false, false), 0);
+    CheckTitleIndex(n_titles);
+    GetNandCacheStats(&first_hits, &first_misses);
+    CHECK(first_misses > 0);
+
+    // title.db is read once per NAND selection
+    CheckTitleIndex(n_titles);
+    GetNandCacheStats(&hits, &misses);
+    CHECK((hits == first_hits) && (misses == first_misses));
+    CHECK_EQ(SetNand(false, false), 0);
+    CheckTitleIndex(n_titles);
+    GetNandCacheStats(&hits, &misses);
+    CHECK(misses > 0);
+    free(titledb);
+}
+
+HOST_TEST(nand_archive)
+{
+    // raw backup and decrypted partitions from one NAND pass, the NAND is cut inside CTRNAND
+    const u32 nand_size = 0x0BA00000;
+    const u32 p_list[5] = { P_TWLN, P_TWLP, P_AGBSAVE, P_FIRM0, P_FIRM1 };
+    const char* p_names[5] = { "TWLN", "TWLP", "AGBSAVE", "FIRM0", "FIRM1" };
+    char path[64];
+    u8 shasum[32];
+    size_t size;
+    u8* nand = FixtureNand(NULL, 0);
+    HostNandAttach(nand, nand_size);
+    HostSdCreate(1024);
+    CHECK_EQ(SetNand(false, false), 0);
+
+    HostQueueInput(BUTTON_A); // file name
+    u64 n_read = HostNandRead();
+    CHECK_EQ(DumpNandArchive(NA_PARTITIONS), 0);
+    n_read = HostNandRead() - n_read;
+    // one pass, plus a few sectors for the partition magic checks and the serial in the file name
+    CHECK(n_read <= (nand_size / 0x200) + 16);
+
+    u8* data = HostGet("/NAND.bin", &size);
+    CHECK(data && (size == nand_size) && (memcmp(data, nand, nand_size) == 0));
+    u8* hash = HostGet("/NAND.bin.sha", NULL);
+    sha_quick(shasum, data, size, SHA256_MODE);
+    CHECK(hash && (memcmp(hash, shasum, 32) == 0));
+    free(hash);
+    free(data);
+    for (u32 i = 0; i < 5; i++) {
+        PartitionInfo* info = GetPartitionInfo(p_list[i]);
+        u8* expected = malloc(info->size);
+        CHECK(expected);
+        CHECK_EQ(DecryptNandToMem(expected, info->offset, info->size, info), 0);
+        snprintf(path, 64, "/NAND_%s.bin", p_names[i]);
+        data = HostGet(path, &size);
+        if (!data || (size != info->size) || (memcmp(data, expected, size) != 0))
+            HostFail("%s: bad or missing", path);
+        snprintf(path, 64, "/NAND_%s.bin.sha", p_names[i]);
+        hash = HostGet(path, NULL);
+        sha_quick(shasum, data, size, SHA256_MODE);
+        if (!hash || (memcmp(hash, shasum, 32) != 0))
+            HostFail("%s: wrong SHA256", path);
+        free(hash);
+        free(data);
+        free(expected);
+    }
+    CHECK(!HostExists("/NAND_CTRNAND.bin"));
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(log && strstr(log, "CTRNAND is outside of the NAND, skipped"));
+    free(log);
+}
@@ -0,0 +1,123 @@
+// NCSD partition splitter and out of place NCCH processing, on synthetic images
+#include "fs.h"
+#include "decryptor/aes.h"
+#include "decryptor/game.h"
+#include "hosttest.h"
+
+#define NCSD_TID    0x0004000000A5D500ULL
+#define NCSD_SIZE   (4 * 0x100000)
+
+static u8* plain_part[8];
+static u32 part_size[8];
+
+static u8* MakeNcsd(void)
+{
+    // partition 0: CXI, 1: NoCrypto NCCH, 7: CXI (placed before partition 1), all encrypted CXIs
+    const u32 offsets[8] = { 0x4000, 0x300000, 0, 0, 0, 0, 0, 0x180000 };
+    u8 keyx[16];
+    u8 crypt[8] = { 0 };
+    u8* ncsd = malloc(NCSD_SIZE);
+    NcsdHeader* hdr = (NcsdHeader*) ncsd;
+    CHECK(ncsd);
+    HostRandom(keyx, 16, 0x2C);
+    setup_aeskeyX(0x2C, keyx);
+    HostRandom(ncsd, NCSD_SIZE, 0x3D5);
+    memset(ncsd + 0x100, 0, sizeof(NcsdHeader) - 0x100);
+    memcpy(hdr->magic, "NCSD", 4);
+    hdr->size = NCSD_SIZE / 0x200;
+    hdr->mediaId = NCSD_TID;
+    for (u32 p = 0; p < 8; p++) {
+        u8* part = ncsd + offsets[p];
+        if (!offsets[p])
+            continue;
+        part_size[p] = (p == 1) ? FixtureNcch(part, 0x20000, NCSD_TID | 1, "CTR-M-SPLT", 0x501) :
+            FixtureCxi(part, 0x80000 + (p * 0x1000), NCSD_TID, 0x500 + p);
+        plain_part[p] = malloc(part_size[p]);
+        CHECK(plain_part[p]);
+        memcpy(plain_part[p], part, part_size[p]);
+        if (p != 1)
+            FixtureNcchEncrypt(part, part_size[p], crypt);
+        hdr->partitions[p].offset = offsets[p] / 0x200;
+        hdr->partitions[p].size = (part_size[p] / 0x200) + 0x10; // room behind the NCCH
+    }
+    return ncsd;
+}
+
+static void CheckPartition(const char* path, const u8* expected, u32 size)
+{
+    size_t fsize;
+    u8* data = HostGet(path, &fsize);
+    if (!data || (fsize != size) || (memcmp(data, expected, size) != 0))
+        HostFail("%s: bad or missing", path);
+    free(data);
+}
+
+HOST_TEST(ncsd_split)
+{
+    // one file per partition, named from the partition table, partitions are cut at the NCCH size
+    HostSdCreate(512);
+    u8* ncsd = MakeNcsd();
+    HostPut("/D9Game/game.3ds", ncsd, NCSD_SIZE);
+
+    CHECK_EQ(SplitNcsdFiles(0), 0);
+    CheckPartition("/D9Game/game.3ds.Main.cxi", ncsd + 0x4000, part_size[0]);
+    CheckPartition("/D9Game/game.3ds.Manual.cfa", ncsd + 0x300000, part_size[1]);
+    CheckPartition("/D9Game/game.3ds.UpdateO3DS.cxi", ncsd + 0x180000, part_size[7]);
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    char* first = (log) ? strstr(log, "Partition 7 ->") : NULL;
+    char* last = (log) ? strstr(log, "Partition 1 ->") : NULL;
+    CHECK(log && strstr(log, "Splitting \"game.3ds\" (3 partitions)") && first && last && (first < last));
+    free(log);
+
+    // the source stays as it is, the splitter only reads it
+    u8* data = HostGet("/D9Game/game.3ds", NULL);
+    CHECK(data && (memcmp(data, ncsd, NCSD_SIZE) == 0));
+    free(data);
+    free(ncsd);
+}
+
+HOST_TEST(ncsd_split_decrypt)
+{
+    // encrypted partitions are decrypted on the way, NoCrypto partitions are copied
+    HostSdCreate(512);
+    u8* ncsd = MakeNcsd();
+    HostPut("/D9Game/game.3ds", ncsd, NCSD_SIZE);
+    free(ncsd);
+
+    CHECK_EQ(SplitNcsdFiles(SP_DECRYPT), 0);
+    CheckPartition("/D9Game/game.3ds.Main.cxi", plain_part[0], part_size[0]);
+    CheckPartition("/D9Game/game.3ds.Manual.cfa", plain_part[1], part_size[1]);
+    CheckPartition("/D9Game/game.3ds.UpdateO3DS.cxi", plain_part[7], part_size[7]);
+
+    // a broken partition table fails the file and leaves no output for the broken partition
+    HostSdCreate(512);
+    ncsd = MakeNcsd();
+    ((NcsdHeader*) ncsd)->partitions[1].offset += 1;
+    HostPut("/D9Game/bad.3ds", ncsd, NCSD_SIZE);
+    free(ncsd);
+    CHECK(SplitNcsdFiles(SP_DECRYPT) != 0);
+    CHECK(!HostExists("/D9Game/bad.3ds.Manual.cfa"));
+}
+
+HOST_TEST(ncsd_ncch_no_regions)
+{
+    // an "encrypted" NCCH without ExHeader, ExeFS and RomFS only needs its header rewritten
+    u8* ncch = malloc(0x200000);
+    CHECK(ncch);
+    HostSdCreate(512);
+    u8 keyx[16];
+    HostRandom(keyx, 16, 0x2C);
+    setup_aeskeyX(0x2C, keyx);
+    u32 size = FixtureNcch(ncch, 0x200000, NCSD_TID, "CTR-P-NONE", 0x600);
+    ((NcchHeader*) ncch)->flags[7] = 0x00;
+    HostPut("/D9Game/none.cxi", ncch, size);
+
+    u64 written = HostSdWritten();
+    CHECK_EQ(CryptGameFiles(GC_NCCH_PROCESS), 0);
+    written = HostSdWritten() - written;
+    CHECK(written * 0x200 < size / 4);
+    ((NcchHeader*) ncch)->flags[7] = 0x04;
+    CheckPartition("/D9Game/none.cxi", ncch, size);
+    free(ncch);
+}
@@ -0,0 +1,250 @@
+// RomFS / ExeFS file extraction straight from encrypted NCCH, NCSD and CIA files
+#include "fs.h"
+#include "decryptor/aes.h"
+#include "decryptor/game.h"
+#include "decryptor/hashfile.h"
+#include "decryptor/romfs.h"
+#include "hosttest.h"
+
+#define ROMFS_TID   0x0004000000F5F500ULL
+#define N_ROMFS_FILES 6
+
+static u8* file_data[N_ROMFS_FILES];
+static FixtureFile romfs_files[N_ROMFS_FILES] = {
+    { "/sound/bgm/title.bcstm", NULL, 0x30000 },
+    { "/sound/se.bin", NULL, 0x123 },
+    { "/data/level1.bin", NULL, 0x2001 },
+    { "/data/level2.bin", NULL, 0x10 },
+    { "/readme.txt", NULL, 0x40 },
+    { "/sound/bgm/big.bin", NULL, 0x400000 }
+};
+
+static void SetupKeys(void)
+{
+    u8 keyx[16];
+    HostRandom(keyx, 16, 0x2C);
+    setup_aeskeyX(0x2C, keyx);
+    HostRandom(keyx, 16, 0x3D);
+    setup_aeskeyX(0x3D, keyx);
+}
+
+static u32 MakeCxi(u8* out, u8* plain, u32 n_files, u32 seed)
+{
+    // CXI with the first n_files RomFS files, encrypted with standard crypto (plain: optional copy)
+    u8 crypt[8] = { 0 };
+    u8* romfs = malloc(0x500000);
+    CHECK(romfs);
+    for (u32 i = 0; i < N_ROMFS_FILES; i++) {
+        if (!file_data[i]) {
+            file_data[i] = malloc(romfs_files[i].size);
+            CHECK(file_data[i]);
+            HostRandom(file_data[i], romfs_files[i].size, 0xF00 + i);
+            romfs_files[i].data = file_data[i];
+        }
+    }
+    u32 size_romfs = FixtureRomFs(romfs, romfs_files, n_files);
+    u32 size = FixtureCxiRomFs(out, romfs, size_romfs, ROMFS_TID, seed);
+    free(romfs);
+    if (plain)
+        memcpy(plain, out, size);
+    FixtureNcchEncrypt(out, size, crypt);
+    return size;
+}
+
+static void CheckExtracted(const char* outdir, const u8* plain, u32 n_files)
+{
+    // RomFS files and ExeFS files (against the plain ExeFS of FixtureCxi())
+    char path[256];
+    size_t size;
+    for (u32 i = 0; i < n_files; i++) {
+        snprintf(path, sizeof(path), "%s/romfs%s", outdir, romfs_files[i].path);
+        u8* data = HostGet(path, &size);
+        if (!data || (size != romfs_files[i].size) || (memcmp(data, romfs_files[i].data, size) != 0))
+            HostFail("%s: bad or missing", path);
+        free(data);
+    }
+    if (!plain)
+        return;
+    NcchHeader* ncch = (NcchHeader*) plain;
+    const u8* exefs = plain + (ncch->offset_exefs * 0x200);
+    for (u32 i = 0; i < 3; i++) {
+        u32 offset, fsize;
+        memcpy(&offset, exefs + (i*0x10) + 0x8, 4);
+        memcpy(&fsize, exefs + (i*0x10) + 0xC, 4);
+        snprintf(path, sizeof(path), "%s/exefs/%.8s.bin", outdir, (const char*) exefs + (i*0x10));
+        u8* data = HostGet(path, &size);
+        if (!data || (size != fsize) || (memcmp(data, exefs + 0x200 + offset, size) != 0))
+            HostFail("%s: bad or missing", path);
+        free(data);
+    }
+}
+
+HOST_TEST(romfs_extract_ncch)
+{
+    // everything, RomFS files in data order (= reverse table order here)
+    u8* cxi = malloc(0x100000);
+    u8* plain = malloc(0x100000);
+    CHECK(cxi && plain);
+    HostSdCreate(512);
+    SetupKeys();
+    u32 size = MakeCxi(cxi, plain, 5, 0xA00);
+    HostPut("/D9Game/game.cxi", cxi, size);
+
+    CHECK_EQ(ExtractGameFiles(0), 0);
+    CheckExtracted("/D9Game/game.cxi_extracted", plain, 5);
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(log && strstr(log, "8 files extracted / 0 failed"));
+    char* first = strstr(log, "romfs/readme.txt");
+    char* last = strstr(log, "romfs/sound/bgm/title.bcstm");
+    CHECK(first && last && (first < last));
+    free(log);
+    free(plain);
+    free(cxi);
+}
+
+HOST_TEST(romfs_extract_selected)
+{
+    // a few files out of a large RomFS, only the tables and those files are decrypted
+    u8* cxi = malloc(0x500000);
+    CHECK(cxi);
+    HostSdCreate(512);
+    SetupKeys();
+    u32 size = MakeCxi(cxi, NULL, N_ROMFS_FILES, 0xB00);
+    HostPut("/D9Game/game.cxi", cxi, size);
+    const char* patterns = "romfs/data/*\nEXEFS/icon\r\n";
+    HostPut("/extract.txt", patterns, strlen(patterns));
+
+    u64 n_blocks = HostAesBlocks();
+    CHECK_EQ(ExtractGameFiles(0), 0);
+    n_blocks = HostAesBlocks() - n_blocks;
+    CHECK(n_blocks * 0x10 < 0x40000);
+    CHECK(size > 0x400000);
+    CheckExtracted("/D9Game/game.cxi_extracted", NULL, 0);
+    u8* data = HostGet("/D9Game/game.cxi_extracted/romfs/data/level1.bin", NULL);
+    CHECK(data && (memcmp(data, romfs_files[2].data, romfs_files[2].size) == 0));
+    free(data);
+    data = HostGet("/D9Game/game.cxi_extracted/romfs/data/level2.bin", NULL);
+    CHECK(data && (memcmp(data, romfs_files[3].data, romfs_files[3].size) == 0));
+    free(data);
+    CHECK(HostExists("/D9Game/game.cxi_extracted/exefs/icon.bin"));
+    CHECK(!HostExists("/D9Game/game.cxi_extracted/exefs/banner.bin"));
+    CHECK(!HostExists("/D9Game/game.cxi_extracted/romfs/sound/bgm/big.bin"));
+    CHECK(!HostExists("/D9Game/game.cxi_extracted/romfs/readme.txt"));
+    free(cxi);
+}
+
+HOST_TEST(romfs_extract_ncsd)
+{
+    // partitions 0 and 1, partition 1 goes to a numbered subfolder
+    const u32 offsets[2] = { 0x4000, 0x200000 };
+    u8* ncsd = calloc(1, 0x400000);
+    CHECK(ncsd);
+    HostSdCreate(512);
+    SetupKeys();
+    NcsdHeader* hdr = (NcsdHeader*) ncsd;
+    memcpy(hdr->magic, "NCSD", 4);
+    hdr->size = 0x400000 / 0x200;
+    hdr->mediaId = ROMFS_TID;
+    for (u32 p = 0; p < 2; p++) {
+        u32 size = MakeCxi(ncsd + offsets[p], NULL, 4 + p, 0xC00 + p);
+        hdr->partitions[p].offset = offsets[p] / 0x200;
+        hdr->partitions[p].size = size / 0x200;
+    }
+    HostPut("/D9Game/game.3ds", ncsd, 0x400000);
+    free(ncsd);
+
+    CHECK_EQ(ExtractGameFiles(0), 0);
+    CheckExtracted("/D9Game/game.3ds_extracted", NULL, 4);
+    CheckExtracted("/D9Game/game.3ds_extracted/1", NULL, 5);
+}
+
+HOST_TEST(romfs_extract_cia)
+{
+    // titlekey encrypted CIA, the CIA layer is decrypted along with the NCCH layer
+    u32 sizes[2];
+    u32 cia_size;
+    u8* contents = malloc(0x200000);
+    CHECK(contents);
+    HostSdCreate(512);
+    SetupKeys();
+    sizes[0] = MakeCxi(contents, NULL, 5, 0xD00);
+    sizes[1] = 0x8000;
+    HostRandom(contents + sizes[0], sizes[1], 0xD01);
+    u8* cia = FixtureCia(contents, sizes, 2, ROMFS_TID, &cia_size);
+    free(contents);
+    HostPut("/D9Game/game.cia", cia, cia_size);
+    free(cia);
+
+    CHECK_EQ(ExtractGameFiles(0), 0);
+    CheckExtracted("/D9Game/game.cia_extracted", NULL, 5);
+    CHECK_EQ(VerifyGameFiles(0), 0);
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(log && strstr(log, "Partition / content 0 RomFS: OK") && !strstr(log, "titlekey encrypted"));
+    free(log);
+}
+
+static void CorruptAndVerify(const u8* cxi, u32 size, u32 offset, bool quick, const char* expected)
+{
+    // flips one byte (CTR: same byte in the plain data) and runs the verifier on a copy
+    u8* copy = malloc(size);
+    CHECK(copy);
+    memcpy(copy, cxi, size);
+    copy[offset] ^= 0x01;
+    HostPut("/corrupt.cxi", copy, size);
+    free(copy);
+    LogWrite(NULL);
+    FileDelete(LOG_FILE);
+    CHECK_EQ(VerifyNcchRomFs("/corrupt.cxi", 0, quick), HASH_FAILED);
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    if (!log || !strstr(log, expected))
+        HostFail("0x%X: expected \"%s\" in log:\n%s", offset, expected, (log) ? log : "");
+    free(log);
+}
+
+HOST_TEST(romfs_verify_ivfc)
+{
+    // every level against the one above, corruption anywhere is found
+    u8* cxi = malloc(0x500000);
+    u8* plain = malloc(0x500000);
+    CHECK(cxi && plain);
+    HostSdCreate(512);
+    SetupKeys();
+    u32 size = MakeCxi(cxi, plain, N_ROMFS_FILES, 0xE00);
+    HostPut("/game.cxi", cxi, size);
+    // quick mode samples level 3: per sample one level 3 block and one block of level 2 hashes,
+    // independent of the RomFS size
+    u64 n_full = HostAesBlocks();
+    CHECK_EQ(VerifyNcchRomFs("/game.cxi", 0, false), HASH_VERIFIED);
+    n_full = HostAesBlocks() - n_full;
+    u64 n_quick = HostAesBlocks();
+    CHECK_EQ(VerifyNcchRomFs("/game.cxi", 0, true), HASH_VERIFIED);
+    n_quick = HostAesBlocks() - n_quick;
+    CHECK((n_quick < n_full) && (n_quick * 0x10 <= (256 * 0x2000) + 0x80000));
+
+    // level offsets, see FixtureRomFs()
+    NcchHeader* ncch = (NcchHeader*) plain;
+    u32 offset_romfs = ncch->offset_romfs * 0x200;
+    RomFsIvfcHeader* ivfc = (RomFsIvfcHeader*) (plain + offset_romfs);
+    u32 offset_lv3 = offset_romfs + GetRomFsLv3Offset(ivfc);
+    u32 offset_lv1 = offset_lv3 + align(ivfc->level[2].size, 0x1000);
+    u32 offset_lv2 = offset_lv1 + align(ivfc->level[0].size, 0x1000);
+    CHECK(ivfc->level[2].size > 300 * 0x1000);
+
+    CorruptAndVerify(cxi, size, offset_romfs + 0x60, false, "RomFS superblock hash mismatch");
+    CorruptAndVerify(cxi, size, offset_lv1 + 0x20, false, "RomFS IVFC level 1 verification failed");
+    CorruptAndVerify(cxi, size, offset_lv2 + 0x20 * 7, true, "RomFS IVFC level 2 verification failed");
+    CorruptAndVerify(cxi, size, offset_lv3 + (300 * 0x1000) + 0x123, false, "Hash mismatch in block 300");
+    // the last block is zero padded behind the level data, the padding is hashed too
+    CorruptAndVerify(cxi, size, offset_lv3 + ivfc->level[2].size, false, "RomFS IVFC level 3 verification failed");
+
+    // stops at the first mismatch, most of level 3 is never read
+    u64 n_blocks = HostAesBlocks();
+    CorruptAndVerify(cxi, size, offset_lv3 + 0x10, false, "Hash mismatch in block 0");
+    n_blocks = HostAesBlocks() - n_blocks;
+    CHECK(n_blocks * 0x10 < ivfc->level[2].size / 2);
+    free(plain);
+    free(cxi);
+}
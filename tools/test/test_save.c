@@ -0,0 +1,187 @@
+// NDS save chip tests: differential writer, against the SPI chip model
+#include "gamecart/card_eeprom.h"
+#include "hosttest.h"
+
+static u8 scratch[0x10000];
+
+static void CheckStats(u32 n_erases, u32 n_programs, u64 n_read_bytes)
+{
+    SpiModelStats stats;
+    SpiModelGetStats(&stats);
+    CHECK_EQ(stats.n_wraps, 0);
+    CHECK_EQ(stats.n_erases, n_erases);
+    CHECK_EQ(stats.n_programs, n_programs);
+    CHECK_EQ(stats.n_read_bytes, n_read_bytes);
+}
+
+HOST_TEST(save_diff_flash)
+{
+    // 512KB FLASH: untouched sector, cleared bits only, set bits (erase) and a partial last page
+    const u32 size = 512 * 1024;
+    CardEepromStats wstats;
+    u8* chip = malloc(size);
+    u8* save = malloc(size);
+    CHECK(chip && save);
+    HostRandom(chip, size, 0x5A7E);
+    memcpy(save, chip, size);
+    SpiModelInsert(3, size, 0x204013, chip);
+
+    // nothing to do, the chip is only read
+    CHECK_EQ(cardWriteEepromDiff(save, size, 3, scratch, &wstats), 0);
+    CHECK((wstats.n_erased == 0) && (wstats.n_programmed == 0));
+    CheckStats(0, 0, size);
+
+    save[0x10000 + 0x123] &= 0x0F;          // sector 1: one page, clear bits only
+    save[0x10000 + 0x8000] &= 0xF0;         // sector 1: another page
+    save[0x20000 + 0x4567] = ~chip[0x24567]; // sector 2: sets bits, needs an erase
+    save[size - 1] &= 0x7F;                 // last sector, last page
+    SpiModelResetStats();
+    CHECK_EQ(cardWriteEepromDiff(save, size, 3, scratch, &wstats), 0);
+    CHECK(memcmp(chip, save, size) == 0);
+    // erased sector: every page is programmed again
+    CHECK_EQ(wstats.n_erased, 1);
+    CHECK_EQ(wstats.n_programmed, 2 + 256 + 1);
+    CheckStats(1, 2 + 256 + 1, size + (3 * 0x10000)); // + read back of the touched sectors
+    free(save);
+    free(chip);
+}
+
+HOST_TEST(save_diff_eeprom)
+{
+    // EEPROMs are overwritten without erase, in 16 (type 1) / 32 (type 2) byte pages
+    const u32 sizes[3] = { 512, 8 * 1024, 64 * 1024 };
+    const int types[3] = { 1, 2, 2 };
+    CardEepromStats wstats;
+    u8* chip = malloc(64 * 1024);
+    u8* save = malloc(64 * 1024);
+    CHECK(chip && save);
+    for (u32 t = 0; t < 3; t++) {
+        u32 size = sizes[t];
+        HostRandom(chip, size, 0xEE00 + t);
+        memcpy(save, chip, size);
+        save[0] ^= 0xFF;
+        save[size / 2] ^= 0x01;
+        save[(size / 2) + 1] ^= 0x01; // same page
+        save[size - 1] ^= 0x80;
+        SpiModelInsert(types[t], size, 0, chip);
+        CHECK_EQ(cardWriteEepromDiff(save, size, types[t], scratch, &wstats), 0);
+        CHECK(memcmp(chip, save, size) == 0);
+        CHECK((wstats.n_erased == 0) && (wstats.n_programmed == 3));
+        CheckStats(0, 3, 2 * size);
+    }
+    free(save);
+    free(chip);
+}
+
+HOST_TEST(save_diff_verify)
+{
+    // a byte that doesn't take the new value is reported
+    const u32 size = 256 * 1024;
+    CardEepromStats wstats;
+    u8* chip = malloc(size);
+    u8* save = malloc(size);
+    CHECK(chip && save);
+    HostRandom(chip, size, 0xBAD);
+    HostRandom(save, size, 0xBAD);
+    save[0x30000] = chip[0x30000] ^ 0x55;
+    save[0x3FFFF] = chip[0x3FFFF] ^ 0xFF;
+    SpiModelInsert(3, size, 0x204012, chip);
+    SpiModelSetStuck(0x3FFFF);
+    CHECK_EQ(cardWriteEepromDiff(save, size, 3, scratch, &wstats), 1);
+    CHECK_EQ(wstats.n_erased, 1);
+    CHECK(chip[0x30000] == save[0x30000]);
+    free(save);
+    free(chip);
+}
+
+typedef struct {
+    u32 size;
+    u32 blank; // blank (0xFF) bytes at the start
+    u32 expected;
+} EepromProbe;
+
+static u32 ProbeEeprom(u8* chip, u32 size, u32 blank)
+{
+    // TYPE 2 chip with random contents behind the first blank bytes
+    memset(chip, 0xFF, blank);
+    HostRandom(chip + blank, size - blank, 0xE200 + size + blank);
+    SpiModelInsert(2, size, 0, chip);
+    return cardEepromGetSize();
+}
+
+static void ProbeEepromOnce(void* arg)
+{
+    // in a child process, the result is cached per cart otherwise
+    EepromProbe* probe = arg;
+    SpiModelStats stats;
+    u8* chip = malloc(64 * 1024);
+    CHECK(chip);
+    CHECK_EQ(ProbeEeprom(chip, probe->size, probe->blank), probe->expected);
+    SpiModelGetStats(&stats);
+    CHECK((stats.n_programs == 0) && (stats.n_erases == 0));
+    CHECK_EQ(stats.n_rdid, 1); // only from cardEepromGetType()
+    free(chip);
+}
+
+HOST_TEST(save_probe_eeprom)
+{
+    // mirror detection, read only
+    // blank windows match any mirror, a chip blank in its first 8KB is taken as the largest size
+    EepromProbe probes[] = {
+        { 8 * 1024, 0, 8 * 1024 }, { 16 * 1024, 0, 16 * 1024 },
+        { 32 * 1024, 0, 32 * 1024 }, { 64 * 1024, 0, 64 * 1024 },
+        { 64 * 1024, 64 * 1024, 64 * 1024 }, { 8 * 1024, 8 * 1024, 64 * 1024 },
+        { 64 * 1024, 8 * 1024, 64 * 1024 }, { 16 * 1024, 8 * 1024 - 0x10, 16 * 1024 },
+        { 8 * 1024, 8 * 1024 - 0x10, 8 * 1024 }
+    };
+    for (u32 i = 0; i < sizeof(probes) / sizeof(EepromProbe); i++) {
+        if (HostRun(ProbeEepromOnce, &probes[i]) != 0)
+            HostFail("%u byte EEPROM, %u byte blank: probe failed", probes[i].size, probes[i].blank);
+    }
+
+    // TYPE 1 is fixed, no probe
+    u8 chip[512];
+    SpiModelStats stats;
+    SpiModelInsert(1, 512, 0, chip);
+    CHECK_EQ(cardEepromGetSize(), 512);
+    SpiModelGetStats(&stats);
+    CHECK_EQ(stats.n_read_bytes, 0);
+}
+
+HOST_TEST(save_probe_flash)
+{
+    // JEDEC ID table, then the capacity byte of the ID, then 256KB
+    const u32 ids[4] = { 0xC22211, 0x204014, 0xEF4015, 0x123456 };
+    const u32 sizes[4] = { 128 * 1024, 1024 * 1024, 2048 * 1024, 256 * 1024 };
+    u8* chip = calloc(1, 0x10000);
+    SpiModelStats stats;
+    CHECK(chip);
+    for (u32 i = 0; i < 4; i++) {
+        SpiModelInsert(3, 0x10000, ids[i], chip);
+        CHECK_EQ(cardEepromGetSize(), sizes[i]);
+        SpiModelGetStats(&stats);
+        CHECK_EQ(stats.n_read_bytes, 0);
+        CHECK_EQ(stats.n_rdid, 2);
+    }
+    free(chip);
+}
+
+HOST_TEST(save_probe_cached)
+{
+    // the probe runs once per cart and chip, the chip type is always checked
+    u8* chip = malloc(64 * 1024);
+    SpiModelStats stats;
+    CHECK(chip);
+    CHECK_EQ(ProbeEeprom(chip, 32 * 1024, 0), 32 * 1024);
+    SpiModelResetStats();
+    CHECK_EQ(cardEepromGetSize(), 32 * 1024);
+    SpiModelGetStats(&stats);
+    CHECK_EQ(stats.n_read_bytes, 0);
+    CHECK(stats.n_commands > 0);
+
+    // another chip type, probed again
+    SpiModelInsert(3, 0x10000, 0x204012, chip);
+    CHECK_EQ(cardEepromGetSize(), 256 * 1024);
+    CHECK_EQ(ProbeEeprom(chip, 8 * 1024, 0), 8 * 1024);
+    free(chip);
+}
@@ -0,0 +1,163 @@
+// seed store tests, seeddb.bin on SD merged with a synthetic NAND seedsave
+#include <time.h>
+
+#include "fs.h"
+#include "decryptor/game.h"
+#include "decryptor/nand.h"
+#include "decryptor/nandfat.h"
+#include "decryptor/sha.h"
+#include "hosttest.h"
+
+#define SEEDSAVE_SIZE   0xAC000
+#define SEEDSAVE_PATH   "/data/00112233445566778899aabbccddeeff/sysdata/0001000f/00000000"
+#define N_NAND_SEEDS    1500
+#define N_SEEDDB_SEEDS  1000 // half of these are also in NAND
+
+static u64 SeedTitleId(u32 i)
+{
+    return 0x0004000000200000ULL | ((u64) (i * 37 % 4000) << 8);
+}
+
+static void SeedHash(u8* hash, const u8* seed, u64 title_id)
+{
+    u8 data[16 + 8];
+    u8 sha[32];
+    memcpy(data, seed, 16);
+    memcpy(data + 16, &title_id, 8);
+    sha_quick(sha, data, 16 + 8, SHA256_MODE);
+    memcpy(hash, sha, 4);
+}
+
+static u8* MakeSeedsave(void)
+{
+    // seeds in the active slot (@0x5C000), every 50th one only in the inactive slot (demo workaround)
+    u8* save = calloc(1, SEEDSAVE_SIZE);
+    u8* active = save + 0x5C000;
+    u8* inactive = save + 0x7000;
+    CHECK(save);
+    save[0x168] = 1;
+    for (u32 i = 0; i < N_NAND_SEEDS; i++) {
+        u64 title_id = SeedTitleId(i);
+        u8* seed = ((i % 50 == 49) ? inactive : active) + (2000 * 8) + (i * 16);
+        memcpy(active + (i * 8), &title_id, 8);
+        HostRandom(seed, 16, 0x5EED + i);
+    }
+    return save;
+}
+
+static SeedInfo* MakeSeedDb(const u8* save)
+{
+    // the first half matches NAND, the second half has other titles
+    // one title id has a second, differing seed
+    SeedInfo* db = calloc(1, sizeof(SeedInfo));
+    CHECK(db);
+    db->n_entries = N_SEEDDB_SEEDS + 1;
+    for (u32 i = 0; i < N_SEEDDB_SEEDS; i++) {
+        u32 n = (i < N_SEEDDB_SEEDS / 2) ? i * 2 : N_NAND_SEEDS + i;
+        SeedInfoEntry* entry = db->entries + (N_SEEDDB_SEEDS - 1 - i); // reverse order
+        entry->titleId = SeedTitleId(n);
+        if (n < N_NAND_SEEDS) {
+            const u8* slot = save + ((n % 50 == 49) ? 0x7000 : 0x5C000);
+            memcpy(entry->external_seed, slot + (2000 * 8) + (n * 16), 16);
+        } else HostRandom(entry->external_seed, 16, 0x5EED + n);
+    }
+    db->entries[N_SEEDDB_SEEDS].titleId = SeedTitleId(2);
+    HostRandom(db->entries[N_SEEDDB_SEEDS].external_seed, 16, 0xD1FF);
+    return db;
+}
+
+static void SetupSeeds(bool with_seeddb)
+{
+    u8* save = MakeSeedsave();
+    const FixtureFile files[] = { { SEEDSAVE_PATH, save, SEEDSAVE_SIZE } };
+    FixtureNand(files, 1);
+    HostSdCreate(512);
+    if (with_seeddb) {
+        SeedInfo* db = MakeSeedDb(save);
+        HostPut("/seeddb.bin", db, 16 + (db->n_entries * sizeof(SeedInfoEntry)));
+        free(db);
+    }
+    free(save);
+    CHECK_EQ(SetNand(false, false), 0);
+}
+
+static void CheckSeed(u32 n, const u8* expected)
+{
+    u8 seed[16];
+    u8 hash[4];
+    u64 title_id = SeedTitleId(n);
+    SeedHash(hash, expected, title_id);
+    if ((FindSeed(seed, title_id, hash) != 0) || (memcmp(seed, expected, 16) != 0))
+        HostFail("seed for %016llX not found", (unsigned long long) title_id);
+}
+
+HOST_TEST(seeds_lookup)
+{
+    u8 expected[16];
+    u8 seed[16];
+    struct timespec t0, t1, t2;
+    SetupSeeds(true);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    CHECK_EQ(FindSeed(seed, 0x0004000000FFFF00ULL, NULL), 1); // loads the store
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (u32 n = 0; n < N_NAND_SEEDS + N_SEEDDB_SEEDS; n++) {
+        if ((n >= N_NAND_SEEDS) && (n < N_NAND_SEEDS + (N_SEEDDB_SEEDS / 2)))
+            continue; // not in any source
+        HostRandom(expected, 16, 0x5EED + n);
+        CheckSeed(n, expected);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    printf("     store load: %ldus, %u lookups with hash check: %ldus\n",
+        ((t1.tv_sec - t0.tv_sec) * 1000000) + ((t1.tv_nsec - t0.tv_nsec) / 1000), N_NAND_SEEDS + (N_SEEDDB_SEEDS / 2),
+        ((t2.tv_sec - t1.tv_sec) * 1000000) + ((t2.tv_nsec - t1.tv_nsec) / 1000));
+
+    // differing seeds for one title id are told apart by the hash
+    HostRandom(expected, 16, 0xD1FF);
+    CheckSeed(2, expected);
+    HostRandom(expected, 16, 0x5EED + 2);
+    CheckSeed(2, expected);
+    memset(expected, 0, 16);
+    CHECK(FindSeed(seed, SeedTitleId(2), expected) != 0);
+}
+
+HOST_TEST(seeds_update_seeddb)
+{
+    SetupSeeds(true);
+    CHECK_EQ(UpdateSeedDb(0), 0);
+    size_t size;
+    SeedInfo* db = (SeedInfo*) HostGet("/seeddb.bin", &size);
+    // NAND seeds, seeddb.bin only seeds, the extra seed
+    u32 n_total = N_NAND_SEEDS + (N_SEEDDB_SEEDS / 2) + 1;
+    CHECK(db && (db->n_entries == n_total) && (size == 16 + (n_total * sizeof(SeedInfoEntry))));
+    for (u32 i = 0; i < db->n_entries; i++) {
+        CHECK(getle64(db->entries[i].reserved) == 0);
+        if (i && (db->entries[i].titleId < db->entries[i-1].titleId))
+            HostFail("seeddb.bin not sorted at entry %u", i);
+    }
+    free(db);
+
+    // nothing new on the second run, a store reload keeps the same seeds
+    CHECK_EQ(UpdateSeedDb(0), 0);
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(log && strstr(log, "Found no new seeds"));
+    free(log);
+}
+
+HOST_TEST(seeds_corrupt_seeddb)
+{
+    // a seeddb.bin that doesn't load is never overwritten
+    const u8 bad[16] = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SetupSeeds(false);
+    HostPut("/seeddb.bin", bad, 16);
+    CHECK_EQ(SetNand(false, false), 0);
+    CHECK(UpdateSeedDb(0) != 0);
+    size_t size;
+    u8* data = HostGet("/seeddb.bin", &size);
+    CHECK(data && (size == 16) && (memcmp(data, bad, 16) == 0));
+    free(data);
+    u8 expected[16];
+    HostRandom(expected, 16, 0x5EED);
+    CheckSeed(0, expected); // NAND seeds are still found
+}
@@ -0,0 +1,168 @@
+// ticket.db parser / titlekey dump tests, against a synthetic ticket.db in CTRNAND
+#include "fs.h"
+#include "decryptor/titlekey.h"
+#include "hid.h"
+#include "hosttest.h"
+
+#define TDB_BLOCK_SIZE  0x200
+#define TDB_TICKET_SIZE (8 + 0x140 + 0x210) // size / unknown, signature, ticket data
+#define TDB_OFFSET_BDRI 0x110 // 'TICK' preheader @0x100
+
+#define N_TICKETS       3000
+#define TDB_TITLE_ID(i) (0x0004000000100000ULL + ((u64) (i) << 8))
+
+typedef struct {
+    u64 title_id;
+    u32 console_id;
+    u32 common_key;
+    u8  titlekey[16];
+} TestTicket;
+
+static TestTicket tickets[N_TICKETS];
+
+static void MakeTickets(void)
+{
+    // every 7th ticket repeats an earlier title id, every 11th is a system ticket (console id 0)
+    for (u32 i = 0; i < N_TICKETS; i++) {
+        TestTicket* t = tickets + i;
+        t->title_id = ((i % 7 == 6) ? tickets[i / 2].title_id : TDB_TITLE_ID(i));
+        t->console_id = (i % 11 == 10) ? 0 : 0x12345678 + i;
+        t->common_key = i % 2;
+        HostRandom(t->titlekey, 16, 0x7100 + i);
+    }
+}
+
+static void WriteTicket(u8* out, const TestTicket* t, bool devkit)
+{
+    u8* ticket = out + 8;
+    u8* tdata = ticket + 0x140;
+    HostRandom(out, TDB_TICKET_SIZE, (u32) t->title_id ^ t->console_id);
+    memcpy(out + 4, "\x50\x03\x00\x00", 4);
+    memcpy(ticket, "\x00\x01\x00\x04", 4);
+    memset(tdata, 0, 0x40);
+    strcpy((char*) tdata, (devkit) ? "Root-CA00000004-XS00000009" : "Root-CA00000003-XS0000000c");
+    memcpy(tdata + 0x7F, t->titlekey, 16);
+    memcpy(tdata + 0x98, &(t->console_id), 4);
+    memcpy(tdata + 0x9C, &(t->title_id), 8);
+    tdata[0xB1] = t->common_key;
+}
+
+static u8* MakeTicketDb(u32* size)
+{
+    // DIFF container stand-in, 'TICK' preheader, BDRI inner filesystem
+    // tickets take two blocks each, odd ones are stored as a chain of two single blocks in reverse order
+    // (except for the last one, the scan can't find a ticket with its second half missing)
+    u32 n_fet_blocks = ((N_TICKETS + 1) * sizeof(BdriFileEntry) + TDB_BLOCK_SIZE - 1) / TDB_BLOCK_SIZE;
+    u32 n_blocks = n_fet_blocks + (2 * N_TICKETS);
+    u32 offset_fat = 0x200;
+    u32 offset_data = align(offset_fat + ((n_blocks + 1) * 8), TDB_BLOCK_SIZE);
+    u32 db_size = TDB_OFFSET_BDRI + offset_data + (n_blocks * TDB_BLOCK_SIZE);
+    u8* db = calloc(1, db_size);
+    CHECK(db);
+
+    HostRandom(db, 0x100, 0xD1FF);
+    memcpy(db, "DIFF", 4);
+    memcpy(db + 0x100, "TICK", 4);
+    BdriHeader* bdri = (BdriHeader*) (db + TDB_OFFSET_BDRI);
+    memcpy(bdri->magic, "BDRI", 4);
+    bdri->version = 0x30000;
+    bdri->info_offset = 0x20;
+    bdri->image_block_size = TDB_BLOCK_SIZE;
+    bdri->data_block_size = TDB_BLOCK_SIZE;
+    bdri->fat_offset = offset_fat;
+    bdri->fat_entry_count = n_blocks;
+    bdri->data_offset = offset_data;
+    bdri->data_block_count = n_blocks;
+    bdri->fet_start_block = 0;
+    bdri->fet_block_count = n_fet_blocks;
+    bdri->max_file_count = N_TICKETS;
+
+    u32* fat = (u32*) (db + TDB_OFFSET_BDRI + offset_fat);
+    u8* data = db + TDB_OFFSET_BDRI + offset_data;
+    BdriFileEntry* fet = (BdriFileEntry*) data;
+    for (u32 i = 0; i < N_TICKETS; i++) {
+        u8 ticket[2 * TDB_BLOCK_SIZE];
+        u32 block = n_fet_blocks + (2 * i);
+        u32 node = block + 1; // FAT entries are 1-based
+        BdriFileEntry* entry = fet + i + 1;
+        WriteTicket(ticket, tickets + i, (i % 5 == 4));
+        entry->parent_index = 1;
+        memcpy(entry->title_id, &(tickets[i].title_id), 8);
+        entry->size = TDB_TICKET_SIZE;
+        if ((i % 2) && (i + 1 < N_TICKETS)) { // second block first, chain: node + 1 -> node
+            entry->start_block_index = block + 1;
+            memcpy(data + ((block + 1) * TDB_BLOCK_SIZE), ticket, TDB_BLOCK_SIZE);
+            memcpy(data + (block * TDB_BLOCK_SIZE), ticket + TDB_BLOCK_SIZE, TDB_BLOCK_SIZE);
+            fat[((node + 1) * 2) + 1] = node;
+            fat[(node * 2) + 1] = 0;
+        } else { // one node of two blocks
+            entry->start_block_index = block;
+            memcpy(data + (block * TDB_BLOCK_SIZE), ticket, 2 * TDB_BLOCK_SIZE);
+            fat[(node * 2) + 1] = 0x80000000;
+            fat[(node + 1) * 2] = 0x80000000 | node;
+            fat[((node + 1) * 2) + 1] = node + 1;
+        }
+    }
+
+    *size = db_size;
+    return db;
+}
+
+static void CheckTitlekeys(const char* path)
+{
+    // unique title ids in ticket.db order, system tickets don't count
+    u32 n_expected = 0;
+    size_t size;
+    u8* seen = calloc(N_TICKETS, 1);
+    TitleKeysInfo* info = (TitleKeysInfo*) HostGet(path, &size);
+    CHECK(info && (size == 16 + (info->n_entries * sizeof(TitleKeyEntry))));
+    for (u32 i = 0; i < N_TICKETS; i++) {
+        TestTicket* t = tickets + i;
+        u32 idx = (t->title_id - TDB_TITLE_ID(0)) >> 8;
+        if (!t->console_id || seen[idx])
+            continue;
+        seen[idx] = 1;
+        CHECK(n_expected < info->n_entries);
+        TitleKeyEntry* entry = info->entries + n_expected++;
+        CHECK(memcmp(entry->titleId, &(t->title_id), 8) == 0);
+        CHECK(memcmp(entry->titleKey, t->titlekey, 16) == 0);
+        CHECK_EQ(entry->commonKeyIndex, t->common_key);
+    }
+    CHECK_EQ(info->n_entries, n_expected);
+    CHECK(n_expected > 1024); // old limit
+    free(seen);
+    free(info);
+}
+
+static void DumpTitlekeys(u8* db, u32 db_size)
+{
+    const FixtureFile files[] = { { "/dbs/ticket.db", db, db_size } };
+    FixtureNand(files, 1);
+    HostSdCreate(512);
+    HostQueueInput(BUTTON_A); // file name
+    CHECK_EQ(DumpTicketsTitlekeys(TK_ENCRYPTED), 0);
+    CheckTitlekeys("/encTitleKeys.bin");
+}
+
+HOST_TEST(titlekey_ticketdb_parse)
+{
+    u32 db_size;
+    MakeTickets();
+    u8* db = MakeTicketDb(&db_size);
+    DumpTitlekeys(db, db_size);
+    LogWrite(NULL);
+    char* log = (char*) HostGet(LOG_FILE, NULL);
+    CHECK(log && !strstr(log, "scanning"));
+    free(log);
+}
+
+HOST_TEST(titlekey_ticketdb_scan)
+{
+    // unknown structure, falls back to scanning (tickets straddle the 1MB windows)
+    u32 db_size;
+    MakeTickets();
+    u8* db = MakeTicketDb(&db_size);
+    memcpy(db + TDB_OFFSET_BDRI, "XXXX", 4);
+    CHECK(db_size > 3 * BUFFER_MAX_SIZE);
+    DumpTitlekeys(db, db_size);
+}
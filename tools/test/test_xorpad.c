@@ -0,0 +1,333 @@
+// XORpad generator tests, pads against a software AES reference, applied with tools/xorpad_apply
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fs.h"
+#include "decryptor/aes.h"
+#include "decryptor/game.h"
+#include "decryptor/sha.h"
+#include "decryptor/xorpad.h"
+#include "fatfs/sdmmc.h"
+#include "hosttest.h"
+
+static const NandPadRange nand_ranges[] = {
+    { 0x00012E00, 0x10 },                           // TWLN boot sector
+    { 0x09011A00 + 0x1230, 0x4560 },                // TWLP, not sector aligned
+    { 0x0B130000, 0x10 },                           // FIRM0 header
+    { 0x0B95C9F0, 0x20 },                           // across the CTRNAND start (CTRFULL)
+    { 0x0B95CA00 + 0x1F0, 0x20 },                   // CTRNAND boot sector end
+    { 0x0B95CA00 + 0x100010, BUFFER_MAX_SIZE + 0x30 } // CTRNAND, more than one buffer
+};
+static const u32 nand_range_keyslots[] = { 0x3, 0x3, 0x6, 0x4, 0x4, 0x4 };
+#define N_NAND_RANGES (sizeof(nand_ranges) / sizeof(NandPadRange))
+
+static void NandKeystream(u8* out, u32 offset, u32 size, u32 keyslot)
+{
+    // CTR from the NAND CID: SHA256 for CTR NAND, reversed SHA1 for TWL NAND (which also sees its blocks reversed)
+    // then counted up to offset, one per 16 byte block
+    bool twl = (offset < 0x0B100000);
+    u8 cid[16];
+    u8 shasum[32];
+    u8 ctr[16];
+    sdmmc_get_cid(1, (uint32_t*) cid);
+    sha_quick(shasum, cid, 16, twl ? SHA1_MODE : SHA256_MODE);
+    for (u32 i = 0; i < 16; i++)
+        ctr[i] = twl ? shasum[15-i] : shasum[i];
+    for (u32 b = 0; b < (offset / 16) + (size / 16); b++) {
+        if (b >= offset / 16) {
+            u8 block[16];
+            u8* dst = out + ((b - (offset / 16)) * 16);
+            soft_aes_encrypt_block(soft_aes_normal_key(keyslot), ctr, block);
+            for (u32 i = 0; i < 16; i++)
+                dst[i] = twl ? block[15-i] : block[i];
+        }
+        for (int i = 15; (i >= 0) && !++ctr[i]; i--);
+    }
+}
+
+static u8* NandRangeSetup(void)
+{
+    // distinct normal keys for the NAND keyslots, then the NAND image and the range list
+    NandPadRanges* ranges = calloc(1, sizeof(NandPadRanges));
+    const u32 keyslots[3] = { 0x3, 0x4, 0x6 };
+    CHECK(ranges);
+    for (u32 i = 0; i < 3; i++) {
+        u8 key[16];
+        HostRandom(key, 16, 0x4E00 + keyslots[i]);
+        setup_aeskey(keyslots[i], key);
+    }
+    u8* nand = FixtureNand(NULL, 0);
+    HostSdCreate(512);
+    ranges->n_entries = N_NAND_RANGES;
+    memcpy(ranges->entries, nand_ranges, sizeof(nand_ranges));
+    HostPut("/nandpad_ranges.bin", ranges, 16 + sizeof(nand_ranges));
+    free(ranges);
+    return nand;
+}
+
+static void WriteHostFile(const char* path, const void* data, size_t size)
+{
+    FILE* fp = fopen(path, "wb");
+    CHECK(fp && (fwrite(data, 1, size, fp) == size));
+    fclose(fp);
+}
+
+static void CheckHostFile(const char* path, const u8* expected, size_t size)
+{
+    u8* data = malloc(size + 1);
+    FILE* fp = fopen(path, "rb");
+    CHECK(data);
+    if (!fp)
+        HostFail("%s not found", path);
+    size_t read = fread(data, 1, size + 1, fp);
+    fclose(fp);
+    CHECK_EQ(read, size);
+    for (u32 i = 0; i < size; i += 0x200) {
+        if (memcmp(data + i, expected + i, min(0x200, size - i)) != 0)
+            HostFail("%s differs at %08X", path, i);
+    }
+    free(data);
+}
+
+static int RunXorpadApply(const char* args, const char* log_path)
+{
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "%s/xorpad_apply %s > %s", HOST_TOOLS, args, log_path);
+    int status = system(cmd);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+HOST_TEST(xorpad_nand_ranges)
+{
+    size_t size;
+    u8* nand = NandRangeSetup();
+    CHECK_EQ(NandRangePadgen(0), 0);
+    u8* pad = HostGet("/nand.ranges.xorpad", &size);
+    CHECK(pad);
+
+    // index: one entry per range, pads 0x200 aligned behind the index, in order
+    NandPadIndex* index = (NandPadIndex*) pad;
+    u64 offset_pad = align(16 + (N_NAND_RANGES * sizeof(NandPadIndexEntry)), 0x200);
+    CHECK(memcmp(index->magic, "NPAD", 4) == 0);
+    CHECK_EQ(index->n_entries, N_NAND_RANGES);
+    for (u32 i = 0; i < N_NAND_RANGES; i++) {
+        NandPadIndexEntry* entry = index->entries + i;
+        CHECK_EQ(entry->offset, nand_ranges[i].offset);
+        CHECK_EQ(entry->size, nand_ranges[i].size);
+        CHECK_EQ(entry->offset_pad, offset_pad);
+        CHECK_EQ(entry->keyslot, nand_range_keyslots[i]);
+        offset_pad = align(offset_pad + entry->size, 0x200);
+    }
+    CHECK_EQ(size, index->entries[N_NAND_RANGES-1].offset_pad + index->entries[N_NAND_RANGES-1].size);
+
+    // pads: same as the reference keystream, XORed with the image they give the known plaintext
+    u8* keystream = malloc(BUFFER_MAX_SIZE + 0x30);
+    CHECK(keystream);
+    for (u32 i = 0; i < N_NAND_RANGES; i++) {
+        NandPadIndexEntry* entry = index->entries + i;
+        NandKeystream(keystream, entry->offset, entry->size, entry->keyslot);
+        if (memcmp(pad + entry->offset_pad, keystream, entry->size) != 0)
+            HostFail("range %08X: pad differs from the reference", entry->offset);
+        for (u32 j = 0; j < entry->size; j++)
+            pad[entry->offset_pad + j] ^= nand[entry->offset + j];
+    }
+    CHECK(memcmp(pad + index->entries[0].offset_pad, "\xE9\x00\x00TWL  ", 8) == 0);
+    CHECK(memcmp(pad + index->entries[2].offset_pad, "FIRM", 4) == 0);
+    CHECK(memcmp(pad + index->entries[4].offset_pad + 0xE, "\x55\xAA", 2) == 0);
+    free(keystream);
+    free(pad);
+
+    // ranges outside of any partition or not 16 byte aligned are refused
+    const NandPadRange bad_ranges[2] = { { 0x160, 0xA0 }, { 0x0B95CA00 + 0x8, 0x10 } };
+    for (u32 i = 0; i < 2; i++) {
+        u32 bad[6] = { 1, 0, 0, 0, bad_ranges[i].offset, bad_ranges[i].size };
+        FileDelete("/nand.ranges.xorpad");
+        HostPut("/nandpad_ranges.bin", bad, sizeof(bad));
+        CHECK(NandRangePadgen(0) != 0);
+        CHECK(!HostExists("/nand.ranges.xorpad"));
+    }
+    free(nand);
+}
+
+HOST_TEST(xorpad_apply_npad)
+{
+    // the pad file applied to a NAND dump by the host tool, only the ranges change
+    char pad_path[128];
+    char nand_path[128];
+    char log_path[128];
+    char args[512];
+    size_t size;
+    u8* nand = NandRangeSetup();
+    CHECK_EQ(NandRangePadgen(0), 0);
+    u8* pad = HostGet("/nand.ranges.xorpad", &size);
+    CHECK(pad);
+    NandPadIndex* index = (NandPadIndex*) pad;
+    snprintf(pad_path, 128, "%s", HostTempPath("nand.ranges.xorpad"));
+    snprintf(nand_path, 128, "%s", HostTempPath("NAND.bin"));
+    snprintf(log_path, 128, "%s", HostTempPath("npad.log"));
+    WriteHostFile(pad_path, pad, size);
+
+    // sparse dump, the image outside the ranges is all zeroes anyways
+    u32 nand_size = align(nand_ranges[N_NAND_RANGES-1].offset + nand_ranges[N_NAND_RANGES-1].size, 0x100000);
+    int fd = open(nand_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK((fd >= 0) && (ftruncate(fd, nand_size) == 0));
+    for (u32 i = 0; i < N_NAND_RANGES; i++)
+        CHECK(pwrite(fd, nand + nand_ranges[i].offset, nand_ranges[i].size, nand_ranges[i].offset) == nand_ranges[i].size);
+    CHECK_EQ(pwrite(fd, "\xAB", 1, 0x0B95CA00 + 0x210), 1);
+
+    snprintf(args, sizeof(args), "-j 4 npad %s %s", pad_path, nand_path);
+    CHECK_EQ(RunXorpadApply(args, log_path), 0);
+    u8* dump = malloc(BUFFER_MAX_SIZE + 0x30);
+    CHECK(dump);
+    for (u32 i = 0; i < N_NAND_RANGES; i++) {
+        NandPadIndexEntry* entry = index->entries + i;
+        CHECK(pread(fd, dump, entry->size, entry->offset) == entry->size);
+        for (u32 j = 0; j < entry->size; j++) {
+            if (dump[j] != (nand[entry->offset + j] ^ pad[entry->offset_pad + j]))
+                HostFail("range %08X: wrong byte at +%X", entry->offset, j);
+        }
+    }
+    CHECK((pread(fd, dump, 1, 0x0B95CA00 + 0x210) == 1) && (dump[0] == 0xAB));
+
+    // no double XOR: a broken index leaves the dump alone
+    memcpy(pad + 0x20, pad + 0x30, 0x10); // second entry same as the third
+    WriteHostFile(pad_path, pad, size);
+    CHECK(RunXorpadApply(args, log_path) != 0);
+    CHECK((pread(fd, dump, 0x10, nand_ranges[2].offset) == 0x10) && (memcmp(dump, "FIRM", 4) == 0));
+    memcpy(pad, "XPAD", 4);
+    WriteHostFile(pad_path, pad, size);
+    CHECK(RunXorpadApply(args, log_path) != 0);
+    close(fd);
+    free(dump);
+    free(pad);
+    free(nand);
+}
+
+#define NCCH_CART_SIZE  (5 * 0x100000)
+
+static u8* EncryptedNcsd(u8* plain)
+{
+    // partition 0: standard crypto, partition 1: seed crypto, plain: decrypted image
+    const u32 part_sizes[2] = { 0x2F1200, 0x54400 };
+    u8 hash_seed[4];
+    u8* ncch = malloc(0x300000);
+    u8* ncsd_image = FixtureCtrCart(NCCH_CART_SIZE, part_sizes, 2, NULL);
+    NcsdHeader* ncsd = (NcsdHeader*) ncsd_image;
+    CHECK(ncch);
+    for (u32 p = 0; p < 2; p++) {
+        u8 crypt[8] = { 0 };
+        u64 tid = ncsd->mediaId | p;
+        u32 offset = ncsd->partitions[p].offset * 0x200;
+        u32 size = FixtureCxi(ncch, (p == 0) ? 0x180000 : 0x20000, tid, 0x2200 + p);
+        if (p == 1) {
+            FixtureSeedDb(tid, hash_seed);
+            memcpy(((NcchHeader*) ncch)->hash_seed, hash_seed, 4);
+            crypt[7] = 0x20;
+        }
+        ncsd->partitions[p].size = size / 0x200;
+        memcpy(plain + offset, ncch, size);
+        FixtureNcchEncrypt(ncch, size, crypt);
+        memcpy(ncsd_image + offset, ncch, size);
+    }
+    for (u32 p = 0; p < 2; p++) { // outside the partitions, both are the same
+        u32 start = (p == 0) ? 0 : (ncsd->partitions[0].offset + ncsd->partitions[0].size) * 0x200;
+        u32 end = (p == 0) ? ncsd->partitions[0].offset * 0x200 : ncsd->partitions[1].offset * 0x200;
+        memcpy(plain + start, ncsd_image + start, end - start);
+    }
+    u32 end = (ncsd->partitions[1].offset + ncsd->partitions[1].size) * 0x200;
+    memcpy(plain + end, ncsd_image + end, NCCH_CART_SIZE - end);
+    free(ncch);
+    return ncsd_image;
+}
+
+HOST_TEST(xorpad_apply_ncch)
+{
+    // ncchinfo.bin from the game folder, NCCH padgen, then the pads applied by the host tool
+    // out of place and in place, the results have to match the plain images byte for byte
+    char in_dir[128];
+    char pad_dir[128];
+    char out_dir[128];
+    char log_path[128];
+    char path[256];
+    char args[768];
+    u8 keyx[16];
+    size_t size;
+    HostSdCreate(512);
+    HostRandom(keyx, 16, 0x2C);
+    setup_aeskeyX(0x2C, keyx);
+    snprintf(in_dir, 128, "%s", HostTempPath("ncch.in"));
+    snprintf(pad_dir, 128, "%s", HostTempPath("ncch.pads"));
+    snprintf(out_dir, 128, "%s", HostTempPath("ncch.out"));
+    snprintf(log_path, 128, "%s", HostTempPath("ncch.log"));
+    CHECK((mkdir(in_dir, 0755) == 0) && (mkdir(pad_dir, 0755) == 0));
+
+    u8* plain_ncsd = malloc(NCCH_CART_SIZE);
+    u8* plain_cxi = malloc(0x100000);
+    u8* cxi = malloc(0x100000);
+    CHECK(plain_ncsd && plain_cxi && cxi);
+    u8* ncsd = EncryptedNcsd(plain_ncsd);
+    u8 crypt[8] = { 0 };
+    u32 size_cxi = FixtureCxi(plain_cxi, 0x40000, 0x0004000000A9A900, 0x2300);
+    memcpy(cxi, plain_cxi, size_cxi);
+    FixtureNcchEncrypt(cxi, size_cxi, crypt);
+    HostPut("/D9Game/game.3ds", ncsd, NCCH_CART_SIZE);
+    HostPut("/D9Game/title.cxi", cxi, size_cxi);
+    snprintf(path, sizeof(path), "%s/game.3ds", in_dir);
+    WriteHostFile(path, ncsd, NCCH_CART_SIZE);
+    snprintf(path, sizeof(path), "%s/title.cxi", in_dir);
+    WriteHostFile(path, cxi, size_cxi);
+
+    // ncchinfo.bin, the same as from ncchinfo_gen, then the pads
+    NcchInfo* info = calloc(1, sizeof(NcchInfo));
+    CHECK(info);
+    CHECK_EQ(NcchInfoGen(info, "/D9Game"), 0);
+    CHECK_EQ(info->n_entries, 3 + 3 + 3 + 1); // ExHeader, ExeFS, RomFS, seed crypto: ExeFS 7x
+    HostPut("/ncchinfo.bin", info, 16 + (info->n_entries * sizeof(NcchInfoEntry)));
+    snprintf(path, sizeof(path), "%s/ncchinfo.bin", in_dir);
+    WriteHostFile(path, info, 16 + (info->n_entries * sizeof(NcchInfoEntry)));
+    CHECK_EQ(NcchPadgen(0), 0);
+    for (u32 i = 0; i < info->n_entries; i++) {
+        u8* pad = HostGet(info->entries[i].filename, &size);
+        if (!pad)
+            HostFail("%s not generated", info->entries[i].filename);
+        snprintf(path, sizeof(path), "%s%s", pad_dir, info->entries[i].filename);
+        WriteHostFile(path, pad, size);
+        free(pad);
+    }
+    free(info);
+
+    snprintf(args, sizeof(args), "-j 4 -p %s -o %s ncch %s/ncchinfo.bin %s/game.3ds %s/title.cxi",
+        pad_dir, out_dir, in_dir, in_dir, in_dir);
+    CHECK_EQ(RunXorpadApply(args, log_path), 0);
+    snprintf(path, sizeof(path), "%s/game.3ds", out_dir);
+    CheckHostFile(path, plain_ncsd, NCCH_CART_SIZE);
+    snprintf(path, sizeof(path), "%s/title.cxi", out_dir);
+    CheckHostFile(path, plain_cxi, size_cxi);
+    snprintf(path, sizeof(path), "%s/title.cxi", in_dir);
+    CheckHostFile(path, cxi, size_cxi);
+
+    snprintf(args, sizeof(args), "-j 1 -p %s ncch %s/ncchinfo.bin %s/game.3ds %s/title.cxi",
+        pad_dir, in_dir, in_dir, in_dir);
+    CHECK_EQ(RunXorpadApply(args, log_path), 0);
+    snprintf(path, sizeof(path), "%s/game.3ds", in_dir);
+    CheckHostFile(path, plain_ncsd, NCCH_CART_SIZE);
+    snprintf(path, sizeof(path), "%s/title.cxi", in_dir);
+    CheckHostFile(path, plain_cxi, size_cxi);
+
+    // a missing pad leaves the file alone
+    snprintf(path, sizeof(path), "%s/title.cxi", in_dir);
+    WriteHostFile(path, cxi, size_cxi);
+    snprintf(path, sizeof(path), "%s/0004000000A9A900.Main.romfs.xorpad", pad_dir);
+    CHECK(unlink(path) == 0);
+    snprintf(args, sizeof(args), "-p %s ncch %s/ncchinfo.bin %s/title.cxi", pad_dir, in_dir, in_dir);
+    CHECK(RunXorpadApply(args, log_path) != 0);
+    snprintf(path, sizeof(path), "%s/title.cxi", in_dir);
+    CheckHostFile(path, cxi, size_cxi);
+
+    free(cxi);
+    free(plain_cxi);
+    free(ncsd);
+    free(plain_ncsd);
+}
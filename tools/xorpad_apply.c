@@ -0,0 +1,726 @@
+// xorpad_apply: applies XORpads generated by Decrypt9 to the encrypted files on PC
+//
+// ncch:   NCSD / NCCH files, pads from ncchinfo.bin padgen, results are checked
+//         against the hashes in the NCCH header (same checks as VerifyNcch())
+// sd:     folder on your SD that contains "dbs", "title", etc., pads from
+//         SDinfo.bin padgen (same folder layout as sdinfo_gen)
+// any:    anypad.bin entries, applied to the given files in entry order
+// npad:   nand.ranges.xorpad from NAND Padgen (ranges / FAT only), applied to a
+//         NAND dump at the offsets in its index (NandPadIndex in xorpad.h)
+//
+// Files and pads are memory mapped, the XOR runs in wide vectors on all cores.
+// Files are processed in place unless an output folder is given with -o.
+
+#define _FILE_OFFSET_BITS 64
+#define _XOPEN_SOURCE 700
+#define _DARWIN_C_SOURCE
+
+#include <errno.h>
+#include <ftw.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "decryptor/game.h"
+#include "decryptor/xorpad.h"
+#include "hostcrypto.h"
+#include "hostio.h"
+
+#define CHUNK_SIZE  (4 * 1024 * 1024)
+#define MAX_JOBS    ((2 * MAX_ENTRIES) + 1) // regions and the gaps between them
+#define MAX_PADS    32
+
+// one region of the target, pad == NULL -> plain copy (out of place only)
+typedef struct {
+    u64 offset;
+    u64 size;
+    const u8* pad;
+} XorJob;
+
+static const char* ncsd_partitions[8] = NCSD_PARTITION_NAMES;
+
+static const char* pad_dir = ".";
+static const char* out_dir = NULL;
+static u32 n_threads = 1;
+
+// current target, jobs are relative to it
+static MapFile target_src;
+static MapFile target_dst;
+static char target_out[1024];
+static XorJob jobs[MAX_JOBS];
+static u32 n_jobs = 0;
+static u64 next_chunk = 0;
+
+static MapFile pads[MAX_PADS];
+static u32 n_pads = 0;
+
+
+static u32 CheckHash(u64 offset, u64 size, const u8* expected)
+{
+    u8 hash[32];
+    if ((offset > target_dst.size) || (size > target_dst.size - offset))
+        return 1;
+    Sha256(hash, target_dst.data + offset, size);
+    return (memcmp(hash, expected, 32) == 0) ? 0 : 1;
+}
+
+
+static void XorBlock(u8* dst, const u8* src, const u8* pad, u64 size)
+{
+    // vector extension, compiles to AVX2 / NEON / SSE2 depending on the target
+    typedef u64 vec64 __attribute__((vector_size(32)));
+    u64 i = 0;
+    for (; i + sizeof(vec64) <= size; i += sizeof(vec64)) {
+        vec64 a, b;
+        memcpy(&a, src + i, sizeof(vec64));
+        memcpy(&b, pad + i, sizeof(vec64));
+        a ^= b;
+        memcpy(dst + i, &a, sizeof(vec64));
+    }
+    for (; i < size; i++)
+        dst[i] = src[i] ^ pad[i];
+}
+
+static void* XorWorker(void* arg)
+{
+    (void) (arg);
+    while (true) {
+        u64 chunk = __atomic_fetch_add(&next_chunk, 1, __ATOMIC_RELAXED);
+        XorJob* job = NULL;
+        for (u32 i = 0; i < n_jobs; i++) {
+            u64 n_chunks = (jobs[i].size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            if (chunk < n_chunks) {
+                job = jobs + i;
+                break;
+            }
+            chunk -= n_chunks;
+        }
+        if (!job)
+            break;
+        u64 pos = chunk * CHUNK_SIZE;
+        u64 size = min((u64) CHUNK_SIZE, job->size - pos);
+        u8* dst = target_dst.data + job->offset + pos;
+        const u8* src = target_src.data + job->offset + pos;
+        if (job->pad)
+            XorBlock(dst, src, job->pad + pos, size);
+        else if (dst != src)
+            memcpy(dst, src, size);
+    }
+    return NULL;
+}
+
+static int CompareJobs(const void* a, const void* b)
+{
+    u64 offset_a = ((const XorJob*) a)->offset;
+    u64 offset_b = ((const XorJob*) b)->offset;
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+static u32 AddJob(u64 offset, u64 size, const MapFile* pad, u64 offset_pad)
+{
+    if ((offset > target_src.size) || (size > target_src.size - offset)) {
+        printf("  Region %08llX (%llu byte) is outside the file\n", (unsigned long long) offset, (unsigned long long) size);
+        return 1;
+    }
+    if ((offset_pad > pad->size) || (size > pad->size - offset_pad)) {
+        printf("  Pad too small!\n");
+        return 1;
+    }
+    if (n_jobs >= MAX_JOBS) {
+        printf("  Too many regions!\n");
+        return 1;
+    }
+    jobs[n_jobs++] = (XorJob) { .offset = offset, .size = size, .pad = pad->data + offset_pad };
+    return 0;
+}
+
+static u32 RunJobs(void)
+{
+    pthread_t threads[64];
+    u32 n_started = 0;
+
+    // out of place: everything not covered by a pad is copied as is
+    if (target_dst.data != target_src.data) {
+        qsort(jobs, n_jobs, sizeof(XorJob), CompareJobs);
+        u64 pos = 0;
+        for (u32 i = 0, n = n_jobs; i <= n; i++) {
+            u64 end = (i < n) ? jobs[i].offset : target_src.size;
+            if (end > pos) {
+                if (n_jobs >= MAX_JOBS) {
+                    printf("  Too many regions!\n");
+                    return 1;
+                }
+                jobs[n_jobs++] = (XorJob) { .offset = pos, .size = end - pos, .pad = NULL };
+            }
+            if (i < n)
+                pos = max(pos, jobs[i].offset + jobs[i].size);
+        }
+    }
+
+    next_chunk = 0;
+    for (; n_started < n_threads - 1; n_started++)
+        if (pthread_create(threads + n_started, NULL, XorWorker, NULL) != 0)
+            break;
+    XorWorker(NULL);
+    for (u32 i = 0; i < n_started; i++)
+        pthread_join(threads[i], NULL);
+    n_jobs = 0;
+
+    return 0;
+}
+
+
+static void CloseTarget(bool discard)
+{
+    // discard: nothing was written, don't leave an empty output file behind
+    if (target_dst.fd != target_src.fd)
+        MapClose(&target_dst);
+    if (discard && *target_out)
+        unlink(target_out);
+    MapClose(&target_src);
+    target_dst = target_src;
+    while (n_pads)
+        MapClose(pads + --n_pads);
+}
+
+static u32 OpenTarget(const char* path, const char* out_path)
+{
+    struct stat st_in, st_out;
+    if (out_path && (stat(path, &st_in) == 0) && (stat(out_path, &st_out) == 0) &&
+        (st_in.st_dev == st_out.st_dev) && (st_in.st_ino == st_out.st_ino))
+        out_path = NULL; // same file, process in place
+    target_out[0] = '\0';
+    if (!out_path) {
+        if (MapOpen(&target_src, path, true) != 0) {
+            MapClose(&target_src);
+            return 1;
+        }
+        target_dst = target_src;
+        return 0;
+    }
+    if ((MapOpen(&target_src, path, false) != 0) || (MakePath(out_path) != 0)) {
+        MapClose(&target_src);
+        return 1;
+    }
+    snprintf(target_out, sizeof(target_out), "%s", out_path);
+    if (MapCreate(&target_dst, out_path, target_src.size) != 0) {
+        CloseTarget(true);
+        return 1;
+    }
+    return 0;
+}
+
+static const MapFile* OpenPad(const char* name)
+{
+    char path[1024];
+    if (n_pads >= MAX_PADS)
+        return NULL;
+    while (*name == '/')
+        name++;
+    snprintf(path, sizeof(path), "%s/%s", pad_dir, name);
+    if (access(path, F_OK) != 0) // caller reports missing pads
+        return NULL;
+    if (MapOpen(pads + n_pads, path, false) != 0) {
+        MapClose(pads + n_pads);
+        return NULL;
+    }
+    return pads + n_pads++;
+}
+
+static const char* GetOutPath(char* out_path, u32 size, const char* name)
+{
+    if (!out_dir)
+        return NULL;
+    char name_copy[1024];
+    snprintf(name_copy, sizeof(name_copy), "%s", name);
+    snprintf(out_path, size, "%s/%s", out_dir, basename(name_copy));
+    return out_path;
+}
+
+
+static u32 LoadInfoFile(void* info, u32 size_max, const char* path)
+{
+    FILE* fp = fopen(path, "rb");
+    u32 size = 0;
+    if (!fp) {
+        printf("Can't open %s\n", path);
+        return 0;
+    }
+    size = fread(info, 1, size_max, fp);
+    fclose(fp);
+    return size;
+}
+
+static u32 LoadNcchInfo(NcchInfo* info, const char* path)
+{
+    u32 size = LoadInfoFile(info, sizeof(NcchInfo), path);
+    if ((size < 16) || !info->n_entries || (info->n_entries > MAX_ENTRIES)) {
+        printf("Bad number of entries in %s\n", path);
+        return 1;
+    }
+    if (info->ncch_info_version == 0xF0000004) { // ncchinfo v4
+        if (size < 16 + (info->n_entries * sizeof(NcchInfoEntry))) {
+            printf("File is missing data: %s\n", path);
+            return 1;
+        }
+    } else if (info->ncch_info_version == 0xF0000003) { // ncchinfo v3
+        // convert ncchinfo v3 entries to ncchinfo v4, last to first
+        if (size < 16 + (info->n_entries * 160)) {
+            printf("File is missing data: %s\n", path);
+            return 1;
+        }
+        for (u32 i = info->n_entries; i > 0; i--) {
+            u8* entry_data = (u8*) (info->entries + i - 1);
+            memmove(entry_data, ((u8*) info) + 16 + (160*(i-1)), 160);
+            memmove(entry_data + 56, entry_data + 48, 112);
+            memset(entry_data + 48, 0x00, 8);
+        }
+    } else { // unknown file / ncchinfo version
+        printf("Incompatible version %s\n", path);
+        return 1;
+    }
+
+    for (u32 i = 0; i < info->n_entries; i++) { // check and fix filenames
+        char* filename = info->entries[i].filename;
+        if (filename[1] == 0x00) { // convert UTF-16 -> UTF-8
+            for (u32 j = 1; j < (112 / 2); j++)
+                filename[j] = filename[j*2];
+        }
+        if (memcmp(filename, "sdmc:", 5) == 0) // fix sdmc: prefix
+            memmove(filename, filename + 5, 112 - 5);
+        filename[111] = '\0';
+    }
+
+    return 0;
+}
+
+static bool NcchInfoHasPad(const NcchInfo* info, const char* name)
+{
+    for (u32 i = 0; i < info->n_entries; i++)
+        if (strncmp(info->entries[i].filename, name, 112) == 0)
+            return true;
+    return false;
+}
+
+static const MapFile* OpenNcchPad(const NcchInfo* info, const char* titleId, const char* partition, const char* section)
+{
+    char name[112];
+    const MapFile* pad;
+    snprintf(name, sizeof(name), "/%s.%s.%s.xorpad", titleId, partition, section);
+    if (!NcchInfoHasPad(info, name)) {
+        printf("  Not in ncchinfo.bin: %s\n", name);
+        return NULL;
+    }
+    if (!(pad = OpenPad(name)))
+        printf("  Missing: %s\n", name);
+    return pad;
+}
+
+static u32 AddNcchJobs(const NcchInfo* info, u64 offset, const char* titleId, const char* partition)
+{
+    NcchHeader ncch;
+    const MapFile* pad_exthdr = NULL;
+    const MapFile* pad_exefs = NULL;
+    const MapFile* pad_exefs_7x = NULL;
+    const MapFile* pad_romfs = NULL;
+
+    if (offset + 0x200 > target_src.size)
+        return 1;
+    memcpy(&ncch, target_src.data + offset, 0x200);
+    if (memcmp(ncch.magic, "NCCH", 4) != 0) {
+        printf("  Not a NCCH!\n");
+        return 1;
+    }
+    if (ncch.flags[7] & 0x04) {
+        printf("  %s: not encrypted\n", partition);
+        return 0;
+    }
+
+    // collect pads first, don't touch the file if anything is missing
+    // the 7x pad only exists under the same conditions as in ncchinfo_gen
+    if ((ncch.size_exthdr > 0) && !(pad_exthdr = OpenNcchPad(info, titleId, partition, "exheader")))
+        return 1;
+    if ((ncch.size_exefs > 0) && !(pad_exefs = OpenNcchPad(info, titleId, partition, "exefs_norm")))
+        return 1;
+    if ((ncch.size_exefs > 0) && (ncch.flags[3] || (ncch.flags[7] == 0x20)) &&
+        !(pad_exefs_7x = OpenNcchPad(info, titleId, partition, "exefs_7x")))
+        return 1;
+    if ((ncch.size_romfs > 0) && !(pad_romfs = OpenNcchPad(info, titleId, partition, "romfs")))
+        return 1;
+    printf("  %s: %.16s\n", partition, ncch.productcode);
+
+    if (pad_exthdr && (AddJob(offset + 0x200, 0x800, pad_exthdr, 0) != 0))
+        return 1;
+    if (pad_exefs_7x) {
+        // ExeFS header, "icon" and "banner" use the standard pad, everything else the 7x one
+        u64 offset_exefs = offset + ((u64) ncch.offset_exefs * 0x200);
+        u8 exefs_hdr[0x200];
+        if ((AddJob(offset_exefs, 0x200, pad_exefs, 0) != 0))
+            return 1;
+        XorBlock(exefs_hdr, target_src.data + offset_exefs, pad_exefs->data, 0x200);
+        for (u32 i = 0; i < 10; i++) {
+            char* name_exefs_file = (char*) exefs_hdr + (i*0x10);
+            u64 offset_exefs_file = (u64) getle32(exefs_hdr + (i*0x10) + 0x8) + 0x200;
+            u64 size_exefs_file = align((u64) getle32(exefs_hdr + (i*0x10) + 0xC), 0x200);
+            if (size_exefs_file == 0)
+                continue;
+            bool is_norm = (strncmp(name_exefs_file, "banner", 8) == 0) || (strncmp(name_exefs_file, "icon", 8) == 0);
+            if (AddJob(offset_exefs + offset_exefs_file, size_exefs_file,
+                is_norm ? pad_exefs : pad_exefs_7x, offset_exefs_file) != 0)
+                return 1;
+        }
+    } else if (pad_exefs && (AddJob(offset + ((u64) ncch.offset_exefs * 0x200),
+        (u64) ncch.size_exefs * 0x200, pad_exefs, 0) != 0)) {
+        return 1;
+    }
+    if (pad_romfs && (AddJob(offset + ((u64) ncch.offset_romfs * 0x200),
+        (u64) ncch.size_romfs * 0x200, pad_romfs, 0) != 0))
+        return 1;
+
+    return 0;
+}
+
+static u32 FinalizeNcch(u64 offset, const char* partition)
+{
+    NcchHeader* ncch = (NcchHeader*) (void*) (target_dst.data + offset);
+    const char* status_str[3] = { "OK", "Fail", "-" };
+    u32 ver_exthdr = 2;
+    u32 ver_exefs = 2;
+    u32 ver_romfs = 2;
+
+    // mark as decrypted
+    if (ncch->flags[7] & 0x04)
+        return 0;
+    ncch->flags[3] = 0x00;
+    ncch->flags[7] = (ncch->flags[7] & ((0x01|0x20)^0xFF)) | 0x04;
+
+    // base hash checks for ExHeader / ExeFS / RomFS
+    if (ncch->size_exthdr > 0)
+        ver_exthdr = CheckHash(offset + 0x200, 0x400, ncch->hash_exthdr);
+    if (ncch->size_exefs_hash > 0)
+        ver_exefs = CheckHash(offset + ((u64) ncch->offset_exefs * 0x200), (u64) ncch->size_exefs_hash * 0x200, ncch->hash_exefs);
+    if (ncch->size_romfs_hash > 0)
+        ver_romfs = CheckHash(offset + ((u64) ncch->offset_romfs * 0x200), (u64) ncch->size_romfs_hash * 0x200, ncch->hash_romfs);
+
+    // thorough exefs verification
+    if ((ncch->size_exefs > 0) && (ver_exefs != 1)) {
+        u64 offset_exefs = offset + ((u64) ncch->offset_exefs * 0x200);
+        u8* exefs = target_dst.data + offset_exefs;
+        if (offset_exefs + 0x200 > target_dst.size)
+            ver_exefs = 1;
+        for (u32 i = 0; (i < 10) && (ver_exefs != 1); i++) {
+            u64 offset_exefs_file = (u64) getle32(exefs + (i*0x10) + 0x8) + 0x200;
+            u32 size_exefs_file = getle32(exefs + (i*0x10) + 0xC);
+            u8* hash_exefs_file = exefs + 0x200 - ((i+1)*0x20);
+            if (size_exefs_file == 0)
+                break;
+            ver_exefs = CheckHash(offset_exefs + offset_exefs_file, size_exefs_file, hash_exefs_file);
+        }
+    }
+
+    printf("  %s verify ExHdr/ExeFS/RomFS: %s/%s/%s\n", partition,
+        status_str[ver_exthdr], status_str[ver_exefs], status_str[ver_romfs]);
+
+    return (((ver_exthdr | ver_exefs | ver_romfs) & 1) == 0) ? 0 : 1;
+}
+
+static u32 ApplyNcchFile(const NcchInfo* info, const char* path)
+{
+    char out_path[1024];
+    u64 offsets[8] = { 0 };
+    bool is_ncch[8] = { false };
+    char titleId[17];
+    u32 result = 0;
+
+    printf("Processing \"%s\":\n", path);
+    if (OpenTarget(path, GetOutPath(out_path, sizeof(out_path), path)) != 0)
+        return 1;
+
+    if ((target_src.size >= 0x200) && (memcmp(target_src.data + 0x100, "NCCH", 4) == 0)) {
+        snprintf(titleId, sizeof(titleId), "%016llX", (unsigned long long) getle64(target_src.data + 0x108));
+        is_ncch[0] = true;
+        result = AddNcchJobs(info, 0, titleId, ncsd_partitions[0]);
+    } else if ((target_src.size >= 0x200) && (memcmp(target_src.data + 0x100, "NCSD", 4) == 0)) {
+        NcsdHeader ncsd;
+        memcpy(&ncsd, target_src.data, 0x200);
+        snprintf(titleId, sizeof(titleId), "%016llX", (unsigned long long) ncsd.mediaId);
+        for (u32 p = 0; (p < 8) && (result == 0); p++) {
+            if (!ncsd.partitions[p].offset)
+                continue;
+            offsets[p] = (u64) ncsd.partitions[p].offset * 0x200;
+            is_ncch[p] = true;
+            result = AddNcchJobs(info, offsets[p], titleId, ncsd_partitions[p]);
+        }
+    } else {
+        printf("  Not a NCSD / NCCH file\n");
+        result = 1;
+    }
+
+    bool written = (result == 0) && (RunJobs() == 0);
+    for (u32 p = 0; (p < 8) && written; p++)
+        if (is_ncch[p] && (FinalizeNcch(offsets[p], ncsd_partitions[p]) != 0))
+            result = 1;
+    if (!written)
+        result = 1;
+    n_jobs = 0;
+    CloseTarget(!written);
+
+    return result;
+}
+
+
+static SdInfo* sd_info = NULL;
+static const char* sd_base = NULL;
+static u32 sd_result = 0;
+static u32 sd_processed = 0;
+
+static int ApplySdEntry(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+    (void) (st);
+    (void) (ftw);
+    char fname[1024];
+    char padname[1024 + 8];
+    char out_path[1024];
+    const MapFile* pad;
+    bool written = false;
+    u32 i;
+
+    if (type != FTW_F)
+        return 0;
+    // "/title/0004.../content/xxx" -> "/title.0004....content.xxx.xorpad"
+    snprintf(fname, sizeof(fname), "%s", path + strlen(sd_base));
+    snprintf(padname, sizeof(padname), "%s.xorpad", fname);
+    for (char* c = padname + 1; *c; c++)
+        if (*c == '/') *c = '.';
+    for (i = 0; i < sd_info->n_entries; i++)
+        if (strncmp(sd_info->entries[i].filename, padname, 180) == 0)
+            break;
+    if (i >= sd_info->n_entries)
+        return 0;
+
+    printf("Processing \"%s\"...\n", fname);
+    if (out_dir)
+        snprintf(out_path, sizeof(out_path), "%s%s", out_dir, fname);
+    if (OpenTarget(path, out_dir ? out_path : NULL) != 0) {
+        sd_result = 1;
+        return 0;
+    }
+    if (!(pad = OpenPad(padname))) {
+        printf("  Missing: %s\n", padname);
+        sd_result = 1;
+    } else if ((AddJob(0, target_src.size, pad, 0) != 0) || (RunJobs() != 0)) {
+        sd_result = 1;
+    } else {
+        sd_processed++;
+        written = true;
+    }
+    n_jobs = 0;
+    CloseTarget(!written);
+
+    return 0;
+}
+
+static u32 ApplySd(const char* sdinfo_path, const char* sd_path)
+{
+    const char* folders[3] = { "dbs", "extdata", "title" };
+    char base[1024];
+    char folder[1024];
+
+    sd_info = calloc(1, sizeof(SdInfo));
+    if (!sd_info)
+        return 1;
+    u32 size = LoadInfoFile(sd_info, sizeof(SdInfo), sdinfo_path);
+    if ((size < 4) || !sd_info->n_entries || (sd_info->n_entries > MAX_ENTRIES) ||
+        (size < 4 + (sd_info->n_entries * sizeof(SdInfoEntry)))) {
+        printf("Corrupt or not existing: %s\n", sdinfo_path);
+        free(sd_info);
+        return 1;
+    }
+    for (u32 i = 0; i < sd_info->n_entries; i++)
+        sd_info->entries[i].filename[179] = '\0';
+
+    snprintf(base, sizeof(base), "%s", sd_path);
+    for (u32 l = strlen(base); (l > 1) && (base[l-1] == '/'); l--)
+        base[l-1] = '\0';
+    sd_base = base;
+    for (u32 i = 0; i < 3; i++) {
+        snprintf(folder, sizeof(folder), "%s/%s", base, folders[i]);
+        if (access(folder, F_OK) == 0)
+            nftw(folder, ApplySdEntry, 16, FTW_PHYS);
+    }
+    printf("%u file(s) processed\n", sd_processed);
+    free(sd_info);
+
+    return sd_result;
+}
+
+static u32 ApplyAny(const char* anypad_path, char** files, u32 n_files)
+{
+    AnyPadInfo* info = calloc(1, sizeof(AnyPadInfo));
+    u32 result = 0;
+
+    if (!info)
+        return 1;
+    u32 size = LoadInfoFile(info, sizeof(AnyPadInfo), anypad_path);
+    if ((size < 16) || !info->n_entries || (info->n_entries > MAX_ENTRIES) ||
+        (size < 16 + (info->n_entries * sizeof(AnyPadInfoEntry)))) {
+        printf("Corrupt or not existing: %s\n", anypad_path);
+        free(info);
+        return 1;
+    }
+    if (n_files > info->n_entries) {
+        printf("More files than entries in %s\n", anypad_path);
+        free(info);
+        return 1;
+    }
+
+    for (u32 i = 0; i < n_files; i++) {
+        AnyPadInfoEntry* entry = info->entries + i;
+        char out_path[1024];
+        const MapFile* pad;
+        bool written = false;
+        entry->filename[47] = '\0';
+        printf("Processing \"%s\" with %s...\n", files[i], entry->filename);
+        if (OpenTarget(files[i], GetOutPath(out_path, sizeof(out_path), files[i])) != 0) {
+            result = 1;
+            continue;
+        }
+        if (!(pad = OpenPad(entry->filename))) {
+            printf("  Missing: %s\n", entry->filename);
+            result = 1;
+        } else if ((AddJob(0, min((u64) entry->size_b, target_src.size), pad, 0) != 0) || (RunJobs() != 0)) {
+            result = 1;
+        } else {
+            written = true;
+        }
+        n_jobs = 0;
+        CloseTarget(!written);
+    }
+    free(info);
+
+    return result;
+}
+
+
+static u32 ApplyNandPad(const char* pad_path, const char* path)
+{
+    char out_path[1024];
+    const NandPadIndex* index;
+    const MapFile* pad = pads;
+    u32 result = 0;
+
+    printf("Processing \"%s\" with %s...\n", path, pad_path);
+    if (OpenTarget(path, GetOutPath(out_path, sizeof(out_path), path)) != 0)
+        return 1;
+    n_pads = 1; // closed along with the target
+    if (MapOpen(pads, pad_path, false) != 0) {
+        CloseTarget(true);
+        return 1;
+    }
+
+    // index at the start of the pad file, the pads follow (each 0x200 aligned)
+    index = (const NandPadIndex*) (const void*) pad->data;
+    u64 size_index = (pad->size >= 16) ? 16 + ((u64) index->n_entries * sizeof(NandPadIndexEntry)) : 0;
+    if ((pad->size < 16) || (memcmp(index->magic, "NPAD", 4) != 0) || !index->n_entries ||
+        (index->n_entries > MAX_ENTRIES) || (pad->size < size_index)) {
+        printf("  Corrupt or not a NAND ranges xorpad: %s\n", pad_path);
+        result = 1;
+    }
+    for (u32 i = 0; (result == 0) && (i < index->n_entries); i++) {
+        const NandPadIndexEntry* entry = index->entries + i;
+        if (entry->offset_pad < size_index) {
+            printf("  Range %08X: pad overlaps the index\n", entry->offset);
+            result = 1;
+        } else {
+            printf("  %08X (%u byte), keyslot 0x%X\n", entry->offset, entry->size, entry->keyslot);
+            result = AddJob(entry->offset, entry->size, pad, entry->offset_pad);
+        }
+    }
+
+    // a range XORed twice would end up encrypted again
+    qsort(jobs, n_jobs, sizeof(XorJob), CompareJobs);
+    for (u32 i = 1; (i < n_jobs) && (result == 0); i++) {
+        if (jobs[i-1].offset + jobs[i-1].size > jobs[i].offset) {
+            printf("  Overlapping ranges at %08llX\n", (unsigned long long) jobs[i].offset);
+            result = 1;
+        }
+    }
+
+    bool written = (result == 0) && (RunJobs() == 0);
+    if (!written)
+        result = 1;
+    n_jobs = 0;
+    CloseTarget(!written);
+
+    return result;
+}
+
+
+static void Usage(void)
+{
+    printf("usage: xorpad_apply [-p paddir] [-o outdir] [-j threads] ncch ncchinfo.bin files..\n");
+    printf("       xorpad_apply [-p paddir] [-o outdir] [-j threads] sd SDinfo.bin folderpath\n");
+    printf("       xorpad_apply [-p paddir] [-o outdir] [-j threads] any anypad.bin files..\n");
+    printf("       xorpad_apply [-o outdir] [-j threads] npad nand.ranges.xorpad NAND.bin\n");
+    printf("  paddir:  folder containing the XORpads (default: current folder)\n");
+    printf("  outdir:  write results to this folder instead of processing in place\n");
+    printf("  threads: number of worker threads (default: all cores)\n");
+    printf("  Example: xorpad_apply -p xorpads -o decrypted ncch ncchinfo.bin *.3ds\n");
+}
+
+int main(int argc, char** argv)
+{
+    long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 result = 0;
+    int opt;
+
+    n_threads = (n_cores > 0) ? (u32) n_cores : 1;
+    while ((opt = getopt(argc, argv, "p:o:j:")) != -1) {
+        if (opt == 'p') {
+            pad_dir = optarg;
+        } else if (opt == 'o') {
+            out_dir = optarg;
+        } else if (opt == 'j') {
+            n_threads = atoi(optarg);
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+    n_threads = min(max(n_threads, 1u), 64u);
+    target_src = target_dst = (MapFile) { .fd = -1 };
+
+    argc -= optind;
+    argv += optind;
+    if ((argc < 3) || ((strcmp(argv[0], "ncch") != 0) && (strcmp(argv[0], "sd") != 0) &&
+        (strcmp(argv[0], "any") != 0) && (strcmp(argv[0], "npad") != 0))) {
+        Usage();
+        return 1;
+    }
+    if (out_dir && (mkdir(out_dir, 0755) != 0) && (errno != EEXIST)) {
+        printf("Can't create %s\n", out_dir);
+        return 1;
+    }
+
+    if (strcmp(argv[0], "ncch") == 0) {
+        NcchInfo* info = calloc(1, sizeof(NcchInfo));
+        if (!info || (LoadNcchInfo(info, argv[1]) != 0)) {
+            result = 1;
+        } else {
+            for (int i = 2; i < argc; i++)
+                if (ApplyNcchFile(info, argv[i]) != 0)
+                    result = 1;
+        }
+        free(info);
+    } else if (strcmp(argv[0], "sd") == 0) {
+        result = ApplySd(argv[1], argv[2]);
+    } else if (strcmp(argv[0], "npad") == 0) {
+        result = ApplyNandPad(argv[1], argv[2]);
+    } else {
+        result = ApplyAny(argv[1], argv + 2, argc - 2);
+    }
+
+    printf((result == 0) ? "Done!\n" : "Done, with errors!\n");
+    return (result == 0) ? 0 : 1;
+}